@@ -45,6 +45,7 @@ BUILD_TYPE ?= Release
 MRI_BREAK_ON_INIT ?= 1
 MRI_UART ?= MRI_UART_MBED_USB
 HEAP_TAGS ?= 0
+HEAP_TRACE ?= 0
 WRITE_BUFFER_DISABLE ?= 0
 STACK_SIZE ?= 0
 
@@ -189,6 +190,11 @@ ifeq "$(HEAP_TAGS)" "1"
 DEFINES += -DHEAP_TAGS
 endif
 
+# Keep the size, call site and module of every live heap allocation for mem -v.
+ifeq "$(HEAP_TRACE)" "1"
+DEFINES += -DHEAP_TRACE
+endif
+
 # Compiler Options
 GCFLAGS += -O$(OPTIMIZATION) -g3 $(DEVICE_CFLAGS)
 GCFLAGS += -ffunction-sections -fdata-sections  -fno-exceptions -fno-delete-null-pointer-checks
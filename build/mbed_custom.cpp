@@ -21,6 +21,7 @@
 #include "mpu.h"
 
 #include "platform_memory.h"
+#include "HeapTrace.h"
 
 unsigned int g_maximumHeapAddress;
 
@@ -363,7 +364,13 @@ extern "C" void *__real_malloc(size_t size);
 extern "C" void *__wrap_malloc(size_t size)
 {
     breakOnHeapOpFromInterruptHandler();
+#ifdef HEAP_TRACE
+    void *p = __real_malloc(size);
+    heap_trace.allocated(p, size, (uint32_t)__builtin_return_address(0));
+    return p;
+#else
     return __real_malloc(size);
+#endif
 }
 
 
@@ -371,7 +378,16 @@ extern "C" void *__real_realloc(void *ptr, size_t size);
 extern "C" void *__wrap_realloc(void *ptr, size_t size)
 {
     breakOnHeapOpFromInterruptHandler();
+#ifdef HEAP_TRACE
+    void *p = __real_realloc(ptr, size);
+    if (p) {
+        heap_trace.freed(ptr);
+        heap_trace.allocated(p, size, (uint32_t)__builtin_return_address(0));
+    }
+    return p;
+#else
     return __real_realloc(ptr, size);
+#endif
 }
 
 
@@ -379,7 +395,33 @@ extern "C" void __real_free(void *ptr);
 extern "C" void __wrap_free(void *ptr)
 {
     breakOnHeapOpFromInterruptHandler();
+#ifdef HEAP_TRACE
+    heap_trace.freed(ptr);
+#endif
     __real_free(ptr);
 }
 
+#ifdef HEAP_TRACE
+/* Charge what new allocates to the caller of new rather than to the library's operator new. */
+static void *newWithSite(size_t size, uint32_t site)
+{
+    breakOnHeapOpFromInterruptHandler();
+    void *p = __real_malloc(size);
+    if (!p)
+        abort();
+    heap_trace.allocated(p, size, site);
+    return p;
+}
+
+void *operator new(size_t size)
+{
+    return newWithSite(size, (uint32_t)__builtin_return_address(0));
+}
+
+void *operator new[](size_t size)
+{
+    return newWithSite(size, (uint32_t)__builtin_return_address(0));
+}
+#endif // HEAP_TRACE
+
 #endif // HEAP_TAGS
@@ -8,16 +8,19 @@
 #include "Adc.h"
 #include "libs/nuts_bolts.h"
 #include "libs/Kernel.h"
+#include "libs/SlowTicker.h"
 #include "libs/Pin.h"
 #include "libs/ADC/adc.h"
 #include "libs/Pin.h"
-#include "libs/Median.h"
+#include "platform_memory.h"
 
 #include <cstring>
-#include <algorithm>
 
 #include "mbed.h"
 
+// 1KHz sample rate, the conversions are shared by the enabled channels
+#define ADC_SAMPLE_RATE 1000
+
 // This is an interface to the mbed.org ADC library you can find in libs/ADC/adc.h
 // TODO : Having the same name is confusing, should change that
 
@@ -33,10 +36,99 @@ Adc::Adc()
     instance = this;
     // ADC sample rate need to be fast enough to be able to read the enabled channels within the thermistor poll time
     // even though ther maybe 32 samples we only need one new one within the polling time
-    const uint32_t sample_rate= 1000; // 1KHz sample rate
+    const uint32_t sample_rate= ADC_SAMPLE_RATE;
     this->adc = new mbed::ADC(sample_rate, 8);
     this->adc->append(sample_isr);
+
+#ifdef OVERSAMPLE
+    memset(ave_buf, 0, sizeof(ave_buf));
+#endif
+
+#ifdef USE_ADC_DMA
+    dma_setup();
+#endif
+}
+
+#ifdef USE_ADC_DMA
+// the GPDMA channel used, the lowest priority one
+#define ADC_DMA_CHANNEL LPC_GPDMACH7
+
+// GPDMA linked list item, it links to itself so the channel refills dma_buffer forever without any CPU involvement
+struct dma_lli_t {
+    uint32_t src;
+    uint32_t dst;
+    uint32_t lli;
+    uint32_t control;
+};
+
+// Every burst conversion sets the global DONE flag which makes a DMA request, the DMA then copies ADGDR (which holds the
+// result and its channel number) into dma_buffer. The buffer and linked list item are in AHB0 which the GPDMA can access
+void Adc::dma_setup()
+{
+    dma_buffer= (uint32_t *)AHB0.alloc(dma_buffer_size * sizeof(uint32_t));
+    dma_lli_t *lli= (dma_lli_t *)AHB0.alloc(sizeof(dma_lli_t));
+    memset(dma_buffer, 0, dma_buffer_size * sizeof(uint32_t));
+    dma_read_index= 0;
+    dma_last_drain= us_ticker_read();
+    dma_overruns= 0;
+
+    // transfer size, 32 bit source and destination, increment destination only, no terminal count interrupt
+    const uint32_t control= dma_buffer_size | (2 << 18) | (2 << 21) | (1 << 27);
+
+    lli->src= (uint32_t)&LPC_ADC->ADGDR;
+    lli->dst= (uint32_t)dma_buffer;
+    lli->lli= (uint32_t)lli;
+    lli->control= control;
+
+    LPC_SC->PCONP |= (1 << 29);     // power up GPDMA
+    LPC_GPDMA->DMACConfig= 1;       // enable, little endian
+    ADC_DMA_CHANNEL->DMACCConfig= 0;
+    LPC_GPDMA->DMACIntTCClear= 1 << 7;
+    LPC_GPDMA->DMACIntErrClr= 1 << 7;
+    ADC_DMA_CHANNEL->DMACCSrcAddr= lli->src;
+    ADC_DMA_CHANNEL->DMACCDestAddr= lli->dst;
+    ADC_DMA_CHANNEL->DMACCLLI= lli->lli;
+    ADC_DMA_CHANNEL->DMACCControl= control;
+    // enable, source peripheral is the ADC (4), peripheral to memory with DMA flow control
+    ADC_DMA_CHANNEL->DMACCConfig= 1 | (4 << 1) | (2 << 11);
+
+    // drained in the timer interrupt often enough that the ring never wraps, rather than when a thermistor happens to be
+    // read, which may be only a few times a second
+    THEKERNEL->slow_ticker->attach(dma_drain_frequency, this, &Adc::dma_drain);
+}
+
+// feed all the results the DMA has written since the last call into the channel filters
+uint32_t Adc::dma_drain(uint32_t)
+{
+    int write_index= (ADC_DMA_CHANNEL->DMACCDestAddr - (uint32_t)dma_buffer) / sizeof(uint32_t);
+    if(write_index >= dma_buffer_size) write_index= 0;
+
+    // the indexes can not tell a full lap from none, so go by the conversions there have been time for. If the drain
+    // was held off that long the whole ring is the newest results, so filter all of it starting at the oldest
+    uint32_t now= us_ticker_read();
+    uint32_t conversions= (uint64_t)(now - dma_last_drain) * ADC_SAMPLE_RATE / 1000000;
+    dma_last_drain= now;
+    if(conversions >= dma_buffer_size - 1) {
+        ++dma_overruns;
+        for (int i = 0; i < dma_buffer_size; ++i) {
+            uint32_t v= dma_buffer[(write_index + i) % dma_buffer_size];
+            if(v & 0x80000000) new_sample((v >> 24) & 0x07, v);
+        }
+        dma_read_index= write_index;
+        return 0;
+    }
+
+    while(dma_read_index != write_index) {
+        uint32_t v= dma_buffer[dma_read_index];
+        // only results that were DONE when read, the channel number is in bits 24-26
+        if(v & 0x80000000) {
+            new_sample((v >> 24) & 0x07, v);
+        }
+        if(++dma_read_index >= dma_buffer_size) dma_read_index= 0;
+    }
+    return 0;
 }
+#endif
 
 /*
 LPC176x ADC channels and pins
@@ -57,21 +149,25 @@ void Adc::enable_pin(Pin *pin)
 {
     PinName pin_name = this->_pin_to_pinname(pin);
     int channel = adc->_pin_to_channel(pin_name);
-    memset(sample_buffers[channel], 0, sizeof(sample_buffers[0]));
+    filters[channel].reset(0);
 
     this->adc->burst(1);
     this->adc->setup(pin_name, 1);
+#ifdef USE_ADC_DMA
+    // only the global DONE flag requests DMA, the ADC interrupt itself is not used
+    LPC_ADC->ADINTEN = 0x100;
+    NVIC_DisableIRQ(ADC_IRQn);
+#else
     this->adc->interrupt_state(pin_name, 1);
+#endif
 }
 
-// Keeps the last 8 values for each channel
-// This is called in an ISR, so sample_buffers needs to be accessed atomically
+// Adds the new value to the filter for the channel, which keeps the last num_samples values
+// This is called in the ADC ISR, or the SlowTicker ISR when using DMA, the filter sum is a single word so read gets a consistent value
 void Adc::new_sample(int chan, uint32_t value)
 {
-    // Shuffle down and add new value to the end
     if(chan < num_channels) {
-        memmove(&sample_buffers[chan][0], &sample_buffers[chan][1], sizeof(sample_buffers[0]) - sizeof(sample_buffers[0][0]));
-        sample_buffers[chan][num_samples - 1] = (value >> 4) & 0xFFF; // the 12 bit ADC reading
+        filters[chan].push((value >> 4) & 0xFFF); // the 12 bit ADC reading
     }
 }
 
@@ -82,26 +178,15 @@ unsigned int Adc::read(Pin *pin)
     PinName p = this->_pin_to_pinname(pin);
     int channel = adc->_pin_to_channel(p);
 
-    uint16_t median_buffer[num_samples];
-    // needs atomic access TODO maybe be able to use std::atomic here or some lockless mutex
-    __disable_irq();
-    memcpy(median_buffer, sample_buffers[channel], sizeof(median_buffer));
-    __enable_irq();
-
 #ifdef USE_MEDIAN_FILTER
-    // returns the median value of the last 8 samples
-    return median_buffer[quick_median(median_buffer, num_samples)];
+    // returns the median value of the last num_samples samples
+    return filters[channel].median();
 
 #elif defined(OVERSAMPLE)
     // Oversample to get 2 extra bits of resolution
     // weed out top and bottom worst values then oversample the rest
     // put into a 4 element moving average and return the average of the last 4 oversampled readings
-    static uint16_t ave_buf[num_channels][4] =  { {0} };
-    std::sort(median_buffer, median_buffer + num_samples);
-    uint32_t sum = 0;
-    for (int i = num_samples / 4; i < (num_samples - (num_samples / 4)); ++i) {
-        sum += median_buffer[i];
-    }
+    uint32_t sum = filters[channel].trimmed_sum();
     // this slows down the rate of change a little bit
     ave_buf[channel][3]= ave_buf[channel][2];
     ave_buf[channel][2]= ave_buf[channel][1];
@@ -110,13 +195,8 @@ unsigned int Adc::read(Pin *pin)
     return roundf((ave_buf[channel][0]+ave_buf[channel][1]+ave_buf[channel][2]+ave_buf[channel][3])/4.0F);
 
 #else
-    // sort the 8 readings and return the average of the middle 4
-    std::sort(median_buffer, median_buffer + num_samples);
-    int sum = 0;
-    for (int i = num_samples / 4; i < (num_samples - (num_samples / 4)); ++i) {
-        sum += median_buffer[i];
-    }
-    return sum / (num_samples / 2);
+    // return the average of the middle 4 of the 8 readings
+    return filters[channel].trimmed_sum() / (num_samples / 2);
 
 #endif
 }
@@ -11,6 +11,7 @@
 #define ADC_H
 
 #include "PinNames.h" // mbed.h lib
+#include "SlidingTrimmedMean.h"
 
 #include <cmath>
 
@@ -23,6 +24,9 @@ namespace mbed {
 // 2 bits means the 12bit ADC is 14 bits of resolution
 #define OVERSAMPLE 2
 
+// define to have the burst conversions written to a ring buffer by GPDMA instead of taking an interrupt per conversion
+#define USE_ADC_DMA
+
 class Adc
 {
 public:
@@ -50,8 +54,30 @@ private:
 #else
     static const int num_samples= 8;
 #endif
-    // buffers storing the last num_samples readings for each channel
-    uint16_t sample_buffers[num_channels][num_samples];
+    // filters over the last num_samples readings for each channel
+    SlidingTrimmedMean<num_samples> filters[num_channels];
+#ifdef OVERSAMPLE
+    uint16_t ave_buf[num_channels][4];
+#endif
+
+#ifdef USE_ADC_DMA
+public:
+    // times the DMA wrote over results before they were filtered
+    uint32_t get_dma_overruns() const { return dma_overruns; }
+
+private:
+    void dma_setup();
+    uint32_t dma_drain(uint32_t);
+
+    // ADGDR results written by GPDMA for all the channels, which is 128ms of conversions at the 1KHz sample rate, and
+    // the index of the next one to be filtered
+    static const int dma_buffer_size= 128;
+    static const uint32_t dma_drain_frequency= 20;
+    uint32_t *dma_buffer;
+    int dma_read_index;
+    uint32_t dma_last_drain;
+    uint32_t dma_overruns;
+#endif
 };
 
 #endif
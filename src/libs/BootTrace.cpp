@@ -0,0 +1,84 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BootTrace.h"
+#include "StreamOutput.h"
+
+BootTrace boot_trace;
+
+void BootTrace::end_stage(uint32_t now)
+{
+    if(current >= 0) records[current].us = now - stage_start;
+    current = -1;
+}
+
+void BootTrace::stage(const char *name, uint32_t now)
+{
+    if(done) return;
+    if(n == 0 && current < 0) start = now;
+
+    // when it is full the time goes to the last stage
+    if(n == MAX_RECORDS) return;
+    end_stage(now);
+    current = n++;
+    records[current].name = name;
+    records[current].us = 0;
+    records[current].loaded_us = 0;
+    records[current].is_step = 0;
+    stage_start = now;
+}
+
+void BootTrace::step(const char *name, uint32_t us)
+{
+    if(done || n == MAX_RECORDS) return;
+    records[n].name = name;
+    records[n].us = us;
+    records[n].loaded_us = 0;
+    records[n].is_step = 1;
+    ++n;
+}
+
+void BootTrace::loaded(uint32_t us)
+{
+    if(done || current < 0) return;
+    records[current].loaded_us += us;
+}
+
+void BootTrace::finish(uint32_t now)
+{
+    if(done) return;
+    end_stage(now);
+    total = now - start;
+    done = true;
+}
+
+void BootTrace::summary(StreamOutput *stream) const
+{
+    int longest = -1;
+    for (int i = 0; i < n; ++i) {
+        if(!records[i].is_step && (longest < 0 || records[i].us > records[longest].us)) longest = i;
+    }
+    if(longest < 0) return;
+    stream->printf("Boot took %lu ms, the longest was %s at %lu ms, boot shows each stage\n",
+                   (unsigned long)total / 1000, records[longest].name, (unsigned long)records[longest].us / 1000);
+}
+
+void BootTrace::dump(StreamOutput *stream) const
+{
+    for (int i = 0; i < n; ++i) {
+        const record_t &r = records[i];
+        if(r.is_step) {
+            stream->printf("    %-22s %6lu us\n", r.name, (unsigned long)r.us);
+        } else if(r.loaded_us > 0) {
+            stream->printf("  %-24s %6lu us, %lu us of it in on_module_loaded\n", r.name, (unsigned long)r.us, (unsigned long)r.loaded_us);
+        } else {
+            stream->printf("  %-24s %6lu us\n", r.name, (unsigned long)r.us);
+        }
+    }
+    if(done) stream->printf("Boot took %lu us\n", (unsigned long)total);
+    else stream->printf("Boot is not finished\n");
+}
@@ -0,0 +1,71 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BOOTTRACE_H
+#define BOOTTRACE_H
+
+#include "HeapTrace.h"
+
+#include <stdint.h>
+
+class StreamOutput;
+
+// Times the stages of init(), which are mostly the modules being made and loaded, and the steps within them such as
+// reading each config source. The time of a stage that went to on_module_loaded is kept apart from the constructor.
+// Names must be string constants. Times are given by the caller in us so this has no dependency on the ticker, once
+// boot is finished nothing more is recorded
+class BootTrace
+{
+    public:
+        BootTrace() : n(0), current(-1), start(0), stage_start(0), total(0), done(false) {}
+
+        // ends the stage before
+        void stage(const char *name, uint32_t now);
+        // part of the current stage that took us
+        void step(const char *name, uint32_t us);
+        // time the current stage spent in on_module_loaded
+        void loaded(uint32_t us);
+        void finish(uint32_t now);
+
+        struct record_t {
+            const char *name;
+            uint32_t us;
+            uint32_t loaded_us:24;
+            uint32_t is_step:1;
+        };
+
+        bool is_done() const { return done; }
+        uint32_t get_total() const { return total; }
+        int get_records() const { return n; }
+        const record_t &get_record(int i) const { return records[i]; }
+
+        // one line for the console, and all the stages and steps for the boot command
+        void summary(StreamOutput *stream) const;
+        void dump(StreamOutput *stream) const;
+
+    private:
+        static const int MAX_RECORDS = 40;
+
+        void end_stage(uint32_t now);
+
+        record_t records[MAX_RECORDS];
+        int n;
+        int current;
+        uint32_t start;
+        uint32_t stage_start;
+        uint32_t total;
+        bool done;
+};
+
+extern BootTrace boot_trace;
+
+// starts the next stage of boot, which is a module, and charges the heap it allocates to it when HEAP_TRACE is on
+#define BOOT_STAGE(name) BOOT_STAGE_AS(name, name)
+// a stage that is not a module charges its heap to tag, nullptr for other, so it does not take one of the heap tags
+#define BOOT_STAGE_AS(name, tag) do { boot_trace.stage(name, us_ticker_read()); HEAP_TRACE_TAG(tag); } while (0)
+
+#endif
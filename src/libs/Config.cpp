@@ -8,6 +8,7 @@
 using namespace std;
 #include <vector>
 #include <string>
+#include <string.h>
 
 #include "libs/Kernel.h"
 #include "Config.h"
@@ -20,12 +21,20 @@ using namespace std;
 #include "libs/ConfigSources/FileConfigSource.h"
 #include "libs/ConfigSources/FirmConfigSource.h"
 #include "StreamOutputPool.h"
+#include "md5.h"
+#include "BootTrace.h"
+
+#include "mbed.h" // for us_ticker_read()
+#include <stdio.h>
+
+#define config_image_enable_checksum CHECKSUM("config_image_enable")
 
 // Add various config sources. Config can be fetched from several places.
 // All values are read into a cache, that is then used by modules to read their configuration
 Config::Config()
 {
     this->config_cache = NULL;
+    this->booted = false;
 
     // Config source for firm config found in src/config.default
     this->config_sources.push_back( new FirmConfigSource("firm") );
@@ -44,13 +53,17 @@ Config::Config()
         fcs = new FileConfigSource("/sd/config", "sd");
     else if( file_exists("/sd/config.txt") )
         fcs = new FileConfigSource("/sd/config.txt", "sd");
-    if( fcs != NULL )
+    if( fcs != NULL ) {
         this->config_sources.push_back( fcs );
+        // the cache is kept on the sd card as an image for the next boot
+        this->image_file = "/sd/config.bin";
+    }
 }
 
 Config::Config(ConfigSource *cs)
 {
     this->config_cache = NULL;
+    this->booted = false;
     this->config_sources.push_back( cs );
 }
 
@@ -68,6 +81,11 @@ void Config::get_module_list(vector<uint16_t> *list, uint16_t family)
     this->config_cache->collect(family, CHECKSUM("enable"), list);
 }
 
+int Config::pin_users(int port, int pin)
+{
+    return this->config_cache != NULL ? this->config_cache->count_pin(port, pin) : 0;
+}
+
 // Command to load config cache into buffer for multiple reads during init
 void Config::config_cache_load(bool parse)
 {
@@ -75,11 +93,61 @@ void Config::config_cache_load(bool parse)
     this->config_cache_clear();
 
     this->config_cache= new ConfigCache;
-    if(parse) {
-        // For each ConfigSource in our stack
-        for( ConfigSource *source : this->config_sources ) {
-            source->transfer_values_to_cache(this->config_cache);
-        }
+    if(!parse) return;
+
+    // An image made from the same sources is read instead of parsing them
+    uint8_t digest[16];
+    uint32_t t = us_ticker_read();
+    if(!this->image_file.empty() && source_digest(digest) && this->config_cache->load_image(this->image_file.c_str(), digest)) {
+        boot_trace.step("config image", us_ticker_read() - t);
+        this->booted = true;
+        return;
+    }
+
+    // For each ConfigSource in our stack
+    for( ConfigSource *source : this->config_sources ) {
+        t = us_ticker_read();
+        source->transfer_values_to_cache(this->config_cache);
+        boot_trace.step(source->get_name(), us_ticker_read() - t);
+    }
+    t = us_ticker_read();
+    this->config_cache->build_index();
+    boot_trace.step("config index", us_ticker_read() - t);
+
+    if(!this->image_file.empty() && !this->booted) {
+        t = us_ticker_read();
+        save_config_image();
+        boot_trace.step("config image saved", us_ticker_read() - t);
+    }
+    this->booted = true;
+}
+
+// The MD5 of everything the config sources read and of the firmware build, false if any of them can not be imaged
+bool Config::source_digest(uint8_t *digest)
+{
+    MD5 md5;
+#ifdef __GITVERSIONSTRING__
+    md5.update(__GITVERSIONSTRING__, sizeof(__GITVERSIONSTRING__));
+#endif
+    for( ConfigSource *source : this->config_sources ) {
+        if(!source->add_to_digest(md5)) return false;
+    }
+    md5.finalize().bindigest(digest, 16);
+    return true;
+}
+
+// Saves the cache just parsed for the next boot, an old image is removed if it can not be replaced
+void Config::save_config_image()
+{
+    uint8_t digest[16];
+    if(!this->value(config_image_enable_checksum)->by_default(true)->as_bool() || !source_digest(digest)) {
+        remove(this->image_file.c_str());
+        return;
+    }
+
+    this->config_cache->parse_values();
+    if(!this->config_cache->save_image(this->image_file.c_str(), digest)) {
+        printf("WARNING: could not save the config image %s\n", this->image_file.c_str());
     }
 }
 
@@ -100,11 +168,12 @@ ConfigValue *Config::value(uint16_t check_sum_a, uint16_t check_sum_b, uint16_t
     return this->value(check_sums);
 }
 
-static ConfigValue dummyValue;
+static ConfigValue configValue;
 
 // Get a value from the configuration as a string
 // Because we don't like to waste space in Flash with lengthy config parameter names, we take a checksum instead so that the name does not have to be stored
 // See get_checksum
+// The value returned is shared, it is only valid until the next call
 ConfigValue *Config::value(uint16_t check_sums[])
 {
     if( !is_config_cache_loaded() ) {
@@ -113,18 +182,9 @@ ConfigValue *Config::value(uint16_t check_sums[])
         return NULL;
     }
 
-    ConfigValue *result = this->config_cache->lookup(check_sums);
-
-    if(result == NULL) {
-        // create a dummy value for this to play with, each call requires it's own value not a shared one
-        // result= new ConfigValue(check_sums);
-        // config_cache->add(result);
-        dummyValue.clear();
-        result = &dummyValue;
-    }
+    configValue.clear();
+    memcpy(configValue.check_sums, check_sums, sizeof(configValue.check_sums));
+    this->config_cache->lookup(check_sums, configValue);
 
-    return result;
+    return &configValue;
 }
-
-
-
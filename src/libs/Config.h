@@ -31,15 +31,21 @@ class Config  {
         ConfigValue* value(uint16_t check_sums[3] );
 
         void get_module_list(vector<uint16_t>* list, uint16_t family);
+        // the number of settings that name the pin, so a module can tell if it is used by another, 0 once the cache is cleared
+        int pin_users(int port, int pin);
         bool is_config_cache_loaded() { return config_cache != NULL; };    // Whether or not the cache is currently popluated
 
         friend class  Configurator;
 
     private:
         bool   has_characters(uint16_t check_sum, string str );
+        bool   source_digest(uint8_t *digest);
+        void   save_config_image();
 
         ConfigCache* config_cache;            // A cache in which ConfigValues are kept
         vector<ConfigSource*> config_sources; // A list of all possible coniguration sources
+        string image_file;                    // Where the cache is saved as an image for the next boot, empty for none
+        bool   booted;                        // The sd card may be mounted over USB after boot so the image is only written before
 };
 
 #endif
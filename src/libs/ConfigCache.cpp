@@ -3,6 +3,17 @@
 
 #include "libs/StreamOutput.h"
 
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// marks a line replaced by a later one, arena offsets are always less
+#define REPLACED 0xFFFF
+
+// "SCI1", bump when the image layout changes
+#define IMAGE_MAGIC 0x31494353
+
 ConfigCache::ConfigCache()
 {
 }
@@ -14,70 +25,225 @@ ConfigCache::~ConfigCache()
 
 void ConfigCache::clear()
 {
-    for (auto &kv : store)  {
-        delete kv;
-    }
-    store.clear();
-    storage_t().swap(store);   //  makes sure the vector releases its memory
+    //  makes sure the vectors release their memory
+    vector<line_t>().swap(lines);
+    vector<uint16_t>().swap(index);
+    vector<char>().swap(arena);
+    vector<parsed_t>().swap(parsed);
 }
 
-void ConfigCache::add(ConfigValue *v)
+void ConfigCache::add(const uint16_t *check_sums, const string& value)
 {
-    store.push_back(v);
+    if(lines.size() >= REPLACED || arena.size() + value.size() + 1 >= REPLACED) {
+        printf("ERROR: config too large, line ignored\n");
+        return;
+    }
+
+    line_t l;
+    memcpy(l.check_sums, check_sums, sizeof(l.check_sums));
+    l.value = arena.size();
+    lines.push_back(l);
+    arena.insert(arena.end(), value.begin(), value.end());
+    arena.push_back('\0');
 }
 
 void ConfigCache::pop()
 {
-    auto cv= store.back();
-    store.pop_back();
-    delete cv;
+    arena.resize(lines.back().value);
+    lines.pop_back();
+}
+
+int ConfigCache::compare(const uint16_t *check_sums, uint16_t i) const
+{
+    const uint16_t *cs = lines[i].check_sums;
+    for (int k = 0; k < 3; ++k) {
+        if(check_sums[k] != cs[k]) return check_sums[k] < cs[k] ? -1 : 1;
+    }
+    return 0;
+}
+
+bool ConfigCache::less(uint16_t a, uint16_t b) const
+{
+    return compare(lines[a].check_sums, b) < 0;
+}
+
+void ConfigCache::build_index()
+{
+    index.resize(lines.size());
+    for (size_t i = 0; i < index.size(); ++i) index[i] = i;
+
+    // stable so the lines of a setting stay in the order they were read
+    std::stable_sort(index.begin(), index.end(), [this](uint16_t a, uint16_t b) { return less(a, b); });
+
+    // The first line of a setting takes the value of the last one, which is what replacing it in place used to do
+    bool replaced = false;
+    for (size_t first = 0, i = 1; i < index.size(); ++i) {
+        if(compare(lines[index[first]].check_sums, index[i]) != 0) {
+            first = i;
+            continue;
+        }
+        lines[index[first]].value = lines[index[i]].value;
+        lines[index[i]].value = REPLACED;
+        replaced = true;
+        printf("WARNING: duplicate config line replaced\n");
+    }
+
+    if(replaced) {
+        lines.erase(std::remove_if(lines.begin(), lines.end(), [](const line_t& l) { return l.value == REPLACED; }), lines.end());
+        build_index();
+        return;
+    }
+
+    lines.shrink_to_fit();
+    index.shrink_to_fit();
+    arena.shrink_to_fit();
 }
 
-// If we find an existing value, replace it, otherwise, push it at the back of the list
-void ConfigCache::replace_or_push_back(ConfigValue *new_value)
+bool ConfigCache::lookup(const uint16_t *check_sums, ConfigValue &result) const
 {
-    // For each already existing element
-    for(auto &cv : store) {
-        // If this configvalue matches the checksum
-        if(memcmp(new_value->check_sums, cv->check_sums, sizeof(cv->check_sums)) == 0) {
-            // Replace with the provided value
-            delete cv; // free up old one
-            cv =  new_value;
-            printf("WARNING: duplicate config line replaced\n");
-            return;
+    int lo = 0, hi = index.size();
+    while(lo < hi) {
+        int mid = (lo + hi) / 2;
+        int c = compare(check_sums, index[mid]);
+        if(c < 0) {
+            hi = mid;
+        } else if(c > 0) {
+            lo = mid + 1;
+        } else {
+            uint16_t i = index[mid];
+            result.found = true;
+            result.value.assign(&arena[lines[i].value]);
+            if(!parsed.empty()) {
+                result.number = parsed[i].number;
+                result.integer = parsed[i].integer;
+                result.parsed = parsed[i].flags;
+            }
+            return true;
         }
     }
 
-    // Value does not already exists, add to the list
-    store.push_back(new_value);
+    return false;
+}
+
+void ConfigCache::parse_values()
+{
+    ConfigValue v;
+    parsed.resize(lines.size());
+    for (size_t i = 0; i < lines.size(); ++i) {
+        v.value.assign(&arena[lines[i].value]);
+        parsed_t &p = parsed[i];
+        int n;
+        p.flags = ConfigValue::PARSED_BOOL;
+        if(v.parse_bool()) p.flags |= ConfigValue::PARSED_TRUE;
+        if(v.parse_number(p.number)) p.flags |= ConfigValue::PARSED_NUMBER;
+        if(v.parse_int(n)) p.flags |= ConfigValue::PARSED_INT;
+        p.integer = n;
+    }
+}
+
+bool ConfigCache::save_image(const char *file, const uint8_t *digest) const
+{
+    if(parsed.size() != lines.size()) return false;
+
+    image_header_t h;
+    h.magic = IMAGE_MAGIC;
+    memcpy(h.digest, digest, sizeof(h.digest));
+    h.lines = lines.size();
+    h.arena = arena.size();
+    h.line_size = sizeof(line_t);
+    h.parsed_size = sizeof(parsed_t);
+
+    FILE *fp = fopen(file, "w");
+    if(fp == NULL) return false;
+
+    bool ok = fwrite(&h, sizeof(h), 1, fp) == 1 &&
+              fwrite(lines.data(), sizeof(line_t), lines.size(), fp) == lines.size() &&
+              fwrite(index.data(), sizeof(uint16_t), index.size(), fp) == index.size() &&
+              fwrite(parsed.data(), sizeof(parsed_t), parsed.size(), fp) == parsed.size() &&
+              fwrite(arena.data(), 1, arena.size(), fp) == arena.size();
+    if(fclose(fp) != 0) ok = false;
+
+    // a partial image would just fail its checks next boot, but don't leave it around
+    if(!ok) remove(file);
+    return ok;
 }
 
-ConfigValue *ConfigCache::lookup(const uint16_t *check_sums) const
+// Each part of the image is read straight into the vector it is kept in, there is nothing to parse
+bool ConfigCache::load_image(const char *file, const uint8_t *digest)
 {
-    for( auto &cv : store) {
-        if(memcmp(check_sums, cv->check_sums, sizeof(cv->check_sums)) == 0)
-            return cv;
+    FILE *fp = fopen(file, "r");
+    if(fp == NULL) return false;
+
+    image_header_t h;
+    bool ok = fread(&h, sizeof(h), 1, fp) == 1 && h.magic == IMAGE_MAGIC && memcmp(h.digest, digest, sizeof(h.digest)) == 0 &&
+              h.line_size == sizeof(line_t) && h.parsed_size == sizeof(parsed_t);
+    if(ok) {
+        clear();
+        lines.resize(h.lines);
+        index.resize(h.lines);
+        parsed.resize(h.lines);
+        arena.resize(h.arena);
+        ok = fread(lines.data(), sizeof(line_t), h.lines, fp) == h.lines &&
+             fread(index.data(), sizeof(uint16_t), h.lines, fp) == h.lines &&
+             fread(parsed.data(), sizeof(parsed_t), h.lines, fp) == h.lines &&
+             fread(arena.data(), 1, h.arena, fp) == h.arena;
+    }
+    fclose(fp);
+
+    if(!ok) {
+        clear();
+        return false;
+    }
+
+    // don't trust what was read to index the arena
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if(lines[i].value >= arena.size() || index[i] >= lines.size()) {
+            clear();
+            return false;
+        }
+    }
+    if(!arena.empty() && arena.back() != '\0') {
+        clear();
+        return false;
     }
 
-    return NULL;
+    return true;
 }
 
 void ConfigCache::collect(uint16_t family, uint16_t cs, vector<uint16_t> *list)
 {
-    for( auto &kv : store ) {
-        if( kv->check_sums[2] == cs && kv->check_sums[0] == family ) {
+    for( auto &l : lines ) {
+        if( l.check_sums[2] == cs && l.check_sums[0] == family ) {
             // We found a module enable for this family, add it's number
-            list->push_back(kv->check_sums[1]);
+            list->push_back(l.check_sums[1]);
         }
     }
 }
 
+// the pin modifiers as Pin::from_string reads them
+static bool is_pin_value(const char *v, int port, int pin)
+{
+    char *end;
+    if(strtol(v, &end, 10) != port || end == v || *end != '.') return false;
+    v = end + 1;
+    if(strtol(v, &end, 10) != pin || end == v) return false;
+    return end[strspn(end, "!o^v-@ \t")] == '\0';
+}
+
+int ConfigCache::count_pin(int port, int pin) const
+{
+    int n = 0;
+    for( auto &l : lines ) {
+        if( is_pin_value(&arena[l.value], port, pin) ) ++n;
+    }
+    return n;
+}
+
 void ConfigCache::dump(StreamOutput *stream)
 {
-    int l = 1;
-    for( auto &kv : store ) {
-        ConfigValue *v = kv;
-        stream->printf("%3d - %04X %04X %04X : '%s' - found: %d, default: %d, default-double: %f, default-int: %d\n",
-                       l++, v->check_sums[0], v->check_sums[1], v->check_sums[2], v->value.c_str(), v->found, v->default_set, v->default_double, v->default_int );
+    int n = 1;
+    for( auto &l : lines ) {
+        stream->printf("%3d - %04X %04X %04X : '%s'\n", n++, l.check_sums[0], l.check_sums[1], l.check_sums[2], &arena[l.value]);
     }
+    stream->printf("%d lines, %d bytes of values\n", (int)lines.size(), (int)arena.size());
 }
@@ -11,37 +11,76 @@
 using namespace std;
 #include <vector>
 #include <stdint.h>
+#include <string>
 #include <map>
 
-class ConfigValue;
 class StreamOutput;
+class ConfigValue;
 
+// Holds the config lines read from all the ConfigSources while the modules load.
+// The values are kept in one flat arena and the lines in the order they were read, with an index sorted on the three
+// checksums so lookups are a binary search. Lines are only appended while the sources are read, build_index() must be
+// called before the first lookup, it also drops the lines that are replaced by a later line with the same checksums.
+// Once indexed the cache can be saved as an image with the numbers and bools already parsed, which is read back in one
+// go on the next boot if the digest of the sources it was made from still matches
 class ConfigCache {
     public:
         ConfigCache();
         ~ConfigCache();
         void clear();
 
-        void add(ConfigValue* v);
+        // append a line, remove the last one appended
+        void add(const uint16_t *check_sums, const string& value);
         void pop();
 
-        // lookup and return the entru that matches the check sums,return NULL if not found
-        ConfigValue *lookup(const uint16_t *check_sums) const;
+        // sorts the index, the last value read of a setting replaces the earlier ones but keeps their place
+        void build_index();
+
+        // lookup the value that matches the check sums into result, return false if not found
+        bool lookup(const uint16_t *check_sums, ConfigValue &result) const;
+
+        // parses the numbers and bools of all the values, so they are kept in the image
+        void parse_values();
+
+        bool save_image(const char *file, const uint8_t *digest) const;
+        bool load_image(const char *file, const uint8_t *digest);
 
-        // collect enabled checksums of the given family
+        // collect enabled checksums of the given family, in the order they were read
         void collect(uint16_t family, uint16_t cs, vector<uint16_t> *list);
 
-        // If we find an existing value, replace it, otherwise, push it at the back of the list
-        void replace_or_push_back(ConfigValue* new_value);
+        // the number of settings whose value is the pin port.pin, with or without modifiers
+        int count_pin(int port, int pin) const;
+
+        size_t size() const { return lines.size(); }
 
         // used for debugging, dumps the cache to a stream
         void dump(StreamOutput *stream);
 
     private:
-        typedef vector<ConfigValue*> storage_t;
-        storage_t store;
-};
-
+        struct line_t {
+            uint16_t check_sums[3];
+            uint16_t value;         // offset of the value in the arena
+        };
+        struct parsed_t {
+            float number;
+            int32_t integer;
+            uint8_t flags;          // ConfigValue::PARSED
+        };
+        struct image_header_t {
+            uint32_t magic;
+            uint8_t digest[16];
+            uint16_t lines;
+            uint16_t arena;
+            uint16_t line_size;     // so an image from a build with another layout is not used
+            uint16_t parsed_size;
+        };
+        bool less(uint16_t a, uint16_t b) const;
+        int compare(const uint16_t *check_sums, uint16_t i) const;
 
+        vector<line_t> lines;
+        vector<uint16_t> index;     // lines sorted on the check sums
+        vector<char> arena;         // the nul terminated values
+        vector<parsed_t> parsed;    // of each line, empty unless parse_values() was called or it was loaded from an image
+};
 
 #endif
@@ -12,27 +12,37 @@ using namespace std;
 #include <vector>
 #include <string>
 
-class ConfigValue;
+#include "ConfigValue.h"
+
 class ConfigCache;
+class MD5;
 
 class ConfigSource {
     public:
         ConfigSource(){}
         virtual ~ConfigSource(){}
 
-        // Read each value, and append it as a ConfigValue to the config_cache we were passed
+        // Read each value, and append it to the config_cache we were passed
         virtual void transfer_values_to_cache( ConfigCache* ) = 0;
         virtual bool is_named( uint16_t check_sum ) = 0;
         virtual bool write( string setting, string value ) = 0;
         virtual string read( uint16_t check_sums[3] ) = 0;
 
+        // Adds everything the values read depend on to the digest, false if they can not be kept in a config image
+        virtual bool add_to_digest( MD5& ) { return false; }
+
+        const char *get_name() const { return name; }
+
     protected:
         virtual ConfigValue* process_line_from_ascii_config(const string& line, ConfigCache* cache);
         virtual string process_line_from_ascii_config(const string& line, uint16_t line_checksums[3]);
         uint16_t name_checksum;
+        const char *name;               // a string constant
 
     private:
-        ConfigValue* process_line(const string &buffer);
+        bool process_line(const string &buffer, ConfigValue &result);
+        ConfigValue line_value;         // the last line given to the cache, valid until the next one
+
 };
 
 
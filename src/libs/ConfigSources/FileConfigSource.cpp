@@ -11,6 +11,7 @@
 #include "ConfigCache.h"
 #include "checksumm.h"
 #include "utils.h"
+#include "md5.h"
 #include <malloc.h>
 
 using namespace std;
@@ -22,8 +23,10 @@ using namespace std;
 FileConfigSource::FileConfigSource(string config_file, const char *name)
 {
     this->name_checksum = get_checksum(name);
+    this->name = name;
     this->config_file = config_file;
     this->config_file_found = false;
+    this->has_includes = false;
 }
 
 bool FileConfigSource::readLine(string& line, int lineno, FILE *fp)
@@ -55,6 +58,7 @@ void FileConfigSource::transfer_values_to_cache( ConfigCache *cache )
     if( !this->has_config_file() ) {
         return;
     }
+    this->has_includes = false;
     transfer_values_to_cache( cache, this->get_config_file().c_str());
 }
 
@@ -81,6 +85,7 @@ void FileConfigSource::transfer_values_to_cache( ConfigCache *cache, const char
             if(cv->check_sums[0] == include_checksum) {
                 string inc_file_name = cv->value.c_str();
                 cache->pop(); // we do not need to keep this around or leave it on the list
+                this->has_includes = true;
 
                 if(!file_exists(inc_file_name)) {
                     // if the file is not found at the location entered then look around for it a bit
@@ -126,6 +131,31 @@ bool FileConfigSource::is_named( uint16_t check_sum )
     return check_sum == this->name_checksum;
 }
 
+// Reads the whole file in blocks, a file that includes others can not be kept in an image as they are not hashed
+bool FileConfigSource::add_to_digest( MD5& md5 )
+{
+    if( this->has_includes ) {
+        return false;
+    }
+
+    md5.update((const char *)&this->name_checksum, sizeof(this->name_checksum));
+    if( !this->has_config_file() ) {
+        return true;
+    }
+
+    FILE *lp = fopen(this->get_config_file().c_str(), "r");
+    if(lp == NULL) {
+        return false;
+    }
+    char buf[512];
+    size_t n;
+    while((n = fread(buf, 1, sizeof(buf), lp)) > 0) {
+        md5.update(buf, n);
+    }
+    fclose(lp);
+    return true;
+}
+
 // OverWrite or append a config setting to the file
 bool FileConfigSource::write( string setting, string value )
 {
@@ -25,6 +25,7 @@ public:
     bool is_named( uint16_t check_sum );
     bool write( string setting, string value );
     string read( uint16_t check_sums[3] );
+    bool add_to_digest( MD5& md5 );
     bool has_config_file();
     void try_config_file(string candidate);
     string get_config_file();
@@ -33,6 +34,7 @@ private:
     bool readLine(string& line, int lineno, FILE *fp);
     string config_file;         // Path to the config file
     bool   config_file_found;   // Wether or not the config file's location is known
+    bool   has_includes;        // Whether the last read included other files, which are not in the digest
 };
 
 
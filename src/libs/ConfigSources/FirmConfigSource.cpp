@@ -11,6 +11,7 @@
 #include "ConfigCache.h"
 #include <malloc.h>
 #include "utils.h"
+#include "md5.h"
 
 using namespace std;
 #include <string>
@@ -22,12 +23,14 @@ extern char _binary_config_default_end;
 
 FirmConfigSource::FirmConfigSource(const char* name){
     this->name_checksum = get_checksum(name);
+    this->name = name;
     this->start= &_binary_config_default_start;
     this->end= &_binary_config_default_end;
 }
 
 FirmConfigSource::FirmConfigSource(const char* name, const char *start, const char *end){
     this->name_checksum = get_checksum(name);
+    this->name = name;
     this->start= start;
     this->end= end;
 }
@@ -55,6 +58,12 @@ bool FirmConfigSource::is_named( uint16_t check_sum ){
     return check_sum == this->name_checksum;
 }
 
+// The firm config is in flash so this is cheap
+bool FirmConfigSource::add_to_digest( MD5& md5 ){
+    md5.update(this->start, this->end - this->start);
+    return true;
+}
+
 // Write a config setting to the file *** FirmConfigSource is read only ***
 bool FirmConfigSource::write( string setting, string value ){
     //THEKERNEL->streams->printf("ERROR: FirmConfigSource is read only\r\n");
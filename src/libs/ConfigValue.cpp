@@ -26,6 +26,7 @@ void ConfigValue:: clear()
     this->check_sums[2] = 0x0000;
     this->default_double= 0.0F;
     this->default_int= 0;
+    this->parsed= 0;
     this->value= "";
 }
 
@@ -33,6 +34,7 @@ ConfigValue::ConfigValue(uint16_t *cs) {
     memcpy(this->check_sums, cs, sizeof(this->check_sums));
     this->found = false;
     this->default_set = false;
+    this->parsed= 0;
     this->value= "";
 }
 
@@ -42,6 +44,9 @@ ConfigValue::ConfigValue(const ConfigValue& to_copy)
     this->default_set = to_copy.default_set;
     memcpy(this->check_sums, to_copy.check_sums, sizeof(this->check_sums));
     this->value.assign(to_copy.value);
+    this->number = to_copy.number;
+    this->integer = to_copy.integer;
+    this->parsed = to_copy.parsed;
 }
 
 ConfigValue& ConfigValue::operator= (const ConfigValue& to_copy)
@@ -51,6 +56,9 @@ ConfigValue& ConfigValue::operator= (const ConfigValue& to_copy)
         this->default_set = to_copy.default_set;
         memcpy(this->check_sums, to_copy.check_sums, sizeof(this->check_sums));
         this->value.assign(to_copy.value);
+        this->number = to_copy.number;
+        this->integer = to_copy.integer;
+        this->parsed = to_copy.parsed;
     }
     return *this;
 }
@@ -63,16 +71,38 @@ ConfigValue *ConfigValue::required()
     return this;
 }
 
+bool ConfigValue::parse_number(float &result) const
+{
+    char *endptr = NULL;
+    string str = remove_non_number(this->value);
+    const char *cp= str.c_str();
+    result = strtof(cp, &endptr);
+    return endptr > cp;
+}
+
+bool ConfigValue::parse_int(int &result) const
+{
+    char *endptr = NULL;
+    string str = remove_non_number(this->value);
+    const char *cp= str.c_str();
+    result = strtol(cp, &endptr, 10);
+    return endptr > cp;
+}
+
+bool ConfigValue::parse_bool() const
+{
+    return this->value.find_first_of("ty1") != string::npos;
+}
+
 float ConfigValue::as_number()
 {
     if( this->found == false && this->default_set == true ) {
         return this->default_double;
+    } else if( this->parsed & PARSED_NUMBER ) {
+        return this->number;
     } else {
-        char *endptr = NULL;
-        string str = remove_non_number(this->value);
-        const char *cp= str.c_str();
-        float result = strtof(cp, &endptr);
-        if( endptr <= cp ) {
+        float result;
+        if( !parse_number(result) ) {
             printErrorandExit("config setting with value '%s' and checksums[%04X,%04X,%04X] is not a valid number, please see http://smoothieware.org/configuring-smoothie\r\n", this->value.c_str(), this->check_sums[0], this->check_sums[1], this->check_sums[2] );
         }
         return result;
@@ -83,12 +113,11 @@ int ConfigValue::as_int()
 {
     if( this->found == false && this->default_set == true ) {
         return this->default_int;
+    } else if( this->parsed & PARSED_INT ) {
+        return this->integer;
     } else {
-        char *endptr = NULL;
-        string str = remove_non_number(this->value);
-        const char *cp= str.c_str();
-        int result = strtol(cp, &endptr, 10);
-        if( endptr <= cp ) {
+        int result;
+        if( !parse_int(result) ) {
             printErrorandExit("config setting with value '%s' and checksums[%04X,%04X,%04X] is not a valid int, please see http://smoothieware.org/configuring-smoothie\r\n", this->value.c_str(), this->check_sums[0], this->check_sums[1], this->check_sums[2] );
         }
         return result;
@@ -104,8 +133,10 @@ bool ConfigValue::as_bool()
 {
     if( this->found == false && this->default_set == true ) {
         return this->default_int;
+    } else if( this->parsed & PARSED_BOOL ) {
+        return this->parsed & PARSED_TRUE;
     } else {
-        return this->value.find_first_of("ty1") != string::npos;
+        return parse_bool();
     }
 }
 
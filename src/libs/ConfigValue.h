@@ -37,11 +37,25 @@ class ConfigValue{
         friend class FileConfigSource;
 
     private:
+        // what was parsed from the value before it was looked up, the others are parsed when asked for
+        enum PARSED {
+            PARSED_NUMBER = 1,
+            PARSED_INT = 2,
+            PARSED_BOOL = 4,
+            PARSED_TRUE = 8
+        };
+
         bool has_characters( const char* mask );
+        bool parse_number(float &result) const;
+        bool parse_int(int &result) const;
+        bool parse_bool() const;
         string value;
         int default_int;
         float default_double;
+        float number;
+        int integer;
         uint16_t check_sums[3];
+        uint8_t parsed;
         bool found;
         bool default_set;
 };
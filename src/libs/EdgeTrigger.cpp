@@ -0,0 +1,98 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "EdgeTrigger.h"
+#include "Pin.h"
+#include "StepperMotor.h"
+
+#include "mbed.h"
+#include "InterruptIn.h"
+#include "Timeout.h"
+
+EdgeTrigger *EdgeTrigger::create(Pin *pin, uint32_t filter_us, StepperMotor *motor, handler_t handler)
+{
+    // interrupt_pin() marks any other pin as invalid so check first, it still has to be polled
+    if(!pin->connected() || (pin->port_number != 0 && pin->port_number != 2)) return nullptr;
+
+    mbed::InterruptIn *irq= pin->interrupt_pin();
+    if(irq == nullptr) return nullptr;
+
+    return new EdgeTrigger(pin, irq, filter_us, motor, handler);
+}
+
+EdgeTrigger::EdgeTrigger(Pin *pin, mbed::InterruptIn *irq, uint32_t filter_us, StepperMotor *motor, handler_t handler)
+    : pin(pin), irq(irq), motor(motor), handler(handler), filter_us(filter_us)
+{
+    filter= new mbed::Timeout();
+    edge_position= 0;
+    armed= false;
+    filtering= false;
+}
+
+EdgeTrigger::~EdgeTrigger()
+{
+    disarm();
+    delete filter;
+    delete irq;
+}
+
+void EdgeTrigger::arm()
+{
+    if(armed) return;
+
+    // active is the raw level unless the pin is inverted
+    if(pin->is_inverting()) {
+        irq->rise(this, &EdgeTrigger::on_inactive);
+        irq->fall(this, &EdgeTrigger::on_active);
+    } else {
+        irq->fall(this, &EdgeTrigger::on_inactive);
+        irq->rise(this, &EdgeTrigger::on_active);
+    }
+    armed= true;
+}
+
+void EdgeTrigger::disarm()
+{
+    if(!armed) return;
+
+    armed= false;
+    irq->rise(nullptr);
+    irq->fall(nullptr);
+    filter->detach();
+    filtering= false;
+}
+
+// in the GPIO interrupt, the position is latched now and the edge is accepted later if the pin is still active
+void EdgeTrigger::on_active()
+{
+    if(!armed || filtering) return;
+    edge_position= (motor != nullptr) ? (int32_t)motor->get_current_step() : 0;
+
+    if(filter_us == 0) {
+        handler();
+        return;
+    }
+    filtering= true;
+    filter->attach_us(this, &EdgeTrigger::on_filtered, filter_us);
+}
+
+// in the GPIO interrupt, a glitch is ignored if the pin goes back inactive before the filter time is up
+void EdgeTrigger::on_inactive()
+{
+    if(!filtering) return;
+    filter->detach();
+    filtering= false;
+}
+
+// in the us_ticker interrupt once the filter time is up
+void EdgeTrigger::on_filtered()
+{
+    filtering= false;
+    // the inactive edge may have been missed, the level is what counts
+    if(!armed || !pin->get()) return;
+    handler();
+}
@@ -0,0 +1,56 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EDGETRIGGER_H
+#define EDGETRIGGER_H
+
+#include <stdint.h>
+#include <functional>
+
+class Pin;
+class StepperMotor;
+namespace mbed {
+    class InterruptIn;
+    class Timeout;
+}
+
+// Calls a handler when a pin becomes active, so a switch can stop a motor within a few us instead of waiting for the
+// next 1ms poll. The step position of a motor is latched by the GPIO interrupt at the edge, the glitch filter then
+// only accepts the edge if the pin stays active for filter_us. The filter is a us_ticker timeout that the inactive
+// edge cancels, so neither interrupt waits and the handler is called from the timeout.
+// Only pins on ports 0 and 2 can interrupt, create() returns nullptr for the others which have to be polled
+class EdgeTrigger {
+    public:
+        using handler_t = std::function<void(void)>;
+
+        static EdgeTrigger *create(Pin *pin, uint32_t filter_us, StepperMotor *motor, handler_t handler);
+        ~EdgeTrigger();
+
+        // the edge is chosen from the pin inversion when armed, the handler is only called while armed
+        void arm();
+        void disarm();
+
+        int32_t get_edge_position() const { return edge_position; }
+
+    private:
+        EdgeTrigger(Pin *pin, mbed::InterruptIn *irq, uint32_t filter_us, StepperMotor *motor, handler_t handler);
+        void on_active();
+        void on_inactive();
+        void on_filtered();
+
+        Pin *pin;
+        mbed::InterruptIn *irq;
+        mbed::Timeout *filter;
+        StepperMotor *motor;
+        handler_t handler;
+        uint32_t filter_us;
+        volatile int32_t edge_position;
+        volatile bool armed;
+        volatile bool filtering;
+};
+
+#endif
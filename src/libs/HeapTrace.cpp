@@ -0,0 +1,185 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "HeapTrace.h"
+#include "StreamOutput.h"
+
+#include <string.h>
+
+#ifdef HEAP_TRACE
+#ifndef HEAP_TRACE_ENTRIES
+#define HEAP_TRACE_ENTRIES 256
+#endif
+// zeroed in bss before the first malloc, and constant initialized so no allocation is missed before the constructors run
+static HeapTrace::entry_t heap_trace_table[HEAP_TRACE_ENTRIES];
+HeapTrace heap_trace(heap_trace_table, sizeof(heap_trace_table));
+#endif
+
+size_t HeapTrace::slot(const void *p) const
+{
+    // the heap hands out 8 byte aligned blocks
+    return (((uintptr_t)p >> 3) * 2654435761U) % capacity;
+}
+
+void HeapTrace::allocated(const void *p, size_t size, uint32_t site)
+{
+    if(p == nullptr) return;
+
+    // keep the probe sequences short, the rest are only counted
+    if(entries >= capacity * 7 / 8) {
+        ++untracked;
+        return;
+    }
+
+    size_t i = slot(p);
+    while(table[i].p != nullptr) i = (i + 1) % capacity;
+
+    if(size > 0xFFFF) size = 0xFFFF;
+    table[i].p = p;
+    table[i].site = site;
+    table[i].size = size;
+    table[i].tag = current;
+    ++entries;
+
+    tag_t &t = tags[current];
+    t.bytes += size;
+    t.count++;
+    if(t.bytes > t.peak) t.peak = t.bytes;
+    bytes += size;
+    if(bytes > peak) peak = bytes;
+}
+
+// a block that was not tracked is ignored
+void HeapTrace::freed(const void *p)
+{
+    if(p == nullptr || entries == 0) return;
+
+    size_t i = slot(p);
+    while(table[i].p != p) {
+        if(table[i].p == nullptr) return;
+        i = (i + 1) % capacity;
+    }
+
+    tag_t &t = tags[table[i].tag];
+    t.bytes -= table[i].size;
+    t.count--;
+    bytes -= table[i].size;
+    --entries;
+
+    // move back the entries after it that would no longer be found past the hole
+    for (size_t j = (i + 1) % capacity; table[j].p != nullptr; j = (j + 1) % capacity) {
+        size_t k = slot(table[j].p);
+        bool stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+        if(!stays) {
+            table[i] = table[j];
+            i = j;
+        }
+    }
+    table[i].p = nullptr;
+}
+
+uint8_t HeapTrace::set_tag(const char *name)
+{
+    uint8_t previous = current;
+    if(name == nullptr) {
+        current = 0;
+        return previous;
+    }
+
+    for (uint8_t i = 1; i < n_tags; ++i) {
+        if(tags[i].name == name || strcmp(tags[i].name, name) == 0) {
+            current = i;
+            return previous;
+        }
+    }
+
+    // when they run out the rest are charged to other
+    if(n_tags < MAX_TAGS) {
+        tags[n_tags].name = name;
+        current = n_tags++;
+    } else {
+        current = 0;
+    }
+    return previous;
+}
+
+const HeapTrace::tag_t *HeapTrace::find_tag(const char *name) const
+{
+    for (uint8_t i = 1; i < n_tags; ++i) {
+        if(strcmp(tags[i].name, name) == 0) return &tags[i];
+    }
+    return nullptr;
+}
+
+uint32_t HeapTrace::live_bytes(const char *name) const
+{
+    const tag_t *t = find_tag(name);
+    return t == nullptr ? 0 : t->bytes;
+}
+
+uint32_t HeapTrace::peak_bytes(const char *name) const
+{
+    const tag_t *t = find_tag(name);
+    return t == nullptr ? 0 : t->peak;
+}
+
+void HeapTrace::reset_peaks()
+{
+    for (uint8_t i = 0; i < n_tags; ++i) tags[i].peak = tags[i].bytes;
+    peak = bytes;
+}
+
+void HeapTrace::dump(StreamOutput *stream) const
+{
+    stream->printf("Heap trace: %lu bytes in %u allocations, peak %lu, %lu allocations not tracked\n",
+                   (unsigned long)bytes, entries, (unsigned long)peak, (unsigned long)untracked);
+    for (uint8_t i = 0; i < n_tags; ++i) {
+        const tag_t &t = tags[i];
+        if(t.peak == 0) continue;
+        stream->printf("  %-20s %6lu bytes in %3u, peak %6lu\n", t.name == nullptr ? "other" : t.name,
+                       (unsigned long)t.bytes, t.count, (unsigned long)t.peak);
+    }
+
+    // group the live allocations by call site, which addr2line turns into a line of source
+    struct site_t {
+        uint32_t site;
+        uint32_t bytes;
+        uint16_t count;
+    };
+    const int MAX_SITES = 16;
+    site_t sites[MAX_SITES];
+    int n = 0;
+    uint32_t other = 0;
+    for (size_t i = 0; i < capacity; ++i) {
+        if(table[i].p == nullptr) continue;
+        int s = 0;
+        while(s < n && sites[s].site != table[i].site) ++s;
+        if(s == n) {
+            if(n == MAX_SITES) {
+                other += table[i].size;
+                continue;
+            }
+            sites[n].site = table[i].site;
+            sites[n].bytes = 0;
+            sites[n].count = 0;
+            ++n;
+        }
+        sites[s].bytes += table[i].size;
+        sites[s].count++;
+    }
+
+    for (int printed = 0; printed < 8 && n > 0; ++printed) {
+        int most = 0;
+        for (int s = 1; s < n; ++s) {
+            if(sites[s].bytes > sites[most].bytes) most = s;
+        }
+        stream->printf("  site %08lX %6lu bytes in %3u\n", (unsigned long)sites[most].site, (unsigned long)sites[most].bytes, sites[most].count);
+        sites[most] = sites[--n];
+    }
+    for (int s = 0; s < n; ++s) other += sites[s].bytes;
+    if(other > 0) stream->printf("  more sites     %6lu bytes\n", (unsigned long)other);
+}
@@ -0,0 +1,108 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEAPTRACE_H
+#define HEAPTRACE_H
+
+#include "Module.h" // for NUMBER_OF_DEFINED_EVENTS
+
+#include <stddef.h>
+#include <stdint.h>
+
+class StreamOutput;
+
+// Keeps the size, call site and tag of every live heap allocation in a hash table beside the heap, and the bytes live
+// and their high water mark for each tag. Allocations are charged to the tag set when they were made, which is the
+// module being loaded or the event being handled, so what a module holds or a code path leaks can be seen in mem -v.
+// It is opt in, built with HEAP_TRACE=1 the malloc wrappers feed heap_trace, it has no other dependencies so it can
+// be fed by tests on the host too.
+// Nothing here allocates, an allocation that does not fit in the table is only counted
+class HeapTrace
+{
+    public:
+        struct entry_t {
+            const void *p;
+            uint32_t site;
+            uint16_t size;
+            uint8_t tag;
+        };
+
+        // the table is in memory, which must stay zeroed until the first allocation
+        constexpr HeapTrace(entry_t *memory, size_t size)
+            : table(memory), capacity(size / sizeof(entry_t)), current(0), n_tags(1), entries(0), untracked(0),
+              bytes(0), peak(0), tags{} {}
+
+        void allocated(const void *p, size_t size, uint32_t site);
+        void freed(const void *p);
+
+        // charges the allocations from here on to name, which must be a string constant, returns the tag it replaces
+        uint8_t set_tag(const char *name);
+        void restore_tag(uint8_t tag) { current = tag; }
+
+        uint32_t live_bytes(const char *name) const;
+        uint32_t peak_bytes(const char *name) const;
+        uint32_t get_bytes() const { return bytes; }
+        uint32_t get_peak() const { return peak; }
+        uint16_t get_entries() const { return entries; }
+        uint32_t get_untracked() const { return untracked; }
+
+        // starts a new high water mark for every tag from what is live now
+        void reset_peaks();
+        // the tags and the call sites holding the most
+        void dump(StreamOutput *stream) const;
+
+        // tags the allocations made while it is in scope
+        class Scope
+        {
+            public:
+                Scope(HeapTrace *trace, const char *name) : trace(trace), previous(trace->set_tag(name)) {}
+                ~Scope() { trace->restore_tag(previous); }
+
+            private:
+                HeapTrace *trace;
+                uint8_t previous;
+        };
+
+        // each module made in init() has a tag and so does each event, there are about 30 modules now so this leaves
+        // room for more. Tags past the end are charged to other
+        static const uint8_t MAX_MODULE_TAGS = 40;
+        static const uint8_t MAX_TAGS = 1 + MAX_MODULE_TAGS + NUMBER_OF_DEFINED_EVENTS;
+
+    private:
+
+        struct tag_t {
+            const char *name;
+            uint32_t bytes;
+            uint32_t peak;
+            uint16_t count;
+        };
+
+        size_t slot(const void *p) const;
+        const tag_t *find_tag(const char *name) const;
+
+        entry_t *table;
+        size_t capacity;
+        uint8_t current;
+        uint8_t n_tags;
+        uint16_t entries;
+        uint32_t untracked;
+        uint32_t bytes;
+        uint32_t peak;
+        tag_t tags[MAX_TAGS];
+};
+
+// HEAP_TRACE_TAG charges what follows to name, HEAP_TRACE_SCOPE only until the end of the block
+#ifdef HEAP_TRACE
+extern HeapTrace heap_trace;
+#define HEAP_TRACE_TAG(name) heap_trace.set_tag(name)
+#define HEAP_TRACE_SCOPE(name) HeapTrace::Scope heap_trace_scope(&heap_trace, name)
+#else
+#define HEAP_TRACE_TAG(name) do {} while (0)
+#define HEAP_TRACE_SCOPE(name) do {} while (0)
+#endif
+
+#endif
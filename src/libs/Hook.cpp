@@ -5,4 +5,11 @@ extern "C"{
 
 // Hook is just a glorified FPointer
 
-Hook::Hook(){}
+Hook::Hook()
+{
+    interval= 0;
+    countdown= 0;
+    deferred= false;
+    due= false;
+    due_timestamp= 0;
+}
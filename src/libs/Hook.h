@@ -9,6 +9,10 @@ class Hook : public FPointer {
         Hook();
         int     interval;
         int     countdown;
+        // deferred hooks are only flagged as due by the timer interrupt and called later from the main loop
+        bool    deferred;
+        volatile bool due;
+        volatile uint32_t due_timestamp; // us_ticker_read() when it became due, passed to the hook when called
 };
 
 #endif
@@ -0,0 +1,163 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "InputShaper.h"
+#include "platform_memory.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ring sizes, at the bottom a slow motor still gets a useful ring and at the top it is 8K
+#define MIN_EVENTS 64
+#define MAX_EVENTS 2048
+
+#define EVENT_TICK_MASK 0x7FFFFFFFUL
+
+InputShaper::InputShaper()
+{
+    events= nullptr;
+    mask= 0;
+    n_impulses= 1;
+    delay[0]= 0;
+    amplitude[0]= 65536;
+    reset();
+}
+
+InputShaper::~InputShaper()
+{
+    if(events == nullptr) return;
+    if(AHB0.has(events)) AHB0.dealloc(events);
+    else free(events);
+}
+
+InputShaper::TYPE InputShaper::type_from_string(const char *s)
+{
+    if(strcmp(s, "zv") == 0) return ZV;
+    if(strcmp(s, "zvd") == 0) return ZVD;
+    if(strcmp(s, "mzv") == 0) return MZV;
+    return NONE;
+}
+
+bool InputShaper::configure(TYPE type, float frequency, float damping, float tick_frequency, float max_steps_per_second)
+{
+    // back to unshaped first so a failure leaves it off
+    n_impulses= 1;
+    amplitude[0]= 65536;
+    reset();
+    if(type == NONE || frequency <= 0) return true;
+
+    if(damping < 0) damping= 0;
+    if(damping > 0.9F) damping= 0.9F;
+    float d= sqrtf(1.0F - damping * damping);
+    // the damped period
+    float td= 1.0F / (frequency * d);
+
+    // impulses of the shapers as described in Singhose's papers, MZV as Klipper has it
+    float a[max_impulses], t[max_impulses];
+    int n;
+    if(type == ZV) {
+        float k= expf(-damping * M_PI / d);
+        a[0]= 1; a[1]= k;
+        t[0]= 0; t[1]= 0.5F * td;
+        n= 2;
+    } else if(type == ZVD) {
+        float k= expf(-damping * M_PI / d);
+        a[0]= 1; a[1]= 2 * k; a[2]= k * k;
+        t[0]= 0; t[1]= 0.5F * td; t[2]= td;
+        n= 3;
+    } else {
+        float k= expf(-0.75F * damping * M_PI / d);
+        float a1= 1.0F - 1.0F / sqrtf(2.0F);
+        a[0]= a1; a[1]= (sqrtf(2.0F) - 1.0F) * k; a[2]= a1 * k * k;
+        t[0]= 0; t[1]= 0.375F * td; t[2]= 0.75F * td;
+        n= 3;
+    }
+
+    // the ring holds every planned step of the longest delay at full speed
+    uint32_t needed= t[n - 1] * max_steps_per_second + 1;
+    uint32_t size= MIN_EVENTS;
+    while(size < needed && size < MAX_EVENTS) size <<= 1;
+
+    if(events == nullptr || (uint32_t)mask + 1 != size) {
+        if(events != nullptr) {
+            if(AHB0.has(events)) AHB0.dealloc(events);
+            else free(events);
+        }
+        events= (uint32_t *)AHB0.alloc(size * sizeof(uint32_t));
+        if(events == nullptr) events= (uint32_t *)malloc(size * sizeof(uint32_t));
+        if(events == nullptr) return false;
+        mask= size - 1;
+    }
+
+    float sum= 0;
+    for (int i = 0; i < n; ++i) sum += a[i];
+    uint32_t total= 0;
+    for (int i = 0; i < n; ++i) {
+        delay[i]= lroundf(t[i] * tick_frequency);
+        amplitude[i]= (i == n - 1) ? 65536 - total : lroundf(a[i] / sum * 65536.0F);
+        total += amplitude[i];
+    }
+    n_impulses= n;
+    reset();
+
+    return true;
+}
+
+void InputShaper::reset()
+{
+    head= 0;
+    position= 0;
+    for (int i = 0; i < max_impulses; ++i) {
+        cursor[i]= 0;
+        delayed[i]= 0;
+    }
+}
+
+// the impulse sees the next planned step
+void InputShaper::apply(int i)
+{
+    delayed[i] += (events[cursor[i]] & 1) ? -1 : 1;
+    cursor[i]= (cursor[i] + 1) & mask;
+}
+
+void InputShaper::push(uint32_t now, bool backwards)
+{
+    delayed[0] += backwards ? -1 : 1;
+    if(n_impulses < 2) return;
+
+    // full, the oldest step is given to the impulses that have not seen it yet, early rather than lost
+    uint16_t next= (head + 1) & mask;
+    uint16_t tail= cursor[n_impulses - 1];
+    if(next == tail) {
+        for (int i = 1; i < n_impulses; ++i) {
+            if(cursor[i] == tail) apply(i);
+        }
+    }
+
+    events[head]= (now << 1) | (backwards ? 1 : 0);
+    head= next;
+}
+
+int InputShaper::want(uint32_t now)
+{
+    for (int i = 1; i < n_impulses; ++i) {
+        while(cursor[i] != head && ((now - (events[cursor[i]] >> 1)) & EVENT_TICK_MASK) >= delay[i]) {
+            apply(i);
+        }
+    }
+
+    // the shaped position in 0.16 fixed point and the motor rounded to it
+    int64_t target= 0;
+    for (int i = 0; i < n_impulses; ++i) {
+        target += (int64_t)delayed[i] * amplitude[i];
+    }
+    int64_t error= target - ((int64_t)position << 16);
+    if(error >= 32768) return 1;
+    if(error < -32768) return -1;
+    return 0;
+}
@@ -0,0 +1,57 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Input shaping of one motor to cancel a resonance. The planned steps are pushed in as the block generates them and the
+// motor follows the sum of two or three delayed copies of the planned motion, each scaled by its impulse of the shaper,
+// which together excite nothing at the resonant frequency. The planned steps of the longest delay are kept in a ring,
+// one word each. Only integer maths after configure() as it runs in the step interrupt
+class InputShaper {
+    public:
+        enum TYPE { NONE, ZV, ZVD, MZV };
+
+        InputShaper();
+        ~InputShaper();
+
+        // frequency in Hz of the resonance and its damping ratio, max_steps_per_second sizes the ring so the longest
+        // delay holds the fastest the motor can go. false if there was no memory for it, then it is off
+        bool configure(TYPE type, float frequency, float damping, float tick_frequency, float max_steps_per_second);
+        bool is_enabled() const { return n_impulses > 1; }
+        static TYPE type_from_string(const char *s);
+
+        // a planned step at tick now, backwards as StepperMotor has the direction
+        void push(uint32_t now, bool backwards);
+        // the step the motor should make at tick now to follow the shaped motion, 1 forward, -1 back or 0
+        int want(uint32_t now);
+        // the step that was wanted was issued
+        void moved(int dir) { position += dir; }
+        // the shaped motion has caught up with the planned one
+        bool is_idle() const { return cursor[n_impulses - 1] == head && position == delayed[0]; }
+        // drops whatever has not been stepped yet, eg on a halt
+        void reset();
+
+        // the longest delay in ticks, the shaped motion ends this long after the planned one
+        uint32_t get_duration() const { return delay[n_impulses - 1]; }
+
+    private:
+        static const int max_impulses= 3;
+
+        void apply(int i);
+
+        uint32_t *events;                   // tick << 1 | backwards of each planned step
+        uint16_t mask;                      // size of the ring - 1, a power of 2
+        uint16_t head;                      // next to write
+        uint16_t cursor[max_impulses];      // the next event each impulse has not seen yet, the last one is the tail
+        uint32_t delay[max_impulses];       // in ticks, the first is 0
+        uint32_t amplitude[max_impulses];   // 0.16 fixed point adding up to 1
+        int32_t delayed[max_impulses];      // the planned position as each impulse sees it
+        int32_t position;                   // where the motor is
+        uint8_t n_impulses;
+};
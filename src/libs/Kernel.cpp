@@ -10,6 +10,7 @@
 #include "libs/Config.h"
 #include "libs/nuts_bolts.h"
 #include "libs/SlowTicker.h"
+#include "libs/PwmEngine.h"
 #include "libs/Adc.h"
 #include "libs/StreamOutputPool.h"
 #include <mri.h>
@@ -30,6 +31,9 @@
 #include "SimpleShell.h"
 
 #include "platform_memory.h"
+#include "HeapTrace.h"
+#include "BootTrace.h"
+#include "mbed.h" // for us_ticker_read()
 
 #include <malloc.h>
 #include <array>
@@ -46,12 +50,20 @@
 
 Kernel* Kernel::instance;
 
+#ifdef HEAP_TRACE
+// what the allocations made while handling each event are charged to
+static const char *const event_names[NUMBER_OF_DEFINED_EVENTS] = {
+    "main loop", "console line", "gcode", "idle", "second tick", "get public data", "set public data", "halt", "enable"
+};
+#endif
+
 // The kernel is the central point in Smoothie : it stores modules, and handles event calls
 Kernel::Kernel(){
     halted= false;
     feed_hold= false;
 
     instance= this; // setup the Singleton instance of the kernel
+    BOOT_STAGE_AS("Config", "Kernel");
 
     // serial first at fixed baud rate (DEFAULT_SERIAL_BAUD_RATE) so config can report errors to serial
 	// Set to UART0, this will be changed to use the same UART as MRI if it's enabled
@@ -62,6 +74,7 @@ Kernel::Kernel(){
 
     // Pre-load the config cache, do after setting up serial so we can report errors to serial
     this->config->config_cache_load();
+    BOOT_STAGE("Kernel");
 
     // now config is loaded we can do normal setup for serial based on config
     delete this->serial;
@@ -112,6 +125,7 @@ Kernel::Kernel(){
 
     // HAL stuff
     add_module( this->slow_ticker = new SlowTicker());
+    this->pwm_engine = new PwmEngine();
 
     this->step_ticker = new StepTicker();
     this->adc = new Adc();
@@ -122,6 +136,10 @@ Kernel::Kernel(){
     NVIC_SetPriority(TIMER0_IRQn, 2);
     NVIC_SetPriority(TIMER1_IRQn, 1);
     NVIC_SetPriority(TIMER2_IRQn, 4);
+    // us_ticker, the endstop and probe edge triggers stop the motors from it. Every us_ticker user is below the step
+    // timers, SoftSerial's FlexTicker for the Modbus spindles included: its bit times are absolute so a step tick only
+    // delays a sample by a few us, well inside the half bit of 52us at its 9600 baud
+    NVIC_SetPriority(TIMER3_IRQn, 3);
     NVIC_SetPriority(PendSV_IRQn, 3);
 
     // Set other priorities lower than the timers
@@ -150,12 +168,18 @@ Kernel::Kernel(){
     this->step_ticker->set_unstep_time( microseconds_per_step_pulse );
 
     // Core modules
+    BOOT_STAGE("Conveyor");
     this->add_module( this->conveyor       = new Conveyor()      );
+    BOOT_STAGE("GcodeDispatch");
     this->add_module( this->gcode_dispatch = new GcodeDispatch() );
+    BOOT_STAGE("Robot");
     this->add_module( this->robot          = new Robot()         );
+    BOOT_STAGE("SimpleShell");
     this->add_module( this->simpleshell    = new SimpleShell()   );
 
+    BOOT_STAGE("Planner");
     this->planner = new Planner();
+    BOOT_STAGE("Configurator");
     this->configurator = new Configurator();
 }
 
@@ -220,7 +244,9 @@ std::string Kernel::get_query_string()
 
 // Add a module to Kernel. We don't actually hold a list of modules we just call its on_module_loaded
 void Kernel::add_module(Module* module){
+    uint32_t t= us_ticker_read();
     module->on_module_loaded();
+    boot_trace.loaded(us_ticker_read() - t);
 }
 
 // Adds a hook for a given module and event
@@ -236,6 +262,8 @@ void Kernel::call_event(_EVENT_ENUM id_event, void * argument){
         was_idle= conveyor->is_idle(); // see if we were doing anything like printing
     }
 
+    HEAP_TRACE_SCOPE(event_names[id_event]);
+
     // send to all registered modules
     for (auto m : hooks[id_event]) {
         (m->*kernel_callback_functions[id_event])(argument);
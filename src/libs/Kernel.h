@@ -22,6 +22,7 @@ class Config;
 class Module;
 class Conveyor;
 class SlowTicker;
+class PwmEngine;
 class SerialConsole;
 class StreamOutputPool;
 class GcodeDispatch;
@@ -69,6 +70,7 @@ class Kernel {
 
         SlowTicker*       slow_ticker;
         StepTicker*       step_ticker;
+        PwmEngine*        pwm_engine;
         Adc*              adc;
         std::string       current_path;
         uint32_t          base_stepping_frequency;
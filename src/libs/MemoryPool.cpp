@@ -9,16 +9,12 @@
 // it first checks if the deleted object is part of a pool, and uses free otherwise.
 void  operator delete(void* p)
 {
-    MemoryPool* m = MemoryPool::first;
-    while (m)
+    MemoryPool* m = MemoryPool::find(p);
+    if (m)
     {
-        if (m->has(p))
-        {
-            MDEBUG("Pool %p has %p, using dealloc()\n", m, p);
-            m->dealloc(p);
-            return;
-        }
-        m = m->next;
+        MDEBUG("Pool %p has %p, using dealloc()\n", m, p);
+        m->dealloc(p);
+        return;
     }
 
     MDEBUG("no pool has %p, using free()\n", p);
@@ -37,6 +33,14 @@ typedef struct __attribute__ ((packed))
 } _poolregion;
 
 MemoryPool* MemoryPool::first = NULL;
+void* MemoryPool::lowest = NULL;
+void* MemoryPool::highest = NULL;
+
+// the blocks of a page are a multiple of 4 so they stay aligned, and these divide the PAGE_SIZE - 4 bytes after the
+// page's region header with little left over
+const uint8_t MemoryPool::class_size[N_CLASSES] = { 8, 12, 16, 24, 32, 48, 64 };
+
+#define PAGE_DATA (PAGE_SIZE - sizeof(_poolregion))
 
 MemoryPool::MemoryPool(void* base, uint16_t size)
 {
@@ -46,6 +50,26 @@ MemoryPool::MemoryPool(void* base, uint16_t size)
     ((_poolregion*) base)->used = 0;
     ((_poolregion*) base)->next = size;
 
+    // the page table comes from the pool itself, a pool of a few pages is not worth splitting
+    uint32_t n = (size + sizeof(_poolregion)) / PAGE_SIZE;
+    if (n > NONE) n = NONE;
+    this->pages = NULL;
+    this->n_pages = 0;
+    for (int c = 0; c < N_CLASSES; c++)
+        this->partial[c] = NONE;
+    if (n >= 8)
+    {
+        this->pages = (page_t*) alloc_region(n * sizeof(page_t));
+        this->n_pages = n;
+        for (uint32_t i = 0; i < n; i++)
+            this->pages[i].cls = NONE;
+    }
+
+    if (lowest == NULL || base < lowest)
+        lowest = base;
+    if (((uint8_t*) base) + size > highest)
+        highest = ((uint8_t*) base) + size;
+
     // insert ourselves into head of LL
     next = first;
     first = this;
@@ -76,6 +100,197 @@ MemoryPool::~MemoryPool()
 }
 
 void* MemoryPool::alloc(size_t nbytes)
+{
+    if (pages && nbytes <= SLAB_MAX)
+    {
+        uint8_t cls = 0;
+        while (class_size[cls] < nbytes)
+            cls++;
+
+        void* d = alloc_slab(cls);
+        if (d)
+            return d;
+        // no room for another page, the block can still fit in a region
+    }
+
+    void* d = alloc_region(nbytes);
+    if (d == NULL && release_empty_pages())
+        d = alloc_region(nbytes);
+    return d;
+}
+
+void MemoryPool::dealloc(void* d)
+{
+    if (pages)
+    {
+        uint32_t pg = (((uint8_t*) d) - ((uint8_t*) base)) / PAGE_SIZE;
+        if (pg < n_pages && pages[pg].cls != NONE)
+        {
+            dealloc_slab(pg, d);
+            return;
+        }
+    }
+
+    dealloc_region(d);
+}
+
+void* MemoryPool::alloc_slab(uint8_t cls)
+{
+    int pg = partial[cls];
+    if (pg == NONE)
+    {
+        pg = new_page(cls);
+        if (pg < 0)
+            return NULL;
+    }
+
+    page_t& page = pages[pg];
+    uint8_t* d = page_data(pg) + page.free * class_size[cls];
+    page.free = *d;
+    page.used++;
+
+    // a full page is only found again through its blocks
+    if (page.free == NONE)
+        unlink_page(pg);
+
+    MDEBUG("\tslab %d allocated %p from page %d\n", class_size[cls], d, pg);
+    return d;
+}
+
+void MemoryPool::dealloc_slab(uint8_t pg, void* d)
+{
+    page_t& page = pages[pg];
+    uint8_t cls = page.cls;
+    uint8_t block = (((uint8_t*) d) - page_data(pg)) / class_size[cls];
+
+    MDEBUG("\tslab %d deallocating %p from page %d\n", class_size[cls], d, pg);
+
+    if (page.free == NONE)
+    {
+        // it was full, it has a free block again
+        page.next = partial[cls];
+        page.prev = NONE;
+        if (page.next != NONE)
+            pages[page.next].prev = pg;
+        partial[cls] = pg;
+    }
+    *((uint8_t*) d) = page.free;
+    page.free = block;
+
+    // an empty page goes back to the pool, unless it is the only one of its class left with free blocks
+    if (--page.used == 0 && (partial[cls] != pg || page.next != NONE))
+    {
+        unlink_page(pg);
+        page.cls = NONE;
+        dealloc_region(page_data(pg));
+    }
+}
+
+void MemoryPool::unlink_page(uint8_t pg)
+{
+    page_t& page = pages[pg];
+    if (page.prev != NONE)
+        pages[page.prev].next = page.next;
+    else
+        partial[page.cls] = page.next;
+    if (page.next != NONE)
+        pages[page.next].prev = page.prev;
+}
+
+// the empty page kept for each class may be in the way of a large block, returns whether any were given back
+bool MemoryPool::release_empty_pages()
+{
+    bool released = false;
+    for (int pg = 0; pg < n_pages; pg++)
+    {
+        if (pages[pg].cls != NONE && pages[pg].used == 0)
+        {
+            unlink_page(pg);
+            pages[pg].cls = NONE;
+            dealloc_region(page_data(pg));
+            released = true;
+        }
+    }
+    return released;
+}
+
+// Takes the highest page whose region fits in a free region, keeping the low end of the pool for the regions allocated
+// first fit. The page's header is in the last 4 bytes of the page before it so its data starts on the page.
+// Returns the page, or -1 if none fits
+int MemoryPool::new_page(uint8_t cls)
+{
+    _poolregion* best = NULL;
+    uint32_t best_page = 0;
+
+    _poolregion* p = (_poolregion*) base;
+    do {
+        if (p->used == 0 && p->next >= PAGE_SIZE)
+        {
+            uint32_t start = offset(p), end = start + p->next;
+            uint32_t pg = (end - PAGE_DATA) / PAGE_SIZE;
+            if (pg >= n_pages)
+                pg = n_pages - 1;
+            for (; pg > best_page && pg * PAGE_SIZE - sizeof(_poolregion) >= start; pg--)
+            {
+                // the free region before can't be smaller than a header and a word, a smaller one after is part of
+                // the page's region
+                uint32_t before = pg * PAGE_SIZE - sizeof(_poolregion) - start;
+                if (before == 0 || before >= 8)
+                {
+                    best = p;
+                    best_page = pg;
+                    break;
+                }
+            }
+        }
+
+        if (offset(p) + p->next >= size)
+            break;
+        p = (_poolregion*) (((uint8_t*) p) + p->next);
+    } while (1);
+
+    if (best == NULL)
+        return -1;
+
+    // split the free region into what is before the page, the page and what is after it
+    uint32_t end = offset(best) + best->next;
+    _poolregion* q = (_poolregion*) (page_data(best_page) - sizeof(_poolregion));
+    if (q != best)
+        best->next = ((uint8_t*) q) - ((uint8_t*) best);
+    q->used = 1;
+    q->next = PAGE_SIZE;
+    if (offset(q) + PAGE_SIZE + 8 > end)
+    {
+        q->next = end - offset(q);
+    }
+    else
+    {
+        _poolregion* r = (_poolregion*) (((uint8_t*) q) + PAGE_SIZE);
+        r->used = 0;
+        r->next = end - offset(r);
+    }
+
+    // chain the blocks in order, the last one has none after it
+    uint8_t* d = page_data(best_page);
+    uint8_t n = PAGE_DATA / class_size[cls];
+    for (uint8_t i = 0; i < n; i++)
+        d[i * class_size[cls]] = (i + 1 < n) ? i + 1 : NONE;
+
+    page_t& page = pages[best_page];
+    page.cls = cls;
+    page.used = 0;
+    page.free = 0;
+    page.prev = NONE;
+    page.next = partial[cls];
+    if (page.next != NONE)
+        pages[page.next].prev = best_page;
+    partial[cls] = best_page;
+
+    MDEBUG("\tnew page %lu for slab %d\n", best_page, class_size[cls]);
+    return best_page;
+}
+
+void* MemoryPool::alloc_region(size_t nbytes)
 {
     // nbytes = ceil(nbytes / 4) * 4
     if (nbytes & 3)
@@ -129,22 +344,22 @@ void* MemoryPool::alloc(size_t nbytes)
         p = (_poolregion*) (((uint8_t*) p) + p->next);
 
         // make sure we don't walk off the end
-    } while (p <= (_poolregion*) (((uint8_t*)base) + size));
+    } while (p < (_poolregion*) (((uint8_t*)base) + size));
 
     // fell off the end of the region!
     return NULL;
 }
 
-void MemoryPool::dealloc(void* d)
+void MemoryPool::dealloc_region(void* d)
 {
     _poolregion* p = (_poolregion*) (((uint8_t*) d) - sizeof(_poolregion));
     p->used = 0;
 
     MDEBUG("\tdeallocating %p (%+d, %db)\n", p, offset(p), p->next);
 
-    // combine next block if it's free
+    // combine next block if it's free, the last block has none
     _poolregion* q = (_poolregion*) (((uint8_t*) p) + p->next);
-    if (q->used == 0)
+    if (offset(q) < size && q->used == 0)
     {
         MDEBUG("\t\tCombining with next free region at %p, new size is %d\n", q, p->next + q->next);
 
@@ -173,7 +388,7 @@ void MemoryPool::dealloc(void* d)
                 q->next += p->next;
 
                 // sanity check
-                if ((offset(p) + p->next) >= size)
+                if ((offset(p) + p->next) > size)
                 {
                     // captain, we have a problem!
                     // this can only happen if something has corrupted our heap, since we should simply fail to find a free block if it's full
@@ -215,10 +430,70 @@ void MemoryPool::debug(StreamOutput* str)
         if ((offset(p) + p->next >= size) || (p->next <= sizeof(_poolregion)))
         {
             str->printf("End: total %lub, free: %lub\n", tot, free);
-            return;
+            break;
+        }
+        p = (_poolregion*) (((uint8_t*) p) + p->next);
+    } while (1);
+
+    // how much of the free space can't be allocated in one go
+    uint16_t regions;
+    uint32_t largest = largest_free(&regions);
+    if (free > 0)
+        str->printf("Largest free: %lub of %u free regions, fragmentation %lu%%\n", largest, regions, 100 - largest * 100 / free);
+
+    for (int c = 0; c < N_CLASSES && pages; c++)
+    {
+        uint32_t n = 0, used = 0;
+        for (int pg = 0; pg < n_pages; pg++)
+        {
+            if (pages[pg].cls == c)
+            {
+                n++;
+                used += pages[pg].used;
+            }
         }
+        if (n > 0)
+            str->printf("\tSlab %2ub: %lu pages, %lu used, %lu free\n", class_size[c], n, used, n * (PAGE_DATA / class_size[c]) - used);
+    }
+}
+
+uint32_t MemoryPool::largest_free(uint16_t *regions)
+{
+    uint32_t largest = 0;
+    uint16_t n = 0;
+
+    _poolregion* p = (_poolregion*) base;
+
+    do {
+        if (p->used == 0)
+        {
+            n++;
+            if (p->next > largest)
+                largest = p->next;
+        }
+        if ((offset(p) + p->next >= size) || (p->next <= sizeof(_poolregion)))
+            break;
         p = (_poolregion*) (((uint8_t*) p) + p->next);
     } while (1);
+
+    if (regions)
+        *regions = n;
+    return (largest > sizeof(_poolregion)) ? largest - sizeof(_poolregion) : 0;
+}
+
+MemoryPool* MemoryPool::find(void* p)
+{
+    if (p < lowest || p >= highest)
+        return NULL;
+
+    MemoryPool* m = first;
+    while (m)
+    {
+        if (m->has(p))
+            return m;
+        m = m->next;
+    }
+    return NULL;
 }
 
 bool MemoryPool::has(void* p)
@@ -226,10 +501,17 @@ bool MemoryPool::has(void* p)
     return ((p >= base) && (p < (void*) (((uint8_t*) base) + size)));
 }
 
+// the free blocks of the slabs are counted too, though they can only be used for allocations of their size
 uint32_t MemoryPool::free()
 {
     uint32_t free = 0;
 
+    for (int pg = 0; pg < n_pages; pg++)
+    {
+        if (pages[pg].cls != NONE)
+            free += (PAGE_DATA / class_size[pages[pg].cls] - pages[pg].used) * class_size[pages[pg].cls];
+    }
+
     _poolregion* p = (_poolregion*) base;
 
     do {
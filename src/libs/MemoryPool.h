@@ -17,6 +17,11 @@ class StreamOutput;
  * with MUCH thanks to http://www.parashift.com/c++-faq-lite/memory-pools.html
  *
  * test framework at https://gist.github.com/triffid/5563987
+ *
+ * Allocations of up to SLAB_MAX bytes come from slabs, pages of the pool each split into blocks of one size class, so
+ * they are allocated and freed in constant time and small objects that come and go do not fragment the regions the
+ * larger ones are allocated from first fit. A page is found from an address by its offset in the pool, the pages are
+ * taken from the top of the pool and given back when all their blocks are free.
  */
 
 class MemoryPool
@@ -34,13 +39,51 @@ public:
 
     uint32_t free(void);
 
+    // the largest block that can be allocated, and the number of free regions it is out of
+    uint32_t largest_free(uint16_t *regions = NULL);
+
+    // the pool p is in, NULL if it is not in any of them
+    static MemoryPool* find(void* p);
+
     MemoryPool* next;
 
     static MemoryPool* first;
 
+    static const uint16_t SLAB_MAX = 64;
+    static const uint16_t PAGE_SIZE = 256;
+
 private:
+    enum { N_CLASSES = 7, NONE = 0xFF };
+
+    struct page_t
+    {
+        uint8_t cls;            // size class of the blocks, NONE if the page is not a slab
+        uint8_t used;           // blocks allocated
+        uint8_t free;           // first free block, a free block holds the index of the next one
+        uint8_t next, prev;     // pages of the same class with free blocks
+    };
+
+    void* alloc_region(size_t);
+    void  dealloc_region(void* p);
+    void* alloc_slab(uint8_t cls);
+    void  dealloc_slab(uint8_t pg, void* p);
+    int   new_page(uint8_t cls);
+    void  unlink_page(uint8_t pg);
+    bool  release_empty_pages();
+    uint8_t* page_data(uint8_t pg) const { return (uint8_t*) base + pg * PAGE_SIZE; }
+
+    static const uint8_t class_size[N_CLASSES];
+
     void* base;
     uint16_t size;
+
+    page_t* pages;              // one for each PAGE_SIZE of the pool, NULL if it is too small for slabs
+    uint8_t n_pages;
+    uint8_t partial[N_CLASSES]; // first page of each class with free blocks
+
+    // address range of all the pools, so most deletes of heap memory don't have to look at them
+    static void* lowest;
+    static void* highest;
 };
 
 // this overloads "placement new"
@@ -0,0 +1,21 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PressureAdvance.h"
+
+// more than this is not a sensible K and would overflow want()
+#define MAX_K_SECONDS 0.5F
+
+void PressureAdvance::set_k(float seconds, float tick_frequency)
+{
+    if(seconds <= 0) {
+        k_ticks= 0;
+        return;
+    }
+    if(seconds > MAX_K_SECONDS) seconds= MAX_K_SECONDS;
+    k_ticks= (uint32_t)(seconds * tick_frequency * 65536.0F + 0.5F);
+}
@@ -0,0 +1,43 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Pressure advance for one extruder. The filament is pushed ahead of where the move puts it by K times the extruder's
+// velocity, so the nozzle pressure keeps up as the speed changes. The step ticker asks it every tick for a step on top of
+// the block's own, in either direction, so the block's step count is not changed and the advance always winds back to
+// nothing when the extruder stops. Only integer maths as it runs in the step interrupt
+class PressureAdvance {
+    public:
+        PressureAdvance() : k_ticks(0), position(0) {};
+
+        // K in seconds, 0 turns it off
+        void set_k(float seconds, float tick_frequency);
+        bool is_enabled() const { return k_ticks != 0; }
+
+        // rate is the extruder's nominal steps per tick in 2.62 fixed point, 0 when it is not extruding.
+        // Returns the step it wants this tick, 1 to extrude, -1 to pull back or 0
+        int want(int64_t rate) const
+        {
+            int32_t target= 0;
+            if(rate > 0) target= (((uint64_t)rate >> 30) * k_ticks) >> 48;
+            return (target > position) ? 1 : (target < position) ? -1 : 0;
+        }
+
+        // the step that was wanted was issued
+        void moved(int dir) { position += dir; }
+
+        // steps the filament is ahead
+        int32_t get_position() const { return position; }
+        void reset() { position= 0; }
+
+    private:
+        uint32_t k_ticks;   // K in step ticks, 16.16 fixed point
+        int32_t position;
+};
@@ -1,28 +1,48 @@
 #include "Pwm.h"
 
 #include "utils.h"
-
-#define PID_PWM_MAX 256
-
-// What ?
+#include "Kernel.h"
+#include "PwmEngine.h"
+#include "PwmOut.h" // mbed.h lib
 
 Pwm::Pwm()
 {
+    _hardware = nullptr;
     _max = PID_PWM_MAX - 1;
     _pwm = -1;
-    _sd_direction= false;
-    _sd_accumulator= 0;
+    _channel = -1;
+}
+
+// have the PwmEngine drive this pin, the sigma-delta is updated at frequency Hz
+bool Pwm::attach(uint32_t frequency)
+{
+    _channel = THEKERNEL->pwm_engine->attach(this, frequency);
+    return _channel >= 0;
+}
+
+// drive this pin from a hardware PWM channel instead, returns false if the pin does not support it
+// NOTE all the hardware PWM channels share one period so this affects other hardware PWM outputs too
+bool Pwm::attach_hardware(uint32_t period_us)
+{
+    _hardware = hardware_pwm();
+    if(_hardware == nullptr) return false;
+
+    _hardware->period_us(period_us);
+    update();
+    return true;
 }
 
 void Pwm::pwm(int new_pwm)
 {
     _pwm = confine(new_pwm, 0, _max);
+    update();
 }
 
 Pwm* Pwm::max_pwm(int new_max)
 {
     _max = confine(new_max, 0, PID_PWM_MAX - 1);
     _pwm = confine(   _pwm, 0, _max);
+    update();
     return this;
 }
 
@@ -34,102 +54,24 @@ int Pwm::max_pwm()
 void Pwm::set(bool value)
 {
     _pwm = -1;
+    if(_hardware != nullptr) {
+        _hardware->write((value ^ is_inverting()) ? 1.0F : 0.0F);
+        return;
+    }
+
+    // stop the engine driving the pin before setting it
+    if(_channel >= 0) THEKERNEL->pwm_engine->set_pwm(_channel, -1);
     Pin::set(value);
 }
 
-uint32_t Pwm::on_tick(uint32_t dummy)
+void Pwm::update()
 {
-    if ((_pwm < 0) || _pwm >= PID_PWM_MAX) {
-        return dummy;
-    }
-    else if (_pwm == 0) {
-        Pin::set(false);
-        return dummy;
-    }
-    else if (_pwm == PID_PWM_MAX - 1) {
-        Pin::set(true);
-        return dummy;
-    }
+    if(_hardware != nullptr) {
+        if(_pwm < 0) return;
+        float d = _pwm / (float)(PID_PWM_MAX - 1);
+        _hardware->write(is_inverting() ? 1.0F - d : d);
 
-    /*
-     * Sigma-Delta PWM algorithm
-     *
-     * This Sigma-Delta implementation works by increasing _sd_accumulator by _pwm until we reach _half_ of max,
-     * then decreasing by (max - target_pwm) until we hit zero
-     *
-     * While we're increasing, the output is 0 and while we're decreasing the output is 1
-     *
-     * For example, with pwm=128 and a max of 256, we'll see the following pattern:
-     * ACC  ADD OUT
-     *   0  128   1 // after the add, we hit 256/2 = 128 so we change direction
-     * 128 -128   0 // after the add, we hit 0 so we change direction again
-     *   0  128   1
-     * 128 -128   0
-     *  as expected
-     *
-     * with a pwm value of 192 (75%) we'll see this:
-     *  ACC  ADD OUT
-     *    0  192   0 // after the add, we are beyond max/2 so we change direction
-     *  192  -64   1 // haven't reached 0 yet
-     *  128  -64   1 // haven't reached 0 yet
-     *   64  -64   1 // after this add we reach 0, and change direction
-     *    0  192   0
-     *  192  -64   1
-     *  128  -64   1
-     *   64  -64   1
-     *    0  192   0
-     * etcetera
-     *
-     * with a pwm value of 75 (about 29%) we'll see this pattern:
-     *  ACC  ADD OUT
-     *    0   75   0
-     *   75   75   0
-     *  150 -181   1
-     *  -31   75   0
-     *   44   75   0
-     *  119   75   0
-     *  194 -181   1
-     *   13 -181   1
-     * -168   75   0
-     *  -93   75   0
-     *  -18   75   0
-     *   57   75   0
-     *  132 -181   1
-     *  -49   75   0
-     *   26   75   0
-     *  101   75   0
-     *  176 -181   1
-     *   -5   75   0
-     *   70   75   0
-     *  145 -181   1
-     *  -36   75   0
-     * etcetera. This pattern has 6 '1's over a total of 21 lines which is on 28.57% of the time. If we let it run longer, it would get closer to the target as time went on
-     */
-
-    // this line should never actually do anything, it's just a sanity check in case our accumulator gets corrupted somehow.
-    // If we didn't check and the accumulator is corrupted, we could leave a heater on for quite a long time
-    // the accumulator is kept within these limits by the normal operation of the Sigma-Delta algorithm
-    _sd_accumulator = confine(_sd_accumulator, -PID_PWM_MAX, PID_PWM_MAX << 1);
-
-    // when _sd_direction == false, our output is 0 and our accumulator is increasing by _pwm
-    if (_sd_direction == false)
-    {
-        // increment accumulator
-        _sd_accumulator += _pwm;
-        // if we've reached half of max, flip our direction
-        if (_sd_accumulator >= (PID_PWM_MAX >> 1))
-            _sd_direction = true;
+    }else if(_channel >= 0) {
+        THEKERNEL->pwm_engine->set_pwm(_channel, _pwm);
     }
-    // when _sd_direction == true, our output is 1 and our accumulator is decreasing by (MAX - _pwm)
-    else
-    {
-        // decrement accumulator
-        _sd_accumulator -= (PID_PWM_MAX - _pwm);
-        // if we've reached 0, flip our direction
-        if (_sd_accumulator <= 0)
-            _sd_direction = false;
-    }
-    Pin::set(_sd_direction);
-
-    return dummy;
 }
@@ -6,12 +6,22 @@
 #include "Pin.h"
 #include "Module.h"
 
+#define PID_PWM_MAX 256
+
+namespace mbed {
+    class PwmOut;
+}
+
+// A pin driven by PwmEngine at the frequency given to attach(), or optionally by a hardware PWM channel
 class Pwm : public Module, public Pin {
 public:
     Pwm();
 
     void     on_module_load(void);
-    uint32_t on_tick(uint32_t);
+
+    bool     attach(uint32_t frequency);
+    bool     attach_hardware(uint32_t period_us);
+    bool     is_hardware() const { return _hardware != nullptr; }
 
     Pwm*     max_pwm(int);
     int      max_pwm(void);
@@ -21,10 +31,12 @@ public:
     void     set(bool);
 
 private:
+    void     update();
+
+    mbed::PwmOut *_hardware;
     int  _max;
     int  _pwm;
-    int  _sd_accumulator;
-    bool _sd_direction;
+    int  _channel;
 };
 
 #endif /* _PWM_H */
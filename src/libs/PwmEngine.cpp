@@ -0,0 +1,169 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PwmEngine.h"
+#include "Pwm.h"
+#include "Kernel.h"
+#include "SlowTicker.h"
+#include "utils.h"
+
+static LPC_GPIO_TypeDef * const gpios[5]= {LPC_GPIO0, LPC_GPIO1, LPC_GPIO2, LPC_GPIO3, LPC_GPIO4};
+
+PwmEngine::PwmEngine()
+{
+    hook= nullptr;
+    frequency= 0;
+    n_channels= 0;
+}
+
+// The engine ticks at the highest frequency asked for, slower channels are only updated every divider ticks
+int PwmEngine::attach(Pwm *pwm, uint32_t frequency)
+{
+    if(n_channels >= MAX_PWM_CHANNELS || !pwm->connected() || frequency == 0) return -1;
+
+    if(hook == nullptr) {
+        this->frequency= frequency;
+        hook= THEKERNEL->slow_ticker->attach(frequency, this, &PwmEngine::on_tick);
+
+    }else if(frequency > this->frequency) {
+        // speed up the engine and rescale the dividers of the existing channels
+        __disable_irq();
+        for (int i = 0; i < n_channels; ++i) {
+            channels[i].divider= channels[i].divider * frequency / this->frequency;
+            channels[i].countdown= channels[i].divider;
+        }
+        this->frequency= frequency;
+        THEKERNEL->slow_ticker->set_hook_frequency(hook, frequency);
+        __enable_irq();
+    }
+
+    channel_t &c= channels[n_channels];
+    c.mask= 1 << pwm->pin;
+    c.port= pwm->port_number;
+    c.inverting= pwm->is_inverting();
+    c.pwm= pwm->get_pwm();
+    c.accumulator= 0;
+    c.direction= false;
+    c.divider= (this->frequency + frequency / 2) / frequency;
+    if(c.divider == 0) c.divider= 1;
+    c.countdown= c.divider;
+
+    // the new channel is only seen by on_tick once it is fully setup
+    return n_channels++;
+}
+
+/*
+ * Sigma-Delta PWM algorithm
+ *
+ * This Sigma-Delta implementation works by increasing the accumulator by pwm until we reach _half_ of max,
+ * then decreasing by (max - target_pwm) until we hit zero
+ *
+ * While we're increasing, the output is 0 and while we're decreasing the output is 1
+ *
+ * For example, with pwm=128 and a max of 256, we'll see the following pattern:
+ * ACC  ADD OUT
+ *   0  128   1 // after the add, we hit 256/2 = 128 so we change direction
+ * 128 -128   0 // after the add, we hit 0 so we change direction again
+ *   0  128   1
+ * 128 -128   0
+ *  as expected
+ *
+ * with a pwm value of 192 (75%) we'll see this:
+ *  ACC  ADD OUT
+ *    0  192   0 // after the add, we are beyond max/2 so we change direction
+ *  192  -64   1 // haven't reached 0 yet
+ *  128  -64   1 // haven't reached 0 yet
+ *   64  -64   1 // after this add we reach 0, and change direction
+ *    0  192   0
+ *  192  -64   1
+ *  128  -64   1
+ *   64  -64   1
+ *    0  192   0
+ * etcetera
+ *
+ * with a pwm value of 75 (about 29%) we'll see this pattern:
+ *  ACC  ADD OUT
+ *    0   75   0
+ *   75   75   0
+ *  150 -181   1
+ *  -31   75   0
+ *   44   75   0
+ *  119   75   0
+ *  194 -181   1
+ *   13 -181   1
+ * -168   75   0
+ *  -93   75   0
+ *  -18   75   0
+ *   57   75   0
+ *  132 -181   1
+ *  -49   75   0
+ *   26   75   0
+ *  101   75   0
+ *  176 -181   1
+ *   -5   75   0
+ *   70   75   0
+ *  145 -181   1
+ *  -36   75   0
+ * etcetera. This pattern has 6 '1's over a total of 21 lines which is on 28.57% of the time. If we let it run longer, it would get closer to the target as time went on
+ */
+uint32_t PwmEngine::on_tick(uint32_t dummy)
+{
+    uint32_t set[5]= {0, 0, 0, 0, 0};
+    uint32_t clr[5]= {0, 0, 0, 0, 0};
+
+    for (int i = 0; i < n_channels; ++i) {
+        channel_t &c= channels[i];
+        if(--c.countdown != 0) continue;
+        c.countdown= c.divider;
+
+        int pwm= c.pwm;
+        bool out;
+        if(pwm < 0 || pwm >= PID_PWM_MAX) {
+            // pin is being set directly
+            continue;
+
+        }else if(pwm == 0) {
+            out= false;
+
+        }else if(pwm == PID_PWM_MAX - 1) {
+            out= true;
+
+        }else{
+            // this line should never actually do anything, it's just a sanity check in case our accumulator gets corrupted somehow.
+            // If we didn't check and the accumulator is corrupted, we could leave a heater on for quite a long time
+            // the accumulator is kept within these limits by the normal operation of the Sigma-Delta algorithm
+            int acc= confine(c.accumulator, -PID_PWM_MAX, PID_PWM_MAX << 1);
+
+            // when direction == false, our output is 0 and our accumulator is increasing by pwm
+            if(!c.direction) {
+                acc += pwm;
+                // if we've reached half of max, flip our direction
+                if(acc >= (PID_PWM_MAX >> 1)) c.direction= true;
+
+            // when direction == true, our output is 1 and our accumulator is decreasing by (MAX - pwm)
+            }else{
+                acc -= (PID_PWM_MAX - pwm);
+                // if we've reached 0, flip our direction
+                if(acc <= 0) c.direction= false;
+            }
+            c.accumulator= acc;
+            out= c.direction;
+        }
+
+        if(out ^ c.inverting) set[c.port] |= c.mask;
+        else clr[c.port] |= c.mask;
+    }
+
+    // FIOSET and FIOCLR only change the bits written as 1, so other pins on the port, including ones written by higher
+    // priority interrupts, are not affected
+    for (int p = 0; p < 5; ++p) {
+        if(set[p] != 0) gpios[p]->FIOSET= set[p];
+        if(clr[p] != 0) gpios[p]->FIOCLR= clr[p];
+    }
+
+    return dummy;
+}
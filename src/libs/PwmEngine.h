@@ -0,0 +1,52 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PWMENGINE_H
+#define PWMENGINE_H
+
+#include <stdint.h>
+
+class Pwm;
+class Hook;
+
+// the maximum number of software PWM pins, heaters plus sigma delta switches
+#define MAX_PWM_CHANNELS 16
+
+// Drives all the sigma-delta software PWM pins from a single SlowTicker hook. The channel state is kept in one packed
+// array, all accumulators are updated in one loop, and the outputs are then written with one FIOSET and one FIOCLR per port
+class PwmEngine
+{
+    public:
+        PwmEngine();
+
+        // add the pin as a channel updated at frequency Hz, returns the channel number or -1 if there are no free channels
+        int attach(Pwm *pwm, uint32_t frequency);
+
+        // -1 leaves the pin alone so it can be set directly, otherwise 0 to PID_PWM_MAX-1
+        void set_pwm(int channel, int16_t pwm) { channels[channel].pwm= pwm; }
+
+        uint32_t on_tick(uint32_t);
+
+    private:
+        struct channel_t {
+            uint32_t mask;
+            volatile int16_t pwm;
+            int16_t accumulator;
+            uint16_t divider;
+            uint16_t countdown;
+            uint8_t port;
+            bool inverting:1;
+            bool direction:1;
+        };
+
+        channel_t channels[MAX_PWM_CHANNELS];
+        Hook *hook;
+        uint32_t frequency;
+        uint8_t n_channels;
+};
+
+#endif
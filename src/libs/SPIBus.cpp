@@ -0,0 +1,287 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SPIBus.h"
+#include "Pin.h"
+#include "StreamOutput.h"
+
+// SSP register bits
+#define SSP_SSE   (1 << 1)  // CR1 enable
+#define SSP_TNF   (1 << 1)  // SR transmit fifo not full
+#define SSP_RNE   (1 << 2)  // SR receive fifo not empty
+#define SSP_RORIM (1 << 0)  // IMSC receive overrun
+#define SSP_RTIM  (1 << 1)  // IMSC receive timeout
+#define SSP_RXIM  (1 << 2)  // IMSC receive fifo half full
+#define SSP_FIFO_DEPTH 8
+
+static SPIBus *buses[2]= {nullptr, nullptr};
+
+SPITransaction::SPITransaction()
+{
+    tx= nullptr;
+    rx= nullptr;
+    length= 0;
+    next= nullptr;
+    cs= nullptr;
+    cr0= 7;
+    cpsr= 2;
+    bits= 8;
+    sent= 0;
+    received= 0;
+    busy= false;
+}
+
+// mirrors spi_format and spi_frequency but with integer maths so a transaction can be started from an interrupt
+void SPITransaction::setup(Pin *cs, int bits, int mode, int hz)
+{
+    this->cs= cs;
+    this->bits= bits;
+
+    uint32_t pclk= SystemCoreClock; // the SPIBus constructor sets the SSP clock to CCLK
+    uint32_t prescaler, divider= 256;
+    for (prescaler = 2; prescaler <= 254; prescaler += 2) {
+        divider= (pclk / prescaler + hz / 2) / hz;
+        if(divider < 256) break;
+    }
+    if(divider == 0) divider= 1;
+
+    this->cpsr= prescaler;
+    this->cr0= (bits - 1) | ((mode & 2) ? 1 << 6 : 0) | ((mode & 1) ? 1 << 7 : 0) | ((divider - 1) << 8);
+}
+
+SPIBus *SPIBus::get(int channel)
+{
+    channel= (channel == 1) ? 1 : 0;
+    if(buses[channel] == nullptr) {
+        if(channel == 0) {
+            buses[0]= new SPIBus(P0_18, P0_17, P0_15, SSP0_IRQn);
+        } else {
+            buses[1]= new SPIBus(P0_9, P0_8, P0_7, SSP1_IRQn);
+        }
+    }
+    return buses[channel];
+}
+
+SPIBus::SPIBus(PinName mosi, PinName miso, PinName sclk, IRQn_Type irq) : mbed::SPI(mosi, miso, sclk)
+{
+    ssp= _spi.spi;
+    head= tail= nullptr;
+    current= nullptr;
+    locked= 0;
+    interrupt_users= held_off= 0;
+    this->irq= irq;
+    n_transfers= n_queued= n_locks= n_lock_waits= n_lock_conflicts= 0;
+    depth= max_depth= 0;
+
+    ssp->IMSC= 0;
+    // lower than the step and slow tickers, higher than USB which may wait on the bus when reading the sdcard
+    NVIC_SetPriority(irq, 4);
+    NVIC_EnableIRQ(irq);
+}
+
+bool SPIBus::queue(SPITransaction *t)
+{
+    __disable_irq();
+    if(t->busy) {
+        __enable_irq();
+        return false;
+    }
+
+    t->busy= true;
+    t->next= nullptr;
+    if(current == nullptr && locked == 0) {
+        start(t);
+
+    } else {
+        if(tail == nullptr) head= t;
+        else tail->next= t;
+        tail= t;
+        n_queued++;
+        if(++depth > max_depth) max_depth= depth;
+    }
+    __enable_irq();
+    return true;
+}
+
+void SPIBus::transfer(SPITransaction *t)
+{
+    lock();
+    // poll the fifo here instead of waiting for the interrupt, the caller may be blocking it
+    NVIC_DisableIRQ(irq);
+    t->busy= true;
+    start(t);
+    ssp->IMSC= 0;
+    while(current != nullptr) service();
+    NVIC_EnableIRQ(irq);
+    unlock();
+}
+
+// finish the transfer in flight by polling, the caller has masked the SSP interrupt so it can't race us for the fifo
+void SPIBus::wait_idle()
+{
+    ssp->IMSC= 0;
+    while(current != nullptr) service();
+}
+
+// only the first 32 interrupts, which include USB, are held off
+void SPIBus::add_interrupt_user(IRQn_Type irq)
+{
+    if(irq < 0 || irq >= 32) return;
+    uint32_t bit= 1UL << irq;
+
+    __disable_irq();
+    interrupt_users |= bit;
+    // it may be added while the main loop has the bus
+    if(locked > 0 && __get_IPSR() == 0 && (NVIC->ISER[0] & bit)) {
+        held_off |= bit;
+        NVIC->ICER[0]= bit;
+    }
+    __enable_irq();
+}
+
+void SPIBus::lock()
+{
+    __disable_irq();
+    if(__get_IPSR() == 0) {
+        if(locked == 0) {
+            // the interrupts that use the bus could not wait for us to unlock, so they wait to be run instead
+            held_off= interrupt_users & NVIC->ISER[0];
+            NVIC->ICER[0]= held_off;
+        }
+    } else if(locked > 0) {
+        // an interrupt that was not added has the bus from under whoever it interrupted
+        n_lock_conflicts++;
+    }
+    __enable_irq();
+
+    NVIC_DisableIRQ(irq);
+    if(current != nullptr) n_lock_waits++;
+    // locks nest rather than wait, the holder can only be the code this interrupted or this code itself
+    locked++;
+    wait_idle();
+    n_locks++;
+    // the transfers change the format behind mbed::SPI's back so make the next user set it again
+    _owner= nullptr;
+    NVIC_EnableIRQ(irq);
+}
+
+void SPIBus::unlock()
+{
+    __disable_irq();
+    if(locked > 0) locked--;
+    _owner= nullptr;
+    if(locked == 0 && current == nullptr && head != nullptr) {
+        SPITransaction *t= head;
+        head= t->next;
+        if(head == nullptr) tail= nullptr;
+        depth--;
+        start(t);
+    }
+    if(locked == 0 && held_off != 0) {
+        NVIC->ISER[0]= held_off;
+        held_off= 0;
+    }
+    __enable_irq();
+}
+
+// called with interrupts disabled or from the ISR
+void SPIBus::start(SPITransaction *t)
+{
+    current= t;
+    t->sent= t->received= 0;
+
+    ssp->CR1 &= ~SSP_SSE;
+    ssp->CR0= t->cr0;
+    ssp->CPSR= t->cpsr;
+    ssp->CR1 |= SSP_SSE;
+    while(ssp->SR & SSP_RNE) (void)ssp->DR;
+    _owner= nullptr;
+
+    if(t->cs != nullptr) t->cs->set(false);
+
+    // a transfer that fits in the fifo is done with a single interrupt
+    while(t->sent < t->length && t->sent < SSP_FIFO_DEPTH) {
+        uint16_t v= 0;
+        if(t->tx != nullptr) v= (t->bits > 8) ? ((const uint16_t*)t->tx)[t->sent] : ((const uint8_t*)t->tx)[t->sent];
+        ssp->DR= v;
+        t->sent++;
+    }
+    ssp->ICR= SSP_RORIM | SSP_RTIM;
+    ssp->IMSC= SSP_RXIM | SSP_RTIM;
+}
+
+void SPIBus::service()
+{
+    SPITransaction *t= current;
+    if(t == nullptr) {
+        ssp->IMSC= 0;
+        return;
+    }
+
+    while(ssp->SR & SSP_RNE) {
+        uint16_t v= ssp->DR;
+        if(t->rx != nullptr && t->received < t->length) {
+            if(t->bits > 8) ((uint16_t*)t->rx)[t->received]= v;
+            else ((uint8_t*)t->rx)[t->received]= v;
+        }
+        t->received++;
+    }
+    ssp->ICR= SSP_RTIM;
+
+    if(t->received < t->length) {
+        // keep no more than a fifo's worth in flight so the receive fifo can't overrun
+        while(t->sent < t->length && t->sent - t->received < SSP_FIFO_DEPTH && (ssp->SR & SSP_TNF)) {
+            uint16_t v= 0;
+            if(t->tx != nullptr) v= (t->bits > 8) ? ((const uint16_t*)t->tx)[t->sent] : ((const uint8_t*)t->tx)[t->sent];
+            ssp->DR= v;
+            t->sent++;
+        }
+        return;
+    }
+
+    ssp->IMSC= 0;
+    if(t->cs != nullptr) t->cs->set(true);
+    current= nullptr;
+    n_transfers++;
+    t->busy= false;
+    if(t->done) t->done(t);
+
+    if(locked == 0 && current == nullptr && head != nullptr) {
+        SPITransaction *n= head;
+        head= n->next;
+        if(head == nullptr) tail= nullptr;
+        depth--;
+        start(n);
+    }
+}
+
+void SPIBus::on_irq()
+{
+    service();
+}
+
+void SPIBus::dump_stats(StreamOutput *stream)
+{
+    for (int i = 0; i < 2; ++i) {
+        SPIBus *b= buses[i];
+        if(b == nullptr) continue;
+        stream->printf("SPI%d: transfers %lu, waited in queue %lu, max queue depth %u, locks %lu, lock waits %lu, lock conflicts %lu%s\n",
+            i, b->n_transfers, b->n_queued, b->max_depth, b->n_locks, b->n_lock_waits, b->n_lock_conflicts, b->locked > 0 ? ", locked" : "");
+    }
+}
+
+extern "C" void SSP0_IRQHandler(void)
+{
+    if(buses[0] != nullptr) buses[0]->on_irq();
+    else LPC_SSP0->IMSC= 0;
+}
+
+extern "C" void SSP1_IRQHandler(void)
+{
+    if(buses[1] != nullptr) buses[1]->on_irq();
+    else LPC_SSP1->IMSC= 0;
+}
@@ -0,0 +1,108 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPIBUS_H
+#define SPIBUS_H
+
+#include "mbed.h"
+
+#include <functional>
+#include <stdint.h>
+
+class Pin;
+class StreamOutput;
+
+// One transfer on a shared bus. The device owns it and reuses it for every transfer so nothing is allocated.
+// Frames of up to 8 bits use uint8_t buffers, wider frames use uint16_t buffers
+class SPITransaction
+{
+    public:
+        SPITransaction();
+
+        // precalculates the SSP registers for this device, the chip select is active low
+        void setup(Pin *cs, int bits, int mode, int hz);
+        bool is_busy() const { return busy; }
+
+        const void *tx;
+        void *rx;
+        uint16_t length;
+
+        // optional, called from the SSP interrupt once the chip select has been released
+        std::function<void(SPITransaction*)> done;
+
+    private:
+        friend class SPIBus;
+        SPITransaction *next;
+        Pin *cs;
+        uint32_t cr0;
+        uint8_t cpsr;
+        uint8_t bits;
+        uint16_t sent;
+        uint16_t received;
+        volatile bool busy;
+};
+
+// Schedules the transfers of every device on one SSP channel. Transfers are queued and run from the SSP interrupt
+// so the caller does not wait for the bus, devices that drive an mbed::SPI directly lock the bus around their transfers.
+// An interrupt can not wait for the main loop to unlock, so interrupts that lock the bus (the USB mass storage reading
+// the sdcard) must be added with add_interrupt_user, they are held off while the main loop has the bus locked
+class SPIBus : public mbed::SPI
+{
+    public:
+        static SPIBus *get(int channel);
+        static void dump_stats(StreamOutput *stream);
+
+        // returns false if the transaction is still in flight from the last time it was queued
+        bool queue(SPITransaction *t);
+
+        // locks the bus and runs the transaction to completion
+        void transfer(SPITransaction *t);
+
+        // waits for the transfer in flight then holds the bus until unlock, queued transfers are started again on unlock.
+        // From an interrupt only if it was added with add_interrupt_user
+        void lock();
+        void unlock();
+        void add_interrupt_user(IRQn_Type irq);
+
+        void on_irq();
+
+        // RAII helper for code that talks to the bus through an mbed::SPI
+        class Lock {
+            public:
+                Lock(SPIBus *bus) : bus(bus) { if(bus != nullptr) bus->lock(); }
+                ~Lock() { if(bus != nullptr) bus->unlock(); }
+            private:
+                SPIBus *bus;
+        };
+
+    private:
+        SPIBus(PinName mosi, PinName miso, PinName sclk, IRQn_Type irq);
+        void start(SPITransaction *t);
+        void service();
+        void wait_idle();
+
+        LPC_SSP_TypeDef *ssp;
+        SPITransaction *head;
+        SPITransaction *tail;
+        SPITransaction *volatile current;
+        IRQn_Type irq;
+        volatile uint8_t locked;
+        // interrupts that lock the bus, and those of them that were enabled when the main loop locked it
+        uint32_t interrupt_users;
+        uint32_t held_off;
+
+        // contention counters, shown by the spi command
+        uint32_t n_transfers;
+        uint32_t n_queued;
+        uint32_t n_locks;
+        uint32_t n_lock_waits;
+        uint32_t n_lock_conflicts;
+        uint16_t depth;
+        uint16_t max_depth;
+};
+
+#endif
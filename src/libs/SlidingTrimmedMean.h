@@ -0,0 +1,109 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SLIDINGTRIMMEDMEAN_H
+#define SLIDINGTRIMMEDMEAN_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Keeps the last length samples both in arrival order and sorted, and maintains the sum of the middle half of the
+// sorted samples as each new sample replaces the oldest one. This gives the same result as sorting the last length
+// samples and summing the middle half, but a new sample costs a binary search and a short memmove within the sorted
+// window and reading the sum or median is O(1)
+template<int length> class SlidingTrimmedMean {
+    public:
+        SlidingTrimmedMean() { reset(0); }
+
+        void reset(uint16_t value);
+        void push(uint16_t value);
+
+        // sum of the middle length/2 samples
+        uint32_t trimmed_sum() const { return sum; }
+        uint16_t median() const { return sorted[length / 2]; }
+
+    private:
+        // the sorted samples in [lo, hi) are the ones that are summed
+        static const int lo = length / 4;
+        static const int hi = length - (length / 4);
+
+        int lower_bound(uint16_t value) const;
+        int upper_bound(uint16_t value) const;
+
+        uint16_t history[length];
+        uint16_t sorted[length];
+        uint32_t sum;
+        uint16_t head;
+};
+
+template<int length> void SlidingTrimmedMean<length>::reset(uint16_t value)
+{
+    for (int i = 0; i < length; ++i) {
+        history[i] = sorted[i] = value;
+    }
+    sum = (uint32_t)value * (hi - lo);
+    head = 0;
+}
+
+// first index in sorted that is >= value
+template<int length> int SlidingTrimmedMean<length>::lower_bound(uint16_t value) const
+{
+    int l = 0, h = length;
+    while (l < h) {
+        int mid = (l + h) / 2;
+        if (sorted[mid] < value) l = mid + 1;
+        else h = mid;
+    }
+    return l;
+}
+
+// first index in sorted that is > value
+template<int length> int SlidingTrimmedMean<length>::upper_bound(uint16_t value) const
+{
+    int l = 0, h = length;
+    while (l < h) {
+        int mid = (l + h) / 2;
+        if (sorted[mid] <= value) l = mid + 1;
+        else h = mid;
+    }
+    return l;
+}
+
+template<int length> void SlidingTrimmedMean<length>::push(uint16_t value)
+{
+    uint16_t old = history[head];
+    history[head] = value;
+    if (++head == length) head = 0;
+    if (old == value) return;
+
+    // the oldest sample is at p in the sorted window, the samples between it and where the new value goes shift by one
+    // towards p and the new value is put at q. The change to the middle sum is calculated from the old sorted values
+    // before they are moved: the shifted samples inside [lo, hi) telescope to the difference of the two end values
+    int p = lower_bound(old);
+    int32_t delta = 0;
+    int q;
+    if (value > old) {
+        q = upper_bound(value) - 1;
+        int a = (p > lo) ? p : lo;
+        int b = (q < hi) ? q : hi;
+        if (a < b) delta += sorted[b] - sorted[a];
+        if (q >= lo && q < hi) delta += value - sorted[q];
+        memmove(&sorted[p], &sorted[p + 1], (q - p) * sizeof(uint16_t));
+
+    } else {
+        q = upper_bound(value);
+        int a = (q + 1 > lo) ? q + 1 : lo;
+        int b = (p < hi - 1) ? p : hi - 1;
+        if (a <= b) delta += sorted[a - 1] - sorted[b];
+        if (q >= lo && q < hi) delta += value - sorted[q];
+        memmove(&sorted[q + 1], &sorted[q], (p - q) * sizeof(uint16_t));
+    }
+    sorted[q] = value;
+    sum += delta;
+}
+
+#endif
@@ -17,6 +17,7 @@ using namespace std;
 #include "Gcode.h"
 
 #include <mri.h>
+#include "us_ticker_api.h" // mbed.h lib
 
 // This module uses a Timer to periodically call hooks
 // Modules register with a function ( callback ) and a frequency, and we then call that function at the given frequency.
@@ -58,6 +59,18 @@ void SlowTicker::set_frequency( int frequency ){
     flag_1s_count= SystemCoreClock>>2;
 }
 
+// Change the frequency an attached hook is called at
+void SlowTicker::set_hook_frequency( Hook *hook, uint32_t frequency ){
+    __disable_irq();
+    hook->interval = floorf((SystemCoreClock/4)/frequency);
+    hook->countdown = hook->interval;
+    if( frequency > this->max_frequency ){
+        this->max_frequency = frequency;
+        this->set_frequency(frequency);
+    }
+    __enable_irq();
+}
+
 // The actual interrupt being called by the timer, this is where work is done
 void SlowTicker::tick(){
 
@@ -67,7 +80,14 @@ void SlowTicker::tick(){
         if (hook->countdown < 0)
         {
             hook->countdown += hook->interval;
-            hook->call();
+            if(!hook->deferred) {
+                hook->call();
+
+            }else if(!hook->due) {
+                // on_idle will call it
+                hook->due_timestamp= us_ticker_read();
+                hook->due= true;
+            }
         }
     }
 
@@ -118,6 +138,15 @@ void SlowTicker::on_idle(void*)
         leds[2]= (ledcnt++ & 0x1000) ? 1 : 0;
     }
 
+    // call any deferred hooks the interrupt has flagged as due, the vector is only modified in the main loop so is safe to iterate here
+    for (Hook* hook : this->hooks){
+        if(hook->due) {
+            uint32_t timestamp= hook->due_timestamp;
+            hook->due= false;
+            hook->call(timestamp);
+        }
+    }
+
     // if interrupt has set the 1 second flag
     if (flag_1s())
         // fire the on_second_tick event
@@ -29,14 +29,29 @@ class SlowTicker : public Module{
         void on_idle(void*);
         void start();
         void set_frequency( int frequency );
+        void set_hook_frequency( Hook *hook, uint32_t frequency );
         void tick();
         // For some reason this can't go in the .cpp, see :  http://mbed.org/forum/mbed/topic/2774/?page=1#comment-14221
         // TODO replace this with std::function()
         template<typename T> Hook* attach( uint32_t frequency, T *optr, uint32_t ( T::*fptr )( uint32_t ) ){
+            return attach(frequency, optr, fptr, false);
+        }
+
+        // The hook is not called in the timer interrupt, it is flagged as due there and called from on_idle, so it can take
+        // longer and block without adding jitter to the other interrupts. All due hooks are called once per idle pass,
+        // missed periods are coalesced, and the hook is passed the us_ticker_read() time it became due so it can calculate
+        // the actual period between calls
+        template<typename T> Hook* attach_deferred( uint32_t frequency, T *optr, uint32_t ( T::*fptr )( uint32_t ) ){
+            return attach(frequency, optr, fptr, true);
+        }
+
+    private:
+        template<typename T> Hook* attach( uint32_t frequency, T *optr, uint32_t ( T::*fptr )( uint32_t ), bool deferred ){
             Hook* hook = new Hook();
             hook->interval = floorf((SystemCoreClock/4)/frequency);
             hook->attach(optr, fptr);
             hook->countdown = hook->interval;
+            hook->deferred = deferred;
 
             // to avoid race conditions we must stop the interupts before updating this non thread safe vector
             __disable_irq();
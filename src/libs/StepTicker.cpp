@@ -53,6 +53,8 @@ StepTicker::StepTicker()
     this->num_motors = 0;
 
     this->running = false;
+    this->sync_waiting = false;
+    this->waiting_for_shaper = false;
     this->current_block = nullptr;
 
     #ifdef STEPTICKER_DEBUG_PIN
@@ -93,6 +95,59 @@ void StepTicker::set_unstep_time( float microseconds )
     // TODO check that the unstep time is less than the step period, if not slow down step ticker
 }
 
+void StepTicker::set_velocity_fnc(std::function<void(const Block*)> fnc, uint32_t interval)
+{
+    __disable_irq();
+    velocity_fnc= fnc;
+    velocity_interval= (interval < 1) ? 1 : interval;
+    velocity_count= 0;
+    __enable_irq();
+}
+
+void StepTicker::set_sync_position_fnc(std::function<uint32_t()> fnc, uint32_t counts_per_rev)
+{
+    __disable_irq();
+    sync_position_fnc= fnc;
+    sync_counts_per_rev= (counts_per_rev < 1) ? 1 : counts_per_rev;
+    __enable_irq();
+}
+
+void StepTicker::set_pressure_advance(uint8_t m, float k)
+{
+    if(m >= k_max_actuators) return;
+    __disable_irq();
+    advance[m].set_k(k, frequency);
+    advance_motors.set(m, advance[m].is_enabled());
+    if(!advance[m].is_enabled()) advance[m].reset();
+    __enable_irq();
+}
+
+bool StepTicker::set_input_shaper(uint8_t m, InputShaper::TYPE type, float hz, float damping, float max_steps_per_second)
+{
+    if(m >= k_max_actuators) return false;
+
+    // the interrupt leaves it alone once it is off
+    __disable_irq();
+    shaped_motors.reset(m);
+    __enable_irq();
+
+    bool ok= shaper[m].configure(type, hz, damping, frequency, max_steps_per_second);
+
+    __disable_irq();
+    shaped_motors.set(m, shaper[m].is_enabled());
+    __enable_irq();
+    return ok;
+}
+
+bool StepTicker::is_shaping() const
+{
+    if(shaped_motors.none()) return false;
+    for (uint8_t m = 0; m < num_motors; m++) {
+        if(shaped_motors[m] && !shaper[m].is_idle()) return true;
+    }
+    return false;
+}
+
 // Reset step pins on any motor that was stepped
 void StepTicker::unstep_tick()
 {
@@ -102,6 +157,16 @@ void StepTicker::unstep_tick()
         }
     }
     this->unstep.reset();
+
+    // after an advance step that went against the block, so there is a whole tick before the next step of the block
+    if(this->redirect.any()) {
+        for (int i = 0; i < num_motors; i++) {
+            if(this->redirect[i] && current_block != nullptr) {
+                this->motor[i]->set_direction(current_block->direction_bits[i]);
+            }
+        }
+        this->redirect.reset();
+    }
 }
 
 extern "C" void TIMER1_IRQHandler (void)
@@ -135,79 +200,151 @@ void StepTicker::step_tick (void)
 {
     //SET_STEPTICKER_DEBUG_PIN(running ? 1 : 0);
 
+    ++shaper_now;
+
     // if nothing has been setup we ignore the ticks
     if(!running){
-        // check if anything new available
-        if(THECONVEYOR->get_next_block(&current_block)) { // returns false if no new block is available
+        // check if anything new available, or if the block that was waiting for the shapers can go now
+        if(waiting_for_shaper || THECONVEYOR->get_next_block(&current_block)) { // returns false if no new block is available
             running= start_next_block(); // returns true if there is at least one motor with steps to issue
-            if(!running) return;
-        }else{
+        }
+        if(!running) {
+            if(THEKERNEL->is_halted()) {
+                if(shaped_motors.any() || advance_motors.any()) halt_motion();
+            } else {
+                // the shaped motion carries on for a while after the last shaped block
+                if(shaped_motors.any()) shape_step();
+                // and what the advance still has pushed ahead when the moves run out is pulled back
+                for (uint8_t m = 0; m < num_motors; m++) {
+                    if(advance_motors[m] && advance[m].get_position() != 0) advance_step(m, advance[m].want(0));
+                }
+            }
+            if(unstep.any()) {
+                LPC_TIM1->TCR = 3;
+                LPC_TIM1->TCR = 1;
+            }
             return;
         }
+        // update the velocity follower on the first tick of the block
+        velocity_count= velocity_interval - 1;
     }
 
     if(THEKERNEL->is_halted()) {
         running= false;
         current_tick = 0;
         current_block= nullptr;
+        halt_motion();
         return;
     }
 
+    // the advance steps the extruders want this tick, worked out before the block's steps so the two can be merged
+    int8_t want[k_max_actuators];
+    bool advancing= advance_motors.any() && current_block->sync_counts == 0;
+    if(advancing) {
+        for (uint8_t m = 0; m < num_motors; m++) {
+            want[m]= advance_motors[m] ? advance_want(m) : 0;
+        }
+    }
+
+    bool shaping= shaped_motors.any() && is_shaped(current_block);
+
     bool still_moving= false;
-    // foreach motor, if it is active see if time to issue a step to that motor
-    for (uint8_t m = 0; m < num_motors; m++) {
-        if(current_block->tick_info[m].steps_to_move == 0) continue; // not active
-
-        current_block->tick_info[m].steps_per_tick += current_block->tick_info[m].acceleration_change;
-
-        if(current_tick == current_block->tick_info[m].next_accel_event) {
-            if(current_tick == current_block->accelerate_until) { // We are done accelerating, deceleration becomes 0 : plateau
-                current_block->tick_info[m].acceleration_change = 0;
-                if(current_block->decelerate_after < current_block->total_move_ticks) {
-                    current_block->tick_info[m].next_accel_event = current_block->decelerate_after;
-                    if(current_tick != current_block->decelerate_after) { // We are plateauing
-                        // steps/sec / tick frequency to get steps per tick
-                        current_block->tick_info[m].steps_per_tick = current_block->tick_info[m].plateau_rate;
+    if(current_block->sync_counts > 0) {
+        // synchronized to the spindle, the trapezoid is not used
+        still_moving= sync_step();
+
+    } else {
+        // foreach motor, if it is active see if time to issue a step to that motor
+        for (uint8_t m = 0; m < num_motors; m++) {
+            if(current_block->tick_info[m].steps_to_move == 0) continue; // not active
+
+            current_block->tick_info[m].steps_per_tick += current_block->tick_info[m].acceleration_change;
+
+            if(current_tick == current_block->tick_info[m].next_accel_event) {
+                if(current_tick == current_block->accelerate_until) { // We are done accelerating, deceleration becomes 0 : plateau
+                    current_block->tick_info[m].acceleration_change = 0;
+                    if(current_block->decelerate_after < current_block->total_move_ticks) {
+                        current_block->tick_info[m].next_accel_event = current_block->decelerate_after;
+                        if(current_tick != current_block->decelerate_after) { // We are plateauing
+                            // steps/sec / tick frequency to get steps per tick
+                            current_block->tick_info[m].steps_per_tick = current_block->tick_info[m].plateau_rate;
+                        }
                     }
                 }
-            }
 
-            if(current_tick == current_block->decelerate_after) { // We start decelerating
-                current_block->tick_info[m].acceleration_change = current_block->tick_info[m].deceleration_change;
+                if(current_tick == current_block->decelerate_after) { // We start decelerating
+                    current_block->tick_info[m].acceleration_change = current_block->tick_info[m].deceleration_change;
+                }
             }
-        }
-
-        // protect against rounding errors and such
-        if(current_block->tick_info[m].steps_per_tick <= 0) {
-            current_block->tick_info[m].counter = STEPTICKER_FPSCALE; // we force completion this step by setting to 1.0
-            current_block->tick_info[m].steps_per_tick = 0;
-        }
-
-        current_block->tick_info[m].counter += current_block->tick_info[m].steps_per_tick;
 
-        if(current_block->tick_info[m].counter >= STEPTICKER_FPSCALE) { // >= 1.0 step time
-            current_block->tick_info[m].counter -= STEPTICKER_FPSCALE; // -= 1.0F;
-            ++current_block->tick_info[m].step_count;
+            // protect against rounding errors and such
+            if(current_block->tick_info[m].steps_per_tick <= 0) {
+                current_block->tick_info[m].counter = STEPTICKER_FPSCALE; // we force completion this step by setting to 1.0
+                current_block->tick_info[m].steps_per_tick = 0;
+            }
 
-            // step the motor
-            bool ismoving= motor[m]->step(); // returns false if the moving flag was set to false externally (probes, endstops etc)
-            // we stepped so schedule an unstep
-            unstep.set(m);
+            current_block->tick_info[m].counter += current_block->tick_info[m].steps_per_tick;
+
+            if(current_block->tick_info[m].counter >= STEPTICKER_FPSCALE) { // >= 1.0 step time
+                current_block->tick_info[m].counter -= STEPTICKER_FPSCALE; // -= 1.0F;
+                ++current_block->tick_info[m].step_count;
+
+                bool ismoving;
+                if(shaping && shaped_motors[m]) {
+                    // the shaper steps the motor after this, see shape_step
+                    shaper[m].push(shaper_now, current_block->direction_bits[m]);
+                    ismoving= motor[m]->is_moving();
+
+                } else if(turned[m]) {
+                    // it was turned round for an advance step the other way, which this step of the block is taken as
+                    advance[m].moved(current_block->direction_bits[m] ? 1 : -1);
+                    motor[m]->set_direction(current_block->direction_bits[m]);
+                    turned.reset(m);
+                    want[m]= 0;
+                    ismoving= motor[m]->is_moving();
+
+                } else if(advancing && want[m] < 0 && !current_block->direction_bits[m]) {
+                    // the advance wants one back just as the block wants one forward, so neither is stepped
+                    advance[m].moved(-1);
+                    want[m]= 0;
+                    ismoving= motor[m]->is_moving();
+
+                } else {
+                    // step the motor
+                    ismoving= motor[m]->step(); // returns false if the moving flag was set to false externally (probes, endstops etc)
+                    // we stepped so schedule an unstep
+                    unstep.set(m);
+                }
 
-            if(!ismoving || current_block->tick_info[m].step_count == current_block->tick_info[m].steps_to_move) {
-                // done
-                current_block->tick_info[m].steps_to_move = 0;
-                motor[m]->stop_moving(); // let motor know it is no longer moving
+                if(!ismoving || current_block->tick_info[m].step_count == current_block->tick_info[m].steps_to_move) {
+                    // done
+                    current_block->tick_info[m].steps_to_move = 0;
+                    motor[m]->stop_moving(); // let motor know it is no longer moving
+                }
             }
+
+            // see if any motors are still moving after this tick
+            if(motor[m]->is_moving()) still_moving= true;
         }
+    }
 
-        // see if any motors are still moving after this tick
-        if(motor[m]->is_moving()) still_moving= true;
+    // the advance steps that were not merged, one that wants the same way as a block step that was just issued waits a tick
+    if(advancing) {
+        for (uint8_t m = 0; m < num_motors; m++) {
+            if(want[m] != 0 && !unstep[m]) advance_step(m, want[m]);
+        }
     }
 
+    if(shaped_motors.any()) shape_step();
+
     // do this after so we start at tick 0
     current_tick++; // count number of ticks
 
+    if(velocity_fnc && ++velocity_count >= velocity_interval) {
+        velocity_count= 0;
+        velocity_fnc(current_block);
+    }
+
     // We may have set a pin on in this tick, now we reset the timer to set it off
     // Note there could be a race here if we run another tick before the unsteps have happened,
     // right now it takes about 3-4us but if the unstep were near 10uS or greater it would be an issue
@@ -237,6 +374,12 @@ void StepTicker::step_tick (void)
             running= false;
         }
 
+        // the next block may be a different speed or not a G1 at all so don't wait for the interval
+        if(velocity_fnc) {
+            velocity_count= 0;
+            velocity_fnc(running ? current_block : nullptr);
+        }
+
         // all moves finished
         // we delegate the slow stuff to the pendsv handler which will run as soon as this interrupt exits
         //NVIC_SetPendingIRQ(PendSV_IRQn); this doesn't work
@@ -244,11 +387,31 @@ void StepTicker::step_tick (void)
     }
 }
 
+// what the shapers still had to step and what the advance had pushed ahead is dropped, the position is lost on a halt
+// anyway and the next move after it must start from none
+void StepTicker::halt_motion()
+{
+    for (uint8_t m = 0; m < num_motors; m++) {
+        shaper[m].reset();
+        advance[m].reset();
+    }
+    turned.reset();
+    waiting_for_shaper= false;
+}
+
 // only called from the step tick ISR (single consumer)
 bool StepTicker::start_next_block()
 {
     if(current_block == nullptr) return false;
 
+    // a block that is not shaped, like a homing or probing move, waits for the shaped motion before it to finish
+    bool shaping= shaped_motors.any() && is_shaped(current_block);
+    if(shaped_motors.any() && !shaping && is_shaping()) {
+        waiting_for_shaper= true;
+        return false;
+    }
+    waiting_for_shaper= false;
+
     bool ok= false;
     // need to prepare each active motor
     for (uint8_t m = 0; m < num_motors; m++) {
@@ -258,12 +421,25 @@ bool StepTicker::start_next_block()
         // set direction bit here
         // NOTE this would be at least 10us before first step pulse.
         // TODO does this need to be done sooner, if so how without delaying next tick
-        motor[m]->set_direction(current_block->direction_bits[m]);
+        // the shaper turns its motors as the shaped motion needs
+        if(!(shaping && shaped_motors[m])) motor[m]->set_direction(current_block->direction_bits[m]);
+        turned.reset(m);
         motor[m]->start_moving(); // also let motor know it is moving now
     }
 
     current_tick= 0;
 
+    if(ok && current_block->sync_counts > 0) {
+        // worked out once here so each tick only needs a multiply
+        for (uint8_t m = 0; m < num_motors; m++) {
+            sync_scale[m]= ((uint64_t)current_block->tick_info[m].steps_to_move << 32) / current_block->sync_counts;
+        }
+        uint32_t pos= sync_position_fnc ? sync_position_fnc() : 0;
+        sync_start= pos;
+        sync_angle= pos % sync_counts_per_rev;
+        sync_waiting= current_block->sync_phase;
+    }
+
     if(ok) {
         //SET_STEPTICKER_DEBUG_PIN(1);
         return true;
@@ -278,6 +454,112 @@ bool StepTicker::start_next_block()
 }
 
 
+// only extruding moves that also move X, Y or Z are advanced, so a retract or prime is done as it is asked for
+int8_t StepTicker::advance_want(uint8_t m) const
+{
+    int64_t rate= 0;
+    bool moves_axes= current_block->steps[X_AXIS] > 0 || current_block->steps[Y_AXIS] > 0 || current_block->steps[Z_AXIS] > 0;
+    if(current_block->steps[m] > 0 && !current_block->direction_bits[m] && moves_axes) {
+        rate= current_block->tick_info[m].steps_per_tick;
+    }
+    return advance[m].want(rate);
+}
+
+// an extra step on an extruder for pressure advance. One that is going the other way is turned round this tick and
+// stepped on the next so the driver sees the direction first, as in shape_step, then put back on unstep
+void StepTicker::advance_step(uint8_t m, int8_t dir)
+{
+    // direction true is backwards
+    bool backwards= dir < 0;
+    if(motor[m]->which_direction() != backwards) {
+        motor[m]->set_direction(backwards);
+        if(current_block != nullptr) turned.set(m, backwards != current_block->direction_bits[m]);
+        return;
+    }
+    motor[m]->step();
+    unstep.set(m);
+    advance[m].moved(dir);
+    if(turned[m]) {
+        turned.reset(m);
+        redirect.set(m);
+    }
+}
+
+bool StepTicker::is_shaped(const Block *block) const
+{
+    return block->is_g123 && block->sync_counts == 0;
+}
+
+// steps the shaped motors towards the shaped motion, a motor that has to turn round is turned this tick and stepped on
+// the next so the driver sees the direction first
+void StepTicker::shape_step()
+{
+    for (uint8_t m = 0; m < num_motors; m++) {
+        if(!shaped_motors[m]) continue;
+
+        int dir= shaper[m].want(shaper_now);
+        if(dir == 0) continue;
+
+        bool backwards= dir < 0;
+        if(motor[m]->which_direction() != backwards) {
+            motor[m]->set_direction(backwards);
+            continue;
+        }
+        motor[m]->step();
+        unstep.set(m);
+        shaper[m].moved(dir);
+    }
+}
+
+// steps each motor of a synchronized move towards where the encoder says it should be, the moves are position locked to
+// the spindle so the thread comes out right at any spindle speed, as long as the motors can keep up at one step a tick
+bool StepTicker::sync_step()
+{
+    uint32_t pos= sync_position_fnc ? sync_position_fnc() : sync_start;
+    bool reverse= current_block->sync_reverse;
+
+    if(sync_waiting) {
+        // start each pass at the same spindle angle so repeated threading passes line up
+        uint32_t angle= pos % sync_counts_per_rev;
+        bool crossed= reverse ? angle > sync_angle : angle < sync_angle;
+        sync_angle= angle;
+        if(!crossed) return true;
+        sync_waiting= false;
+        sync_start= reverse ? pos - angle + sync_counts_per_rev : pos - angle;
+    }
+
+    int32_t done= pos - sync_start;
+    if(reverse) done= -done;
+    if(done < 0) {
+        // the spindle still turns the other way, eg it is slowing down to reverse at the bottom of a tapped hole
+        sync_start= pos;
+        done= 0;
+    }
+
+    bool still_moving= false;
+    for (uint8_t m = 0; m < num_motors; m++) {
+        if(current_block->tick_info[m].steps_to_move == 0) continue;
+
+        uint32_t target= (done * sync_scale[m]) >> 32;
+        if(current_block->tick_info[m].step_count < target) {
+            ++current_block->tick_info[m].step_count;
+            ++sync_steps;
+
+            bool ismoving= motor[m]->step();
+            unstep.set(m);
+
+            if(!ismoving || current_block->tick_info[m].step_count == current_block->tick_info[m].steps_to_move) {
+                current_block->tick_info[m].steps_to_move = 0;
+                motor[m]->stop_moving();
+            }
+        }
+
+        if(motor[m]->is_moving()) still_moving= true;
+    }
+
+    return still_moving;
+}
+
 // returns index of the stepper motor in the array and bitset
 int StepTicker::register_motor(StepperMotor* m)
 {
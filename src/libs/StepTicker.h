@@ -17,6 +17,8 @@
 
 #include "ActuatorCoordinates.h"
 #include "TSRingBuffer.h"
+#include "PressureAdvance.h"
+#include "InputShaper.h"
 
 class StepperMotor;
 class Block;
@@ -43,23 +45,68 @@ class StepTicker{
         // whatever setup the block should register this to know when it is done
         std::function<void()> finished_fnc{nullptr};
 
+        // called from the step interrupt every interval ticks with the block being stepped, at the start of each block and
+        // with nullptr when there are no more blocks, so something like a laser can follow the velocity. Must not use floats
+        void set_velocity_fnc(std::function<void(const Block*)> fnc, uint32_t interval);
+
+        // the spindle encoder position in counts that synchronized moves follow, read every tick of such a move
+        void set_sync_position_fnc(std::function<uint32_t()> fnc, uint32_t counts_per_rev);
+        // counts the steps of synchronized moves, it stops changing when the spindle does not move the axes on
+        uint32_t get_sync_steps() const { return sync_steps; }
+
+        // K in seconds for the extruder on motor, 0 turns pressure advance off
+        void set_pressure_advance(uint8_t motor, float k);
+
+        // shapes the G1, G2 and G3 moves of motor, what it still had to step is lost so the caller waits for the queue and
+        // any shaped motion to finish first. false if there was no memory
+        bool set_input_shaper(uint8_t motor, InputShaper::TYPE type, float hz, float damping, float max_steps_per_second);
+        bool is_shaping() const;
+
         static StepTicker *getInstance() { return instance; }
 
     private:
         static StepTicker *instance;
 
         bool start_next_block();
+        void halt_motion();
+        bool sync_step();
+        int8_t advance_want(uint8_t m) const;
+        void advance_step(uint8_t m, int8_t dir);
+        bool is_shaped(const Block *block) const;
+        void shape_step();
 
         float frequency;
         uint32_t period;
         std::array<StepperMotor*, k_max_actuators> motor;
         std::bitset<k_max_actuators> unstep;
 
+        PressureAdvance advance[k_max_actuators];
+        std::bitset<k_max_actuators> advance_motors;    // motors with pressure advance on
+        std::bitset<k_max_actuators> redirect;          // motors turned round for an advance step, put back on unstep
+        std::bitset<k_max_actuators> turned;            // motors turned round for an advance step to be issued next tick
+
+        InputShaper shaper[k_max_actuators];
+        std::bitset<k_max_actuators> shaped_motors;     // motors with input shaping on
+        uint32_t shaper_now{0};                         // ticks, the shapers' clock
+
         Block *current_block;
         uint32_t current_tick{0};
 
+        std::function<void(const Block*)> velocity_fnc{nullptr};
+        uint32_t velocity_interval{1};
+        uint32_t velocity_count{0};
+
+        std::function<uint32_t()> sync_position_fnc{nullptr};
+        uint32_t sync_counts_per_rev{1};
+        uint32_t sync_start;        // encoder position the synchronized move started from
+        uint32_t sync_angle;        // last angle seen while waiting for angle 0
+        uint64_t sync_scale[k_max_actuators]; // steps per encoder count of each motor, 32.32 fixed point
+        volatile uint32_t sync_steps{0};
+
         struct {
             volatile bool running:1;
+            bool sync_waiting:1;
+            bool waiting_for_shaper:1;          // current_block is not shaped and waits for the shaped motion to finish
             uint8_t num_motors:4;
         };
 };
@@ -128,6 +128,9 @@ static const uint8_t OXFF = 0xFF;
 
 SDCard::SDCard(PinName mosi, PinName miso, PinName sclk, PinName cs) :
   _spi(mosi, miso, sclk), _cs(cs) {
+    // the bus is got when the card is initialized, this runs during static initialization
+    _channel = (mosi == P0_18) ? 0 : 1;
+    _bus = nullptr;
     _cs.output();
     _cs = 1;
     busyflag = false;
@@ -257,6 +260,8 @@ SDCard::CARD_TYPE SDCard::initialise_card_v2() {
 
 int SDCard::disk_initialize()
 {
+    if(_bus == nullptr) _bus = SPIBus::get(_channel);
+    SPIBus::Lock lock(_bus);
     busyflag = true;
 
     _sectors = 0;
@@ -290,6 +295,7 @@ int SDCard::disk_write(const char *buffer, uint32_t block_number)
         return 0;
 
     busyflag = true;
+    SPIBus::Lock lock(_bus);
 
     if (cardtype == SDCARD_FAIL)
         return -1;
@@ -312,6 +318,7 @@ int SDCard::disk_read(char *buffer, uint32_t block_number)
         return 0;
 
     busyflag = true;
+    SPIBus::Lock lock(_bus);
 
     if (cardtype == SDCARD_FAIL)
         return -1;
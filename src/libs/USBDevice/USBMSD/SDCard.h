@@ -30,6 +30,7 @@
 
 #include "disk.h"
 #include "mbed.h"
+#include "SPIBus.h"
 
 // #include "DMA.h"
 
@@ -81,6 +82,8 @@ public:
     CARD_TYPE card_type(void);
 
     bool busy();
+    // nullptr until disk_initialize
+    SPIBus *get_bus() const { return _bus; }
 
 protected:
 
@@ -101,6 +104,10 @@ protected:
     mbed::SPI _spi;
     GPIO _cs;
 
+    // shared with the other devices on the same SSP, locked for each disk operation
+    SPIBus *_bus;
+    int _channel;
+
     volatile bool busyflag;
 
     CARD_TYPE cardtype;
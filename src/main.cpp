@@ -58,6 +58,7 @@
 #include "version.h"
 #include "system_LPC17xx.h"
 #include "platform_memory.h"
+#include "BootTrace.h"
 
 #include "mbed.h"
 
@@ -92,19 +93,23 @@ GPIO leds[5] = {
 
 void init() {
 
-    // Default pins to low status
+    Kernel* kernel = new Kernel();
+
+    // Default pins to low status, unless the config gives the pin to something else (P1.20 is the spindle encoder on the QEI)
     for (int i = 0; i < 5; i++){
+        if(kernel->config->pin_users(leds[i].port, leds[i].pin) > 0) continue;
         leds[i].output();
         leds[i]= 0;
     }
 
-    Kernel* kernel = new Kernel();
-
     kernel->streams->printf("Smoothie Running @%ldMHz\r\n", SystemCoreClock / 1000000);
     SimpleShell::version_command("", kernel->streams);
 
+    BOOT_STAGE_AS("SD card", nullptr);
     bool sdok= (sd.disk_initialize() == 0);
     if(!sdok) kernel->streams->printf("SDCard failed to initialize\r\n");
+    // the USB mass storage reads and writes the sdcard from the USB interrupt
+    if(sd.get_bus() != nullptr) sd.get_bus()->add_interrupt_user(USB_IRQn);
 
     #ifdef NONETWORK
         kernel->streams->printf("NETWORK is disabled\r\n");
@@ -125,72 +130,92 @@ void init() {
 #endif
 
     // Create and add main modules
+    BOOT_STAGE("Player");
     kernel->add_module( new(AHB0) Player() );
 
+    BOOT_STAGE("CurrentControl");
     kernel->add_module( new(AHB0) CurrentControl() );
+    BOOT_STAGE("KillButton");
     kernel->add_module( new(AHB0) KillButton() );
+    BOOT_STAGE("PlayLed");
     kernel->add_module( new(AHB0) PlayLed() );
 
     // these modules can be completely disabled in the Makefile by adding to EXCLUDE_MODULES
     #ifndef NO_TOOLS_ENDSTOPS
+    BOOT_STAGE("Endstops");
     kernel->add_module( new(AHB0) Endstops() );
     #endif
 
     #ifndef NO_TOOLS_SWITCH
+    BOOT_STAGE("Switch");
     SwitchPool *sp= new SwitchPool();
     sp->load_tools();
     delete sp;
     #endif
     #ifndef NO_TOOLS_EXTRUDER
     // NOTE this must be done first before Temperature control so ToolManager can handle Tn before temperaturecontrol module does
+    BOOT_STAGE("Extruder");
     ExtruderMaker *em= new ExtruderMaker();
     em->load_tools();
     delete em;
     #endif
     #ifndef NO_TOOLS_TEMPERATURECONTROL
     // Note order is important here must be after extruder so Tn as a parameter will get executed first
+    BOOT_STAGE("TemperatureControl");
     TemperatureControlPool *tp= new TemperatureControlPool();
     tp->load_tools();
     delete tp;
     #endif
     #ifndef NO_TOOLS_LASER
+    BOOT_STAGE("Laser");
     kernel->add_module( new Laser() );
     #endif
     #ifndef NO_TOOLS_SPINDLE
+    BOOT_STAGE("Spindle");
     SpindleMaker *sm= new SpindleMaker();
     sm->load_spindle();
     delete sm;
     //kernel->add_module( new(AHB0) Spindle() );
     #endif
     #ifndef NO_UTILS_PANEL
+    BOOT_STAGE("Panel");
     kernel->add_module( new(AHB0) Panel() );
     #endif
     #ifndef NO_TOOLS_ZPROBE
+    BOOT_STAGE("ZProbe");
     kernel->add_module( new(AHB0) ZProbe() );
     #endif
     #ifndef NO_TOOLS_SCARACAL
+    BOOT_STAGE("SCARAcal");
     kernel->add_module( new(AHB0) SCARAcal() );
     #endif
     #ifndef NO_TOOLS_ROTARYDELTACALIBRATION
+    BOOT_STAGE("RotaryDeltaCalibration");
     kernel->add_module( new(AHB0) RotaryDeltaCalibration() );
     #endif
     #ifndef NONETWORK
+    BOOT_STAGE("Network");
     kernel->add_module( new Network() );
     #endif
     #ifndef NO_TOOLS_TEMPERATURESWITCH
     // Must be loaded after TemperatureControl
+    BOOT_STAGE("TemperatureSwitch");
     kernel->add_module( new(AHB0) TemperatureSwitch() );
     #endif
     #ifndef NO_TOOLS_DRILLINGCYCLES
+    BOOT_STAGE("Drillingcycles");
     kernel->add_module( new(AHB0) Drillingcycles() );
     #endif
     #ifndef NO_TOOLS_FILAMENTDETECTOR
+    BOOT_STAGE("FilamentDetector");
     kernel->add_module( new(AHB0) FilamentDetector() );
     #endif
     #ifndef NO_UTILS_MOTORDRIVERCONTROL
+    BOOT_STAGE("MotorDriverControl");
     kernel->add_module( new MotorDriverControl(0) );
     #endif
     // Create and initialize USB stuff
+    BOOT_STAGE("USB");
     u.init();
 
 #ifdef DISABLEMSD
@@ -235,6 +260,7 @@ void init() {
         leds[3]= sdok?1:0; // 4th led indicates sdcard is available (TODO maye should indicate config was found)
     }
 
+    BOOT_STAGE_AS("config override", nullptr);
     if(sdok) {
         // load config override file if present
         // NOTE only Mxxx commands that set values should be put in this file. The file is generated by M500
@@ -254,9 +280,14 @@ void init() {
     }
 
     // start the timers and interrupts
+    BOOT_STAGE_AS("start", nullptr);
     THEKERNEL->conveyor->start(THEROBOT->get_number_registered_motors());
     THEKERNEL->step_ticker->start();
     THEKERNEL->slow_ticker->start();
+
+    boot_trace.finish(us_ticker_read());
+    HEAP_TRACE_TAG(nullptr);
+    boot_trace.summary(kernel->streams);
 }
 
 int main()
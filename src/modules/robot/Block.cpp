@@ -70,6 +70,13 @@ void Block::clear()
     is_g123             = false;
     locked              = false;
     s_value             = 0.0F;
+    speed_ratio_scale   = 0;
+    primary_motor       = 0;
+    pixels              = nullptr;
+    n_pixels            = 0;
+    sync_counts         = 0;
+    sync_reverse        = false;
+    sync_phase          = false;
 
     total_move_ticks= 0;
     if(tick_info == nullptr) {
@@ -317,6 +324,15 @@ void Block::prepare(float acceleration_in_steps, float deceleration_in_steps)
     double acceleration_per_tick = acceleration_in_steps * fp_scale; // this is now scaled to fit a 2.30 fixed point number
     double deceleration_per_tick = deceleration_in_steps * fp_scale;
 
+    // precalculate the scale for get_speed_ratio, a very slow move saturates it and just reads as full speed most of the time
+    this->primary_motor= 0;
+    for (uint8_t m = 1; m < n_actuators; m++) {
+        if(this->steps[m] > this->steps[this->primary_motor]) this->primary_motor= m;
+    }
+    double nominal_spt= ((this->nominal_rate * inv * this->steps[this->primary_motor]) / STEP_TICKER_FREQUENCY) * (1LL << 30);
+    double ratio_scale= (nominal_spt > 0) ? (double)(1LL << 48) / nominal_spt : 0;
+    this->speed_ratio_scale= (ratio_scale >= 4294967295.0) ? 0xFFFFFFFFUL : (uint32_t)ratio_scale;
+
     for (uint8_t m = 0; m < n_actuators; m++) {
         uint32_t steps = this->steps[m];
         this->tick_info[m].steps_to_move = steps;
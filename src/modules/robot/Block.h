@@ -27,6 +27,16 @@ class Block {
         void clear();
         float get_trapezoid_rate(int i) const;
 
+        // fraction of the nominal rate the primary motor is currently stepping at in 1.16 fixed point, only integer maths
+        // so it can be used from the step interrupt
+        uint32_t get_speed_ratio() const
+        {
+            int64_t spt= tick_info[primary_motor].steps_per_tick;
+            if(spt <= 0) return 0;
+            uint32_t r= ((uint64_t)(uint32_t)(spt >> 32) * speed_ratio_scale) >> 32;
+            return (r > 65536) ? 65536 : r;
+        }
+
     private:
         float max_allowable_speed( float acceleration, float target_velocity, float distance);
         void prepare(float acceleration_in_steps, float deceleration_in_steps);
@@ -68,6 +78,17 @@ class Block {
         // need info for each active motor
         tickinfo_t *tick_info;
 
+        // the motor with the most steps, and 2^48 over its nominal steps per tick in 2.30 fixed point, for get_speed_ratio
+        uint32_t speed_ratio_scale;
+        uint8_t primary_motor;
+
+        // a laser raster line, the power of each of n_pixels equal parts of the primary motor's steps, see Laser G7
+        const uint8_t *pixels;
+        uint16_t n_pixels;
+
+        // encoder counts the spindle turns during a spindle synchronized move, 0 for a normal move, see SpindleSync
+        uint32_t sync_counts;
+
         static uint8_t n_actuators;
 
         struct {
@@ -79,5 +100,7 @@ class Block {
             volatile bool is_ticking:1;          // set when this block is being actively ticked by the stepticker
             volatile bool locked:1;              // set to true when the critical data is being updated, stepticker will have to skip if this is set
             uint16_t s_value:12;                 // for laser 1.11 Fixed point
+            bool sync_reverse:1;                 // the synchronized move follows the spindle turning backwards
+            bool sync_phase:1;                   // the synchronized move starts when the spindle comes round to angle 0
         };
 };
@@ -114,10 +114,11 @@ void Conveyor::on_idle(void*)
 
 // see if we are idle
 // this checks the block queue is empty, and that the step queue is empty and
-// checks that all motors are no longer moving
+// checks that all motors are no longer moving, including the input shapers which step on after the last block
 bool Conveyor::is_idle() const
 {
     if(queue.is_empty()) {
+        if(THEKERNEL->step_ticker->is_shaping()) return false;
         for(auto &a : THEROBOT->actuators) {
             if(a->is_moving()) return false;
         }
@@ -139,7 +140,7 @@ void Conveyor::wait_for_idle(bool wait_for_motors)
     }
 
     if(wait_for_motors) {
-        // now we wait for all motors to stop moving
+        // now we wait for all motors to stop moving and the input shapers to finish
         while(!is_idle()) {
             THEKERNEL->call_event(ON_IDLE, this);
         }
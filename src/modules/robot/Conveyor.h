@@ -36,6 +36,7 @@ public:
     float get_current_feedrate() const { return current_feedrate; }
 
     friend class Planner; // for queue
+    friend class TestConveyor; // for queue, the test framework's stand in for the planner
 
 private:
     void check_queue(bool force= false);
@@ -50,7 +50,7 @@ void Planner::config_load()
 
 
 // Append a block to the queue, compute it's speed factors
-bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors, float rate_mm_s, float distance, float *unit_vec, float acceleration, float s_value, bool g123)
+bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors, float rate_mm_s, float distance, float *unit_vec, float acceleration, float s_value, bool g123, const uint8_t *pixels, uint16_t n_pixels)
 {
     // Create ( recycle ) a new block
     Block* block = THECONVEYOR->queue.head_ref();
@@ -80,6 +80,16 @@ bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors,
     // info needed by laser
     block->s_value = roundf(s_value*(1<<11)); // 1.11 fixed point
     block->is_g123 = g123;
+    block->pixels = pixels;
+    block->n_pixels = n_pixels;
+
+    // a spindle synchronized move, the step ticker follows the encoder rather than the trapezoid
+    const Robot::spindle_sync_t &sync = THEROBOT->get_spindle_sync();
+    if(sync.counts_per_mm > 0) {
+        block->sync_counts = std::max(1L, lroundf(distance * sync.counts_per_mm));
+        block->sync_reverse = sync.reverse;
+        block->sync_phase = sync.phase;
+    }
 
     // use default JD
     float junction_deviation = this->junction_deviation;
@@ -87,6 +87,12 @@
 
 #define laser_module_default_power_checksum     CHECKSUM("laser_module_default_power")
 
+#define input_shaping_checksum              CHECKSUM("input_shaping")
+#define type_checksum                       CHECKSUM("type")
+#define damping_checksum                    CHECKSUM("damping")
+#define x_frequency_checksum                CHECKSUM("x_frequency")
+#define y_frequency_checksum                CHECKSUM("y_frequency")
+
 #define ARC_ANGULAR_TRAVEL_EPSILON 5E-7F // Float (radians)
 #define PI 3.14159265358979323846F // force to be float, do not use M_PI
 
@@ -106,6 +112,12 @@ Robot::Robot()
     this->clearToolOffset();
     this->compensationTransform = nullptr;
     this->get_e_scale_fnc= nullptr;
+    this->raster_pixels= nullptr;
+    this->raster_n_pixels= 0;
+    this->shaper_type= InputShaper::NONE;
+    this->shaper_frequency[X_AXIS]= this->shaper_frequency[Y_AXIS]= 0;
+    this->shaper_damping= 0.1F;
+    this->spindle_sync= {0, false, false};
     this->wcs_offsets.fill(wcs_t(0.0F, 0.0F, 0.0F));
     this->g92_offset = wcs_t(0.0F, 0.0F, 0.0F);
     this->next_command_is_MCS = false;
@@ -141,8 +153,11 @@ void Robot::load_config()
     if (this->arm_solution) delete this->arm_solution;
     int solution_checksum = get_checksum(THEKERNEL->config->value(arm_solution_checksum)->by_default("cartesian")->as_string());
     // Note checksums are not const expressions when in debug mode, so don't use switch
+    // input shaping works on the first two motors, which only move X and Y on a cartesian or corexy
+    this->shaping_allowed= false;
     if(solution_checksum == hbot_checksum || solution_checksum == corexy_checksum) {
         this->arm_solution = new HBotSolution(THEKERNEL->config);
+        this->shaping_allowed= true;
 
     } else if(solution_checksum == corexz_checksum) {
         this->arm_solution = new CoreXZSolution(THEKERNEL->config);
@@ -161,9 +176,11 @@ void Robot::load_config()
 
     } else if(solution_checksum == cartesian_checksum) {
         this->arm_solution = new CartesianSolution(THEKERNEL->config);
+        this->shaping_allowed= true;
 
     } else {
         this->arm_solution = new CartesianSolution(THEKERNEL->config);
+        this->shaping_allowed= true;
     }
 
     this->feed_rate           = THEKERNEL->config->value(default_feed_rate_checksum   )->by_default(  100.0F)->as_number();
@@ -259,9 +276,32 @@ void Robot::load_config()
     for (size_t i = 0; i < n_motors; i++)
         actuators[i]->change_last_milestone(actuator_pos[i]);
 
+    // input shaping of the first two motors, which are X and Y on a cartesian and A and B on a corexy
+    this->shaper_type= InputShaper::type_from_string(THEKERNEL->config->value(input_shaping_checksum, type_checksum)->by_default("none")->as_string().c_str());
+    if(this->shaper_type != InputShaper::NONE && !this->shaping_allowed) {
+        THEKERNEL->streams->printf("WARNING: input shaping needs a cartesian or corexy arm solution, it is off\n");
+        this->shaper_type= InputShaper::NONE;
+    }
+    this->shaper_damping= THEKERNEL->config->value(input_shaping_checksum, damping_checksum)->by_default(0.1F)->as_number();
+    this->shaper_frequency[X_AXIS]= THEKERNEL->config->value(input_shaping_checksum, x_frequency_checksum)->by_default(0)->as_number();
+    this->shaper_frequency[Y_AXIS]= THEKERNEL->config->value(input_shaping_checksum, y_frequency_checksum)->by_default(0)->as_number();
+    set_input_shaping();
+
     //this->clearToolOffset();
 }
 
+// the step ticker drops what a shaper still had to step, so this is only called at boot before anything moves or after
+// waiting for the queue and the shaped motion to finish
+void Robot::set_input_shaping()
+{
+    for (int a = X_AXIS; a <= Y_AXIS; ++a) {
+        float steps_per_second= actuators[a]->get_max_rate() * actuators[a]->get_steps_per_mm();
+        if(!THEKERNEL->step_ticker->set_input_shaper(a, (InputShaper::TYPE)shaper_type, shaper_frequency[a], shaper_damping, steps_per_second)) {
+            THEKERNEL->streams->printf("WARNING: no memory for input shaping of %c\n", 'X' + a);
+        }
+    }
+}
+
 uint8_t Robot::register_motor(StepperMotor *motor)
 {
     // register this motor with the step ticker
@@ -737,6 +777,28 @@ void Robot::on_gcode_received(void *argument)
                 }
                 break;
 
+            case 593: // M593 Xnnn Ynnn - input shaping resonant frequency of each axis in Hz, 0 turns it off, Dnnn - damping ratio
+                if(!shaping_allowed) {
+                    gcode->is_error= true;
+                    gcode->txt_after_ok= "input shaping needs a cartesian or corexy arm solution";
+                    break;
+                }
+                if(gcode->has_letter('X') || gcode->has_letter('Y') || gcode->has_letter('D')) {
+                    if(shaper_type == InputShaper::NONE) {
+                        gcode->stream->printf("input_shaping.type is not set\n");
+                        break;
+                    }
+                    if(gcode->has_letter('X')) shaper_frequency[X_AXIS]= std::max(0.0F, gcode->get_value('X'));
+                    if(gcode->has_letter('Y')) shaper_frequency[Y_AXIS]= std::max(0.0F, gcode->get_value('Y'));
+                    if(gcode->has_letter('D')) shaper_damping= gcode->get_value('D');
+                    // run out the queue and the shaped motion first
+                    THEKERNEL->conveyor->wait_for_idle();
+                    set_input_shaping();
+                } else {
+                    gcode->stream->printf("Input shaping X:%1.1f Hz Y:%1.1f Hz D:%1.3f\n", shaper_frequency[X_AXIS], shaper_frequency[Y_AXIS], shaper_damping);
+                }
+                break;
+
             case 220: // M220 - speed override percentage
                 if (gcode->has_letter('S')) {
                     float factor = gcode->get_value('S');
@@ -778,6 +840,10 @@ void Robot::on_gcode_received(void *argument)
 
                 gcode->stream->printf(";X- Junction Deviation, Z- Z junction deviation, S - Minimum Planner speed mm/sec:\nM205 X%1.5f Z%1.5f S%1.5f\n", THEKERNEL->planner->junction_deviation, isnan(THEKERNEL->planner->z_junction_deviation)?-1:THEKERNEL->planner->z_junction_deviation, THEKERNEL->planner->minimum_planner_speed);
 
+                if(shaper_type != InputShaper::NONE) {
+                    gcode->stream->printf(";Input shaping frequencies Hz, damping:\nM593 X%1.2f Y%1.2f D%1.4f\n", shaper_frequency[X_AXIS], shaper_frequency[Y_AXIS], shaper_damping);
+                }
+
                 gcode->stream->printf(";Max cartesian feedrates in mm/sec:\nM203 X%1.5f Y%1.5f Z%1.5f\n", this->max_speeds[X_AXIS], this->max_speeds[Y_AXIS], this->max_speeds[Z_AXIS]);
 
                 gcode->stream->printf(";Max actuator feedrates in mm/sec:\nM203.1 ");
@@ -1227,7 +1293,9 @@ bool Robot::append_milestone(const float target[], float rate_mm_s)
 
     // Append the block to the planner
     // NOTE that distance here should be either the distance travelled by the XYZ axis, or the E mm travel if a solo E move
-    if(THEKERNEL->planner->append_block( actuator_pos, n_motors, rate_mm_s, distance, auxilliary_move ? nullptr : unit_vec, acceleration, s_value, is_g123)) {
+    if(THEKERNEL->planner->append_block( actuator_pos, n_motors, rate_mm_s, distance, auxilliary_move ? nullptr : unit_vec, acceleration, s_value, is_g123, raster_pixels, raster_n_pixels)) {
+        // only the first segment of a synchronized move waits for the spindle angle, the rest carry on from it
+        spindle_sync.phase= false;
         // this is the new compensated machine position
         memcpy(this->compensated_machine_position, transformed_target, n_motors*sizeof(float));
         return true;
@@ -44,6 +44,17 @@ class Robot : public Module {
         float get_feed_rate() const;
         float get_s_value() const { return s_value; }
         void set_s_value(float s) { s_value= s; }
+        // the moves appended until this is cleared are laser raster lines with these pixel powers
+        void set_raster(const uint8_t *pixels, uint16_t n) { raster_pixels= pixels; raster_n_pixels= n; }
+
+        // the moves appended while counts_per_mm is set follow the spindle encoder, see SpindleSync
+        struct spindle_sync_t {
+            float counts_per_mm;    // encoder counts per mm of travel, 0 for normal moves
+            bool reverse;           // the spindle turns backwards
+            bool phase;             // wait for the spindle to come round to angle 0, cleared once a move is appended
+        };
+        void set_spindle_sync(const spindle_sync_t &s) { spindle_sync= s; }
+        const spindle_sync_t &get_spindle_sync() const { return spindle_sync; }
         void  push_state();
         void  pop_state();
         void check_max_actuator_speeds();
@@ -86,6 +97,7 @@ class Robot : public Module {
             bool segment_z_moves:1;
             bool save_g92:1;                                  // save g92 on M500 if set
             bool is_g123:1;
+            bool shaping_allowed:1;                           // the arm solution moves X and Y with the first two motors
             uint8_t plane_axis_0:2;                           // Current plane ( XY, XZ, YZ )
             uint8_t plane_axis_1:2;
             uint8_t plane_axis_2:2;
@@ -101,6 +113,7 @@ class Robot : public Module {
         };
 
         void load_config();
+        void set_input_shaping();
         bool append_milestone(const float target[], float rate_mm_s);
         bool append_line( Gcode* gcode, const float target[], float rate_mm_s, float delta_e);
         bool append_arc( Gcode* gcode, const float target[], const float offset[], float radius, bool is_clockwise );
@@ -132,7 +145,12 @@ class Robot : public Module {
         float delta_segments_per_second;                     // Setting : Used to split lines into segments for delta based on speed
         float seconds_per_minute;                            // for realtime speed change
         float default_acceleration;                          // the defualt accleration if not set for each axis
+        float shaper_frequency[2];                           // input shaping resonant frequency of X and Y, 0 when off
+        float shaper_damping;
         float s_value;                                       // modal S value
+        const uint8_t *raster_pixels;                        // set by the laser for a raster line
+        uint16_t raster_n_pixels;
+        spindle_sync_t spindle_sync;
 
         // Number of arc generation iterations by small angle approximation before exact arc trajectory
         // correction. This parameter may be decreased if there are issues with the accuracy of the arc
@@ -143,6 +161,7 @@ class Robot : public Module {
         float max_speeds[3];                                 // Setting : max allowable speed in mm/s for each axis
 
         uint8_t n_motors;                                    //count of the motors/axis registered
+        uint8_t shaper_type;                                 // InputShaper::TYPE
 
         // Used by Planner
         friend class Planner;
@@ -75,7 +75,9 @@ http://www.tormach.com/g81_g89_backgroung.html
 
 /!\ This code expects a clean gcode, no fail safe at this time.
 
-Implemented     : G80-83, G98, G99
+Implemented     : G80-84, G98, G99
+G84 needs spindle.sync_enable and spindle.encoder_pha_pin and encoder_phb_pin, K is the thread pitch, and a spindle
+                  that M4 reverses (Huanyang VFD)
 Absolute mode   : yes
 Relative mode   : no
 Incremental (L) : no
@@ -89,6 +91,7 @@ void Drillingcycles::reset_sticky()
     this->sticky_f = 0; // feedrate
     this->sticky_q = 0; // peck drilling increment
     this->sticky_p = 0; // dwell in seconds
+    this->sticky_k = 0; // tapping pitch
 }
 
 /* update all sticky values, called before each hole */
@@ -99,6 +102,7 @@ void Drillingcycles::update_sticky(Gcode *gcode)
     if (gcode->has_letter('F')) this->sticky_f = gcode->get_value('F');
     if (gcode->has_letter('Q')) this->sticky_q = gcode->get_value('Q');
     if (gcode->has_letter('P')) this->sticky_p = gcode->get_int('P');
+    if (gcode->has_letter('K')) this->sticky_k = gcode->get_value('K');
 
     // set retract plane
     if (this->retract_type == RETRACT_TO_Z)
@@ -188,6 +192,36 @@ void Drillingcycles::make_hole(Gcode *gcode)
     this->send_gcode("G0 Z%1.4f", this->r_plane);
 }
 
+/* G84: rigid tapping, the feed follows the spindle so F is not used */
+void Drillingcycles::tap_hole(Gcode *gcode)
+{
+    // compile X and Y values
+    char x[16] = "";
+    char y[16] = "";
+    if (gcode->has_letter('X'))
+        snprintf(x, sizeof(x), " X%1.4f", gcode->get_value('X'));
+    if (gcode->has_letter('Y'))
+        snprintf(y, sizeof(y), " Y%1.4f", gcode->get_value('Y'));
+
+    // rapids to X/Y
+    this->send_gcode("G0%s%s", x, y);
+    // rapids to retract position (R)
+    this->send_gcode("G0 Z%1.4f", this->sticky_r);
+    // tap to depth and back out to R with the spindle reversing at the bottom, it is refused if the spindle can not
+    // reverse so its errors are the G84's
+    char line[32];
+    snprintf(line, sizeof(line), "G33.1 Z%1.4f K%1.4f", this->sticky_z, this->sticky_k);
+    Gcode tap(line, gcode->stream);
+    THEKERNEL->call_event(ON_GCODE_RECEIVED, &tap);
+    if(tap.is_error) {
+        gcode->is_error= true;
+        gcode->txt_after_ok= tap.txt_after_ok;
+        return;
+    }
+    // rapids retract at R-Plane (Initial-Z or R)
+    this->send_gcode("G0 Z%1.4f", this->r_plane);
+}
+
 void Drillingcycles::on_gcode_received(void* argument)
 {
     // received gcode
@@ -243,5 +277,9 @@ void Drillingcycles::on_gcode_received(void* argument)
             this->update_sticky(gcode);
             this->make_hole(gcode);
         }
+        else if (code == 84) {
+            this->update_sticky(gcode);
+            this->tap_hole(gcode);
+        }
     }
 }
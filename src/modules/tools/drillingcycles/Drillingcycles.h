@@ -27,6 +27,7 @@ class Drillingcycles : public Module
         int  send_gcode(const char* format, ...);
         void make_hole(Gcode *gcode);
         void peck_hole();
+        void tap_hole(Gcode *gcode);
 
         bool cycle_started; // cycle status
         int  retract_type;  // rretract type
@@ -40,6 +41,7 @@ class Drillingcycles : public Module
 
         float sticky_q;     // depth increment
         int   sticky_p;     // dwell pause
+        float sticky_k;     // thread pitch
 
         int   dwell_units;  // units for dwell
 };
@@ -29,6 +29,7 @@
 #include "StepTicker.h"
 #include "BaseSolution.h"
 #include "SerialMessage.h"
+#include "EdgeTrigger.h"
 
 #include <ctype.h>
 #include <algorithm>
@@ -60,6 +61,9 @@ enum DEFNS {MIN_PIN, MAX_PIN, MAX_TRAVEL, FAST_RATE, SLOW_RATE, RETRACT, DIRECTI
 
 #define endstop_debounce_count_checksum  CHECKSUM("endstop_debounce_count")
 #define endstop_debounce_ms_checksum     CHECKSUM("endstop_debounce_ms")
+#define endstop_interrupts_checksum      CHECKSUM("endstop_interrupts")
+#define endstop_glitch_filter_checksum   CHECKSUM("endstop_glitch_filter_us")
+#define homing_slow_zone_checksum        CHECKSUM("homing_slow_zone_mm")
 
 #define home_z_first_checksum            CHECKSUM("home_z_first")
 #define homing_order_checksum            CHECKSUM("homing_order")
@@ -129,7 +133,17 @@ void Endstops::on_module_loaded()
     register_for_event(ON_GET_PUBLIC_DATA);
     register_for_event(ON_SET_PUBLIC_DATA);
 
+    // if enabled homing endstops on ports 0 and 2 stop their motors from the pin interrupt, the others are only polled.
+    // Off by default as the interrupt only has the glitch filter, endstop_debounce_ms and endstop_debounce_count are not used
+    if(THEKERNEL->config->value(endstop_interrupts_checksum)->by_default(false)->as_bool()) {
+        for (size_t i = 0; i < homing_axis.size(); ++i) {
+            endstop_info_t *info= homing_axis[i].pin_info;
+            if(info == nullptr || homing_axis[i].axis_index >= THEROBOT->actuators.size()) continue;
+            info->trigger= EdgeTrigger::create(&info->pin, glitch_filter_us, STEPPER[homing_axis[i].axis_index], [this, i]() { on_endstop_edge(i); });
+        }
+    }
 
+    // still polled with interrupts as a switch that is already pressed when the move starts has no edge
     THEKERNEL->slow_ticker->attach(1000, this, &Endstops::read_endstops);
 }
 
@@ -148,6 +162,7 @@ bool Endstops::load_old_config()
 
         // init homing struct
         hinfo.home_offset= 0;
+        hinfo.overshoot= 0;
         hinfo.homed= false;
         hinfo.axis= 'X'+i;
         hinfo.axis_index= i;
@@ -188,6 +203,9 @@ bool Endstops::load_old_config()
 
             // init struct
             info->debounce= 0;
+            info->trigger= nullptr;
+            info->trigger_position= 0;
+            info->triggered= false;
             info->axis= 'X'+i;
             info->axis_index= i;
 
@@ -234,6 +252,7 @@ bool Endstops::load_config()
         homing_info_t t;
         t.axis= 0;
         t.axis_index= 0;
+        t.overshoot= 0;
         t.pin_info= nullptr;
 
         temp_axis_array.fill(t);
@@ -275,6 +294,9 @@ bool Endstops::load_config()
 
         // init pin struct
         pin_info->debounce= 0;
+        pin_info->trigger= nullptr;
+        pin_info->trigger_position= 0;
+        pin_info->triggered= false;
         pin_info->axis= toupper(axis[0]);
         pin_info->axis_index= i;
 
@@ -302,6 +324,7 @@ bool Endstops::load_config()
 
         // init homing struct
         hinfo.home_offset= 0;
+        hinfo.overshoot= 0;
         hinfo.homed= false;
         hinfo.axis= toupper(axis[0]);
         hinfo.axis_index= i;
@@ -338,6 +361,7 @@ bool Endstops::load_config()
                 homing_info_t t;
                 t.axis= 'X' + i;
                 t.axis_index= i;
+                t.overshoot= 0;
                 t.pin_info= nullptr; // this tells it that it cannot be used for homing
                 homing_axis.push_back(t);
             }
@@ -363,6 +387,12 @@ void Endstops::get_global_configs()
     this->debounce_ms= THEKERNEL->config->value(endstop_debounce_ms_checksum)->by_default(0)->as_number();
     this->debounce_count= THEKERNEL->config->value(endstop_debounce_count_checksum)->by_default(100)->as_number();
 
+    // an edge is ignored unless the pin stays active this long, it is waited for in the interrupt so keep it short
+    this->glitch_filter_us= std::min(100, std::max(0, THEKERNEL->config->value(endstop_glitch_filter_checksum)->by_default(10)->as_int()));
+
+    // if set the approach after the retract is fast until this far from where the endstop triggered, then slow
+    this->slow_zone= THEKERNEL->config->value(homing_slow_zone_checksum)->by_default(0)->as_number();
+
     this->is_corexy= THEKERNEL->config->value(corexy_homing_checksum)->by_default(false)->as_bool();
     this->is_delta=  THEKERNEL->config->value(delta_homing_checksum)->by_default(false)->as_bool();
     this->is_rdelta= THEKERNEL->config->value(rdelta_homing_checksum)->by_default(false)->as_bool();
@@ -535,7 +565,8 @@ uint32_t Endstops::read_endstops(uint32_t dummy)
     if(this->status != MOVING_TO_ENDSTOP_SLOW && this->status != MOVING_TO_ENDSTOP_FAST) return 0; // not doing anything we need to monitor for
 
     // check each homing endstop
-    for(auto& e : homing_axis) { // check all axis homing endstops
+    for (size_t i = 0; i < homing_axis.size(); ++i) { // check all axis homing endstops
+        homing_info_t& e= homing_axis[i];
         if(e.pin_info == nullptr) continue; // ignore if not a homing endstop
         int m= e.axis_index;
 
@@ -549,16 +580,7 @@ uint32_t Endstops::read_endstops(uint32_t dummy)
                     e.pin_info->debounce++;
 
                 } else {
-                    if(is_corexy && (m == X_AXIS || m == Y_AXIS)) {
-                        // corexy when moving in X or Y we need to stop both the X and Y motors
-                        STEPPER[X_AXIS]->stop_moving();
-                        STEPPER[Y_AXIS]->stop_moving();
-
-                    }else{
-                        // we signal the motor to stop, which will preempt any moves on that axis
-                        STEPPER[m]->stop_moving();
-                    }
-                    e.pin_info->triggered= true;
+                    stop_on_endstop(i, STEPPER[m]->get_current_step());
                 }
 
             } else {
@@ -571,6 +593,71 @@ uint32_t Endstops::read_endstops(uint32_t dummy)
     return 0;
 }
 
+// Called from the edge trigger interrupt of a homing endstop once the edge has passed the glitch filter
+void Endstops::on_endstop_edge(size_t i)
+{
+    if(this->status != MOVING_TO_ENDSTOP_SLOW && this->status != MOVING_TO_ENDSTOP_FAST) return;
+
+    homing_info_t& e= homing_axis[i];
+    int m= e.axis_index;
+    if(is_corexy && (m == X_AXIS || m == Y_AXIS) && !axis_to_home[m]) return;
+
+    // if it is not moving yet it will be caught by read_endstops once it is
+    if(STEPPER[m]->is_moving()) {
+        stop_on_endstop(i, e.pin_info->trigger->get_edge_position());
+    }
+}
+
+// position is the step position of the motor when the endstop triggered, only the first one is kept
+void Endstops::stop_on_endstop(size_t i, int32_t position)
+{
+    homing_info_t& e= homing_axis[i];
+    int m= e.axis_index;
+
+    if(is_corexy && (m == X_AXIS || m == Y_AXIS)) {
+        // corexy when moving in X or Y we need to stop both the X and Y motors
+        STEPPER[X_AXIS]->stop_moving();
+        STEPPER[Y_AXIS]->stop_moving();
+
+    }else{
+        // we signal the motor to stop, which will preempt any moves on that axis
+        STEPPER[m]->stop_moving();
+    }
+
+    if(!e.pin_info->triggered) {
+        e.pin_info->trigger_position= position;
+        e.pin_info->triggered= true;
+    }
+}
+
+void Endstops::arm_triggers(bool on)
+{
+    for(auto& e : homing_axis) {
+        if(e.pin_info == nullptr || e.pin_info->trigger == nullptr) continue;
+        if(on) e.pin_info->trigger->arm();
+        else e.pin_info->trigger->disarm();
+    }
+}
+
+// moves the axes being homed n times their retract distance less the given distance, towards or away from the endstops
+void Endstops::homing_move(float n, float less, bool towards, float rate)
+{
+    float delta[homing_axis.size()];
+    for (size_t i = 0; i < homing_axis.size(); ++i) delta[i]= 0;
+
+    for (auto& i : homing_axis) {
+        int c= i.axis_index;
+        if(axis_to_home[c]) {
+            delta[c]= i.retract * n - less;
+            if(i.home_direction == towards) delta[c]= -delta[c];
+        }
+    }
+
+    THEROBOT->delta_move(delta, rate, homing_axis.size());
+    // wait until finished
+    THECONVEYOR->wait_for_idle();
+}
+
 void Endstops::home_xy()
 {
     if(axis_to_home[X_AXIS] && axis_to_home[Y_AXIS]) {
@@ -614,6 +701,7 @@ void Endstops::home(axis_bitmap_t a)
 
     // Start moving the axes to the origin
     this->status = MOVING_TO_ENDSTOP_FAST;
+    arm_triggers(true);
 
     THEROBOT->disable_segmentation= true; // we must disable segmentation as this won't work with it enabled
 
@@ -652,6 +740,7 @@ void Endstops::home(axis_bitmap_t a)
     for (size_t i = X_AXIS; i <= Z_AXIS; ++i) {
         if((axis_to_home[i] || this->is_delta || this->is_rdelta) && !homing_axis[i].pin_info->triggered) {
             this->status = NOT_HOMING;
+            arm_triggers(false);
             THEKERNEL->call_event(ON_HALT, nullptr);
             return;
         }
@@ -662,6 +751,7 @@ void Endstops::home(axis_bitmap_t a)
         for (size_t i = A_AXIS; i < homing_axis.size(); ++i) {
             if(axis_to_home[i] && !homing_axis[i].pin_info->triggered) {
                 this->status = NOT_HOMING;
+                arm_triggers(false);
                 THEKERNEL->call_event(ON_HALT, nullptr);
                 return;
             }
@@ -675,40 +765,66 @@ void Endstops::home(axis_bitmap_t a)
         THEROBOT->reset_position_from_current_actuator_position();
     }
 
-    // Move back a small distance for all homing axis
-    this->status = MOVING_BACK;
-    float delta[homing_axis.size()];
-    for (size_t i = 0; i < homing_axis.size(); ++i) delta[i]= 0;
-
-    // use minimum feed rate of all axes that are being homed (sub optimal, but necessary)
+    // use minimum feed rates of all axes that are being homed (sub optimal, but necessary)
     float feed_rate= homing_axis[X_AXIS].slow_rate;
+    float fast_rate= homing_axis[X_AXIS].fast_rate;
+    bool two_speed= slow_zone > 0;
     for (auto& i : homing_axis) {
-        int c= i.axis_index;
-        if(axis_to_home[c]) {
-            delta[c]= i.retract;
-            if(!i.home_direction) delta[c]= -delta[c];
+        if(axis_to_home[i.axis_index]) {
             feed_rate= std::min(i.slow_rate, feed_rate);
+            fast_rate= std::min(i.fast_rate, fast_rate);
+            // there has to be room to go fast
+            if(i.retract <= slow_zone) two_speed= false;
         }
     }
 
-    THEROBOT->delta_move(delta, feed_rate, homing_axis.size());
-    // wait until finished
-    THECONVEYOR->wait_for_idle();
+    // Move back a small distance for all homing axis, which can be fast if we are going to come back fast
+    this->status = MOVING_BACK;
+    homing_move(1, 0, false, two_speed ? fast_rate : feed_rate);
+
+    for(auto& e : endstops) e->triggered= false;
+
+    if(two_speed) {
+        // we now know where the endstops are so come back fast to the slow zone before them, still stopping if one triggers
+        this->status = MOVING_TO_ENDSTOP_SLOW;
+        homing_move(1, slow_zone, true, fast_rate);
+
+        bool early= false;
+        for(auto& e : endstops) {
+            early |= e->triggered;
+            e->triggered= false;
+        }
+
+        if(early) {
+            // an endstop triggered before the slow zone so it was not a clean hit, do the full slow approach instead
+            this->status = MOVING_BACK;
+            homing_move(1, 0, false, feed_rate);
+            two_speed= false;
+        }
+    }
 
     // Start moving the axes towards the endstops slowly
     this->status = MOVING_TO_ENDSTOP_SLOW;
+    if(two_speed) {
+        // through the slow zone and as far again past where it triggered
+        homing_move(0, -2 * slow_zone, true, feed_rate);
+    } else {
+        // move further than we moved off to make sure we hit it cleanly
+        homing_move(2, 0, true, feed_rate);
+    }
+    arm_triggers(false);
+
+    // the motors stopped a little after the endstops triggered, the home position is where they triggered.
+    // On a cartesian each motor is an axis so that can be corrected for when the position is set
     for (auto& i : homing_axis) {
         int c= i.axis_index;
-        if(axis_to_home[c]) {
-            delta[c]= i.retract*2; // move further than we moved off to make sure we hit it cleanly
-            if(i.home_direction) delta[c]= -delta[c];
-        }else{
-            delta[c]= 0;
-        }
+        if(!axis_to_home[c]) continue;
+        i.overshoot= 0;
+        if(i.pin_info == nullptr || !i.pin_info->triggered) continue;
+        if(is_corexy || is_delta || is_rdelta || is_scara) continue;
+        int32_t steps= (int32_t)STEPPER[c]->get_current_step() - i.pin_info->trigger_position;
+        i.overshoot= steps / STEPS_PER_MM(c);
     }
-    THEROBOT->delta_move(delta, feed_rate, homing_axis.size());
-    // wait until finished
-    THECONVEYOR->wait_for_idle();
 
     // we did not complete movement the full distance if we hit the endstops
     // TODO Maybe only reset axis involved in the homing cycle
@@ -862,7 +978,7 @@ void Endstops::process_home_command(Gcode* gcode)
         // so XY are at a known consistent position.  (especially true if using a proximity probe)
         for (auto &p : homing_axis) {
             if (haxis[p.axis_index]) { // if we requested this axis to home
-                THEROBOT->reset_axis_position(p.homing_position + p.home_offset, p.axis_index);
+                THEROBOT->reset_axis_position(p.homing_position + p.home_offset + p.overshoot, p.axis_index);
                 // set flag indicating axis was homed, it stays set once set until H/W reset or unhomed
                 p.homed= true;
             }
@@ -17,6 +17,7 @@
 class StepperMotor;
 class Gcode;
 class Pin;
+class EdgeTrigger;
 
 class Endstops : public Module{
     public:
@@ -40,12 +41,18 @@ class Endstops : public Module{
         void process_home_command(Gcode* gcode);
         void set_homing_offset(Gcode* gcode);
         uint32_t read_endstops(uint32_t dummy);
+        void on_endstop_edge(size_t i);
+        void stop_on_endstop(size_t i, int32_t position);
+        void arm_triggers(bool on);
+        void homing_move(float n, float less, bool towards, float rate);
         void handle_park(Gcode * gcode);
 
         // global settings
         float saved_position[3]{0}; // save G28 (in grbl mode)
         uint32_t debounce_count;
         uint32_t  debounce_ms;
+        uint32_t glitch_filter_us;
+        float slow_zone;
         axis_bitmap_t axis_to_home;
 
         float trim_mm[3];
@@ -53,12 +60,14 @@ class Endstops : public Module{
         // per endstop settings
         using endstop_info_t = struct {
             Pin pin;
+            EdgeTrigger *trigger; // nullptr if the pin is polled
+            int32_t trigger_position; // step position of the motor when it triggered
+            volatile bool triggered; // set from the pin interrupt so it is not in the bitfield
             struct {
                 uint16_t debounce:16;
                 char axis:8; // one of XYZABC
                 uint8_t axis_index:3;
                 bool limit_enable:1;
-                bool triggered:1;
             };
         };
 
@@ -69,6 +78,7 @@ class Endstops : public Module{
             float retract;
             float fast_rate;
             float slow_rate;
+            float overshoot; // how far past the trigger position the slow approach stopped
             endstop_info_t *pin_info;
 
             struct {
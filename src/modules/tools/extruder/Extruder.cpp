@@ -14,6 +14,7 @@
 #include "modules/robot/Block.h"
 #include "StepperMotor.h"
 #include "SlowTicker.h"
+#include "StepTicker.h"
 #include "Config.h"
 #include "StepperMotor.h"
 #include "Robot.h"
@@ -45,6 +46,7 @@
 #define retract_recover_feedrate_checksum    CHECKSUM("retract_recover_feedrate")
 #define retract_zlift_length_checksum        CHECKSUM("retract_zlift_length")
 #define retract_zlift_feedrate_checksum      CHECKSUM("retract_zlift_feedrate")
+#define pressure_advance_checksum            CHECKSUM("pressure_advance")
 
 #define PI 3.14159265358979F
 
@@ -121,6 +123,10 @@ void Extruder::config_load()
     stepper_motor->change_steps_per_mm(steps_per_millimeter);
     stepper_motor->set_selected(false); // not selected by default
     stepper_motor->set_extruder(true);  // indicates it is an extruder
+
+    // pressure advance K in seconds, the filament is pushed ahead by K times the extruder's speed
+    this->pressure_advance = THEKERNEL->config->value(extruder_checksum, this->identifier, pressure_advance_checksum)->by_default(0)->as_number();
+    THEKERNEL->step_ticker->set_pressure_advance(motor_id, this->pressure_advance);
 }
 
 void Extruder::select()
@@ -312,6 +318,16 @@ void Extruder::on_gcode_received(void *argument)
             if(gcode->has_letter('S')) retract_recover_length = gcode->get_value('S');
             if(gcode->has_letter('F')) retract_recover_feedrate = gcode->get_value('F') / 60.0F; // specified in mm/min converted to mm/sec
 
+        } else if (gcode->m == 900 && ( (this->selected && !gcode->has_letter('P')) || (gcode->has_letter('P') && gcode->get_value('P') == this->identifier)) ) {
+            // M900 - set pressure advance K[seconds], 0 turns it off
+            if(gcode->has_letter('K')) {
+                THEKERNEL->conveyor->wait_for_idle();
+                this->pressure_advance = gcode->get_value('K');
+                THEKERNEL->step_ticker->set_pressure_advance(motor_id, this->pressure_advance);
+            } else {
+                gcode->stream->printf("Pressure advance K%1.4f\n", this->pressure_advance);
+            }
+
         } else if (gcode->m == 221 && this->selected) { // M221 S100 change flow rate by percentage
             if(gcode->has_letter('S')) {
                 float last_scale = this->extruder_multiplier;
@@ -334,6 +350,7 @@ void Extruder::on_gcode_received(void *argument)
             gcode->stream->printf(";E retract recover length, feedrate:\nM208 S%1.4f F%1.4f P%d\n", this->retract_recover_length, this->retract_recover_feedrate * 60.0F, this->identifier);
             gcode->stream->printf(";E acceleration mm/sec²:\nM204 E%1.4f P%d\n", stepper_motor->get_acceleration(), this->identifier);
             gcode->stream->printf(";E max feed rate mm/sec:\nM203 E%1.4f P%d\n", stepper_motor->get_max_rate(), this->identifier);
+            gcode->stream->printf(";E pressure advance seconds:\nM900 K%1.4f P%d\n", this->pressure_advance, this->identifier);
             if(this->max_volumetric_rate > 0) {
                 gcode->stream->printf(";E max volumetric rate mm³/sec:\nM203 V%1.4f P%d\n", this->max_volumetric_rate, this->identifier);
             }
@@ -43,6 +43,7 @@ class Extruder : public Tool {
         float filament_diameter;            // filament diameter
         float volumetric_multiplier;
         float max_volumetric_rate;      // used for calculating volumetric rate in mm³/sec
+        float pressure_advance;         // K in seconds, 0 when it is off
 
         // for firmware retract
         float retract_length;               // firmware retract length
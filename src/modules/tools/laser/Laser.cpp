@@ -16,15 +16,20 @@
 #include "ConfigValue.h"
 #include "StepTicker.h"
 #include "Block.h"
-#include "SlowTicker.h"
 #include "Robot.h"
 #include "utils.h"
 #include "Pin.h"
 #include "Gcode.h"
 #include "PwmOut.h" // mbed.h lib
 #include "PublicDataRequest.h"
+#include "cmsis.h"
+#include "platform_memory.h"
 
-#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <vector>
 
 #define laser_checksum                          CHECKSUM("laser")
 #define laser_module_enable_checksum            CHECKSUM("laser_module_enable")
@@ -37,13 +42,80 @@
 #define laser_module_tickle_power_checksum      CHECKSUM("laser_module_tickle_power")
 #define laser_module_max_power_checksum         CHECKSUM("laser_module_max_power")
 #define laser_module_maximum_s_value_checksum   CHECKSUM("laser_module_maximum_s_value")
+#define laser_module_power_curve_checksum       CHECKSUM("laser_module_power_curve")
+#define laser_module_overscan_checksum          CHECKSUM("laser_module_overscan")
 
 
+// the PWM1 channel mbed::PwmOut uses for each of the pins Pin::hardware_pwm() accepts
+static uint8_t pwm_channel_of(const Pin *pin)
+{
+    if(pin->port_number == 1) {
+        switch(pin->pin) {
+            case 18: return 1;
+            case 20: return 2;
+            case 21: return 3;
+            case 23: return 4;
+            case 24: return 5;
+            case 26: return 6;
+        }
+    } else if(pin->port_number == 2 && pin->pin <= 5) {
+        return pin->pin + 1;
+    } else if(pin->port_number == 3) {
+        if(pin->pin == 25) return 2;
+        if(pin->pin == 26) return 3;
+    }
+    return 0;
+}
+
+static volatile uint32_t *pwm_match_register(uint8_t channel)
+{
+    switch(channel) {
+        case 1: return &LPC_PWM1->MR1;
+        case 2: return &LPC_PWM1->MR2;
+        case 3: return &LPC_PWM1->MR3;
+        case 4: return &LPC_PWM1->MR4;
+        case 5: return &LPC_PWM1->MR5;
+        case 6: return &LPC_PWM1->MR6;
+    }
+    return nullptr;
+}
+
+// decodes lowercase base32 (RFC 4648 alphabet in lowercase, no padding) up to the first space, returns the number
+// of bytes or -1 if there is a bad character or more than max bytes
+static int decode_base32(const char *in, uint8_t *out, int max)
+{
+    uint32_t bits = 0;
+    int nbits = 0;
+    int n = 0;
+    for (; *in != '\0' && !isspace(*in); ++in) {
+        uint32_t v;
+        if(*in >= 'a' && *in <= 'z') v = *in - 'a';
+        else if(*in >= '2' && *in <= '7') v = *in - '2' + 26;
+        else return -1;
+
+        bits = (bits << 5) | v;
+        nbits += 5;
+        if(nbits >= 8) {
+            if(n >= max) return -1;
+            nbits -= 8;
+            out[n++] = (bits >> nbits) & 0xFF;
+        }
+    }
+    return n;
+}
+
 Laser::Laser()
 {
     laser_on = false;
     scale= 1;
     manual_fire= false;
+    rasters= nullptr;
+    next_raster= 0;
+    raster_pixels= nullptr;
+    raster_scale= 0;
+    power_curve_used= false;
+    overscan= false;
+    row_open= false;
 }
 
 void Laser::on_module_loaded()
@@ -73,6 +145,8 @@ void Laser::on_module_loaded()
 
 
     this->pwm_inverting = dummy_pin->is_inverting();
+    this->pwm_channel = pwm_channel_of(dummy_pin);
+    this->pwm_match = pwm_match_register(this->pwm_channel);
 
     delete dummy_pin;
     dummy_pin = NULL;
@@ -93,6 +167,7 @@ void Laser::on_module_loaded()
     uint32_t period= THEKERNEL->config->value(laser_module_pwm_period_checksum)->by_default(20)->as_number();
     this->pwm_pin->period_us(period);
     this->pwm_pin->write(this->pwm_inverting ? 1 : 0);
+    this->pwm_period = LPC_PWM1->MR0;
     this->laser_maximum_power = THEKERNEL->config->value(laser_module_maximum_power_checksum)->by_default(1.0f)->as_number() ;
 
     // These config variables are deprecated, they have been replaced with laser_module_maximum_power and laser_module_minimum_power
@@ -104,6 +179,13 @@ void Laser::on_module_loaded()
     // S value that represents maximum (default 1)
     this->laser_maximum_s_value = THEKERNEL->config->value(laser_module_maximum_s_value_checksum)->by_default(1.0f)->as_number() ;
 
+    // powers at evenly spaced speeds from stopped to the nominal speed, for tubes that do not burn in proportion to the speed
+    load_power_curve(THEKERNEL->config->value(laser_module_power_curve_checksum)->by_default("")->as_string().c_str());
+
+    // G7 rows start and end with a laser off run up to the feed rate so the whole row is burnt at constant speed
+    this->overscan = THEKERNEL->config->value(laser_module_overscan_checksum)->by_default(false)->as_bool();
+
+    update_power_gain();
     set_laser_power(0);
 
     //register for events
@@ -112,8 +194,9 @@ void Laser::on_module_loaded()
     this->register_for_event(ON_CONSOLE_LINE_RECEIVED);
     this->register_for_event(ON_GET_PUBLIC_DATA);
 
-    // no point in updating the power more than the PWM frequency, but no more than 1KHz
-    THEKERNEL->slow_ticker->attach(std::min(1000UL, 1000000/period), this, &Laser::set_proportional_power);
+    // the power follows the velocity from the step ticker, no point in updating it more than once per PWM period
+    uint32_t interval = (period * THEKERNEL->step_ticker->get_frequency()) / 1000000;
+    THEKERNEL->step_ticker->set_velocity_fnc([this](const Block *block) { set_step_power(block); }, interval);
 }
 
 void Laser::on_console_line_received( void *argument )
@@ -174,87 +257,217 @@ void Laser::on_gcode_received(void *argument)
         if (gcode->m == 221) { // M221 S100 change laser power by percentage S
             if(gcode->has_letter('S')) {
                 this->scale= gcode->get_value('S') / 100.0F;
+                update_power_gain();
 
             } else {
                 gcode->stream->printf("Laser power scale at %6.2f %%\n", this->scale * 100.0F);
             }
         }
+
+    } else if (gcode->has_g && gcode->g == 7) {
+        raster_line(gcode);
     }
 }
 
-// calculates the current speed ratio from the currently executing block
-float Laser::current_speed_ratio(const Block *block) const
+// G7 I<x per pixel> J<y per pixel> F<feedrate> S<power> D<pixels>
+// engraves a line of pixels from the current position as one move, the power at each pixel is S scaled by its value
+// over 255. The pixels are one byte each, base32 encoded in lowercase so no letter in them can be taken for a G or M
+// code, a comment or a parameter. Longer lines are sent as several G7 which the planner joins at full speed, all but
+// the last with C1 so overscan only runs out at the end of the row.
+// The move is not segmented so this is for cartesian machines
+void Laser::raster_line(Gcode *gcode)
 {
-    // find the primary moving actuator (the one with the most steps)
-    size_t pm= 0;
-    uint32_t max_steps= 0;
-    for (size_t i = 0; i < THEROBOT->get_number_registered_motors(); i++) {
-        // find the motor with the most steps
-        if(block->steps[i] > max_steps) {
-            max_steps= block->steps[i];
-            pm= i;
+    if(THEKERNEL->is_halted()) return;
+
+    const char *data = strchr(gcode->get_command(), 'D');
+    float dx = gcode->has_letter('I') ? THEROBOT->to_millimeters(gcode->get_value('I')) : 0;
+    float dy = gcode->has_letter('J') ? THEROBOT->to_millimeters(gcode->get_value('J')) : 0;
+    if(data == nullptr || (dx == 0 && dy == 0)) {
+        gcode->is_error= true;
+        gcode->txt_after_ok= "G7 needs I or J and D";
+        return;
+    }
+
+    if(rasters == nullptr) {
+        // read from the step interrupt so AHB0 is fine
+        size_t bytes = LASER_RASTER_SLOTS * sizeof(raster_t);
+        rasters = (raster_t *)AHB0.alloc(bytes);
+        if(rasters == nullptr) rasters = (raster_t *)malloc(bytes);
+        if(rasters == nullptr) {
+            gcode->is_error= true;
+            gcode->txt_after_ok= "no memory for raster lines";
+            return;
         }
+        for (int i = 0; i < LASER_RASTER_SLOTS; ++i) rasters[i].busy = false;
     }
 
-    // figure out the ratio of its speed, from 0 to 1 based on where it is on the trapezoid,
-    // this is based on the fraction it is of the requested rate (nominal rate)
-    float ratio= block->get_trapezoid_rate(pm) / block->nominal_rate;
+    // wait for the step interrupt to finish with the line that last used this slot
+    raster_t *r = &rasters[next_raster];
+    while(r->busy) {
+        THEKERNEL->call_event(ON_IDLE, this);
+        if(THEKERNEL->is_halted()) return;
+    }
 
-    return ratio;
+    int n = decode_base32(data + 1, r->pixels, LASER_RASTER_PIXELS);
+    if(n <= 0) {
+        gcode->is_error= true;
+        gcode->txt_after_ok= "bad G7 pixels";
+        return;
+    }
+
+    if(gcode->has_letter('S')) THEROBOT->set_s_value(gcode->get_value('S'));
+    float rate_mm_s = (gcode->has_letter('F') ? THEROBOT->to_millimeters(gcode->get_value('F')) : THEROBOT->get_feed_rate()) / THEROBOT->get_seconds_per_minute();
+
+    float delta[2] = {dx * n, dy * n};
+    float length = sqrtf(dx * dx + dy * dy);
+    float unit[2] = {dx / length, dy / length};
+
+    // the distance to get to the feed rate from a stop
+    float run_up = 0;
+    if(this->overscan) {
+        run_up = (rate_mm_s * rate_mm_s) / (2 * THEROBOT->get_default_acceleration());
+        float pos[2];
+        THEROBOT->get_axis_position(pos, 2);
+        bool continued = row_open && pos[0] == row_end[0] && pos[1] == row_end[1] && unit[0] == row_unit[0] && unit[1] == row_unit[1];
+        if(!continued) {
+            // back up and come up to speed with the laser off
+            overscan_move(unit, -run_up, rate_mm_s);
+            overscan_move(unit, run_up, rate_mm_s);
+        }
+    }
+
+    r->busy = true;
+    THEROBOT->set_raster(r->pixels, n);
+    bool moved = THEROBOT->delta_move(delta, rate_mm_s, 2);
+    THEROBOT->set_raster(nullptr, 0);
+
+    if(moved) {
+        if(++next_raster >= LASER_RASTER_SLOTS) next_raster = 0;
+    } else {
+        r->busy = false;
+    }
+
+    row_open = this->overscan && gcode->has_letter('C') && gcode->get_value('C') != 0;
+    if(row_open) {
+        THEROBOT->get_axis_position(row_end, 2);
+        row_unit[0] = unit[0];
+        row_unit[1] = unit[1];
+
+    } else if(this->overscan) {
+        // run out at the feed rate then come back to the end of the row, which is where the next command expects to be
+        overscan_move(unit, run_up, rate_mm_s);
+        overscan_move(unit, -run_up, rate_mm_s);
+    }
 }
 
-// get laser power for the currently executing block, returns false if nothing running or a G0
-bool Laser::get_laser_power(float& power) const
+// a laser off move along the row, these are never G1 so the step interrupt keeps the laser off
+bool Laser::overscan_move(const float *unit, float distance, float rate_mm_s)
 {
-    const Block *block = StepTicker::getInstance()->get_current_block();
+    float delta[2] = {unit[0] * distance, unit[1] * distance};
+    return THEROBOT->delta_move(delta, rate_mm_s, 2);
+}
 
-    // Note to avoid a race condition where the block is being cleared we check the is_ready flag which gets cleared first,
-    // as this is an interrupt if that flag is not clear then it cannot be cleared while this is running and the block will still be valid (albeit it may have finished)
-    if(block != nullptr && block->is_ready && block->is_g123) {
-        float requested_power = ((float)block->s_value/(1<<11)) / this->laser_maximum_s_value; // s_value is 1.11 Fixed point
-        float ratio = current_speed_ratio(block);
-        power = requested_power * ratio * scale;
+// called from the step interrupt when it has moved past the block using these pixels
+void Laser::release_raster(const uint8_t *pixels)
+{
+    uint32_t i = (pixels - rasters[0].pixels) / sizeof(raster_t);
+    rasters[i].busy = false;
+}
 
-        return true;
+// points are comma separated powers from 0 to 1 at evenly spaced speeds from 0 to the nominal speed, resampled to
+// LASER_CURVE_SEGMENTS + 1 so the step interrupt can interpolate it with shifts
+void Laser::load_power_curve(const char *points)
+{
+    std::vector<float> v = parse_number_list(points);
+    this->power_curve_used = v.size() >= 2;
+    if(!this->power_curve_used) return;
+
+    for (int i = 0; i <= LASER_CURVE_SEGMENTS; ++i) {
+        float x = (float)i * (v.size() - 1) / LASER_CURVE_SEGMENTS;
+        size_t j = floorf(x);
+        if(j >= v.size() - 1) j = v.size() - 2;
+        float p = v[j] + (v[j + 1] - v[j]) * (x - j);
+        this->power_curve[i] = roundf(confine(p, 0.0F, 1.0F) * 65536);
     }
+}
+
+// maps a 1.16 speed ratio to a 1.16 power ratio through the power curve
+uint32_t Laser::curve_ratio(uint32_t ratio) const
+{
+    uint32_t i = ratio >> (16 - LASER_CURVE_BITS);
+    if(i >= LASER_CURVE_SEGMENTS) return this->power_curve[LASER_CURVE_SEGMENTS];
 
-    return false;
+    int32_t f = ratio & ((1 << (16 - LASER_CURVE_BITS)) - 1);
+    int32_t d = (int32_t)this->power_curve[i + 1] - (int32_t)this->power_curve[i];
+    return this->power_curve[i] + ((d * f) >> (16 - LASER_CURVE_BITS));
 }
 
-// called every millisecond from timer ISR
-uint32_t Laser::set_proportional_power(uint32_t dummy)
+// precalculates what set_step_power needs, called whenever the scale changes
+void Laser::update_power_gain()
 {
-    if(manual_fire) return 0;
+    this->minimum_match = roundf(this->pwm_period * confine(this->laser_minimum_power, 0.0F, 1.0F));
+    // s_value is 1.11 fixed point
+    float gain = ((this->laser_maximum_power - this->laser_minimum_power) * this->pwm_period * this->scale) / (this->laser_maximum_s_value * (1 << 11));
+    this->power_gain = (gain > 0) ? roundf(gain * 65536) : 0;
+}
+
+// called from the step ticker interrupt every PWM period and at the start of each block, the power is the requested
+// power scaled by the fraction of the nominal speed the block is at, and for a raster line by the pixel the primary
+// motor is in. this only uses integer maths
+void Laser::set_step_power(const Block *block)
+{
+    const uint8_t *pixels = (block == nullptr) ? nullptr : block->pixels;
+    if(pixels != raster_pixels) {
+        if(raster_pixels != nullptr) release_raster(raster_pixels);
+        raster_pixels = pixels;
+        if(pixels != nullptr) {
+            uint32_t steps = block->steps[block->primary_motor];
+            raster_scale = ((uint64_t)block->n_pixels << 32) / (steps > 0 ? steps : 1);
+        }
+    }
 
-    float power;
-    if(get_laser_power(power)) {
-        // adjust power to maximum power and actual velocity
-        float proportional_power = ( (this->laser_maximum_power - this->laser_minimum_power) * power ) + this->laser_minimum_power;
-        set_laser_power(proportional_power);
+    if(manual_fire) return;
 
-    } else if(laser_on) {
+    if(block == nullptr || !(block->is_g123 || pixels != nullptr)) {
         // turn laser off
-        set_laser_power(0);
+        if(laser_on) write_match(0);
+        return;
     }
-    return 0;
+
+    uint32_t full_speed = ((uint64_t)block->s_value * this->power_gain) >> 16;
+    if(pixels != nullptr) {
+        uint32_t pixel = (block->tick_info[block->primary_motor].step_count * raster_scale) >> 32;
+        if(pixel >= block->n_pixels) pixel = block->n_pixels - 1;
+        if(full_speed > this->pwm_period) full_speed = this->pwm_period;
+        full_speed = (full_speed * pixels[pixel]) / 255;
+    }
+    uint32_t ratio = block->get_speed_ratio();
+    if(this->power_curve_used) ratio = curve_ratio(ratio);
+    write_match(this->minimum_match + (((uint64_t)full_speed * ratio) >> 16));
+}
+
+// sets the duty cycle in PWM clock ticks, safe to call from an interrupt
+void Laser::write_match(uint32_t match)
+{
+    if(match > this->pwm_period) match = this->pwm_period;
+    bool on = match > 0;
+
+    uint32_t v = this->pwm_inverting ? this->pwm_period - match : match;
+    // as mbed does, a match equal to the period drops a cycle
+    if(v == this->pwm_period) v++;
+    *this->pwm_match = v;
+    // latched at the start of the next period
+    LPC_PWM1->LER |= 1 << this->pwm_channel;
+
+    if(on != laser_on && this->ttl_used) this->ttl_pin->set(on);
+    laser_on = on;
 }
 
 bool Laser::set_laser_power(float power)
 {
     // Ensure power is >=0 and <= 1
     power= confine(power, 0.0F, 1.0F);
-
-    if(power > 0.00001F) {
-        this->pwm_pin->write(this->pwm_inverting ? 1 - power : power);
-        if(!laser_on && this->ttl_used) this->ttl_pin->set(true);
-        laser_on = true;
-
-    }else{
-        this->pwm_pin->write(this->pwm_inverting ? 1 : 0);
-        if (this->ttl_used) this->ttl_pin->set(false);
-        laser_on = false;
-    }
-
+    write_match(roundf(power * this->pwm_period));
     return laser_on;
 }
 
@@ -263,6 +476,13 @@ void Laser::on_halt(void *argument)
     if(argument == nullptr) {
         set_laser_power(0);
         manual_fire= false;
+
+        // the queue is flushed so no raster line is still needed
+        raster_pixels= nullptr;
+        row_open= false;
+        if(rasters != nullptr) {
+            for (int i = 0; i < LASER_RASTER_SLOTS; ++i) rasters[i].busy = false;
+        }
     }
 }
 
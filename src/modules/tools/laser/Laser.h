@@ -16,6 +16,14 @@ namespace mbed {
 }
 class Pin;
 class Block;
+class Gcode;
+
+// raster lines that can be queued at once, and the most pixels in one
+#define LASER_RASTER_SLOTS 8
+#define LASER_RASTER_PIXELS 128
+// segments of the power curve, a power of two so the tick path only shifts
+#define LASER_CURVE_BITS 4
+#define LASER_CURVE_SEGMENTS (1 << LASER_CURVE_BITS)
 
 class Laser : public Module{
     public:
@@ -27,17 +35,42 @@ class Laser : public Module{
         void on_console_line_received(void *argument);
         void on_get_public_data(void* argument);
 
-        void set_scale(float s) { scale= s/100; }
+        void set_scale(float s) { scale= s/100; update_power_gain(); }
         float get_scale() const { return scale*100; }
         bool set_laser_power(float p);
         float get_current_power() const;
 
     private:
-        uint32_t set_proportional_power(uint32_t dummy);
-        bool get_laser_power(float& power) const;
-        float current_speed_ratio(const Block *block) const;
+        void set_step_power(const Block *block);
+        void raster_line(Gcode *gcode);
+        void release_raster(const uint8_t *pixels);
+        void load_power_curve(const char *points);
+        uint32_t curve_ratio(uint32_t ratio) const;
+        bool overscan_move(const float *unit, float distance, float rate_mm_s);
+        void update_power_gain();
+        void write_match(uint32_t match);
 
         mbed::PwmOut *pwm_pin;    // PWM output to regulate the laser power
+        volatile uint32_t *pwm_match; // pwm_pin's match register, written directly so the power can follow the steps without float maths
+        uint32_t pwm_period;        // PWM period in PWM clock ticks
+        uint32_t minimum_match;     // match for laser_minimum_power
+        uint32_t power_gain;        // match above minimum_match per unit of s_value at the nominal speed, 16.16 fixed point
+        uint8_t pwm_channel;
+
+        // pixels of a G7 raster line, busy until the step interrupt has moved on to another block
+        struct raster_t {
+            uint8_t pixels[LASER_RASTER_PIXELS];
+            volatile bool busy;
+        };
+        raster_t *rasters;          // LASER_RASTER_SLOTS of them, allocated on the first G7
+        uint8_t next_raster;
+        const uint8_t *raster_pixels; // pixels of the block being stepped
+        uint64_t raster_scale;        // its pixels per primary motor step, 32.32 fixed point
+        float row_end[2];             // where the last G7 that said more of its row follows ended, and its direction
+        float row_unit[2];
+
+        // fraction of the power at evenly spaced fractions of the nominal speed, 1.16 fixed point
+        uint32_t power_curve[LASER_CURVE_SEGMENTS + 1];
         Pin *ttl_pin;				// TTL output to fire laser
         float laser_maximum_power; // maximum allowed laser power to be output on the pwm pin
         float laser_minimum_power; // value used to tickle the laser on moves.  Also minimum value for auto-scaling
@@ -49,5 +82,8 @@ class Laser : public Module{
             bool ttl_used:1;		// stores whether we have a TTL output
             bool ttl_inverting:1;   // stores whether the TTL output should be inverted
             bool manual_fire:1;     // set when manually firing
+            bool power_curve_used:1; // the power follows power_curve rather than the speed
+            bool overscan:1;        // G7 rows get a laser off run up and run out
+            bool row_open:1;        // the last G7 row continues in the next one
         };
 };
@@ -190,8 +190,8 @@ void A131SpindleControl::set_speed(int target_rpm)
       0x00, 0x55, 0x00, 0x00, 0x06, 0x01, 0x54, 0xA9, 0xFF
    };
 
-   // convert RPM into Hz
-   unsigned int hz = target_rpm / 60 * 100;
+   // convert RPM into 0.01Hz
+   unsigned int hz = (target_rpm * 100) / 60;
 
    set_speed_msg[3] = (hz >> 8);
    set_speed_msg[4] = hz & 0xFF;
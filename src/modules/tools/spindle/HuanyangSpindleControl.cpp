@@ -70,127 +70,75 @@
 
 #include "libs/Kernel.h"
 #include "StreamOutputPool.h"
-#include "BufferedSoftSerial.h"
 #include "ModbusSpindleControl.h"
 #include "HuanyangSpindleControl.h"
-#include "gpio.h"
-#include "Modbus.h"
+#include "ModbusMaster.h"
+
+// every command is answered with an echo of its function code, these are the lengths with the CRC
+#define CONTROL_WRITE_ANSWER    6
+#define FREQUENCY_WRITE_ANSWER  7
+#define CONTROL_READ_ANSWER     8
+
+// queues the request, the VFD is told and the answer checked later from ON_IDLE. failed is called if it never answers
+void HuanyangSpindleControl::send(const uint8_t *msg, size_t n, size_t response_length, const char *what, std::function<void()> failed)
+{
+    bool queued = master->queue(msg, n, response_length, [what, failed](const uint8_t *response, size_t len) {
+        if(response != nullptr) return;
+        THEKERNEL->streams->printf("error: spindle VFD did not %s\n", what);
+        if(failed) failed();
+    });
+
+    if(!queued) {
+        THEKERNEL->streams->printf("error: too many spindle VFD requests, could not %s\n", what);
+        if(failed) failed();
+    }
+}
 
 void HuanyangSpindleControl::turn_on()
 {
-    // prepare data for the spindle off command
-    char turn_on_msg[6] = { 0x01, 0x03, 0x01, 0x01, 0x00, 0x00 };
-    // calculate CRC16 checksum
-    unsigned int crc = modbus->crc16(turn_on_msg, sizeof(turn_on_msg)-2);
-    turn_on_msg[4] = crc & 0xFF;
-    turn_on_msg[5] = (crc >> 8);
-
-    // enable transmitter
-    modbus->dir_output->set();
-    modbus->delay(1);
-    // send the actual message
-    modbus->serial->write(turn_on_msg, sizeof(turn_on_msg));
-    // wait a calculated time for the data to be sent
-    modbus->delay((int) ceil(sizeof(turn_on_msg) * modbus->delay_time));
-    // disable transmitter
-    modbus->dir_output->clear();
-    // wait 50ms, required by the Modbus standard
-    modbus->delay(50);
+    // start spindle clockwise, or counter-clockwise after M4
+    static const uint8_t turn_on_msg[] = { 0x01, 0x03, 0x01, 0x01 };
+    static const uint8_t turn_on_reversed_msg[] = { 0x01, 0x03, 0x01, 0x11 };
     spindle_on = true;
-
+    // so the next M3 tries again
+    send(spindle_reversed ? turn_on_reversed_msg : turn_on_msg, sizeof(turn_on_msg), CONTROL_WRITE_ANSWER, "turn on", [this]() { spindle_on = false; });
 }
 
 void HuanyangSpindleControl::turn_off()
 {
-    // prepare data for the spindle off command
-    char turn_off_msg[6] = { 0x01, 0x03, 0x01, 0x08, 0x00, 0x00 };
-    // calculate CRC16 checksum
-    unsigned int crc = modbus->crc16(turn_off_msg, sizeof(turn_off_msg)-2);
-    turn_off_msg[4] = crc & 0xFF;
-    turn_off_msg[5] = (crc >> 8);
-
-    // enable transmitter
-    modbus->dir_output->set();
-    modbus->delay(1);
-    // send the actual message
-    modbus->serial->write(turn_off_msg, sizeof(turn_off_msg));
-    // wait a calculated time for the data to be sent
-    modbus->delay((int) ceil(sizeof(turn_off_msg) * modbus->delay_time));
-    // disable transmitter
-    modbus->dir_output->clear();
-    // wait 50ms, required by the Modbus standard
-    modbus->delay(50);
+    static const uint8_t turn_off_msg[] = { 0x01, 0x03, 0x01, 0x08 };
     spindle_on = false;
-
+    send(turn_off_msg, sizeof(turn_off_msg), CONTROL_WRITE_ANSWER, "turn off", [this]() { spindle_on = true; });
 }
 
 void HuanyangSpindleControl::set_speed(int target_rpm)
 {
+    // convert RPM into 0.01Hz
+    unsigned int hz = (target_rpm * 100) / 60;
+    uint8_t set_speed_msg[] = { 0x01, 0x05, 0x02, (uint8_t)(hz >> 8), (uint8_t)(hz & 0xFF) };
+    send(set_speed_msg, sizeof(set_speed_msg), FREQUENCY_WRITE_ANSWER, "set the speed");
+}
 
-    // prepare data for the set speed command
-    char set_speed_msg[7] = { 0x01, 0x05, 0x02, 0x00, 0x00, 0x00, 0x00 };
-    // convert RPM into Hz
-    unsigned int hz = target_rpm / 60 * 100;
-    set_speed_msg[3] = (hz >> 8);
-    set_speed_msg[4] = hz & 0xFF;
-    // calculate CRC16 checksum
-    unsigned int crc = modbus->crc16(set_speed_msg, sizeof(set_speed_msg)-2);
-    set_speed_msg[5] = crc & 0xFF;
-    set_speed_msg[6] = (crc >> 8);
-
-    // enable transmitter
-    modbus->dir_output->set();
-    modbus->delay(1);
-    // send the actual message
-    modbus->serial->write(set_speed_msg, sizeof(set_speed_msg));
-    // wait a calculated time for the data to be sent
-    modbus->delay((int) ceil(sizeof(set_speed_msg) * modbus->delay_time));
-    // disable transmitter
-    modbus->dir_output->clear();
-    // wait 50ms, required by the Modbus standard
-    modbus->delay(50);
-
+void HuanyangSpindleControl::poll_speed()
+{
+    static const uint8_t get_speed_msg[] = { 0x01, 0x04, 0x03, 0x00, 0x00, 0x00 };
+    master->queue(get_speed_msg, sizeof(get_speed_msg), CONTROL_READ_ANSWER, [this](const uint8_t *response, size_t len) {
+        if(response == nullptr) {
+            current_rpm = -1;
+            return;
+        }
+        // get the Hz value from the answer and convert it into an RPM value
+        unsigned int hz = (response[4] << 8) | response[5];
+        current_rpm = (hz * 60) / 100;
+    });
 }
 
 void HuanyangSpindleControl::report_speed()
 {
-    // clear RX buffer before start
-    while(modbus->serial->readable()){
-        modbus->serial->getc();
+    // report the RPM from the last poll
+    if(current_rpm < 0) {
+        THEKERNEL->streams->printf("Current RPM: unknown\n");
+    } else {
+        THEKERNEL->streams->printf("Current RPM: %d\n", current_rpm);
     }
-
-    // prepare data for the get speed command
-    char get_speed_msg[8] = { 0x01, 0x04, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 };
-    // calculate CRC16 checksum
-    unsigned int crc = modbus->crc16(get_speed_msg, sizeof(get_speed_msg)-2);
-    get_speed_msg[6] = crc & 0xFF;
-    get_speed_msg[7] = (crc >> 8);
-
-    // enable transmitter
-    modbus->dir_output->set();
-    modbus->delay(1);
-    // send the actual message
-    modbus->serial->write(get_speed_msg, sizeof(get_speed_msg));
-    // wait a calculated time for the data to be sent
-    modbus->delay((int) ceil(sizeof(get_speed_msg) * modbus->delay_time));
-    // disable transmitter
-    modbus->dir_output->clear();
-    // wait 50ms, required by the Modbus standard
-    modbus->delay(50);
-
-    // wait for the complete message to be received
-    modbus->delay((int) ceil(8 * modbus->delay_time));
-    // prepare an array for the answer
-    char speed[8] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
-
-    // read the answer into the buffer
-    for(int i=0; i<8; i++) {
-        speed[i] = modbus->serial->getc();
-    }
-    // get the Hz value from trhe answer and convert it into an RPM value
-    unsigned int hz = (speed[4] << 8) | speed[5];
-    unsigned int rpm = hz / 100 * 60;
-
-    // report the current RPM value
-    THEKERNEL->streams->printf("Current RPM: %d\n", rpm);
 }
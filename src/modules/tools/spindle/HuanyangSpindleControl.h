@@ -10,19 +10,29 @@
 
 #include "ModbusSpindleControl.h"
 #include <stdint.h>
+#include <stddef.h>
+#include <functional>
 
 // This module implements Modbus control for spindle control over Modbus.
 class HuanyangSpindleControl: public ModbusSpindleControl {
     public:
-        HuanyangSpindleControl() {};
+        HuanyangSpindleControl() : current_rpm(-1) {};
         virtual ~HuanyangSpindleControl() {};
-        
+
+        // the speed from the last poll, -1 if the VFD has not answered
+        int get_current_rpm() const { return current_rpm; }
+        bool can_reverse() const { return true; }
+
     private:
         
         void turn_on(void);
         void turn_off(void);
         void set_speed(int);
         void report_speed(void);
+        void poll_speed(void);
+        void send(const uint8_t *msg, size_t n, size_t response_length, const char *what, std::function<void()> failed= nullptr);
+
+        int current_rpm;
 };
 
 #endif
@@ -9,12 +9,13 @@
 #define MODBUS_H
 
 #include "libs/Module.h"
+#include "ModbusMaster.h"
 #include <vector>
 
 class BufferedSoftSerial;
 class GPIO;
 
-class Modbus : public Module {
+class Modbus : public Module, public ModbusTransport {
     public:
         Modbus( PinName rx_pin, PinName tx_pin, PinName dir_pin);
         Modbus( PinName rx_pin, PinName tx_pin, PinName dir_pin, int baud_rate);
@@ -35,6 +36,11 @@ class Modbus : public Module {
         void delay(unsigned int);
         unsigned int crc16(char *data, unsigned int len); 
 
+        // ModbusTransport for a ModbusMaster on this port
+        void set_transmit(bool on);
+        void write(const uint8_t *data, size_t n);
+        int read();
+
         GPIO *dir_output;
 
         BufferedSoftSerial* serial;
@@ -0,0 +1,190 @@
+/*
+    This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+    Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ModbusMaster.h"
+
+#include <string.h>
+
+// the transmitter is enabled this long before the request is written
+#define ENABLE_US 1000
+
+ModbusMaster::ModbusMaster(ModbusTransport *transport, uint32_t char_us)
+{
+    this->transport= transport;
+    this->char_us= char_us;
+    head= count= tries= received= 0;
+    state= IDLE;
+    deadline= 0;
+    timeout= 200000;
+    turnaround= 50000; // what the blocking code waited, Modbus itself only needs 3.5 characters
+    retries= 2;
+    retried= failed= 0;
+}
+
+bool ModbusMaster::queue(const uint8_t *request, size_t n, size_t response_length, callback_t callback)
+{
+    if(count >= MODBUS_QUEUE_SIZE || n + 2 > MODBUS_MAX_FRAME || response_length > MODBUS_MAX_FRAME) return false;
+
+    transaction_t &t= transactions[(head + count) % MODBUS_QUEUE_SIZE];
+    memcpy(t.request, request, n);
+    uint16_t crc= crc16(request, n);
+    t.request[n]= crc & 0xFF;
+    t.request[n + 1]= crc >> 8;
+    t.request_length= n + 2;
+    t.response_length= response_length;
+    t.callback= callback;
+    count++;
+    return true;
+}
+
+// one step of the current transaction each call, times are compared by difference so they can wrap
+void ModbusMaster::poll(uint32_t now)
+{
+    switch(state) {
+        case IDLE:
+            if(count == 0) return;
+            // anything left over is from an earlier answer that came too late
+            while(transport->read() >= 0) ;
+            transport->set_transmit(true);
+            deadline= now + ENABLE_US;
+            state= ENABLE;
+            break;
+
+        case ENABLE:
+            if((int32_t)(now - deadline) < 0) return;
+            send(now);
+            break;
+
+        case SEND:
+            // the transmitter has to stay on until the last character is out
+            if((int32_t)(now - deadline) < 0) return;
+            transport->set_transmit(false);
+            received= 0;
+            deadline= now + timeout;
+            state= WAIT;
+            break;
+
+        case WAIT: {
+            const transaction_t &t= transactions[head];
+            int c;
+            while(received < t.response_length && (c= transport->read()) >= 0) {
+                response[received++]= c;
+                if(received == 5 && is_exception()) break;
+            }
+
+            if(received == 5 && is_exception()) {
+                // the slave understood and refused, no point asking again
+                finish(now, false);
+
+            } else if(received == t.response_length) {
+                bool ok= response[0] == t.request[0] && response[1] == t.request[1] &&
+                         crc16(response, received - 2) == (response[received - 2] | (response[received - 1] << 8));
+                if(ok) finish(now, true);
+                else deadline= now; // garbled, try again now
+
+            }
+
+            if(state == WAIT && (int32_t)(now - deadline) >= 0) {
+                if(tries < retries) {
+                    tries++;
+                    retried++;
+                    deadline= now + turnaround;
+                    state= GAP;
+                } else {
+                    finish(now, false);
+                }
+            }
+            break;
+        }
+
+        case GAP:
+            if((int32_t)(now - deadline) < 0) return;
+            state= IDLE;
+            break;
+    }
+}
+
+void ModbusMaster::send(uint32_t now)
+{
+    const transaction_t &t= transactions[head];
+    transport->write(t.request, t.request_length);
+    // plus one character for the last one to clear the line
+    deadline= now + (t.request_length + 1) * char_us;
+    state= SEND;
+}
+
+// a valid exception answer, the function code with the top bit set
+bool ModbusMaster::is_exception() const
+{
+    const transaction_t &t= transactions[head];
+    return response[0] == t.request[0] && response[1] == (t.request[1] | 0x80) &&
+           crc16(response, 3) == (response[3] | (response[4] << 8));
+}
+
+void ModbusMaster::finish(uint32_t now, bool ok)
+{
+    transaction_t &t= transactions[head];
+    if(!ok) failed++;
+
+    // take it off the queue first so the callback can queue another
+    callback_t callback= t.callback;
+    t.callback= nullptr;
+    head= (head + 1) % MODBUS_QUEUE_SIZE;
+    count--;
+    tries= 0;
+    deadline= now + turnaround;
+    state= GAP;
+
+    if(callback) {
+        if(ok) callback(response, received);
+        else callback(nullptr, 0);
+    }
+}
+
+static const uint16_t crc_table[] = {
+    0X0000, 0XC0C1, 0XC181, 0X0140, 0XC301, 0X03C0, 0X0280, 0XC241,
+    0XC601, 0X06C0, 0X0780, 0XC741, 0X0500, 0XC5C1, 0XC481, 0X0440,
+    0XCC01, 0X0CC0, 0X0D80, 0XCD41, 0X0F00, 0XCFC1, 0XCE81, 0X0E40,
+    0X0A00, 0XCAC1, 0XCB81, 0X0B40, 0XC901, 0X09C0, 0X0880, 0XC841,
+    0XD801, 0X18C0, 0X1980, 0XD941, 0X1B00, 0XDBC1, 0XDA81, 0X1A40,
+    0X1E00, 0XDEC1, 0XDF81, 0X1F40, 0XDD01, 0X1DC0, 0X1C80, 0XDC41,
+    0X1400, 0XD4C1, 0XD581, 0X1540, 0XD701, 0X17C0, 0X1680, 0XD641,
+    0XD201, 0X12C0, 0X1380, 0XD341, 0X1100, 0XD1C1, 0XD081, 0X1040,
+    0XF001, 0X30C0, 0X3180, 0XF141, 0X3300, 0XF3C1, 0XF281, 0X3240,
+    0X3600, 0XF6C1, 0XF781, 0X3740, 0XF501, 0X35C0, 0X3480, 0XF441,
+    0X3C00, 0XFCC1, 0XFD81, 0X3D40, 0XFF01, 0X3FC0, 0X3E80, 0XFE41,
+    0XFA01, 0X3AC0, 0X3B80, 0XFB41, 0X3900, 0XF9C1, 0XF881, 0X3840,
+    0X2800, 0XE8C1, 0XE981, 0X2940, 0XEB01, 0X2BC0, 0X2A80, 0XEA41,
+    0XEE01, 0X2EC0, 0X2F80, 0XEF41, 0X2D00, 0XEDC1, 0XEC81, 0X2C40,
+    0XE401, 0X24C0, 0X2580, 0XE541, 0X2700, 0XE7C1, 0XE681, 0X2640,
+    0X2200, 0XE2C1, 0XE381, 0X2340, 0XE101, 0X21C0, 0X2080, 0XE041,
+    0XA001, 0X60C0, 0X6180, 0XA141, 0X6300, 0XA3C1, 0XA281, 0X6240,
+    0X6600, 0XA6C1, 0XA781, 0X6740, 0XA501, 0X65C0, 0X6480, 0XA441,
+    0X6C00, 0XACC1, 0XAD81, 0X6D40, 0XAF01, 0X6FC0, 0X6E80, 0XAE41,
+    0XAA01, 0X6AC0, 0X6B80, 0XAB41, 0X6900, 0XA9C1, 0XA881, 0X6840,
+    0X7800, 0XB8C1, 0XB981, 0X7940, 0XBB01, 0X7BC0, 0X7A80, 0XBA41,
+    0XBE01, 0X7EC0, 0X7F80, 0XBF41, 0X7D00, 0XBDC1, 0XBC81, 0X7C40,
+    0XB401, 0X74C0, 0X7580, 0XB541, 0X7700, 0XB7C1, 0XB681, 0X7640,
+    0X7200, 0XB2C1, 0XB381, 0X7340, 0XB101, 0X71C0, 0X7080, 0XB041,
+    0X5000, 0X90C1, 0X9181, 0X5140, 0X9301, 0X53C0, 0X5280, 0X9241,
+    0X9601, 0X56C0, 0X5780, 0X9741, 0X5500, 0X95C1, 0X9481, 0X5440,
+    0X9C01, 0X5CC0, 0X5D80, 0X9D41, 0X5F00, 0X9FC1, 0X9E81, 0X5E40,
+    0X5A00, 0X9AC1, 0X9B81, 0X5B40, 0X9901, 0X59C0, 0X5880, 0X9841,
+    0X8801, 0X48C0, 0X4980, 0X8941, 0X4B00, 0X8BC1, 0X8A81, 0X4A40,
+    0X4E00, 0X8EC1, 0X8F81, 0X4F40, 0X8D01, 0X4DC0, 0X4C80, 0X8C41,
+    0X4400, 0X84C1, 0X8581, 0X4540, 0X8701, 0X47C0, 0X4680, 0X8641,
+    0X8201, 0X42C0, 0X4380, 0X8341, 0X4100, 0X81C1, 0X8081, 0X4040
+};
+
+uint16_t ModbusMaster::crc16(const uint8_t *data, size_t n)
+{
+    uint16_t crc= 0xFFFF;
+    while(n--) {
+        crc= (crc >> 8) ^ crc_table[(*data++ ^ crc) & 0xFF];
+    }
+    return crc;
+}
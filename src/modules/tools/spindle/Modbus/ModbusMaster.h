@@ -0,0 +1,91 @@
+/*
+    This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+    Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MODBUSMASTER_H
+#define MODBUSMASTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+
+// longest request or response, with the CRC
+#define MODBUS_MAX_FRAME 16
+// requests that can wait to be sent
+#define MODBUS_QUEUE_SIZE 8
+
+// the RS485 line a ModbusMaster talks over
+class ModbusTransport {
+    public:
+        virtual ~ModbusTransport() {};
+        // drives the transmitter, it is on while a request is sent
+        virtual void set_transmit(bool on) = 0;
+        virtual void write(const uint8_t *data, size_t n) = 0;
+        // the next byte received, -1 if there is none
+        virtual int read() = 0;
+};
+
+// Non blocking Modbus RTU master. Requests are queued and sent one at a time from poll(), which is given the time in us
+// and is called from ON_IDLE. A request is sent again if its answer does not come in time or has a bad CRC, then its
+// callback gets the answer, or nullptr if there was none after all the retries or the slave answered with an exception
+class ModbusMaster {
+    public:
+        using callback_t = std::function<void(const uint8_t *response, size_t n)>;
+
+        ModbusMaster(ModbusTransport *transport, uint32_t char_us);
+
+        // request is the frame without the CRC, response_length is the length of the answer with it.
+        // false if the queue is full
+        bool queue(const uint8_t *request, size_t n, size_t response_length, callback_t callback= nullptr);
+        void poll(uint32_t now);
+        bool is_idle() const { return state == IDLE && count == 0; }
+
+        void set_timeout(uint32_t us) { timeout= us; }
+        void set_retries(uint8_t n) { retries= n; }
+        // silence after each answer before the next request
+        void set_turnaround(uint32_t us) { turnaround= us; }
+
+        // requests that were retried or failed
+        uint32_t get_retries() const { return retried; }
+        uint32_t get_failures() const { return failed; }
+
+        static uint16_t crc16(const uint8_t *data, size_t n);
+
+    private:
+        enum STATE { IDLE, ENABLE, SEND, WAIT, GAP };
+
+        struct transaction_t {
+            uint8_t request[MODBUS_MAX_FRAME];
+            uint8_t request_length;
+            uint8_t response_length;
+            callback_t callback;
+        };
+
+        void send(uint32_t now);
+        void finish(uint32_t now, bool ok);
+        bool is_exception() const;
+
+        ModbusTransport *transport;
+        transaction_t transactions[MODBUS_QUEUE_SIZE];
+        uint8_t head;               // the one being sent
+        uint8_t count;
+        uint8_t tries;
+
+        uint8_t response[MODBUS_MAX_FRAME];
+        uint8_t received;
+
+        STATE state;
+        uint32_t deadline;          // when the current state is over
+        uint32_t char_us;           // time to send one character
+        uint32_t timeout;
+        uint32_t turnaround;
+        uint8_t retries;
+
+        uint32_t retried;
+        uint32_t failed;
+};
+
+#endif
@@ -10,6 +10,7 @@
 #include "libs/Pin.h"
 #include "mbed.h"
 #include "Modbus.h"
+#include "ModbusMaster.h"
 #include "Config.h"
 #include "checksumm.h"
 #include "ConfigValue.h"
@@ -19,6 +20,7 @@
 #define spindle_rx_pin_checksum             CHECKSUM("rx_pin")
 #define spindle_tx_pin_checksum             CHECKSUM("tx_pin")
 #define spindle_dir_pin_checksum            CHECKSUM("dir_pin")
+#define spindle_poll_interval_checksum      CHECKSUM("poll_interval")
 
 void ModbusSpindleControl::on_module_loaded()
 {
@@ -49,7 +51,35 @@ void ModbusSpindleControl::on_module_loaded()
     // setup the Modbus interface
     modbus = new Modbus(tx_pin, rx_pin, dir_pin);
 
+    // requests are sent from ON_IDLE so M3/M5 and the speed polls never wait for the VFD
+    uint32_t poll_ms = THEKERNEL->config->value(spindle_checksum, spindle_poll_interval_checksum)->by_default(1000)->as_number();
+    start(modbus, ceilf(modbus->delay_time * 1000), poll_ms * 1000);
+
     // register for events
     register_for_event(ON_GCODE_RECEIVED);
 }
 
+void ModbusSpindleControl::start(ModbusTransport *transport, uint32_t char_us, uint32_t poll_interval)
+{
+    master = new ModbusMaster(transport, char_us);
+    this->poll_interval = poll_interval;
+    last_poll = 0;
+    register_for_event(ON_IDLE);
+}
+
+void ModbusSpindleControl::on_idle(void *argument)
+{
+    poll(us_ticker_read());
+}
+
+void ModbusSpindleControl::poll(uint32_t now)
+{
+    // the speed is only asked for when the line is free, so it never delays a command
+    if(poll_interval > 0 && master->is_idle() && now - last_poll >= poll_interval) {
+        last_poll = now;
+        poll_speed();
+    }
+
+    master->poll(now);
+}
+
@@ -10,22 +10,41 @@
 
 #include "SpindleControl.h"
 
+#include <stdint.h>
+
 class Modbus;
+class ModbusMaster;
+class ModbusTransport;
 
 // This module implements Modbus control for spindle control over Modbus.
 class ModbusSpindleControl: public SpindleControl {
     public:
-        ModbusSpindleControl() {};
+        ModbusSpindleControl() : modbus(nullptr), master(nullptr) {};
         virtual ~ModbusSpindleControl() {};
         void on_module_loaded();
-        
+        void on_idle(void *argument);
+
+        // runs the requests over transport, on_module_loaded does this with the Modbus port. poll_interval is the
+        // time between speed polls in us, 0 for none
+        void start(ModbusTransport *transport, uint32_t char_us, uint32_t poll_interval);
+        // sends and receives whatever is due at now in us
+        void poll(uint32_t now);
+
         Modbus* modbus;
+        ModbusMaster* master;
         
         virtual void turn_on(void);
         virtual void turn_off(void);
         virtual void set_speed(int);
         virtual void report_speed(void);
 
+    protected:
+        // queues a request for the current speed, called every poll_interval when nothing else is waiting to be sent
+        virtual void poll_speed(void) {};
+
+    private:
+        uint32_t poll_interval;
+        uint32_t last_poll;
 };
 
 #endif
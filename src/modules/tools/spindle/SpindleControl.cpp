@@ -37,11 +37,13 @@ void SpindleControl::on_gcode_received(void *argument)
             get_pid_settings();
           
         }
-        else if (gcode->m == 3) 
+        else if (gcode->m == 3 || gcode->m == 4)
         {
             THECONVEYOR->wait_for_idle();
-            // M3: Spindle on
-            if(!spindle_on) {
+            // M3: Spindle on, M4: spindle on counter-clockwise
+            bool reversed= gcode->m == 4;
+            if(!spindle_on || reversed != spindle_reversed) {
+                spindle_reversed= reversed;
                 turn_on();
             }
             
@@ -12,12 +12,16 @@
 
 class SpindleControl: public Module {
     public:
-        SpindleControl() {};
+        SpindleControl() : spindle_on(false), spindle_reversed(false) {};
         virtual ~SpindleControl() {};
         virtual void on_module_loaded() {};
+        // true if M4 turns the spindle the other way, which rigid tapping needs
+        virtual bool can_reverse() const { return false; }
 
     protected:
         bool spindle_on;
+        // M4 turns it the other way, spindles that can not reverse ignore this
+        bool spindle_reversed;
 
     private:
         void on_gcode_received(void *argument);
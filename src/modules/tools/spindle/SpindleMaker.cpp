@@ -13,6 +13,7 @@
 #include "AnalogSpindleControl.h"
 #include "HuanyangSpindleControl.h"
 #include "A131SpindleControl.h"
+#include "SpindleSync.h"
 #include "Config.h"
 #include "checksumm.h"
 #include "ConfigValue.h"
@@ -64,5 +65,7 @@ void SpindleMaker::load_spindle()
    // Add the spindle if we successfully initialized one
    if(spindle != NULL){
       THEKERNEL->add_module(spindle);
+      // encoder feedback for G33, it deletes itself if it is not enabled
+      THEKERNEL->add_module(new SpindleSync(spindle->can_reverse()));
       }
 }
@@ -0,0 +1,237 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SpindleSync.h"
+#include "libs/Kernel.h"
+#include "Config.h"
+#include "ConfigValue.h"
+#include "checksumm.h"
+#include "Gcode.h"
+#include "Robot.h"
+#include "Conveyor.h"
+#include "StepTicker.h"
+#include "StreamOutput.h"
+#include "StreamOutputPool.h"
+#include "Pin.h"
+#include "system_LPC17xx.h"
+
+#include "mbed.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#define spindle_checksum                    CHECKSUM("spindle")
+#define sync_enable_checksum                CHECKSUM("sync_enable")
+#define encoder_counts_per_rev_checksum     CHECKSUM("encoder_counts_per_rev")
+#define encoder_quadrature_checksum         CHECKSUM("encoder_quadrature")
+#define encoder_invert_checksum             CHECKSUM("encoder_invert")
+#define encoder_pha_pin_checksum            CHECKSUM("encoder_pha_pin")
+#define encoder_phb_pin_checksum            CHECKSUM("encoder_phb_pin")
+#define sync_timeout_checksum               CHECKSUM("sync_timeout")
+
+// QEICONF bits
+#define QEI_DIRINV  (1 << 0)
+#define QEI_SIGMODE (1 << 1)
+#define QEI_CAPMODE (1 << 2)
+// QEICON bits
+#define QEI_RESP    (1 << 0)
+#define QEI_RESV    (1 << 2)
+
+// the encoder is considered stopped if it gives less than this many counts in a velocity period of 100ms
+#define MIN_COUNTS_PER_PERIOD 2
+
+void SpindleSync::on_module_loaded()
+{
+    if(!THEKERNEL->config->value(spindle_checksum, sync_enable_checksum)->by_default(false)->as_bool()) {
+        delete this;
+        return;
+    }
+
+    // the QEI can only take PHA on P1.20 and PHB on P1.23, they must be given so the other modules and the leds can
+    // tell they are taken. P1.20 is a led on a Smoothieboard, which is not driven when it is named here
+    if(!take_pin(encoder_pha_pin_checksum, 20) || !take_pin(encoder_phb_pin_checksum, 23)) {
+        delete this;
+        return;
+    }
+
+    bool quadrature= THEKERNEL->config->value(spindle_checksum, encoder_quadrature_checksum)->by_default(true)->as_bool();
+    bool invert= THEKERNEL->config->value(spindle_checksum, encoder_invert_checksum)->by_default(false)->as_bool();
+    // the counts of one spindle turn as the QEI counts them, so all four edges of a quadrature encoder
+    counts_per_rev= THEKERNEL->config->value(spindle_checksum, encoder_counts_per_rev_checksum)->by_default(1024)->as_int();
+    if(counts_per_rev < 1) counts_per_rev= 1;
+    // a synchronized move is halted if the axes do not move for longer than this, as they would wait for the spindle forever
+    timeout_us= THEKERNEL->config->value(spindle_checksum, sync_timeout_checksum)->by_default(5.0F)->as_number() * 1000000;
+
+    // the QEI counts the encoder in hardware so no edges are lost at any spindle speed
+    LPC_SC->PCONP |= (1 << 18);
+    LPC_PINCON->PINSEL3 = (LPC_PINCON->PINSEL3 & ~((3 << 8) | (3 << 14))) | (1 << 8) | (1 << 14);
+
+    // a plain encoder with one channel is a clock on PHB and the direction on PHA
+    LPC_QEI->QEICONF = (quadrature ? QEI_CAPMODE : QEI_SIGMODE) | (invert ? QEI_DIRINV : 0);
+    LPC_QEI->QEIMAXPOS = 0xFFFFFFFF;
+    // QEICAP is the count of the last 100ms, PCLK is CCLK/4
+    LPC_QEI->QEILOAD = SystemCoreClock / 4 / 10;
+    LPC_QEI->QEICON = QEI_RESP | QEI_RESV;
+
+    // the position wraps at 2^32 which the step ticker allows for, it only looks at differences and the angle in a turn
+    THEKERNEL->step_ticker->set_sync_position_fnc([]() { return (uint32_t)LPC_QEI->QEIPOS; }, counts_per_rev);
+
+    this->register_for_event(ON_GCODE_RECEIVED);
+}
+
+// the encoder pin setting must be the QEI input on port 1 and no other setting may use it
+bool SpindleSync::take_pin(uint16_t setting, int qei_pin)
+{
+    Pin pin;
+    pin.from_string(THEKERNEL->config->value(spindle_checksum, setting)->by_default("nc")->as_string());
+    if(!pin.connected() || pin.port_number != 1 || pin.pin != qei_pin) {
+        THEKERNEL->streams->printf("Error: spindle sync needs the encoder on the QEI, set spindle.encoder_pha_pin 1.20 and spindle.encoder_phb_pin 1.23\n");
+        return false;
+    }
+    if(THEKERNEL->config->pin_users(1, qei_pin) > 1) {
+        THEKERNEL->streams->printf("Error: spindle sync encoder pin 1.%d is used by another setting\n", qei_pin);
+        return false;
+    }
+    return true;
+}
+
+bool SpindleSync::is_turning() const
+{
+    return LPC_QEI->QEICAP >= MIN_COUNTS_PER_PERIOD;
+}
+
+bool SpindleSync::is_reversed() const
+{
+    return (LPC_QEI->QEISTAT & 1) != 0;
+}
+
+// waits for the synchronized moves to finish. If the axes make no progress for longer than timeout_us they would wait
+// for the spindle forever, eg it stopped or turns the wrong way, so the machine is halted. This does not use
+// wait_for_idle as that would not return until the stalled move finished
+bool SpindleSync::wait_for_move(Gcode *gcode)
+{
+    uint32_t steps= THEKERNEL->step_ticker->get_sync_steps();
+    uint32_t progress_at= us_ticker_read();
+    while(!THECONVEYOR->is_queue_empty() || !THECONVEYOR->is_idle()) {
+        if(THEKERNEL->is_halted()) break;
+        uint32_t now= us_ticker_read();
+        if(THEKERNEL->step_ticker->get_sync_steps() != steps) {
+            steps= THEKERNEL->step_ticker->get_sync_steps();
+            progress_at= now;
+        } else if(now - progress_at > timeout_us) {
+            THEKERNEL->streams->printf("Error: the spindle did not move the axes during a synchronized move\n");
+            THEKERNEL->streams->printf("HALT asserted - reset or M999 required\n");
+            THEKERNEL->call_event(ON_HALT, nullptr);
+            break;
+        }
+        THEKERNEL->call_event(ON_IDLE, this);
+    }
+
+    if(THEKERNEL->is_halted()) {
+        gcode->is_error= true;
+        gcode->txt_after_ok= "synchronized move halted";
+        return false;
+    }
+    return true;
+}
+
+// appends the gcode's move as a move following the spindle and waits for it to finish so the following moves are normal
+// moves again, pitch is the travel in mm per spindle turn
+bool SpindleSync::sync_move(Gcode *gcode, float pitch, bool reverse, bool phase)
+{
+    char line[64];
+    int n= snprintf(line, sizeof(line), "G1");
+    const char axes[]= "XYZ";
+    for (int i = 0; i < 3; ++i) {
+        if(gcode->has_letter(axes[i])) {
+            n += snprintf(&line[n], sizeof(line) - n, " %c%1.4f", axes[i], gcode->get_value(axes[i]));
+        }
+    }
+
+    THEROBOT->set_spindle_sync({counts_per_rev / fabsf(pitch), reverse, phase});
+    Gcode gc(line, gcode->stream);
+    THEKERNEL->call_event(ON_GCODE_RECEIVED, &gc);
+    THEROBOT->set_spindle_sync({0, false, false});
+    if(!wait_for_move(gcode)) return false;
+
+    if(gc.is_error) {
+        gcode->is_error= true;
+        gcode->txt_after_ok= gc.txt_after_ok;
+        return false;
+    }
+    return true;
+}
+
+void SpindleSync::on_gcode_received(void *argument)
+{
+    Gcode *gcode = static_cast<Gcode *>(argument);
+
+    if(!gcode->has_g || gcode->g != 33) return;
+
+    if(!gcode->has_letter('K') || gcode->get_value('K') == 0) {
+        gcode->is_error= true;
+        gcode->txt_after_ok= "G33 needs the pitch in K";
+        return;
+    }
+
+    // tapping follows the spindle back out, a spindle that ignores M4 would keep turning forward and the axes would wait
+    if(gcode->subcode == 1 && !spindle_can_reverse) {
+        gcode->is_error= true;
+        gcode->txt_after_ok= "G33.1 needs a spindle that M4 reverses";
+        return;
+    }
+
+    // the previous moves are not synchronized so they have to be done first
+    THECONVEYOR->wait_for_idle();
+
+    if(!is_turning()) {
+        gcode->is_error= true;
+        gcode->txt_after_ok= "G33 needs the spindle turning";
+        return;
+    }
+
+    // the pitch is a length so it is in inches after G20
+    float pitch= THEROBOT->to_millimeters(gcode->get_value('K'));
+    bool reverse= is_reversed();
+
+    if(gcode->subcode == 0) {
+        // G33 threading, each pass starts at the same spindle angle so the passes cut the same thread
+        sync_move(gcode, pitch, reverse, true);
+
+    } else if(gcode->subcode == 1) {
+        // G33.1 rigid tapping, in at the pitch then reverse the spindle and follow it back out to where it started
+        float start[3];
+        THEROBOT->get_axis_position(start);
+        if(!sync_move(gcode, pitch, reverse, false)) return;
+
+        // the axes wait at the bottom while the spindle slows down, then follow it out as it speeds up the other way
+        char m[4];
+        snprintf(m, sizeof(m), "M%d", reverse ? 3 : 4);
+        Gcode reverse_gc(m, gcode->stream);
+        THEKERNEL->call_event(ON_GCODE_RECEIVED, &reverse_gc);
+        if(reverse_gc.is_error) {
+            gcode->is_error= true;
+            gcode->txt_after_ok= "the spindle did not reverse at the bottom of the tap";
+            return;
+        }
+
+        float pos[3];
+        THEROBOT->get_axis_position(pos);
+        float delta[3];
+        for (int i = 0; i < 3; ++i) delta[i]= start[i] - pos[i];
+        // the rate is only used by the planner, the spindle sets the speed
+        THEROBOT->set_spindle_sync({counts_per_rev / fabsf(pitch), !reverse, false});
+        THEROBOT->delta_move(delta, 10, 3);
+        THEROBOT->set_spindle_sync({0, false, false});
+        if(!wait_for_move(gcode)) return;
+
+        // back to the direction it was turning
+        snprintf(m, sizeof(m), "M%d", reverse ? 4 : 3);
+        Gcode restore_gc(m, gcode->stream);
+        THEKERNEL->call_event(ON_GCODE_RECEIVED, &restore_gc);
+    }
+}
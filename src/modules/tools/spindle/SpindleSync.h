@@ -0,0 +1,38 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPINDLESYNC_MODULE_H
+#define SPINDLESYNC_MODULE_H
+
+#include "libs/Module.h"
+
+#include <stdint.h>
+
+class Gcode;
+
+// Moves locked to the spindle position read from an encoder on the QEI, for threading (G33) and rigid tapping (G33.1).
+// The step ticker steps the axes from the encoder count instead of the move's trapezoid, see StepTicker::sync_step
+class SpindleSync : public Module {
+    public:
+        SpindleSync(bool spindle_can_reverse) : spindle_can_reverse(spindle_can_reverse) {};
+        virtual ~SpindleSync() {};
+        void on_module_loaded();
+
+    private:
+        void on_gcode_received(void *argument);
+        bool take_pin(uint16_t setting, int qei_pin);
+        bool sync_move(Gcode *gcode, float pitch, bool reverse, bool phase);
+        bool wait_for_move(Gcode *gcode);
+        bool is_turning() const;
+        bool is_reversed() const;
+
+        uint32_t counts_per_rev;
+        uint32_t timeout_us;
+        bool spindle_can_reverse;
+};
+
+#endif
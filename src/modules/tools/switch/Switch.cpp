@@ -214,7 +214,7 @@ void Switch::on_config_reload(void *argument)
 
     if(this->output_type == SIGMADELTA) {
         // SIGMADELTA
-        THEKERNEL->slow_ticker->attach(1000, this->sigmadelta_pin, &Pwm::on_tick);
+        this->sigmadelta_pin->attach(1000);
     }
 
     // for commands we need to replace _ for space
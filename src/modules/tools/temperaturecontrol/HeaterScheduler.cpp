@@ -0,0 +1,177 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "HeaterScheduler.h"
+#include "TemperatureControl.h"
+#include "ThermalModel.h"
+#include "Kernel.h"
+#include "Config.h"
+#include "ConfigValue.h"
+#include "checksumm.h"
+#include "Gcode.h"
+#include "SlowTicker.h"
+#include "StreamOutputPool.h"
+#include "modules/robot/Conveyor.h"
+
+#include <algorithm>
+#include <math.h>
+
+#define heater_power_budget_checksum CHECKSUM("heater_power_budget")
+
+// heaters more than this many °C below their target are heating up, otherwise they are holding temperature
+#define HEATING_BAND 2.0F
+// extra output reserved for a heater holding temperature so it can respond to disturbances
+#define HOLDING_HEADROOM 16
+// how often the budget is shared out
+#define SCHEDULE_FREQUENCY 10
+
+HeaterScheduler::HeaterScheduler()
+{
+    power_budget= 0;
+    waiting= false;
+}
+
+void HeaterScheduler::on_module_loaded()
+{
+    // total watts available for heaters, 0 is unlimited
+    this->power_budget= THEKERNEL->config->value(heater_power_budget_checksum)->by_default(0)->as_number();
+
+    register_for_event(ON_GCODE_RECEIVED);
+    register_for_event(ON_SECOND_TICK);
+
+    if(this->power_budget > 0) {
+        THEKERNEL->slow_ticker->attach_deferred(SCHEDULE_FREQUENCY, this, &HeaterScheduler::schedule_tick);
+    }
+}
+
+void HeaterScheduler::add(TemperatureControl *tc)
+{
+    // sensor only controls have no heater
+    if(tc->readonly) return;
+
+    heater_t h;
+    h.tc= tc;
+    h.rate= 0;
+    h.last_temperature= tc->get_temperature();
+    h.remaining= -1;
+    heaters.push_back(h);
+    order.push_back(order.size());
+}
+
+void HeaterScheduler::on_gcode_received(void *argument)
+{
+    Gcode *gcode = static_cast<Gcode *>(argument);
+    if(!gcode->has_m || gcode->m != 116) return;
+
+    // M116 waits for all the heaters that have a target to reach it, so they can all be set with M104/M140 and heat together
+    THEKERNEL->conveyor->wait_for_idle();
+
+    this->waiting= true; // on_second_tick will announce temps
+    while(!all_at_temperature()) {
+        THEKERNEL->call_event(ON_IDLE, this);
+        // check if ON_HALT was called (usually by kill button)
+        if(THEKERNEL->is_halted()) {
+            THEKERNEL->streams->printf("Wait on temperature aborted by kill\n");
+            break;
+        }
+    }
+    this->waiting= false;
+}
+
+bool HeaterScheduler::all_at_temperature() const
+{
+    for(auto &h : heaters) {
+        if(h.tc->target_temperature > 0 && h.tc->get_temperature() < h.tc->target_temperature) return false;
+    }
+    return true;
+}
+
+void HeaterScheduler::on_second_tick(void *argument)
+{
+    if(this->waiting) {
+        std::string s;
+        char buf[32];
+        for(auto &h : heaters) {
+            if(h.tc->target_temperature <= 0) continue;
+            int n= snprintf(buf, sizeof(buf), "%s:%3.1f /%3.1f @%d ", h.tc->designator.c_str(), h.tc->get_temperature(), h.tc->target_temperature, h.tc->o);
+            // n is what it would have been, a long designator is cut off
+            if(n < 0) n= 0;
+            else if(n >= (int)sizeof(buf)) n= sizeof(buf) - 1;
+            s.append(buf, n);
+        }
+        THEKERNEL->streams->printf("%s\n", s.c_str());
+    }
+
+    // measure how fast each heater rises at full power, used to estimate which one will take longest to heat up
+    for(auto &h : heaters) {
+        float t= h.tc->get_temperature();
+        if(h.tc->target_temperature > 0 && t < h.tc->target_temperature - HEATING_BAND && h.tc->o > 0) {
+            float r= (t - h.last_temperature) * (PID_PWM_MAX - 1) / h.tc->o;
+            if(r > 0) h.rate= (h.rate == 0) ? r : (h.rate * 0.7F + r * 0.3F);
+        }
+        h.last_temperature= t;
+    }
+}
+
+// Heaters holding temperature get what they need first so they do not droop, then the heaters that are heating up get
+// full power in order of the longest estimated time to reach temperature, so the slowest heater (usually the bed) is never
+// held back and the others use whatever power is left over
+uint32_t HeaterScheduler::schedule_tick(uint32_t)
+{
+    for(auto &h : heaters) {
+        TemperatureControl *tc= h.tc;
+        float error= tc->target_temperature - tc->get_temperature();
+        if(tc->target_temperature <= 0 || error < HEATING_BAND) {
+            h.remaining= -1;
+        } else {
+            // the model gain is the rise at full power, otherwise use the measured one, unknown heaters go first
+            float rate= (tc->model != nullptr && tc->model->is_valid()) ? tc->model->gain : h.rate;
+            h.remaining= rate > 0 ? error / rate : 1e6F;
+        }
+    }
+    std::sort(order.begin(), order.end(), [this](uint8_t a, uint8_t b) {
+        bool holding_a= heaters[a].remaining < 0, holding_b= heaters[b].remaining < 0;
+        if(holding_a != holding_b) return holding_a;
+        return heaters[a].remaining > heaters[b].remaining;
+    });
+
+    // bang bang heaters are usually on a relay so they are never pulsed to fit the budget, what one draws while it is on
+    // comes off the budget before the others share it
+    float budget= this->power_budget;
+    for(auto &h : heaters) {
+        if(!h.tc->use_bangbang) continue;
+        h.tc->power_limit= PID_PWM_MAX - 1;
+        if(h.tc->o > 0) budget -= h.tc->heater_watts * h.tc->o / (PID_PWM_MAX - 1);
+    }
+    if(budget < 0) budget= 0;
+
+    for(uint8_t i : order) {
+        TemperatureControl *tc= heaters[i].tc;
+        if(tc->use_bangbang) continue;
+        if(tc->heater_watts <= 0) {
+            // not part of the budget
+            tc->power_limit= PID_PWM_MAX - 1;
+            continue;
+        }
+
+        int want;
+        if(tc->target_temperature <= 0) want= 0;
+        else if(heaters[i].remaining >= 0) want= tc->heater_pin.max_pwm();
+        else want= std::min(tc->heater_pin.max_pwm(), tc->requested_o + HOLDING_HEADROOM);
+
+        float need= tc->heater_watts * want / (PID_PWM_MAX - 1);
+        if(need <= budget) {
+            tc->power_limit= want;
+            budget -= need;
+        } else {
+            tc->power_limit= floorf(budget * (PID_PWM_MAX - 1) / tc->heater_watts);
+            budget= 0;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,51 @@
+/*
+      this file is part of smoothie (http://smoothieware.org/). the motion control part is heavily based on grbl (https://github.com/simen/grbl).
+      smoothie is free software: you can redistribute it and/or modify it under the terms of the gnu general public license as published by the free software foundation, either version 3 of the license, or (at your option) any later version.
+      smoothie is distributed in the hope that it will be useful, but without any warranty; without even the implied warranty of merchantability or fitness for a particular purpose. see the gnu general public license for more details.
+      you should have received a copy of the gnu general public license along with smoothie. if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEATERSCHEDULER_H
+#define HEATERSCHEDULER_H
+
+#include "Module.h"
+
+#include <vector>
+#include <stdint.h>
+
+class TemperatureControl;
+
+// Shares a total power budget between all the heaters in the pool so they can heat up together without overloading the
+// power supply, and handles M116 which waits for all of them to reach temperature
+class HeaterScheduler : public Module
+{
+    public:
+        HeaterScheduler();
+
+        void on_module_loaded();
+        void on_gcode_received(void *argument);
+        void on_second_tick(void *argument);
+
+        void add(TemperatureControl *tc);
+
+    private:
+        uint32_t schedule_tick(uint32_t);
+        bool all_at_temperature() const;
+
+        struct heater_t {
+            TemperatureControl *tc;
+            float rate;         // °C/s at full power, measured while heating
+            float last_temperature;
+            float remaining;    // estimated seconds to reach temperature, negative if not heating up
+        };
+
+        std::vector<heater_t> heaters;
+        std::vector<uint8_t> order;
+        float power_budget;
+
+        struct {
+            bool waiting:1;
+        };
+};
+
+#endif
@@ -17,11 +17,12 @@
 PID_Autotuner::PID_Autotuner()
 {
     temp_control = NULL;
-    lastInputs = NULL;
-    peaks = NULL;
+    fit = NULL;
     tick = false;
     tickCnt = 0;
-    nLookBack = 10 * 20; // 10 seconds of lookback (fixed 20ms tick period)
+    lastTickCnt = 0;
+    noiseBand = 0.5;
+    rule = RelayPlantFit::CLASSIC_PID;
 }
 
 void PID_Autotuner::on_module_loaded()
@@ -34,13 +35,8 @@ void PID_Autotuner::on_module_loaded()
 
 void PID_Autotuner::begin(float target, int ncycles)
 {
-    noiseBand = 0.5;
-    oStep = temp_control->heater_pin.max_pwm(); // use max pwm to cycle temp
-    lookBackCnt = 0;
-    tickCnt = 0;
-
-    if (lastInputs != NULL) delete[] lastInputs;
-    lastInputs = new float[nLookBack + 1];
+    output = temp_control->heater_pin.max_pwm(); // use max pwm to cycle temp
+    lastTickCnt = tickCnt;
 
     temp_control->heater_pin.set(0);
     temp_control->target_temperature = 0.0;
@@ -48,18 +44,8 @@ void PID_Autotuner::begin(float target, int ncycles)
     target_temperature = target;
     requested_cycles = ncycles;
 
-    if (peaks != NULL) delete[] peaks;
-    peaks = new float[ncycles];
-
-    for (int i = 0; i < ncycles; i++) {
-        peaks[i] = 0.0;
-    }
-
-    peakType = 0;
-    peakCount = 0;
-    justchanged = false;
-    firstPeak= false;
-    output= 0;
+    if (fit != NULL) delete fit;
+    fit = new RelayPlantFit(ambient, target, output, noiseBand);
 }
 
 void PID_Autotuner::abort()
@@ -71,12 +57,9 @@ void PID_Autotuner::abort()
     temp_control->heater_pin.set(0);
     temp_control = NULL;
 
-    if (peaks != NULL)
-        delete[] peaks;
-    peaks = NULL;
-    if (lastInputs != NULL)
-        delete[] lastInputs;
-    lastInputs = NULL;
+    if (fit != NULL)
+        delete fit;
+    fit = NULL;
 }
 
 void PID_Autotuner::on_gcode_received(void *argument)
@@ -110,11 +93,11 @@ void PID_Autotuner::on_gcode_received(void *argument)
                 gcode->stream->printf("Target: %5.1f\n", target);
             }
 
-            // set the cycles, really not needed for this new version
+            // the maximum number of cycles, it normally stops after two or three when the fit converges
             int ncycles = 8;
             if (gcode->has_letter('C')) {
                 ncycles = gcode->get_value('C');
-                if(ncycles < 8) ncycles= 8;
+                if(ncycles < 3) ncycles= 3;
             }
 
             // optionally set the noise band, default is 0.5
@@ -122,12 +105,20 @@ void PID_Autotuner::on_gcode_received(void *argument)
                 noiseBand = gcode->get_value('B');
             }
 
-            // optionally set the look back in seconds default is 10 seconds
-            if (gcode->has_letter('L')) {
-                nLookBack = gcode->get_value('L');
+            // the rule used to calculate the gains from the fit, default is the classic Ziegler-Nichols
+            rule = RelayPlantFit::CLASSIC_PID;
+            if (gcode->has_letter('R')) {
+                int r = gcode->get_value('R');
+                if(r >= 0 && r < RelayPlantFit::N_RULES) rule = (RelayPlantFit::RULE)r;
+            }
+
+            // the fit assumes the heater cools towards ambient, which defaults to the current temperature so it should be started cold
+            ambient = this->temp_control->get_temperature();
+            if (gcode->has_letter('A')) {
+                ambient = gcode->get_value('A');
             }
 
-            gcode->stream->printf("Start PID tune for index E%d, designator: %s\n", pool_index, this->temp_control->designator.c_str());
+            gcode->stream->printf("Start PID tune for index E%d, designator: %s, rule: %s\n", pool_index, this->temp_control->designator.c_str(), RelayPlantFit::rule_name(rule));
 
             this->begin(target, ncycles);
 
@@ -145,9 +136,6 @@ uint32_t PID_Autotuner::on_tick(uint32_t dummy)
     return 0;
 }
 
-/**
- * this autopid is based on https://github.com/br3ttb/Arduino-PID-AutoTune-Library/blob/master/PID_AutoTune_v0/PID_AutoTune_v0.cpp
- */
 void PID_Autotuner::on_idle(void *)
 {
     if (!tick)
@@ -158,130 +146,65 @@ void PID_Autotuner::on_idle(void *)
     if (temp_control == NULL)
         return;
 
-    if(peakCount >= requested_cycles) {
-        // NOTE we output to kernel::streams becuase it is out-of-band data and original stream may be closed
-        THEKERNEL->streams->printf("// WARNING: Autopid did not resolve within %d cycles, these results are probably innacurate\n", requested_cycles);
-        finishUp();
-        return;
-    }
+    // the time since the last update, in case any ticks were missed
+    unsigned long now = tickCnt;
+    float dt = (now - lastTickCnt) / 1000.0F;
+    bool new_second = (now / 1000) != (lastTickCnt / 1000);
+    lastTickCnt = now;
 
     float refVal = temp_control->get_temperature();
-
-    // oscillate the output base on the input's relation to the setpoint
-    if (refVal > target_temperature + noiseBand) {
-        output = 0;
-        //temp_control->heater_pin.pwm(output);
+    int out = fit->update(refVal, dt);
+    if(out > 0) {
+        temp_control->heater_pin.pwm(out);
+    } else {
         temp_control->heater_pin.set(0);
-        if(!firstPeak) {
-            firstPeak= true;
-            absMax= refVal;
-            absMin= refVal;
-        }
-
-    } else if (refVal < target_temperature - noiseBand) {
-        output = oStep;
-        temp_control->heater_pin.pwm(output);
     }
 
-    if ((tickCnt % 1000) == 0) {
-        THEKERNEL->streams->printf("// Autopid Status - %5.1f/%5.1f @%d %d/%d\n",  refVal, target_temperature, output, peakCount, requested_cycles);
+    if (new_second) {
+        THEKERNEL->streams->printf("// Autopid Status - %5.1f/%5.1f @%d %d/%d\n",  refVal, target_temperature, out, fit->get_cycles(), requested_cycles);
     }
 
-    if(!firstPeak){
-        // we wait until we hit the first peak befire we do anything else,we need to ignore the itial warmup temperatures
-        return;
-    }
-
-    // find the peaks high and low
-    bool isMax = true, isMin = true;
-    for (int i = nLookBack - 1; i >= 0; i--) {
-        float val = lastInputs[i];
-        if (isMax) isMax = refVal > val;
-        if (isMin) isMin = refVal < val;
-        lastInputs[i + 1] = lastInputs[i];
-    }
-
-    lastInputs[0] = refVal;
-
-    //we don't want to trust the maxes or mins until the inputs array has been filled
-    if (lookBackCnt < nLookBack) {
-        lookBackCnt++; // count number of times we have filled lastInputs
-        return;
-    }
-
-    if (isMax) {
-        if(refVal > absMax) absMax= refVal;
-
-        if (peakType == 0) peakType = 1;
-        if (peakType == -1) {
-            peakType = 1;
-            justchanged = true;
-            peak2 = peak1;
-        }
-        peak1 = tickCnt;
-        peaks[peakCount] = refVal;
-
-    } else if (isMin) {
-        if(refVal < absMin) absMin= refVal;
-        if (peakType == 0) peakType = -1;
-        if (peakType == 1) {
-            peakType = -1;
-            peakCount++;
-            justchanged = true;
-        }
-
-        if (peakCount < requested_cycles) peaks[peakCount] = refVal;
-    }
-
-    if (justchanged && peakCount >= 4) {
-        // we've transitioned. check if we can autotune based on the last peaks
-        float avgSeparation = (fabsf(peaks[peakCount - 1] - peaks[peakCount - 2]) + fabsf(peaks[peakCount - 2] - peaks[peakCount - 3])) / 2;
-        THEKERNEL->streams->printf("// Cycle %d: max: %g, min: %g, avg separation: %g\n", peakCount, absMax, absMin, avgSeparation);
-        if (peakCount > 3 && avgSeparation < (0.05 * (absMax - absMin))) {
-            DEBUG_PRINTF("Stabilized\n");
-            finishUp();
-            return;
-        }
-    }
+    if(fit->is_converged()) {
+        DEBUG_PRINTF("Converged\n");
+        finishUp();
 
-    if ((tickCnt % 1000) == 0) {
-        DEBUG_PRINTF("lookBackCnt= %d, peakCount= %d, absmax= %g, absmin= %g, peak1= %lu, peak2= %lu\n", lookBackCnt, peakCount, absMax, absMin, peak1, peak2);
+    } else if(fit->get_cycles() >= requested_cycles) {
+        // NOTE we output to kernel::streams becuase it is out-of-band data and original stream may be closed
+        THEKERNEL->streams->printf("// WARNING: Autopid did not resolve within %d cycles, these results are probably innacurate\n", requested_cycles);
+        finishUp();
     }
-
-    justchanged = false;
 }
 
 
 void PID_Autotuner::finishUp()
 {
-    //we can generate tuning parameters!
-    float Ku = 4 * (2 * oStep) / ((absMax - absMin) * 3.14159);
-    float Pu = (float)(peak1 - peak2) / 1000;
-    THEKERNEL->streams->printf("\tKu: %g, Pu: %g\n", Ku, Pu);
-
-    float kp = 0.6 * Ku;
-    float ki = 1.2 * Ku / Pu;
-    float kd = Ku * Pu * 0.075;
+    THEKERNEL->streams->printf("\tTuned in %d cycles, %1.0f seconds, max: %g, min: %g\n", fit->get_cycles(), fit->get_time(), fit->get_max(), fit->get_min());
+    THEKERNEL->streams->printf("\tKu: %g, Pu: %g\n", fit->get_ultimate_gain(), fit->get_ultimate_period());
+    if(fit->has_fit()) {
+        THEKERNEL->streams->printf("\tModel gain: %g, time constant: %g, dead time: %g\n", fit->get_gain(), fit->get_time_constant(), fit->get_dead_time());
+    }
 
-    THEKERNEL->streams->printf("\tTrying:\n\tKp: %5.1f\n\tKi: %5.3f\n\tKd: %5.0f\n", kp, ki, kd);
+    //we can generate tuning parameters!
+    float kp, ki, kd;
+    if(fit->get_gains(rule, kp, ki, kd)) {
+        THEKERNEL->streams->printf("\tTrying %s:\n\tKp: %5.1f\n\tKi: %5.3f\n\tKd: %5.0f\n", RelayPlantFit::rule_name(rule), kp, ki, kd);
 
-    temp_control->setPIDp(kp);
-    temp_control->setPIDi(ki);
-    temp_control->setPIDd(kd);
+        temp_control->setPIDp(kp);
+        temp_control->setPIDi(ki);
+        temp_control->setPIDd(kd);
 
-    THEKERNEL->streams->printf("PID Autotune Complete! The settings above have been loaded into memory, but not written to your config file.\n");
+        THEKERNEL->streams->printf("PID Autotune Complete! The settings above have been loaded into memory, but not written to your config file.\n");
 
+    } else {
+        THEKERNEL->streams->printf("PID Autotune failed, not enough oscillations to calculate the settings\n");
+    }
 
     // and clean up
     temp_control->target_temperature = 0;
     temp_control->heater_pin.set(0);
     temp_control = NULL;
 
-    if (peaks != NULL)
-        delete[] peaks;
-    peaks = NULL;
-
-    if (lastInputs != NULL)
-        delete[] lastInputs;
-    lastInputs = NULL;
+    if (fit != NULL)
+        delete fit;
+    fit = NULL;
 }
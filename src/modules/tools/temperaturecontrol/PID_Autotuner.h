@@ -1,5 +1,5 @@
 /**
- * Based on https://github.com/br3ttb/Arduino-PID-AutoTune-Library
+ * Relay autotune, the plant is fitted online by RelayPlantFit so it can stop as soon as the fit converges
  */
 
 #ifndef _PID_AUTOTUNE_H
@@ -8,6 +8,7 @@
 #include <stdint.h>
 
 #include "Module.h"
+#include "RelayPlantFit.h"
 
 class TemperatureControl;
 
@@ -27,26 +28,17 @@ private:
     void finishUp();
 
     TemperatureControl *temp_control;
+    RelayPlantFit *fit;
+    RelayPlantFit::RULE rule;
     float target_temperature;
-
-    float *peaks;
-    int requested_cycles;
+    float ambient;
     float noiseBand;
-    unsigned long peak1, peak2;
-    int sampleTime;
-    int nLookBack;
-    int lookBackCnt;
-    int peakType;
-    float *lastInputs;
-    int peakCount;
-    float absMax, absMin;
-    float oStep;
+    int requested_cycles;
     int output;
+    unsigned long lastTickCnt;
     volatile unsigned long tickCnt;
     struct {
-        bool justchanged:1;
         volatile bool tick:1;
-        bool firstPeak:1;
     };
 };
 
@@ -0,0 +1,168 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "RelayPlantFit.h"
+
+#include <math.h>
+
+RelayPlantFit::RelayPlantFit(float ambient, float target, float output, float hysteresis)
+{
+    this->ambient= ambient;
+    this->target= target;
+    this->output= output;
+    this->hysteresis= hysteresis;
+    tolerance= 0.05F;
+
+    time= 0;
+    peak_y= prev_peak_y= trough_y= prev_trough_y= 0;
+    peak_t= prev_peak_t= trough_t= prev_trough_t= 0;
+    extreme= ambient;
+    extreme_time= 0;
+    abs_max= abs_min= ambient;
+
+    gain= time_constant= dead_time= 0;
+    ultimate_gain= ultimate_period= 0;
+
+    peaks= troughs= 0;
+    fits= 0;
+    heating= true;
+    converged= false;
+}
+
+float RelayPlantFit::update(float temperature, float dt)
+{
+    time += dt;
+
+    if(heating) {
+        if(temperature < extreme) {
+            extreme= temperature;
+            extreme_time= time;
+        }
+
+        if(temperature > target + hysteresis) {
+            // switching off, the lowest point since switching on was the trough, except on the initial heat up
+            if(peaks > 0) {
+                prev_trough_y= trough_y;
+                prev_trough_t= trough_t;
+                trough_y= extreme - ambient;
+                trough_t= extreme_time;
+                if(troughs == 0 || extreme < abs_min) abs_min= extreme;
+                ++troughs;
+                fit();
+            }
+            heating= false;
+            extreme= temperature;
+            extreme_time= time;
+        }
+
+    } else {
+        if(temperature > extreme) {
+            extreme= temperature;
+            extreme_time= time;
+        }
+
+        if(temperature < target - hysteresis) {
+            // switching on, the highest point since switching off was the peak
+            prev_peak_y= peak_y;
+            prev_peak_t= peak_t;
+            peak_y= extreme - ambient;
+            peak_t= extreme_time;
+            if(peaks == 0 || extreme > abs_max) abs_max= extreme;
+            ++peaks;
+
+            if(troughs > 0) {
+                // a full oscillation, as calculated by the original autotuner
+                ultimate_gain= 4 * (2 * output) / ((peak_y - trough_y) * 3.14159F);
+                if(peaks > 1) ultimate_period= peak_t - prev_peak_t;
+            }
+
+            fit();
+            heating= true;
+            extreme= temperature;
+            extreme_time= time;
+        }
+    }
+
+    return heating ? output : 0;
+}
+
+// fit the model to the last peak to trough (cooling) and trough to peak (heating) pairs, needs at least two peaks and a trough
+void RelayPlantFit::fit()
+{
+    if(peaks < 2 || troughs < 1) return;
+
+    // the cooling pair is the last trough and the peak before it, the heating pair the last peak and the trough before it
+    float off_peak_y, off_peak_t, on_trough_y, on_trough_t;
+    if(trough_t > peak_t) {
+        off_peak_y= peak_y; off_peak_t= peak_t;
+        on_trough_y= prev_trough_y; on_trough_t= prev_trough_t;
+        if(troughs < 2) return;
+    } else {
+        off_peak_y= prev_peak_y; off_peak_t= prev_peak_t;
+        on_trough_y= trough_y; on_trough_t= trough_t;
+    }
+
+    if(trough_y <= 0 || off_peak_y <= trough_y || trough_t <= off_peak_t || peak_t <= on_trough_t) return;
+
+    float tc= (trough_t - off_peak_t) / logf(off_peak_y / trough_y);
+
+    // the trough is where the heater being switched on at target - hysteresis starts to show, one dead time later
+    float r= target - hysteresis - ambient;
+    float dt= r > trough_y ? tc * logf(r / trough_y) : 0;
+
+    float x= expf((peak_t - on_trough_t) / tc);
+    float g= (x * peak_y - on_trough_y) / ((x - 1) * output);
+    if(g <= 0) return;
+
+    if(fits > 0) {
+        converged= fabsf(g - gain) <= tolerance * gain &&
+                   fabsf(tc - time_constant) <= tolerance * time_constant &&
+                   // the dead time can be close to zero, so allow the same absolute error as the time constant
+                   fabsf(dt - dead_time) <= tolerance * (dead_time > time_constant ? dead_time : time_constant);
+    }
+
+    gain= g;
+    time_constant= tc;
+    dead_time= dt;
+    ++fits;
+}
+
+const char *RelayPlantFit::rule_name(RULE rule)
+{
+    switch(rule) {
+        case CLASSIC_PID: return "Ziegler-Nichols classic PID";
+        case SOME_OVERSHOOT: return "Ziegler-Nichols some overshoot";
+        case NO_OVERSHOOT: return "Ziegler-Nichols no overshoot";
+        case IMC: return "IMC from fitted model";
+        default: return "unknown";
+    }
+}
+
+bool RelayPlantFit::get_gains(RULE rule, float &kp, float &ki, float &kd) const
+{
+    if(rule == IMC) {
+        if(fits == 0) return false;
+        // IMC PID for a first order plus dead time plant, the closed loop time constant is at least the dead time
+        float lambda= dead_time > 0.1F * time_constant ? dead_time : 0.1F * time_constant;
+        kp= (2 * time_constant + dead_time) / (gain * (2 * lambda + dead_time));
+        float ti= time_constant + dead_time / 2;
+        float td= time_constant * dead_time / (2 * time_constant + dead_time);
+        ki= kp / ti;
+        kd= kp * td;
+        return true;
+    }
+
+    if(ultimate_period <= 0) return false;
+    float ku= ultimate_gain, pu= ultimate_period;
+    switch(rule) {
+        case CLASSIC_PID:    kp= 0.6F * ku;  ki= 1.2F * ku / pu;  kd= 0.075F * ku * pu; break;
+        case SOME_OVERSHOOT: kp= 0.33F * ku; ki= 0.66F * ku / pu; kd= 0.11F * ku * pu; break;
+        case NO_OVERSHOOT:   kp= 0.2F * ku;  ki= 0.4F * ku / pu;  kd= 0.066F * ku * pu; break;
+        default: return false;
+    }
+    return true;
+}
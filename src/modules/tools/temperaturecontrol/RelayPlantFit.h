@@ -0,0 +1,79 @@
+/*
+      this file is part of smoothie (http://smoothieware.org/). the motion control part is heavily based on grbl (https://github.com/simen/grbl).
+      smoothie is free software: you can redistribute it and/or modify it under the terms of the gnu general public license as published by the free software foundation, either version 3 of the license, or (at your option) any later version.
+      smoothie is distributed in the hope that it will be useful, but without any warranty; without even the implied warranty of merchantability or fitness for a particular purpose. see the gnu general public license for more details.
+      you should have received a copy of the gnu general public license along with smoothie. if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RELAYPLANTFIT_H
+#define RELAYPLANTFIT_H
+
+// Runs a relay (on/off with hysteresis) around the target and fits a first order plus dead time model of the heater
+//   dy/dt = (gain * u(t - dead_time) - y) / time_constant,  y = temperature - ambient
+// to every peak and trough of the oscillation. With the relay switching at target ± hysteresis the model gives
+//   peak to trough:  t_off = time_constant * ln(y_max / y_min)
+//   trough to peak:  t_on  = time_constant * ln((gain * u - y_min) / (gain * u - y_max))
+//   trough:          y_min = (target - hysteresis) * exp(-dead_time / time_constant)
+// so each new extreme gives a complete fit, and tuning can stop as soon as two consecutive fits agree
+class RelayPlantFit
+{
+    public:
+        RelayPlantFit(float ambient, float target, float output, float hysteresis);
+
+        // feed a reading taken dt seconds after the last one, returns the relay output to apply
+        float update(float temperature, float dt);
+
+        // true when two consecutive fits agree within tolerance
+        bool is_converged() const { return converged; }
+        bool has_fit() const { return fits > 0; }
+        int get_cycles() const { return peaks; }
+        float get_time() const { return time; }
+
+        void set_tolerance(float t) { tolerance= t; }
+
+        // the fitted model, gain is in °C per unit of output
+        float get_gain() const { return gain; }
+        float get_time_constant() const { return time_constant; }
+        float get_dead_time() const { return dead_time; }
+
+        // ultimate gain and period from the last full oscillation
+        float get_ultimate_gain() const { return ultimate_gain; }
+        float get_ultimate_period() const { return ultimate_period; }
+        float get_max() const { return abs_max; }
+        float get_min() const { return abs_min; }
+
+        enum RULE { CLASSIC_PID, SOME_OVERSHOOT, NO_OVERSHOOT, IMC, N_RULES };
+        static const char *rule_name(RULE rule);
+        // computes kp, ki (per second) and kd (seconds) with the given rule, returns false if there is not enough data yet
+        bool get_gains(RULE rule, float &kp, float &ki, float &kd) const;
+
+    private:
+        void fit();
+
+        float ambient;
+        float target;
+        float output;
+        float hysteresis;
+        float tolerance;
+
+        float time;
+        float peak_y, peak_t;               // last peak, y relative to ambient
+        float prev_peak_y, prev_peak_t;
+        float trough_y, trough_t;           // last trough
+        float prev_trough_y, prev_trough_t;
+        float extreme;                      // the peak or trough being tracked
+        float extreme_time;
+        float abs_max, abs_min;
+
+        float gain, time_constant, dead_time;
+        float ultimate_gain, ultimate_period;
+
+        int peaks;
+        int troughs;
+        int fits;
+
+        bool heating;
+        bool converged;
+};
+
+#endif
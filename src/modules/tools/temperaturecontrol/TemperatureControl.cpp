@@ -8,6 +8,7 @@
 #include "libs/Module.h"
 #include "libs/Kernel.h"
 #include <math.h>
+#include <algorithm>
 #include "TemperatureControl.h"
 #include "TemperatureControlPool.h"
 #include "libs/Pin.h"
@@ -23,6 +24,10 @@
 #include "SlowTicker.h"
 #include "ConfigValue.h"
 #include "PID_Autotuner.h"
+#include "ThermalModel.h"
+#include "TemperatureHistory.h"
+#include "SwitchPublicAccess.h"
+#include "ExtruderPublicAccess.h"
 #include "SerialMessage.h"
 #include "utils.h"
 
@@ -41,6 +46,8 @@
 #define readings_per_second_checksum       CHECKSUM("readings_per_second")
 #define max_pwm_checksum                   CHECKSUM("max_pwm")
 #define pwm_frequency_checksum             CHECKSUM("pwm_frequency")
+#define hardware_pwm_checksum              CHECKSUM("hardware_pwm")
+#define heater_watts_checksum              CHECKSUM("heater_watts")
 #define bang_bang_checksum                 CHECKSUM("bang_bang")
 #define hysteresis_checksum                CHECKSUM("hysteresis")
 #define heater_pin_checksum                CHECKSUM("heater_pin")
@@ -58,7 +65,17 @@
 #define d_factor_checksum                  CHECKSUM("d_factor")
 
 #define i_max_checksum                     CHECKSUM("i_max")
+
+#define use_model_checksum                 CHECKSUM("use_model")
+#define model_gain_checksum                CHECKSUM("model_gain")
+#define model_time_constant_checksum       CHECKSUM("model_time_constant")
+#define model_dead_time_checksum           CHECKSUM("model_dead_time")
+#define model_fan_loss_checksum            CHECKSUM("model_fan_loss")
+#define model_extrusion_power_checksum     CHECKSUM("model_extrusion_power")
+#define model_ambient_checksum             CHECKSUM("model_ambient")
+#define model_fan_switch_checksum          CHECKSUM("model_fan_switch")
 #define windup_checksum                    CHECKSUM("windup")
+#define history_checksum                   CHECKSUM("history")
 
 #define preset1_checksum                   CHECKSUM("preset1")
 #define preset2_checksum                   CHECKSUM("preset2")
@@ -75,6 +92,13 @@ TemperatureControl::TemperatureControl(uint16_t name, int index)
     waiting= false;
     temp_violated= false;
     sensor= nullptr;
+    model= nullptr;
+    model_tuner= nullptr;
+    history= nullptr;
+    use_model= false;
+    requested_o= 0;
+    power_limit= PID_PWM_MAX - 1;
+    heater_watts= 0;
     readonly= false;
     tick= 0;
 }
@@ -82,6 +106,9 @@ TemperatureControl::TemperatureControl(uint16_t name, int index)
 TemperatureControl::~TemperatureControl()
 {
     delete sensor;
+    delete model;
+    delete model_tuner;
+    delete history;
 }
 
 void TemperatureControl::on_module_loaded()
@@ -110,6 +137,8 @@ void TemperatureControl::on_halt(void *arg)
 {
     if(arg == nullptr) {
         // turn off heater
+        delete this->model_tuner;
+        this->model_tuner = nullptr;
         this->o = 0;
         this->heater_pin.set(0);
         this->target_temperature = UNDEFINED;
@@ -186,6 +215,17 @@ void TemperatureControl::load_config()
     }
     sensor->UpdateConfig(temperature_control_checksum, this->name_checksum);
 
+    // keeps about 1.6K of averaged readings going back 2 hours
+    delete this->history;
+    this->history = nullptr;
+    if(THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, history_checksum)->by_default(true)->as_bool()) {
+        this->history = new TemperatureHistory();
+        if(!this->history->is_valid()) {
+            delete this->history;
+            this->history = nullptr;
+        }
+    }
+
     this->preset1 = THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, preset1_checksum)->by_default(0)->as_number();
     this->preset2 = THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, preset2_checksum)->by_default(0)->as_number();
 
@@ -199,16 +239,27 @@ void TemperatureControl::load_config()
         this->hysteresis = THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, hysteresis_checksum)->by_default(2)->as_number();
         this->windup = THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, windup_checksum)->by_default(false)->as_bool();
         this->heater_pin.max_pwm( THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, max_pwm_checksum)->by_default(255)->as_number() );
+        // power drawn at full output, used to share heater_power_budget between the heaters
+        this->heater_watts = THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, heater_watts_checksum)->by_default(0)->as_number();
         this->heater_pin.set(0);
         set_low_on_debug(heater_pin.port_number, heater_pin.pin);
-        // activate SD-DAC timer
-        THEKERNEL->slow_ticker->attach( THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, pwm_frequency_checksum)->by_default(2000)->as_number(), &heater_pin, &Pwm::on_tick);
+        uint32_t pwm_frequency = THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, pwm_frequency_checksum)->by_default(2000)->as_number();
+        // optionally use a hardware PWM channel if the heater pin has one, note the period is shared with all other hardware PWM outputs
+        bool hardware_pwm = THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, hardware_pwm_checksum)->by_default(false)->as_bool();
+        if(!hardware_pwm || pwm_frequency == 0 || !this->heater_pin.attach_hardware(1000000 / pwm_frequency)) {
+            // activate SD-DAC
+            if(!this->heater_pin.attach(pwm_frequency)) {
+                THEKERNEL->streams->printf("Error: no free PWM channels for %s heater, it has been disabled\n", this->designator.c_str());
+                this->readonly= true;
+            }
+        }
     }
 
 
-    // reading tick
-    THEKERNEL->slow_ticker->attach( this->readings_per_second, this, &TemperatureControl::thermistor_read_tick );
+    // reading tick, this is deferred to the main loop so the sensor read and PID are not done in the timer interrupt
+    THEKERNEL->slow_ticker->attach_deferred( this->readings_per_second, this, &TemperatureControl::thermistor_read_tick );
     this->PIDdt = 1.0 / this->readings_per_second;
+    this->last_read_time = 0;
 
     // PID
     setPIDp( THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, p_factor_checksum)->by_default(10 )->as_number() );
@@ -218,6 +269,27 @@ void TemperatureControl::load_config()
     if(!this->readonly) {
         // set to the same as max_pwm by default
         this->i_max = THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, i_max_checksum   )->by_default(this->heater_pin.max_pwm())->as_number();
+
+        // model based control, the model can be identified with M307 S<index> T<temperature>
+        this->use_model = THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, use_model_checksum)->by_default(false)->as_bool();
+        float gain = THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, model_gain_checksum)->by_default(0)->as_number();
+        delete this->model;
+        this->model = nullptr;
+        if(this->use_model || gain > 0) {
+            this->model = new ThermalModel();
+            this->model->gain = gain;
+            this->model->time_constant   = THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, model_time_constant_checksum)->by_default(0)->as_number();
+            this->model->dead_time       = THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, model_dead_time_checksum)->by_default(0)->as_number();
+            this->model->fan_loss        = THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, model_fan_loss_checksum)->by_default(0)->as_number();
+            this->model->extrusion_power = THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, model_extrusion_power_checksum)->by_default(0)->as_number();
+            this->model->ambient         = THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, model_ambient_checksum)->by_default(25)->as_number();
+            if(this->use_model && !this->model->is_valid()) {
+                THEKERNEL->streams->printf("Error: %s model_gain and model_time_constant must be set to use_model, using PID\n", this->designator.c_str());
+                this->use_model = false;
+            }
+        }
+        this->model_fan_switch = get_checksum(THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, model_fan_switch_checksum)->by_default("fan")->as_string());
+        this->last_extruder_position = NAN;
     }
 
     this->iTerm = 0.0;
@@ -254,7 +326,7 @@ void TemperatureControl::on_gcode_received(void *argument)
                 }
 
             }else if(!gcode->has_letter('S')) {
-                gcode->stream->printf("%s(S%d): using %s\n", this->designator.c_str(), this->pool_index, this->readonly?"Readonly" : this->use_bangbang?"Bangbang":"PID");
+                gcode->stream->printf("%s(S%d): using %s\n", this->designator.c_str(), this->pool_index, this->readonly?"Readonly" : this->use_model?"Model" : this->use_bangbang?"Bangbang":"PID");
                 sensor->get_raw();
                 TempSensor::sensor_options_t options;
                 if(sensor->get_optional(options)) {
@@ -268,6 +340,29 @@ void TemperatureControl::on_gcode_received(void *argument)
             return;
         }
 
+        if (gcode->m == 308) { // temperature history, M308 S<index> R<1|10|60 seconds per sample> N<samples> B1 for base64 records instead of CSV
+            if (gcode->has_letter('S') && (gcode->get_value('S') == this->pool_index)) {
+                int resolution = gcode->has_letter('R') ? gcode->get_value('R') : 1;
+                int n = gcode->has_letter('N') ? gcode->get_value('N') : 0;
+                bool binary = gcode->has_letter('B') && gcode->get_value('B') != 0;
+                char name[16];
+                snprintf(name, sizeof(name), "%s(S%d)", this->designator.c_str(), this->pool_index);
+                if(this->history == nullptr) {
+                    gcode->stream->printf("%s: no history\n", name);
+                } else if(!this->history->dump(gcode->stream, name, resolution, n, binary)) {
+                    gcode->stream->printf("%s: history resolution must be R1, R10 or R60\n", name);
+                }
+
+            }else if(!gcode->has_letter('S')) {
+                char name[16];
+                snprintf(name, sizeof(name), "%s(S%d)", this->designator.c_str(), this->pool_index);
+                if(this->history == nullptr) gcode->stream->printf("%s: no history\n", name);
+                else this->history->summary(gcode->stream, name);
+            }
+
+            return;
+        }
+
         // readonly sensors don't handle the rest
         if(this->readonly) return;
 
@@ -301,9 +396,68 @@ void TemperatureControl::on_gcode_received(void *argument)
                 gcode->stream->printf("%s(S%d): Pf:%g If:%g Df:%g X(I_max):%g max pwm: %d O:%d\n", this->designator.c_str(), this->pool_index, this->p_factor, this->i_factor / this->PIDdt, this->d_factor * this->PIDdt, this->i_max, this->heater_pin.max_pwm(), o);
             }
 
+        } else if (gcode->m == 307) { // thermal model settings, or identify the model with T<temperature>
+            if (gcode->has_letter('S') && (gcode->get_value('S') == this->pool_index)) {
+                // the tune would drive the heater pin and the model would never be used
+                if(this->readonly) {
+                    gcode->stream->printf("Error: %s(S%d) has no usable heater, it cannot have a thermal model\n", this->designator.c_str(), this->pool_index);
+                    return;
+                }
+
+                if (gcode->has_letter('T')) {
+                    float target = gcode->get_value('T');
+                    delete this->model_tuner;
+                    this->model_tuner = nullptr;
+                    this->target_temperature = UNDEFINED;
+                    this->heater_pin.set((this->o = 0));
+                    if(target <= 0) {
+                        gcode->stream->printf("%s: Model tune aborted\n", this->designator.c_str());
+                        return;
+                    }
+
+                    // the step response is measured from the current temperature, so the heater should be cold
+                    float output = gcode->has_letter('P') ? gcode->get_value('P') : this->heater_pin.max_pwm() / (float)(PID_PWM_MAX - 1);
+                    THEKERNEL->conveyor->wait_for_idle();
+                    this->model_tuner = new ThermalModelTuner(get_temperature(), target, output);
+                    gcode->stream->printf("%s: Starting model tune to %5.1f from %5.1f at %1.2f power, M307 S%d T0 aborts\n", this->designator.c_str(), target, get_temperature(), output, this->pool_index);
+                    return;
+                }
+
+                if(this->model == nullptr) this->model = new ThermalModel();
+                if (gcode->has_letter('A'))
+                    this->model->gain = gcode->get_value('A');
+                if (gcode->has_letter('C'))
+                    this->model->time_constant = gcode->get_value('C');
+                if (gcode->has_letter('D'))
+                    this->model->dead_time = gcode->get_value('D');
+                if (gcode->has_letter('F'))
+                    this->model->fan_loss = gcode->get_value('F');
+                if (gcode->has_letter('E'))
+                    this->model->extrusion_power = gcode->get_value('E');
+                if (gcode->has_letter('R'))
+                    this->model->ambient = gcode->get_value('R');
+                if (gcode->has_letter('U')) {
+                    this->use_model = gcode->get_value('U') != 0 && this->model->is_valid();
+                    this->model->reset(get_temperature());
+                }
+
+            }else if(!gcode->has_letter('S')) {
+                if(this->model == nullptr) {
+                    gcode->stream->printf("%s(S%d): no thermal model\n", this->designator.c_str(), this->pool_index);
+                } else {
+                    gcode->stream->printf("%s(S%d): A(gain):%g C(time constant):%g D(dead time):%g F(fan loss):%g E(extrusion power):%g R(ambient):%g %s\n", this->designator.c_str(), this->pool_index,
+                                          this->model->gain, this->model->time_constant, this->model->dead_time, this->model->fan_loss, this->model->extrusion_power, this->model->ambient, this->use_model ? "in use" : "not in use");
+                }
+            }
+
         } else if (gcode->m == 500 || gcode->m == 503) { // M500 saves some volatile settings to config override file, M503 just prints the settings
             gcode->stream->printf(";PID settings:\nM301 S%d P%1.4f I%1.4f D%1.4f X%1.4f Y%d\n", this->pool_index, this->p_factor, this->i_factor / this->PIDdt, this->d_factor * this->PIDdt, this->i_max, this->heater_pin.max_pwm());
 
+            if(this->model != nullptr) {
+                gcode->stream->printf(";Thermal model settings:\nM307 S%d A%1.4f C%1.4f D%1.4f F%1.4f E%1.4f R%1.4f U%d\n", this->pool_index, this->model->gain, this->model->time_constant,
+                                      this->model->dead_time, this->model->fan_loss, this->model->extrusion_power, this->model->ambient, this->use_model ? 1 : 0);
+            }
+
             gcode->stream->printf(";Max temperature setting:\nM143 S%d P%1.4f\n", this->pool_index, this->max_temp);
 
             if(this->sensor_settings) {
@@ -450,6 +604,7 @@ void TemperatureControl::set_desired_temperature(float desired_temperature)
     }else if(last_target_temperature <= 0.0F) {
         // if it was off and we are now turning it on we need to initialize
         this->lastInput= last_reading;
+        if(this->model != nullptr) this->model->reset(last_reading);
         // set to whatever the output currently is See http://brettbeauregard.com/blog/2011/04/improving-the-beginner%E2%80%99s-pid-initialization/
         this->iTerm= this->o;
         if (this->iTerm > this->i_max) this->iTerm = this->i_max;
@@ -465,28 +620,51 @@ float TemperatureControl::get_temperature()
     return last_reading;
 }
 
-uint32_t TemperatureControl::thermistor_read_tick(uint32_t dummy)
+// called from the main loop, timestamp is when the reading became due in the timer interrupt so the time between
+// readings is accurate even if this gets called late
+uint32_t TemperatureControl::thermistor_read_tick(uint32_t timestamp)
 {
+    // ratio of the actual time since the last reading to the configured PIDdt, readings can be skipped if the main loop is busy
+    float dt_scale= 1.0F;
+    if(this->last_read_time != 0) {
+        dt_scale= ((timestamp - this->last_read_time) * this->readings_per_second) / 1000000.0F;
+        if(dt_scale <= 0.0F) dt_scale= 1.0F;
+    }
+    this->last_read_time= timestamp;
+
     float temperature = sensor->get_temperature();
-    if(!this->readonly && target_temperature > 2) {
+    if(this->model_tuner != nullptr) {
+        model_tune(temperature, dt_scale * this->PIDdt);
+
+    }else if(!this->readonly && target_temperature > 2) {
         if (isinf(temperature) || temperature < min_temp || temperature > max_temp) {
             this->temp_violated = true;
             target_temperature = UNDEFINED;
             heater_pin.set((this->o = 0));
         } else {
-            pid_process(temperature);
+            pid_process(temperature, dt_scale);
         }
     }
 
     last_reading = temperature;
+    if(this->history != nullptr) this->history->add(timestamp, temperature, target_temperature, this->o);
     return 0;
 }
 
 /**
  * Based on https://github.com/br3ttb/Arduino-PID-Library
  */
-void TemperatureControl::pid_process(float temperature)
+void TemperatureControl::pid_process(float temperature, float dt_scale)
 {
+    if(use_model) {
+        // the model gives the output as a fraction of full power, it has to know about the power limit as it tracks the output it applied
+        int max_output = std::min(heater_pin.max_pwm(), this->power_limit);
+        float u = this->model->update(temperature, target_temperature, dt_scale * this->PIDdt, max_output / (float)(PID_PWM_MAX - 1));
+        this->o = this->requested_o = roundf(u * (PID_PWM_MAX - 1));
+        this->heater_pin.pwm(this->o);
+        return;
+    }
+
     if(use_bangbang) {
         // bang bang is very simple, if temp is < target - hysteresis turn on full else if  temp is > target + hysteresis turn heater off
         // good for relays
@@ -511,12 +689,13 @@ void TemperatureControl::pid_process(float temperature)
     // regular PID control
     float error = target_temperature - temperature;
 
-    float new_I = this->iTerm + (error * this->i_factor);
+    // i_factor and d_factor are scaled for PIDdt, so correct them for the actual time since the last reading
+    float new_I = this->iTerm + (error * this->i_factor * dt_scale);
     if (new_I > this->i_max) new_I = this->i_max;
     else if (new_I < 0.0) new_I = 0.0;
     if(!this->windup) this->iTerm= new_I;
 
-    float d = (temperature - this->lastInput);
+    float d = (temperature - this->lastInput) / dt_scale;
 
     // calculate the PID output
     // TODO does this need to be scaled by max_pwm/256? I think not as p_factor already does that
@@ -529,12 +708,84 @@ void TemperatureControl::pid_process(float temperature)
     else if(this->windup)
         this->iTerm = new_I; // Only update I term when output is not saturated.
 
+    this->requested_o = this->o;
+    if (this->o > this->power_limit)
+        this->o = this->power_limit;
+
     this->heater_pin.pwm(this->o);
     this->lastInput = temperature;
 }
 
+// runs the model tuner on each reading, when it is done the identified model is loaded and used
+void TemperatureControl::model_tune(float temperature, float dt)
+{
+    if (isinf(temperature) || temperature > max_temp) {
+        delete this->model_tuner;
+        this->model_tuner = nullptr;
+        this->temp_violated = true;
+        heater_pin.set((this->o = 0));
+        return;
+    }
+
+    float u = this->model_tuner->update(temperature, dt);
+    this->o = roundf(u * (PID_PWM_MAX - 1));
+    this->heater_pin.pwm(this->o);
+
+    ThermalModelTuner::STATE state = this->model_tuner->get_state();
+    if(state != ThermalModelTuner::DONE && state != ThermalModelTuner::FAILED) return;
+
+    if(state == ThermalModelTuner::DONE) {
+        if(this->model == nullptr) this->model = new ThermalModel();
+        this->model_tuner->get_result(*this->model);
+        this->use_model = true;
+        // NOTE we output to kernel::streams because it is out-of-band data and original stream may be closed
+        THEKERNEL->streams->printf("%s: Model tune complete in %1.0f seconds\n\tgain: %g °C/s\n\ttime constant: %g s\n\tdead time: %g s\n", this->designator.c_str(), this->model_tuner->get_time(),
+                                   this->model->gain, this->model->time_constant, this->model->dead_time);
+        THEKERNEL->streams->printf("The model has been loaded into memory and is in use, but not written to your config file, use M500 to save it.\n");
+
+    } else {
+        THEKERNEL->streams->printf("%s: Model tune failed after %1.0f seconds\n", this->designator.c_str(), this->model_tuner->get_time());
+    }
+
+    delete this->model_tuner;
+    this->model_tuner = nullptr;
+    this->heater_pin.set((this->o = 0));
+}
+
+// read the part cooling fan speed and the extrusion rate for the model feed forward, called once a second
+void TemperatureControl::update_feed_forward()
+{
+    float fan = 0;
+    if(this->model->fan_loss > 0) {
+        struct pad_switch pad;
+        if(PublicData::get_value(switch_checksum, this->model_fan_switch, 0, &pad) && pad.state) {
+            // assumes a sigma-delta fan switch, where value is 0 to 255
+            fan = confine(pad.value / 255.0F, 0.0F, 1.0F);
+        }
+    }
+
+    float rate = 0;
+    if(this->model->extrusion_power > 0) {
+        pad_extruder_t rd;
+        if(PublicData::get_value(extruder_checksum, (void *)&rd)) {
+            // mm of filament extruded since the last second, retractions are ignored
+            if(!isnan(this->last_extruder_position) && rd.current_position > this->last_extruder_position)
+                rate = rd.current_position - this->last_extruder_position;
+            this->last_extruder_position = rd.current_position;
+        }
+    }
+
+    this->model->set_feed_forward(fan, rate);
+}
+
 void TemperatureControl::on_second_tick(void *argument)
 {
+    if(this->model_tuner != nullptr) {
+        THEKERNEL->streams->printf("// Model tune status - %5.1f @%d %1.0fs\n", get_temperature(), this->o, this->model_tuner->get_time());
+
+    } else if(this->use_model) {
+        update_feed_forward();
+    }
 
     // If waiting for a temperature to be reach, display it to keep host programs up to date on the progress
     if (waiting)
@@ -13,6 +13,10 @@
 #include "TempSensor.h"
 #include "TemperatureControlPublicAccess.h"
 
+class ThermalModel;
+class ThermalModelTuner;
+class TemperatureHistory;
+
 class TemperatureControl : public Module {
 
     public:
@@ -33,14 +37,19 @@ class TemperatureControl : public Module {
 
 
         friend class PID_Autotuner;
+        friend class HeaterScheduler;
+        // the unit tests' simulated heater replaces the sensor and drives the reading tick
+        friend class ThermalPlant;
 
     private:
         void load_config();
-        uint32_t thermistor_read_tick(uint32_t dummy);
-        void pid_process(float);
+        uint32_t thermistor_read_tick(uint32_t timestamp);
+        void pid_process(float temperature, float dt_scale);
         void setPIDp(float p);
         void setPIDi(float i);
         void setPIDd(float d);
+        void model_tune(float temperature, float dt);
+        void update_feed_forward();
 
         int pool_index;
 
@@ -53,6 +62,10 @@ class TemperatureControl : public Module {
         TempSensor *sensor;
         float i_max;
         int o;
+        // the output wanted before it was limited to power_limit by the HeaterScheduler
+        int requested_o;
+        int power_limit;
+        float heater_watts;
         float last_reading;
         float readings_per_second;
         Pwm  heater_pin;
@@ -68,6 +81,16 @@ class TemperatureControl : public Module {
         float i_factor;
         float d_factor;
         float PIDdt;
+        uint32_t last_read_time;
+
+        // optional model based control, only allocated if configured or tuned
+        ThermalModel *model;
+        ThermalModelTuner *model_tuner;
+        float last_extruder_position;
+        uint16_t model_fan_switch;
+
+        // averaged readings for M308, null if disabled
+        TemperatureHistory *history;
 
         float runaway_error_range;
 
@@ -87,6 +110,7 @@ class TemperatureControl : public Module {
             uint16_t runaway_timer:9;
             uint8_t tick:3;
             bool use_bangbang:1;
+            bool use_model:1;
             bool waiting:1;
             bool temp_violated:1;
             bool active:1;
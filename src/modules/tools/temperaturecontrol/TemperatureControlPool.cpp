@@ -13,6 +13,7 @@ using namespace std;
 #include "TemperatureControlPool.h"
 #include "TemperatureControl.h"
 #include "PID_Autotuner.h"
+#include "HeaterScheduler.h"
 #include "Config.h"
 #include "checksumm.h"
 #include "ConfigValue.h"
@@ -25,11 +26,13 @@ void TemperatureControlPool::load_tools()
     vector<uint16_t> modules;
     THEKERNEL->config->get_module_list( &modules, temperature_control_checksum );
     int cnt = 0;
+    HeaterScheduler *scheduler = new HeaterScheduler();
     for( auto cs : modules ) {
         // If module is enabled
         if( THEKERNEL->config->value(temperature_control_checksum, cs, enable_checksum )->as_bool() ) {
             TemperatureControl *controller = new TemperatureControl(cs, cnt++);
             THEKERNEL->add_module(controller);
+            scheduler->add(controller);
         }
     }
 
@@ -37,5 +40,8 @@ void TemperatureControlPool::load_tools()
     if(cnt > 0) {
         PID_Autotuner *pidtuner = new PID_Autotuner();
         THEKERNEL->add_module( pidtuner );
+        THEKERNEL->add_module( scheduler );
+    } else {
+        delete scheduler;
     }
 }
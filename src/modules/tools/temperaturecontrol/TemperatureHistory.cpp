@@ -0,0 +1,206 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TemperatureHistory.h"
+#include "StreamOutput.h"
+#include "platform_memory.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+// a reading that was not a number, eg an open thermistor
+#define INVALID_TEMPERATURE INT16_MIN
+
+// samples kept, seconds per sample and the number of samples of the finer ring averaged into one of each ring
+static const uint16_t ring_size[]= {120, 90, 120};
+static const uint16_t resolution_seconds[]= {1, 10, 60};
+static const uint16_t decimation[]= {0, 10, 6};
+
+// base64 records are sent in lines of this many bytes, 60 characters
+#define BINARY_LINE_BYTES 45
+
+static int16_t to_tenths(float v)
+{
+    if(v > 3276.0F) return 32760;
+    if(v < -3276.0F) return -32760;
+    return roundf(v * 10.0F);
+}
+
+TemperatureHistory::TemperatureHistory()
+{
+    size_t total= 0;
+    for (int i = 0; i < levels; ++i) total += ring_size[i];
+
+    // the rings are only written once a second so they can go in AHB0, there is more room on the heap if it is full
+    size_t bytes= total * sizeof(sample_t);
+    buffer= (sample_t *)AHB0.alloc(bytes);
+    if(buffer == nullptr) buffer= (sample_t *)malloc(bytes);
+
+    sample_t *p= buffer;
+    for (int i = 0; i < levels; ++i) {
+        rings[i].samples= p;
+        rings[i].size= ring_size[i];
+        rings[i].head= 0;
+        rings[i].count= 0;
+        if(p != nullptr) p += ring_size[i];
+        sums[i]= {0, 0, 0, 0, 0};
+    }
+
+    period_start= 0;
+    started= false;
+}
+
+TemperatureHistory::~TemperatureHistory()
+{
+    if(buffer == nullptr) return;
+    if(AHB0.has(buffer)) AHB0.dealloc(buffer);
+    else free(buffer);
+}
+
+void TemperatureHistory::accumulate(sum_t &sum, const sample_t &s)
+{
+    sum.n++;
+    if(s.temperature == INVALID_TEMPERATURE) sum.invalid++;
+    else sum.temperature += s.temperature;
+    sum.target += s.target;
+    sum.output += s.output;
+}
+
+// rounded averages, then resets the sum for the next sample
+TemperatureHistory::sample_t TemperatureHistory::average(sum_t &sum)
+{
+    sample_t s;
+    int valid= sum.n - sum.invalid;
+    if(valid == 0) {
+        s.temperature= INVALID_TEMPERATURE;
+    } else {
+        s.temperature= (sum.temperature >= 0) ? (sum.temperature + valid / 2) / valid : (sum.temperature - valid / 2) / valid;
+    }
+    s.target= (sum.target + sum.n / 2) / sum.n;
+    s.output= (sum.output + sum.n / 2) / sum.n;
+    sum= {0, 0, 0, 0, 0};
+    return s;
+}
+
+void TemperatureHistory::push(int level, const sample_t &s)
+{
+    ring_t &r= rings[level];
+    r.samples[r.head]= s;
+    if(++r.head >= r.size) r.head= 0;
+    if(r.count < r.size) r.count++;
+
+    if(level + 1 < levels) {
+        sum_t &next= sums[level + 1];
+        accumulate(next, s);
+        if(next.n >= decimation[level + 1]) push(level + 1, average(next));
+    }
+}
+
+void TemperatureHistory::add(uint32_t timestamp, float temperature, float target, int output)
+{
+    if(buffer == nullptr) return;
+
+    if(!started) {
+        period_start= timestamp;
+        started= true;
+    }
+
+    // close the second this reading is past, if readings stopped for a while the gap is not filled in
+    if(timestamp - period_start >= 1000000) {
+        if(sums[0].n > 0) push(0, average(sums[0]));
+        period_start += 1000000;
+        if(timestamp - period_start >= 1000000) period_start= timestamp;
+    }
+
+    sample_t s;
+    s.temperature= isfinite(temperature) ? to_tenths(temperature) : INVALID_TEMPERATURE;
+    s.target= (target > 0) ? to_tenths(target) : 0;
+    s.output= (output < 0) ? 0 : (output > 255) ? 255 : output;
+    accumulate(sums[0], s);
+}
+
+const TemperatureHistory::ring_t *TemperatureHistory::find(int resolution) const
+{
+    for (int i = 0; i < levels; ++i) {
+        if(resolution_seconds[i] == resolution) return &rings[i];
+    }
+    return nullptr;
+}
+
+static void base64_line(StreamOutput *stream, const uint8_t *data, int n)
+{
+    static const char table[]= "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char line[(BINARY_LINE_BYTES / 3) * 4 + 2];
+    char *p= line;
+    for (int i = 0; i < n; i += 3) {
+        uint32_t v= data[i] << 16;
+        if(i + 1 < n) v |= data[i + 1] << 8;
+        if(i + 2 < n) v |= data[i + 2];
+        *p++= table[(v >> 18) & 0x3F];
+        *p++= table[(v >> 12) & 0x3F];
+        *p++= (i + 1 < n) ? table[(v >> 6) & 0x3F] : '=';
+        *p++= (i + 2 < n) ? table[v & 0x3F] : '=';
+    }
+    *p++= '\n';
+    *p= '\0';
+    stream->puts(line);
+}
+
+bool TemperatureHistory::dump(StreamOutput *stream, const char *name, int resolution, int n, bool binary) const
+{
+    const ring_t *r= find(resolution);
+    if(r == nullptr || buffer == nullptr) return false;
+
+    if(n <= 0 || n > r->count) n= r->count;
+    int first= (r->head + r->size - n) % r->size;
+
+    if(!binary) {
+        stream->printf("%s history R%d N%d\nseconds,target,temperature,output\n", name, resolution, n);
+        for (int i = 0; i < n; ++i) {
+            const sample_t &s= r->samples[(first + i) % r->size];
+            int seconds= -(n - 1 - i) * resolution;
+            if(s.temperature == INVALID_TEMPERATURE) {
+                stream->printf("%d,%1.1f,inf,%d\n", seconds, s.target / 10.0F, s.output);
+            } else {
+                stream->printf("%d,%1.1f,%1.1f,%d\n", seconds, s.target / 10.0F, s.temperature / 10.0F, s.output);
+            }
+        }
+        return true;
+    }
+
+    // 5 byte little endian records of target and temperature in 0.1°C and output, oldest first,
+    // INT16_MIN as the temperature is a bad reading. base64 so it is safe on any stream
+    stream->printf("%s history R%d N%d base64\n", name, resolution, n);
+    uint8_t data[BINARY_LINE_BYTES];
+    int len= 0;
+    for (int i = 0; i < n; ++i) {
+        const sample_t &s= r->samples[(first + i) % r->size];
+        data[len++]= s.target & 0xFF;
+        data[len++]= (s.target >> 8) & 0xFF;
+        data[len++]= s.temperature & 0xFF;
+        data[len++]= (s.temperature >> 8) & 0xFF;
+        data[len++]= s.output;
+        if(len == BINARY_LINE_BYTES) {
+            base64_line(stream, data, len);
+            len= 0;
+        }
+    }
+    if(len > 0) base64_line(stream, data, len);
+
+    return true;
+}
+
+void TemperatureHistory::summary(StreamOutput *stream, const char *name) const
+{
+    if(buffer == nullptr) {
+        stream->printf("%s history: no memory\n", name);
+        return;
+    }
+
+    stream->printf("%s history: %u/%u at 1s, %u/%u at 10s, %u/%u at 60s\n", name,
+                   rings[0].count, rings[0].size, rings[1].count, rings[1].size, rings[2].count, rings[2].size);
+}
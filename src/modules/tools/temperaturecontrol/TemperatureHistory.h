@@ -0,0 +1,71 @@
+/*
+      this file is part of smoothie (http://smoothieware.org/). the motion control part is heavily based on grbl (https://github.com/simen/grbl).
+      smoothie is free software: you can redistribute it and/or modify it under the terms of the gnu general public license as published by the free software foundation, either version 3 of the license, or (at your option) any later version.
+      smoothie is distributed in the hope that it will be useful, but without any warranty; without even the implied warranty of merchantability or fitness for a particular purpose. see the gnu general public license for more details.
+      you should have received a copy of the gnu general public license along with smoothie. if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TEMPERATUREHISTORY_H
+#define TEMPERATUREHISTORY_H
+
+#include <stdint.h>
+
+class StreamOutput;
+
+// Fixed size history of a heater's target, temperature and output at three resolutions, the last 2 minutes at 1s,
+// the last 15 minutes at 10s and the last 2 hours at 1 minute. Each sample is the average of the readings in its period,
+// the coarser rings are fed by averaging the finer ones so nothing is kept but the rings and three running sums
+class TemperatureHistory
+{
+    public:
+        TemperatureHistory();
+        ~TemperatureHistory();
+
+        // false if there was no memory for the rings
+        bool is_valid() const { return buffer != nullptr; }
+
+        // called on every reading, timestamp is in us
+        void add(uint32_t timestamp, float temperature, float target, int output);
+
+        // writes the newest n samples at resolution seconds (1, 10 or 60) oldest first, as CSV or base64 encoded records
+        bool dump(StreamOutput *stream, const char *name, int resolution, int n, bool binary) const;
+        void summary(StreamOutput *stream, const char *name) const;
+
+    private:
+        // temperatures are in 0.1°C, output is 0-255
+        struct sample_t {
+            int16_t temperature;
+            int16_t target;
+            uint8_t output;
+        } __attribute__ ((packed));
+
+        struct ring_t {
+            sample_t *samples;
+            uint16_t size;
+            uint16_t head;      // next to write
+            uint16_t count;
+        };
+
+        // running sums of the readings or samples going into the next sample of a ring
+        struct sum_t {
+            int32_t temperature;
+            int32_t target;
+            uint32_t output;
+            uint16_t n;
+            uint16_t invalid;
+        };
+
+        void push(int level, const sample_t &s);
+        static void accumulate(sum_t &sum, const sample_t &s);
+        static sample_t average(sum_t &sum);
+        const ring_t *find(int resolution) const;
+
+        static const int levels= 3;
+        ring_t rings[levels];
+        sum_t sums[levels];
+        sample_t *buffer;
+        uint32_t period_start;
+        bool started;
+};
+
+#endif
@@ -0,0 +1,179 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ThermalModel.h"
+
+#include <math.h>
+
+// the integral correction for model error only runs within this many °C of the target
+#define BIAS_BAND 5.0F
+#define MAX_BIAS 0.5F
+
+ThermalModel::ThermalModel()
+{
+    gain= 0;
+    time_constant= 0;
+    dead_time= 0;
+    fan_loss= 0;
+    extrusion_power= 0;
+    ambient= 25;
+    fan= 0;
+    extrusion_rate= 0;
+    reset(ambient);
+}
+
+void ThermalModel::reset(float temperature)
+{
+    heater_temperature= temperature;
+    sensor_temperature= temperature;
+    bias= 0;
+    last_output= 0;
+}
+
+void ThermalModel::set_feed_forward(float fan, float extrusion_rate)
+{
+    this->fan= fan;
+    this->extrusion_rate= extrusion_rate;
+}
+
+float ThermalModel::update(float temperature, float target, float dt, float max_output)
+{
+    if(!is_valid() || dt <= 0.0F) return 0;
+
+    // the ambient loss rate, the part cooling fan increases it
+    float a= (1.0F + fan_loss * fan) / time_constant;
+
+    // advance the model by the output that was applied since the last reading
+    heater_temperature += (gain * last_output - a * (heater_temperature - ambient)) * dt;
+    if(dead_time > dt) sensor_temperature += (heater_temperature - sensor_temperature) * dt / dead_time;
+    else sensor_temperature= heater_temperature;
+
+    // correct the model with the reading, the heater is assumed to be off by the same amount as the sensor
+    float error= temperature - sensor_temperature;
+    sensor_temperature += error;
+    heater_temperature += error;
+
+    // the output that takes the heater to the target in one dead time, the sensor then follows it without overshooting.
+    // When far from the target this saturates so heating is done at full power, close to it this reduces to the
+    // steady state power needed to hold the target against the ambient loss
+    float h= dead_time > dt ? dead_time : dt;
+    float e= expf(-a * h);
+    float kp= a / (gain * (1.0F - e));
+    float u= kp * ((target - ambient) - (heater_temperature - ambient) * e);
+
+    // feed forward the power carried away by the filament
+    u += extrusion_power * extrusion_rate;
+
+    // slowly integrate out any steady state error caused by the model being inaccurate
+    float offset= target - temperature;
+    if(fabsf(offset) < BIAS_BAND) {
+        bias += offset * kp * dt / (8 * h);
+        if(bias > MAX_BIAS) bias= MAX_BIAS;
+        else if(bias < -MAX_BIAS) bias= -MAX_BIAS;
+    }
+    u += bias;
+
+    if(u > max_output) u= max_output;
+    else if(u < 0.0F) u= 0.0F;
+
+    last_output= u;
+    return u;
+}
+
+// the heater must reach the target within this many seconds or the tune fails
+#define MAX_TUNE_TIME 1800.0F
+// drop from the peak temperature that marks the start of cooling
+#define PEAK_NOISE 0.5F
+// cooling is measured until the rise above ambient has dropped to this fraction
+#define COOLING_FRACTION 0.8F
+
+ThermalModelTuner::ThermalModelTuner(float ambient, float target, float output)
+{
+    this->ambient= ambient;
+    this->target= target;
+    this->output= output;
+    time= 0;
+    sample_time= 0;
+    max_slope= 0;
+    max_slope_temperature= ambient;
+    max_slope_time= 0;
+    peak= ambient;
+    cooling_start_rise= 0;
+    cooling_start_time= 0;
+    time_constant= 0;
+    n_samples= 0;
+    state= (output > 0.0F && target > ambient) ? HEATING : FAILED;
+}
+
+float ThermalModelTuner::update(float temperature, float dt)
+{
+    time += dt;
+    if(time > MAX_TUNE_TIME && state != DONE) state= FAILED;
+
+    switch(state) {
+        case HEATING:
+            // the slope is taken over several samples spread over a few seconds so sensor noise does not dominate it
+            sample_time += dt;
+            if(sample_time >= slope_interval) {
+                sample_time -= slope_interval;
+                for (int i = slope_samples - 1; i > 0; --i) samples[i]= samples[i - 1];
+                samples[0]= temperature;
+                if(++n_samples >= slope_samples) {
+                    const float span= slope_interval * (slope_samples - 1);
+                    float slope= (samples[0] - samples[slope_samples - 1]) / span;
+                    if(slope > max_slope) {
+                        max_slope= slope;
+                        max_slope_temperature= (samples[0] + samples[slope_samples - 1]) / 2;
+                        max_slope_time= time - span / 2;
+                    }
+                }
+            }
+
+            if(temperature < target) return output;
+
+            state= PEAK;
+            peak= temperature;
+            return 0;
+
+        case PEAK:
+            // the heater is off but the sensor keeps rising for a while
+            if(temperature > peak) {
+                peak= temperature;
+
+            }else if(temperature < peak - PEAK_NOISE) {
+                state= COOLING;
+                cooling_start_rise= temperature - ambient;
+                cooling_start_time= time;
+            }
+            return 0;
+
+        case COOLING: {
+            float rise= temperature - ambient;
+            if(rise <= cooling_start_rise * COOLING_FRACTION) {
+                time_constant= (time - cooling_start_time) / logf(cooling_start_rise / rise);
+                state= (max_slope > 0.0F && time_constant > 0.0F) ? DONE : FAILED;
+            }
+            return 0;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+void ThermalModelTuner::get_result(ThermalModel &model) const
+{
+    model.ambient= ambient;
+    model.time_constant= time_constant;
+
+    // at the point of maximum slope part of the heater power was already being lost to ambient
+    model.gain= (max_slope + (max_slope_temperature - ambient) / time_constant) / output;
+
+    // the tangent at the maximum slope crosses ambient one dead time after the heater was turned on
+    float dead_time= max_slope_time - (max_slope_temperature - ambient) / max_slope;
+    model.dead_time= dead_time > 0.0F ? dead_time : 0.0F;
+}
@@ -0,0 +1,91 @@
+/*
+      this file is part of smoothie (http://smoothieware.org/). the motion control part is heavily based on grbl (https://github.com/simen/grbl).
+      smoothie is free software: you can redistribute it and/or modify it under the terms of the gnu general public license as published by the free software foundation, either version 3 of the license, or (at your option) any later version.
+      smoothie is distributed in the hope that it will be useful, but without any warranty; without even the implied warranty of merchantability or fitness for a particular purpose. see the gnu general public license for more details.
+      you should have received a copy of the gnu general public license along with smoothie. if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef THERMALMODEL_H
+#define THERMALMODEL_H
+
+// First order thermal model of a heater, the heater block temperature H and the sensor temperature S follow
+//   dH/dt = gain * output - (1 + fan_loss * fan) * (H - ambient) / time_constant
+//   dS/dt = (H - S) / dead_time
+// where output is the heater power as a fraction of full power and fan is the part cooling fan as a fraction of full speed
+class ThermalModel
+{
+    public:
+        ThermalModel();
+
+        bool is_valid() const { return gain > 0.0F && time_constant > 0.0F; }
+
+        // start controlling from the current temperature with the heater off
+        void reset(float temperature);
+
+        // fan is 0 to 1, extrusion_rate is in mm/s of filament
+        void set_feed_forward(float fan, float extrusion_rate);
+
+        // advance the model by dt seconds and correct it with the measured temperature,
+        // returns the output (0 to max_output) that brings the heater to the target without overshoot
+        float update(float temperature, float target, float dt, float max_output);
+
+        float get_heater_temperature() const { return heater_temperature; }
+
+        // model parameters
+        float gain;             // °C/s rise at full power
+        float time_constant;    // s, heat capacity / ambient loss
+        float dead_time;        // s, lag between the heater and the sensor
+        float fan_loss;         // extra ambient loss at full fan, as a fraction of the still air loss
+        float extrusion_power;  // output needed per mm/s of filament extruded
+        float ambient;          // °C
+
+    private:
+        float heater_temperature;
+        float sensor_temperature;
+        float bias;
+        float last_output;
+        float fan;
+        float extrusion_rate;
+};
+
+// Identifies the ThermalModel parameters from a step response. The heater is run at a fixed output until it reaches the
+// target, the maximum rate of rise gives the gain and the dead time (where its tangent crosses ambient), then the heater is
+// turned off and the exponential cooling after the peak gives the time constant
+class ThermalModelTuner
+{
+    public:
+        enum STATE { HEATING, PEAK, COOLING, DONE, FAILED };
+
+        ThermalModelTuner(float ambient, float target, float output);
+
+        // feed a reading taken dt seconds after the last one, returns the output to apply
+        float update(float temperature, float dt);
+
+        STATE get_state() const { return state; }
+        float get_time() const { return time; }
+
+        // fills in the identified parameters, only valid when the state is DONE
+        void get_result(ThermalModel &model) const;
+
+    private:
+        static const int slope_samples= 8;
+        static constexpr float slope_interval= 0.5F; // seconds between slope samples
+
+        float samples[slope_samples];
+        float ambient;
+        float target;
+        float output;
+        float time;
+        float sample_time;
+        float max_slope;
+        float max_slope_temperature;
+        float max_slope_time;
+        float peak;
+        float cooling_start_rise;
+        float cooling_start_time;
+        float time_constant;
+        int n_samples;
+        STATE state;
+};
+
+#endif
@@ -18,6 +18,8 @@
 
 // a const list of predefined thermistors
 #include "predefined_thermistors.h"
+// and their ADC to temperature tables
+#include "predefined_thermistor_tables.h"
 
 #include <fastmath.h>
 
@@ -47,10 +49,14 @@ Thermistor::Thermistor()
     min_temp= 999;
     max_temp= 0;
     this->thermistor_number= 0; // not a predefined thermistor
+    this->table= nullptr;
+    this->table_buffer= nullptr;
+    this->open_circuit_adc= 0;
 }
 
 Thermistor::~Thermistor()
 {
+    delete [] table_buffer;
 }
 
 // Get configuration from the config file
@@ -180,6 +186,7 @@ void Thermistor::UpdateConfig(uint16_t module_checksum, uint16_t name_checksum)
         return;
     }
 
+    build_table();
 }
 
 // print out predefined thermistors
@@ -234,6 +241,51 @@ void Thermistor::calc_jk()
     }
 }
 
+// Select the ADC to temperature table for the current settings. An unmodified predefined thermistor uses its table in flash,
+// anything else has a table built here so the conversion in the read path needs no logf/powf
+void Thermistor::build_table()
+{
+    if(this->bad_config) return;
+
+    const uint32_t max_adc_value= THEKERNEL->adc->get_max_value();
+    this->open_circuit_adc= ThermistorTable::resistance_to_adc(this->r0 * 8, r1, r2, max_adc_value);
+
+    const thermistor_table_entry_t *predefined= nullptr;
+    if(thermistor_number != 0 && max_adc_value == PREDEFINED_THERMISTOR_TABLES_MAX_ADC) {
+        if(thermistor_number & 0x80) {
+            uint8_t n= (thermistor_number&0x7F)-1;
+            auto &i= predefined_thermistors_beta[n];
+            if(!use_steinhart_hart && beta == i.beta && r0 == i.r0 && t0 == i.t0 && r1 == i.r1 && r2 == i.r2) {
+                predefined= predefined_thermistors_beta_tables[n];
+            }
+        }else{
+            uint8_t n= thermistor_number-1;
+            auto &i= predefined_thermistors[n];
+            if(use_steinhart_hart && c1 == i.c1 && c2 == i.c2 && c3 == i.c3 && r1 == i.r1 && r2 == i.r2) {
+                predefined= predefined_thermistors_tables[n];
+            }
+        }
+    }
+
+    // the new table is swapped in before the old buffer is freed as it may be in use by a reading
+    thermistor_table_entry_t *old_buffer= this->table_buffer;
+    if(predefined != nullptr) {
+        this->table= predefined;
+        this->table_buffer= nullptr;
+
+    }else{
+        thermistor_table_entry_t *t= new thermistor_table_entry_t[THERMISTOR_TABLE_SIZE];
+        if(this->use_steinhart_hart) {
+            ThermistorTable::build_steinhart_hart(t, c1, c2, c3, r1, r2, max_adc_value);
+        }else{
+            ThermistorTable::build_beta(t, beta, r0, t0, r1, r2, max_adc_value);
+        }
+        this->table= t;
+        this->table_buffer= t;
+    }
+    delete [] old_buffer;
+}
+
 float Thermistor::get_temperature()
 {
     if(bad_config) return infinityf();
@@ -254,8 +306,7 @@ void Thermistor::get_raw()
     const uint32_t max_adc_value= THEKERNEL->adc->get_max_value();
 
      // resistance of the thermistor in ohms
-    float r = r2 / (((float)max_adc_value / adc_value) - 1.0F);
-    if (r1 > 0.0F) r = (r1 * r) / (r1 - r);
+    float r = ThermistorTable::adc_to_resistance(adc_value, r1, r2, max_adc_value);
 
     THEKERNEL->streams->printf("adc= %d, resistance= %f\n", adc_value, r);
 
@@ -269,6 +320,7 @@ void Thermistor::get_raw()
         t= (1.0F / (k + (j * logf(r / r0)))) - 273.15F;
         THEKERNEL->streams->printf("beta temp= %f, min= %f, max= %f, delta= %f\n", t, min_temp, max_temp, max_temp-min_temp);
     }
+    THEKERNEL->streams->printf("table temp= %f, using %s table\n", adc_value_to_temperature(adc_value), table_buffer == nullptr ? "predefined" : "calculated");
 
     // if using a predefined thermistor show its name and which table it is from
     if(thermistor_number != 0) {
@@ -283,25 +335,13 @@ void Thermistor::get_raw()
 float Thermistor::adc_value_to_temperature(uint32_t adc_value)
 {
     const uint32_t max_adc_value= THEKERNEL->adc->get_max_value();
-    if ((adc_value >= max_adc_value) || (adc_value == 0))
+    if ((adc_value >= max_adc_value) || (adc_value == 0) || this->table == nullptr)
         return infinityf();
 
-    // resistance of the thermistor in ohms
-    float r = r2 / (((float)max_adc_value / adc_value) - 1.0F);
-    if (r1 > 0.0F) r = (r1 * r) / (r1 - r);
-
-    if(r > this->r0 * 8) return infinityf(); // 800k is probably open circuit
-
-    float t;
-    if(this->use_steinhart_hart) {
-        float l = logf(r);
-        t= (1.0F / (this->c1 + this->c2 * l + this->c3 * powf(l,3))) - 273.15F;
-    }else{
-        // use Beta value
-        t= (1.0F / (k + (j * logf(r / r0)))) - 273.15F;
-    }
+    if(adc_value > this->open_circuit_adc) return infinityf(); // over r0 * 8 (800k) is probably open circuit
 
-    return t;
+    // interpolate in the precomputed table, the beta or Steinhart-Hart math is only done when the table is built
+    return ThermistorTable::lookup(this->table, adc_value);
 }
 
 int Thermistor::new_thermistor_reading()
@@ -352,6 +392,7 @@ bool Thermistor::set_optional(const sensor_options_t& options) {
             calc_jk();
             thermistor_number= predefined;
             this->bad_config= false;
+            build_table();
             return true;
 
         }else {
@@ -370,6 +411,7 @@ bool Thermistor::set_optional(const sensor_options_t& options) {
             use_steinhart_hart= true;
             thermistor_number= predefined;
             this->bad_config= false;
+            build_table();
             return true;
         }
     }
@@ -397,6 +439,7 @@ bool Thermistor::set_optional(const sensor_options_t& options) {
 
     if(this->bad_config) this->bad_config= false;
 
+    build_table();
     return true;
 }
 
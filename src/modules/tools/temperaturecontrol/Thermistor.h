@@ -9,6 +9,7 @@
 #define THERMISTOR_H
 
 #include "TempSensor.h"
+#include "ThermistorTable.h"
 #include "RingBuffer.h"
 #include "Pin.h"
 
@@ -37,6 +38,7 @@ class Thermistor : public TempSensor
         int new_thermistor_reading();
         float adc_value_to_temperature(uint32_t adc_value);
         void calc_jk();
+        void build_table();
 
         // Thermistor computation settings using beta, not used if using Steinhart-Hart
         float r0;
@@ -62,6 +64,12 @@ class Thermistor : public TempSensor
 
         Pin  thermistor_pin;
 
+        // ADC to temperature table used when reading, either a predefined table in flash or table_buffer
+        const thermistor_table_entry_t *table;
+        thermistor_table_entry_t *table_buffer;
+        // readings above this are over r0 * 8 and are probably an open circuit
+        uint16_t open_circuit_adc;
+
         float min_temp, max_temp;
         struct {
             bool bad_config:1;
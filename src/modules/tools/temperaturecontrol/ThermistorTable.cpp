@@ -0,0 +1,95 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ThermistorTable.h"
+
+#include <math.h>
+
+// resistance of the thermistor in ohms for the given adc reading, r2 is the pullup and r1 an optional parallel resistor
+float ThermistorTable::adc_to_resistance(uint32_t adc_value, int r1, int r2, uint32_t max_adc)
+{
+    float r = r2 / (((float)max_adc / adc_value) - 1.0F);
+    if (r1 > 0) r = (r1 * r) / (r1 - r);
+    return r;
+}
+
+// the inverse of adc_to_resistance
+uint32_t ThermistorTable::resistance_to_adc(float r, int r1, int r2, uint32_t max_adc)
+{
+    if (r1 > 0) r = (r1 * r) / (r1 + r);
+    float adc = roundf(max_adc * r / (r + r2));
+    if(adc < 1.0F) return 1;
+    if(adc > max_adc - 1) return max_adc - 1;
+    return adc;
+}
+
+static int16_t to_fixed(float t)
+{
+    return roundf(t * (1 << THERMISTOR_TABLE_TEMP_SHIFT));
+}
+
+static float table_temperature(int i)
+{
+    return THERMISTOR_TABLE_MAX_TEMP - ((float)(THERMISTOR_TABLE_MAX_TEMP - THERMISTOR_TABLE_MIN_TEMP) * i) / (THERMISTOR_TABLE_SIZE - 1);
+}
+
+// the ADC value for each table temperature is found from the inverted equation, then the temperature stored is recalculated
+// from the rounded ADC value so the table is exact at every entry
+void ThermistorTable::build_beta(thermistor_table_entry_t *table, float beta, float r0, float t0, int r1, int r2, uint32_t max_adc)
+{
+    const float j = 1.0F / beta;
+    const float k = 1.0F / (t0 + 273.15F);
+    for (int i = 0; i < THERMISTOR_TABLE_SIZE; ++i) {
+        float r = r0 * expf(beta * ((1.0F / (table_temperature(i) + 273.15F)) - k));
+        uint32_t adc = resistance_to_adc(r, r1, r2, max_adc);
+        float t = (1.0F / (k + (j * logf(adc_to_resistance(adc, r1, r2, max_adc) / r0)))) - 273.15F;
+        table[i].adc = adc;
+        table[i].temp = to_fixed(t);
+    }
+}
+
+void ThermistorTable::build_steinhart_hart(thermistor_table_entry_t *table, float c1, float c2, float c3, int r1, int r2, uint32_t max_adc)
+{
+    // solve c3*l^3 + c2*l + (c1 - 1/T) = 0 for l = ln(r) using Cardano's formula, there is only one real root as c2 and c3 are positive
+    const float p = c2 / c3;
+    for (int i = 0; i < THERMISTOR_TABLE_SIZE; ++i) {
+        float q = (c1 - (1.0F / (table_temperature(i) + 273.15F))) / c3;
+        float s = sqrtf((q * q / 4.0F) + (p * p * p / 27.0F));
+        float l = cbrtf(-q / 2.0F + s) + cbrtf(-q / 2.0F - s);
+        uint32_t adc = resistance_to_adc(expf(l), r1, r2, max_adc);
+        l = logf(adc_to_resistance(adc, r1, r2, max_adc));
+        float t = (1.0F / (c1 + c2 * l + c3 * powf(l, 3))) - 273.15F;
+        table[i].adc = adc;
+        table[i].temp = to_fixed(t);
+    }
+}
+
+// find the segment containing adc_value by binary search and linearly interpolate, readings off either end of the table are extrapolated
+// from the end segments. This is called from the temperature read path so uses only integer math until the final scale
+float ThermistorTable::lookup(const thermistor_table_entry_t *table, uint32_t adc_value)
+{
+    int lo = 0;
+    int hi = THERMISTOR_TABLE_SIZE - 1;
+    if(adc_value <= table[0].adc) {
+        hi = 1;
+    } else if(adc_value >= table[hi].adc) {
+        lo = hi - 1;
+    } else {
+        while(hi - lo > 1) {
+            int mid = (lo + hi) / 2;
+            if(table[mid].adc <= adc_value) lo = mid;
+            else hi = mid;
+        }
+    }
+
+    int32_t da = table[hi].adc - table[lo].adc;
+    int32_t t = table[lo].temp << 8;
+    if(da > 0) {
+        t += (((int32_t)(table[hi].temp - table[lo].temp) << 8) * ((int32_t)adc_value - table[lo].adc)) / da;
+    }
+    return t * (1.0F / (1 << (THERMISTOR_TABLE_TEMP_SHIFT + 8)));
+}
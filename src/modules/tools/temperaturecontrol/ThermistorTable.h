@@ -0,0 +1,40 @@
+/*
+      this file is part of smoothie (http://smoothieware.org/). the motion control part is heavily based on grbl (https://github.com/simen/grbl).
+      smoothie is free software: you can redistribute it and/or modify it under the terms of the gnu general public license as published by the free software foundation, either version 3 of the license, or (at your option) any later version.
+      smoothie is distributed in the hope that it will be useful, but without any warranty; without even the implied warranty of merchantability or fitness for a particular purpose. see the gnu general public license for more details.
+      you should have received a copy of the gnu general public license along with smoothie. if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef THERMISTORTABLE_H
+#define THERMISTORTABLE_H
+
+#include <stdint.h>
+
+// A thermistor lookup table has THERMISTOR_TABLE_SIZE entries spaced evenly in temperature between
+// THERMISTOR_TABLE_MAX_TEMP and THERMISTOR_TABLE_MIN_TEMP, stored in ascending ADC order (so descending temperature)
+// NOTE if these are changed predefined_thermistor_tables.h must be regenerated with generate_thermistor_tables.py
+#define THERMISTOR_TABLE_SIZE 64
+#define THERMISTOR_TABLE_MIN_TEMP -20
+#define THERMISTOR_TABLE_MAX_TEMP 420
+
+// temperatures are stored in fixed point with this many fractional bits
+#define THERMISTOR_TABLE_TEMP_SHIFT 4
+
+typedef struct {
+    uint16_t adc;
+    int16_t temp;
+} thermistor_table_entry_t;
+
+// Builds and interpolates the ADC to temperature tables used by Thermistor, so no transcendental math is needed when reading
+class ThermistorTable
+{
+    public:
+        static void build_beta(thermistor_table_entry_t *table, float beta, float r0, float t0, int r1, int r2, uint32_t max_adc);
+        static void build_steinhart_hart(thermistor_table_entry_t *table, float c1, float c2, float c3, int r1, int r2, uint32_t max_adc);
+        static float lookup(const thermistor_table_entry_t *table, uint32_t adc_value);
+
+        static float adc_to_resistance(uint32_t adc_value, int r1, int r2, uint32_t max_adc);
+        static uint32_t resistance_to_adc(float r, int r1, int r2, uint32_t max_adc);
+};
+
+#endif
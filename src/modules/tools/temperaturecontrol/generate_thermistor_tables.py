@@ -0,0 +1,108 @@
+#!/usr/bin/env python
+"""\
+Generate predefined_thermistor_tables.h from the thermistors in predefined_thermistors.h
+
+The tables are built the same way ThermistorTable builds them at runtime for a configured thermistor,
+so a predefined thermistor used as is does not need any table to be built or stored in RAM.
+
+Run this whenever predefined_thermistors.h, ThermistorTable.h or OVERSAMPLE in Adc.h changes
+"""
+
+from __future__ import print_function
+import math
+import os
+import re
+
+here = os.path.dirname(os.path.abspath(__file__))
+
+def define(text, name):
+    return int(re.search(r'#define\s+%s\s+(-?\d+)' % name, text).group(1))
+
+table_h = open(os.path.join(here, 'ThermistorTable.h')).read()
+SIZE = define(table_h, 'THERMISTOR_TABLE_SIZE')
+MIN_TEMP = define(table_h, 'THERMISTOR_TABLE_MIN_TEMP')
+MAX_TEMP = define(table_h, 'THERMISTOR_TABLE_MAX_TEMP')
+SHIFT = define(table_h, 'THERMISTOR_TABLE_TEMP_SHIFT')
+OVERSAMPLE = define(open(os.path.join(here, '../../../libs/Adc.h')).read(), 'OVERSAMPLE')
+MAX_ADC = 4095 << OVERSAMPLE
+
+def parse_tables(text):
+    beta = []
+    sh = []
+    current = None
+    for line in text.splitlines():
+        if 'predefined_thermistors_beta[]' in line:
+            current = beta
+        elif 'predefined_thermistors[]' in line:
+            current = sh
+        elif current is not None:
+            m = re.match(r'\s*\{\s*"([^"]+)"\s*,(.*)\}', line)
+            if m:
+                current.append([m.group(1)] + [float(v.strip().rstrip('F')) for v in m.group(2).split(',')])
+    return beta, sh
+
+def adc_to_resistance(adc, r1, r2):
+    r = r2 / ((float(MAX_ADC) / adc) - 1.0)
+    if r1 > 0: r = (r1 * r) / (r1 - r)
+    return r
+
+def resistance_to_adc(r, r1, r2):
+    if r1 > 0: r = (r1 * r) / (r1 + r)
+    return min(max(int(round(MAX_ADC * r / (r + r2))), 1), MAX_ADC - 1)
+
+def table_temperature(i):
+    return MAX_TEMP - float(MAX_TEMP - MIN_TEMP) * i / (SIZE - 1)
+
+def to_fixed(t):
+    return int(round(t * (1 << SHIFT)))
+
+def build_beta(r1, r2, beta, r0, t0):
+    k = 1.0 / (t0 + 273.15)
+    table = []
+    for i in range(SIZE):
+        r = r0 * math.exp(beta * ((1.0 / (table_temperature(i) + 273.15)) - k))
+        adc = resistance_to_adc(r, r1, r2)
+        t = (1.0 / (k + (math.log(adc_to_resistance(adc, r1, r2) / r0) / beta))) - 273.15
+        table.append((adc, to_fixed(t)))
+    return table
+
+def cbrt(x):
+    return math.copysign(abs(x) ** (1.0 / 3.0), x)
+
+def build_steinhart_hart(r1, r2, c1, c2, c3):
+    p = c2 / c3
+    table = []
+    for i in range(SIZE):
+        q = (c1 - (1.0 / (table_temperature(i) + 273.15))) / c3
+        s = math.sqrt((q * q / 4.0) + (p * p * p / 27.0))
+        adc = resistance_to_adc(math.exp(cbrt(-q / 2.0 + s) + cbrt(-q / 2.0 - s)), r1, r2)
+        l = math.log(adc_to_resistance(adc, r1, r2))
+        t = (1.0 / (c1 + c2 * l + c3 * l ** 3)) - 273.15
+        table.append((adc, to_fixed(t)))
+    return table
+
+def emit(out, name, entries, builder):
+    out.append('static const thermistor_table_entry_t %s[][THERMISTOR_TABLE_SIZE] {' % name)
+    for e in entries:
+        table = builder(*e[1:])
+        out.append('    { // %s' % e[0])
+        for n in range(0, SIZE, 8):
+            out.append('        ' + ' '.join('{%5d,%5d},' % v for v in table[n:n + 8]))
+        out.append('    },')
+    out.append('};')
+    out.append('')
+
+beta, sh = parse_tables(open(os.path.join(here, 'predefined_thermistors.h')).read())
+
+out = ['// GENERATED by generate_thermistor_tables.py from predefined_thermistors.h, DO NOT EDIT',
+       '// ADC to temperature tables for the predefined thermistors in the same order as the predefined tables',
+       '',
+       '#include "ThermistorTable.h"',
+       '',
+       '// the ADC range the tables were generated for, they are only used if it matches Adc::get_max_value()',
+       '#define PREDEFINED_THERMISTOR_TABLES_MAX_ADC %d' % MAX_ADC,
+       '']
+emit(out, 'predefined_thermistors_beta_tables', beta, build_beta)
+emit(out, 'predefined_thermistors_tables', sh, build_steinhart_hart)
+
+open(os.path.join(here, 'predefined_thermistor_tables.h'), 'w').write('\n'.join(out))
@@ -20,13 +20,20 @@
 #define spi_channel_checksum CHECKSUM("spi_channel")
 
 Max31855::Max31855() :
-    spi(nullptr)
+    bus(nullptr)
 {
+    raw= 0;
+    fresh= false;
+    readings_sum= 0;
+    transaction.rx= &raw;
+    transaction.length= 1;
+    transaction.done= [this](SPITransaction*) { this->fresh= true; };
 }
 
 Max31855::~Max31855()
 {
-    delete spi;
+    // the transaction must not be left on the bus queue
+    while(transaction.is_busy()) ;
 }
 
 // Get configuration from the config file
@@ -39,80 +46,37 @@ void Max31855::UpdateConfig(uint16_t module_checksum, uint16_t name_checksum)
 
     // select which SPI channel to use
     int spi_channel = THEKERNEL->config->value(module_checksum, name_checksum, spi_channel_checksum)->by_default(0)->as_number();
-    PinName miso;
-    PinName mosi;
-    PinName sclk;
-    if(spi_channel == 0) {
-        // Channel 0
-        mosi=P0_18; miso=P0_17; sclk=P0_15;
-    } else {
-        // Channel 1
-        mosi=P0_9; miso=P0_8; sclk=P0_7;
-    }
-
-    delete spi;
-    spi = new mbed::SPI(mosi, miso, sclk);
+    bus= SPIBus::get(spi_channel);
 
-    // Spi settings: 1MHz (default), 16 bits, mode 0 (default)
-    spi->format(16);
+    // Spi settings: 1MHz, 16 bits, mode 0
+    transaction.setup(&spi_cs_pin, 16, 0, 1000000);
 }
 
+// The conversion is read asynchronously, each call picks up the reading queued by the previous one
 float Max31855::get_temperature()
 {
-	// Return an average of the last readings
-    if (readings.size() >= readings.capacity()) {
-        readings.delete_tail();
-    }
-
-	float temp = read_temp();
-
-	// Discard occasional errors...
-	if(!isinf(temp))
-	{
-		readings.push_back(temp);
-	}
-
-	if(readings.size()==0) return infinityf();
-
-	float sum = 0;
-    for (int i=0; i<readings.size(); i++) {
-        sum += *readings.get_ref(i);
+    if(bus == nullptr) return infinityf();
+
+    if(fresh) {
+        fresh= false;
+        // Discard occasional errors...
+        if(!(raw & 0x0001)) {
+            // the top 14 bits are the temperature in quarter degrees
+            int16_t t= ((int16_t)raw) >> 2;
+
+            if (readings.size() >= readings.capacity()) {
+                readings_sum -= *readings.get_tail_ref();
+                readings.delete_tail();
+            }
+            readings.push_back(t);
+            readings_sum += t;
+        }
     }
 
-	return sum / readings.size();
-}
-
-float Max31855::read_temp()
-{
-    this->spi_cs_pin.set(false);
-    wait_us(1); // Must wait for first bit valid
-
-    // Read 16 bits (writing something as well is required by the api)
-    uint16_t data = spi->write(0);
-	//  Read next 16 bits (diagnostics)
-//	uint16_t data2 = spi->write(0);
-
-    this->spi_cs_pin.set(true);
+    bus->queue(&transaction);
 
-    float temperature;
+    // Return an average of the last readings
+    if(readings.size()==0) return infinityf();
 
-    //Process temp
-    if (data & 0x0001)
-    {
-        // Error flag.
-        temperature = infinityf();
-        // Todo: Interpret data2 for more diagnostics.
-    }
-    else
-    {
-        data = data >> 2;
-        temperature = (data & 0x1FFF) / 4.f;
-
-        if (data & 0x2000)
-        {
-            data = ~data;
-            temperature = ((data & 0x1FFF) + 1) / -4.f;
-        }
-    }
-    return temperature;
+    return readings_sum / (readings.size() * 4.0F);
 }
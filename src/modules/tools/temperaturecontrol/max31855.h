@@ -11,8 +11,8 @@
 #include "TempSensor.h"
 #include <string>
 #include <libs/Pin.h>
-#include <mbed.h>
 #include "RingBuffer.h"
+#include "SPIBus.h"
 
 class Max31855 : public TempSensor
 {
@@ -23,10 +23,14 @@ public:
     float get_temperature();
 
 private:
-	float read_temp();
     Pin spi_cs_pin;
-    mbed::SPI *spi;
-    RingBuffer<float,16> readings;
+    SPIBus *bus;
+    SPITransaction transaction;
+    uint16_t raw;
+    volatile bool fresh;
+    // readings in quarter degrees and their running sum
+    RingBuffer<int16_t,16> readings;
+    int32_t readings_sum;
 };
 
 #endif
@@ -0,0 +1,133 @@
+// GENERATED by generate_thermistor_tables.py from predefined_thermistors.h, DO NOT EDIT
+// ADC to temperature tables for the predefined thermistors in the same order as the predefined tables
+
+#include "ThermistorTable.h"
+
+// the ADC range the tables were generated for, they are only used if it matches Adc::get_max_value()
+#define PREDEFINED_THERMISTOR_TABLES_MAX_ADC 16380
+
+static const thermistor_table_entry_t predefined_thermistors_beta_tables[][THERMISTOR_TABLE_SIZE] {
+    { // EPCOS100K
+        {  146, 6715}, {  155, 6602}, {  164, 6498}, {  175, 6380}, {  186, 6272}, {  198, 6163}, {  212, 6046}, {  226, 5939},
+        {  242, 5827}, {  260, 5712}, {  279, 5601}, {  300, 5489}, {  323, 5378}, {  348, 5268}, {  376, 5156}, {  407, 5044},
+        {  441, 4933}, {  479, 4822}, {  522, 4708}, {  569, 4596}, {  621, 4486}, {  680, 4373}, {  745, 4262}, {  819, 4150},
+        {  902, 4038}, {  995, 3926}, { 1100, 3814}, { 1218, 3703}, { 1352, 3591}, { 1503, 3480}, { 1675, 3368}, { 1869, 3256},
+        { 2090, 3144}, { 2340, 3032}, { 2623, 2921}, { 2944, 2809}, { 3306, 2697}, { 3713, 2585}, { 4170, 2474}, { 4679, 2362},
+        { 5243, 2250}, { 5861, 2138}, { 6534, 2027}, { 7255, 1915}, { 8018, 1803}, { 8812, 1691}, { 9624, 1580}, {10437, 1468},
+        {11233, 1356}, {11996, 1244}, {12709, 1133}, {13360, 1021}, {13939,  909}, {14442,  798}, {14870,  686}, {15224,  574},
+        {15511,  462}, {15739,  350}, {15916,  239}, {16050,  127}, {16151,   15}, {16224,  -97}, {16276, -209}, {16312, -320},
+    },
+    { // RRRF100K
+        {  178, 6720}, {  189, 6603}, {  200, 6496}, {  212, 6387}, {  226, 6270}, {  240, 6162}, {  256, 6048}, {  273, 5937},
+        {  292, 5824}, {  312, 5714}, {  334, 5604}, {  359, 5490}, {  385, 5381}, {  415, 5267}, {  447, 5156}, {  483, 5044},
+        {  522, 4933}, {  566, 4820}, {  614, 4709}, {  668, 4596}, {  727, 4485}, {  793, 4374}, {  867, 4262}, {  950, 4150},
+        { 1042, 4038}, { 1146, 3926}, { 1262, 3814}, { 1392, 3703}, { 1539, 3591}, { 1705, 3479}, { 1891, 3368}, { 2101, 3256},
+        { 2338, 3144}, { 2605, 3032}, { 2906, 2920}, { 3243, 2809}, { 3621, 2697}, { 4044, 2585}, { 4514, 2474}, { 5033, 2362},
+        { 5603, 2250}, { 6223, 2138}, { 6892, 2027}, { 7603, 1915}, { 8349, 1803}, { 9120, 1691}, { 9902, 1580}, {10681, 1468},
+        {11440, 1356}, {12166, 1244}, {12842, 1133}, {13459, 1021}, {14009,  909}, {14489,  797}, {14897,  686}, {15237,  574},
+        {15515,  462}, {15737,  350}, {15910,  239}, {16043,  127}, {16143,   16}, {16217,  -96}, {16270, -208}, {16308, -321},
+    },
+    { // RRRF10K
+        {   52, 6716}, {   55, 6607}, {   58, 6506}, {   62, 6382}, {   66, 6267}, {   70, 6162}, {   75, 6041}, {   80, 5930},
+        {   85, 5828}, {   91, 5715}, {   98, 5595}, {  105, 5486}, {  113, 5373}, {  121, 5269}, {  131, 5151}, {  141, 5044},
+        {  153, 4928}, {  165, 4823}, {  179, 4711}, {  195, 4597}, {  212, 4488}, {  232, 4373}, {  253, 4264}, {  278, 4148},
+        {  305, 4037}, {  335, 3927}, {  369, 3815}, {  407, 3704}, {  451, 3590}, {  499, 3480}, {  554, 3368}, {  616, 3255},
+        {  685, 3145}, {  764, 3032}, {  853, 2920}, {  952, 2809}, { 1064, 2697}, { 1189, 2585}, { 1327, 2474}, { 1481, 2362},
+        { 1650, 2250}, { 1835, 2138}, { 2033, 2027}, { 2245, 1915}, { 2468, 1803}, { 2698, 1691}, { 2932, 1580}, { 3166, 1468},
+        { 3394, 1356}, { 3612, 1245}, { 3816, 1133}, { 4002, 1021}, { 4168,  909}, { 4313,  797}, { 4436,  686}, { 4539,  574},
+        { 4623,  463}, { 4691,  350}, { 4743,  239}, { 4783,  128}, { 4814,   14}, { 4836,  -96}, { 4852, -208}, { 4863, -315},
+    },
+    { // Honeywell100K
+        {  173, 6724}, {  184, 6604}, {  195, 6494}, {  207, 6383}, {  220, 6272}, {  234, 6162}, {  249, 6053}, {  266, 5939},
+        {  285, 5823}, {  305, 5712}, {  326, 5604}, {  350, 5492}, {  377, 5377}, {  405, 5269}, {  437, 5156}, {  472, 5044},
+        {  511, 4932}, {  554, 4819}, {  601, 4709}, {  654, 4596}, {  712, 4485}, {  777, 4374}, {  850, 4262}, {  931, 4150},
+        { 1022, 4039}, { 1125, 3926}, { 1239, 3815}, { 1368, 3703}, { 1513, 3591}, { 1677, 3479}, { 1861, 3368}, { 2069, 3256},
+        { 2304, 3144}, { 2569, 3032}, { 2867, 2921}, { 3202, 2809}, { 3578, 2697}, { 3999, 2585}, { 4467, 2474}, { 4985, 2362},
+        { 5555, 2250}, { 6175, 2138}, { 6844, 2027}, { 7557, 1915}, { 8305, 1803}, { 9079, 1691}, { 9865, 1580}, {10649, 1468},
+        {11413, 1356}, {12143, 1245}, {12825, 1133}, {13446, 1021}, {14000,  909}, {14483,  797}, {14893,  686}, {15235,  574},
+        {15514,  462}, {15737,  350}, {15911,  239}, {16044,  127}, {16144,   16}, {16218,  -97}, {16271, -208}, {16308, -319},
+    },
+    { // Semitec
+        {   99, 6728}, {  106, 6606}, {  113, 6493}, {  120, 6390}, {  129, 6267}, {  138, 6156}, {  147, 6053}, {  158, 5939},
+        {  170, 5825}, {  183, 5713}, {  197, 5603}, {  213, 5489}, {  230, 5379}, {  249, 5269}, {  270, 5158}, {  294, 5044},
+        {  320, 4933}, {  350, 4819}, {  382, 4709}, {  419, 4596}, {  460, 4485}, {  506, 4373}, {  558, 4262}, {  617, 4149},
+        {  683, 4038}, {  758, 3927}, {  844, 3814}, {  941, 3703}, { 1052, 3591}, { 1179, 3479}, { 1324, 3368}, { 1490, 3256},
+        { 1681, 3144}, { 1899, 3032}, { 2150, 2920}, { 2437, 2809}, { 2765, 2697}, { 3140, 2586}, { 3567, 2474}, { 4051, 2362},
+        { 4595, 2250}, { 5202, 2138}, { 5873, 2027}, { 6606, 1915}, { 7393, 1803}, { 8225, 1691}, { 9088, 1580}, { 9962, 1468},
+        {10828, 1356}, {11663, 1244}, {12447, 1133}, {13164, 1021}, {13801,  909}, {14352,  797}, {14817,  686}, {15198,  574},
+        {15504,  462}, {15743,  351}, {15926,  239}, {16063,  127}, {16164,   15}, {16235,  -96}, {16285, -207}, {16320, -321},
+    },
+    { // HT100K
+        {  168, 6722}, {  178, 6610}, {  189, 6497}, {  201, 6383}, {  214, 6269}, {  227, 6164}, {  242, 6053}, {  259, 5937},
+        {  277, 5824}, {  296, 5715}, {  318, 5600}, {  341, 5491}, {  367, 5377}, {  395, 5267}, {  426, 5155}, {  460, 5044},
+        {  498, 4932}, {  540, 4820}, {  586, 4710}, {  638, 4597}, {  695, 4486}, {  759, 4374}, {  831, 4262}, {  911, 4150},
+        { 1000, 4039}, { 1101, 3926}, { 1214, 3814}, { 1341, 3703}, { 1484, 3591}, { 1645, 3480}, { 1828, 3367}, { 2033, 3256},
+        { 2266, 3144}, { 2528, 3032}, { 2823, 2921}, { 3156, 2809}, { 3530, 2697}, { 3948, 2585}, { 4415, 2474}, { 4931, 2362},
+        { 5500, 2250}, { 6120, 2138}, { 6790, 2027}, { 7504, 1915}, { 8255, 1803}, { 9033, 1691}, { 9824, 1580}, {10612, 1468},
+        {11382, 1356}, {12118, 1244}, {12805, 1133}, {13431, 1021}, {13990,  909}, {14476,  797}, {14889,  686}, {15233,  574},
+        {15514,  462}, {15737,  351}, {15912,  239}, {16045,  127}, {16145,   16}, {16219,  -97}, {16272, -209}, {16309, -320},
+    },
+};
+
+static const thermistor_table_entry_t predefined_thermistors_tables[][THERMISTOR_TABLE_SIZE] {
+    { // EPCOS100K
+        {   95, 6726}, {  102, 6606}, {  109, 6497}, {  117, 6382}, {  125, 6278}, {  135, 6158}, {  145, 6049}, {  156, 5940},
+        {  169, 5823}, {  182, 5717}, {  197, 5606}, {  214, 5492}, {  233, 5377}, {  253, 5268}, {  276, 5156}, {  302, 5042},
+        {  330, 4932}, {  362, 4820}, {  398, 4707}, {  438, 4596}, {  483, 4485}, {  534, 4373}, {  591, 4262}, {  656, 4150},
+        {  730, 4038}, {  814, 3926}, {  910, 3814}, { 1018, 3703}, { 1143, 3591}, { 1285, 3479}, { 1447, 3368}, { 1633, 3256},
+        { 1847, 3144}, { 2090, 3033}, { 2370, 2920}, { 2688, 2809}, { 3051, 2697}, { 3463, 2585}, { 3928, 2474}, { 4450, 2362},
+        { 5032, 2250}, { 5673, 2138}, { 6372, 2027}, { 7124, 1915}, { 7920, 1803}, { 8746, 1691}, { 9589, 1580}, {10429, 1468},
+        {11246, 1356}, {12024, 1244}, {12745, 1133}, {13398, 1021}, {13974,  909}, {14471,  797}, {14890,  686}, {15236,  574},
+        {15515,  462}, {15736,  351}, {15908,  239}, {16040,  127}, {16139,   15}, {16212,  -97}, {16264, -207}, {16302, -320},
+    },
+    { // Vishay100K
+        {   98, 6715}, {  104, 6614}, {  112, 6489}, {  119, 6390}, {  128, 6272}, {  137, 6165}, {  148, 6045}, {  159, 5936},
+        {  171, 5828}, {  185, 5713}, {  200, 5602}, {  217, 5488}, {  235, 5379}, {  255, 5270}, {  278, 5156}, {  303, 5046},
+        {  332, 4931}, {  363, 4821}, {  398, 4710}, {  438, 4597}, {  483, 4484}, {  533, 4373}, {  589, 4262}, {  653, 4151},
+        {  726, 4038}, {  808, 3927}, {  902, 3815}, { 1009, 3703}, { 1131, 3591}, { 1270, 3479}, { 1429, 3368}, { 1611, 3256},
+        { 1820, 3144}, { 2059, 3032}, { 2332, 2921}, { 2645, 2809}, { 3001, 2697}, { 3405, 2585}, { 3862, 2474}, { 4376, 2362},
+        { 4950, 2250}, { 5584, 2138}, { 6278, 2027}, { 7025, 1915}, { 7819, 1803}, { 8646, 1691}, { 9492, 1580}, {10339, 1468},
+        {11166, 1356}, {11954, 1244}, {12687, 1133}, {13352, 1021}, {13940,  909}, {14448,  797}, {14876,  686}, {15228,  574},
+        {15513,  462}, {15738,  350}, {15912,  239}, {16045,  127}, {16144,   15}, {16217,  -97}, {16269, -209}, {16306, -321},
+    },
+    { // Honeywell100K
+        {  133, 6714}, {  141, 6609}, {  150, 6500}, {  160, 6388}, {  171, 6276}, {  183, 6163}, {  196, 6052}, {  211, 5934},
+        {  226, 5827}, {  243, 5716}, {  262, 5603}, {  283, 5490}, {  306, 5378}, {  331, 5267}, {  359, 5155}, {  390, 5043},
+        {  424, 4933}, {  462, 4821}, {  505, 4709}, {  553, 4596}, {  606, 4485}, {  665, 4374}, {  732, 4262}, {  808, 4149},
+        {  892, 4039}, {  988, 3926}, { 1096, 3815}, { 1218, 3703}, { 1357, 3591}, { 1514, 3479}, { 1692, 3368}, { 1895, 3256},
+        { 2125, 3144}, { 2385, 3032}, { 2681, 2921}, { 3015, 2809}, { 3392, 2697}, { 3816, 2585}, { 4290, 2474}, { 4818, 2362},
+        { 5399, 2250}, { 6035, 2138}, { 6722, 2027}, { 7455, 1915}, { 8225, 1803}, { 9021, 1691}, { 9828, 1580}, {10630, 1468},
+        {11410, 1356}, {12151, 1244}, {12839, 1133}, {13464, 1021}, {14018,  909}, {14498,  797}, {14904,  686}, {15242,  574},
+        {15516,  462}, {15735,  351}, {15906,  239}, {16038,  127}, {16137,   15}, {16210,  -96}, {16264, -209}, {16302, -321},
+    },
+    { // Semitec
+        {   68, 6725}, {   73, 6610}, {   78, 6504}, {   84, 6387}, {   90, 6281}, {   97, 6168}, {  105, 6051}, {  114, 5932},
+        {  123, 5825}, {  133, 5716}, {  145, 5599}, {  157, 5493}, {  171, 5382}, {  187, 5268}, {  205, 5153}, {  224, 5045},
+        {  246, 4933}, {  271, 4820}, {  299, 4707}, {  330, 4597}, {  366, 4484}, {  406, 4373}, {  451, 4262}, {  503, 4150},
+        {  563, 4037}, {  630, 3927}, {  708, 3815}, {  797, 3703}, {  900, 3591}, { 1018, 3479}, { 1154, 3368}, { 1312, 3256},
+        { 1494, 3144}, { 1705, 3032}, { 1949, 2921}, { 2231, 2809}, { 2556, 2697}, { 2931, 2585}, { 3360, 2474}, { 3850, 2362},
+        { 4405, 2250}, { 5027, 2138}, { 5718, 2027}, { 6474, 1915}, { 7288, 1803}, { 8149, 1691}, { 9040, 1580}, { 9940, 1468},
+        {10827, 1356}, {11678, 1244}, {12472, 1133}, {13193, 1021}, {13829,  909}, {14375,  798}, {14833,  686}, {15208,  574},
+        {15507,  462}, {15741,  350}, {15920,  239}, {16055,  127}, {16154,   15}, {16225,  -96}, {16276, -207}, {16312, -321},
+    },
+    { // Honeywell-QAD
+        {   65, 6732}, {   70, 6613}, {   75, 6504}, {   81, 6384}, {   87, 6276}, {   94, 6160}, {  101, 6056}, {  110, 5934},
+        {  119, 5823}, {  129, 5713}, {  140, 5603}, {  152, 5495}, {  166, 5381}, {  182, 5265}, {  199, 5155}, {  218, 5045},
+        {  240, 4931}, {  264, 4821}, {  291, 4710}, {  322, 4598}, {  357, 4486}, {  397, 4374}, {  442, 4262}, {  494, 4149},
+        {  552, 4039}, {  620, 3926}, {  697, 3814}, {  785, 3703}, {  887, 3591}, { 1005, 3479}, { 1141, 3367}, { 1298, 3256},
+        { 1480, 3144}, { 1690, 3033}, { 1934, 2921}, { 2217, 2809}, { 2543, 2697}, { 2918, 2585}, { 3349, 2474}, { 3840, 2362},
+        { 4397, 2250}, { 5022, 2138}, { 5715, 2027}, { 6474, 1915}, { 7292, 1803}, { 8155, 1691}, { 9048, 1580}, { 9950, 1468},
+        {10838, 1356}, {11690, 1244}, {12483, 1133}, {13202, 1021}, {13836,  909}, {14381,  797}, {14837,  686}, {15210,  574},
+        {15508,  462}, {15741,  350}, {15919,  239}, {16053,  127}, {16152,   16}, {16224,  -96}, {16275, -208}, {16311, -321},
+    },
+    { // Semitec-104NT4
+        {   71, 6716}, {   76, 6604}, {   81, 6502}, {   87, 6389}, {   94, 6269}, {  101, 6159}, {  109, 6046}, {  117, 5943},
+        {  127, 5825}, {  137, 5719}, {  149, 5604}, {  162, 5492}, {  177, 5376}, {  193, 5264}, {  210, 5158}, {  230, 5046},
+        {  253, 4931}, {  278, 4820}, {  306, 4709}, {  338, 4597}, {  374, 4485}, {  415, 4373}, {  461, 4262}, {  514, 4149},
+        {  574, 4037}, {  642, 3927}, {  721, 3814}, {  811, 3702}, {  914, 3591}, { 1033, 3479}, { 1170, 3368}, { 1329, 3256},
+        { 1512, 3144}, { 1724, 3032}, { 1968, 2921}, { 2251, 2809}, { 2577, 2697}, { 2952, 2585}, { 3381, 2474}, { 3870, 2362},
+        { 4424, 2250}, { 5045, 2138}, { 5734, 2027}, { 6488, 1915}, { 7300, 1803}, { 8158, 1691}, { 9046, 1580}, { 9944, 1468},
+        {10829, 1356}, {11678, 1244}, {12471, 1133}, {13191, 1021}, {13827,  909}, {14374,  797}, {14832,  686}, {15207,  574},
+        {15507,  462}, {15741,  351}, {15921,  238}, {16055,  127}, {16155,   15}, {16226,  -96}, {16277, -208}, {16313, -322},
+    },
+};
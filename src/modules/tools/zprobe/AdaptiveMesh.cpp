@@ -0,0 +1,170 @@
+#include "AdaptiveMesh.h"
+
+#include <math.h>
+
+AdaptiveMesh::AdaptiveMesh(float *grid, int nx, int ny, int stride, float tolerance)
+    : grid(grid), nx(nx), ny(ny), tolerance(tolerance)
+{
+    if(stride < 1) stride= 1;
+
+    for (int i = 0; i < nx * ny; ++i) grid[i]= NAN;
+
+    for (int x = 0; x < nx; x += stride) xs.push_back(x);
+    if(xs.back() != nx - 1) xs.push_back(nx - 1);
+    for (int y = 0; y < ny; y += stride) ys.push_back(y);
+    if(ys.back() != ny - 1) ys.push_back(ny - 1);
+
+    int cells= (xs.size() > 1 && ys.size() > 1) ? (xs.size() - 1) * (ys.size() - 1) : 0;
+    failed.assign(cells, false);
+    checks.assign(cells, -1);
+
+    stage= COARSE;
+    probes= 0;
+    dense_cells= 0;
+}
+
+// the interval of the grid lines c that v is in
+int AdaptiveMesh::find_cell(const std::vector<int> &c, float v)
+{
+    int k= 0;
+    while(k + 2 < (int)c.size() && v > c[k + 1]) ++k;
+    return k;
+}
+
+// Lagrange weights at v of the up to three grid lines from first, which are the ones nearest to v
+int AdaptiveMesh::weights(const std::vector<int> &c, float v, float *w)
+{
+    int n= c.size();
+    if(n == 1) {
+        w[0]= 1;
+        return 0;
+    }
+
+    int k= find_cell(c, v);
+    if(n == 2) {
+        w[0]= (c[1] - v) / (c[1] - c[0]);
+        w[1]= 1 - w[0];
+        return 0;
+    }
+
+    int first= (v - c[k] <= c[k + 1] - v) ? k - 1 : k;
+    if(first < 0) first= 0;
+    if(first > n - 3) first= n - 3;
+
+    float a= c[first], b= c[first + 1], d= c[first + 2];
+    w[0]= (v - b) * (v - d) / ((a - b) * (a - d));
+    w[1]= (v - a) * (v - d) / ((b - a) * (b - d));
+    w[2]= (v - a) * (v - b) / ((d - a) * (d - b));
+    return first;
+}
+
+// biquadratic fit of the coarse nodes around x, y
+float AdaptiveMesh::predict(int x, int y) const
+{
+    float wx[3], wy[3];
+    int fx= weights(xs, x, wx);
+    int fy= weights(ys, y, wy);
+    int mx= xs.size() < 3 ? xs.size() : 3;
+    int my= ys.size() < 3 ? ys.size() : 3;
+
+    float z= 0;
+    for (int j = 0; j < my; ++j) {
+        for (int i = 0; i < mx; ++i) {
+            z += wx[i] * wy[j] * grid[xs[fx + i] + nx * ys[fy + j]];
+        }
+    }
+    return z;
+}
+
+// the node in the middle of a coarse cell, -1 if it has none that is not already known
+int AdaptiveMesh::check_node(int cx, int cy) const
+{
+    int x= (xs[cx] + xs[cx + 1]) / 2;
+    int y= (ys[cy] + ys[cy + 1]) / 2;
+    int node= x + nx * y;
+    return isnan(grid[node]) ? node : -1;
+}
+
+// rows going back and forth so each one starts where the last one finished
+void AdaptiveMesh::add_serpentine(std::vector<int> &nodes, const std::vector<bool> &wanted) const
+{
+    bool reverse= false;
+    for (int y = 0; y < ny; ++y) {
+        size_t before= nodes.size();
+        for (int i = 0; i < nx; ++i) {
+            int x= reverse ? nx - 1 - i : i;
+            if(wanted[x + nx * y]) nodes.push_back(x + nx * y);
+        }
+        if(nodes.size() != before) reverse= !reverse;
+    }
+}
+
+std::vector<int> AdaptiveMesh::next()
+{
+    std::vector<int> nodes;
+    std::vector<bool> wanted(nx * ny, false);
+    int cols= xs.size() - 1;
+
+    while(nodes.empty() && stage != DONE) {
+        switch(stage) {
+            case COARSE:
+                for (int y : ys) {
+                    for (int x : xs) wanted[x + nx * y]= true;
+                }
+                stage= CHECK;
+                break;
+
+            case CHECK:
+                for (size_t c = 0; c < checks.size(); ++c) {
+                    checks[c]= check_node(c % cols, c / cols);
+                    if(checks[c] >= 0) wanted[checks[c]]= true;
+                }
+                stage= DENSE;
+                break;
+
+            case DENSE:
+                for (size_t c = 0; c < failed.size(); ++c) {
+                    if(!failed[c]) continue;
+                    int cx= c % cols, cy= c / cols;
+                    for (int y = ys[cy]; y <= ys[cy + 1]; ++y) {
+                        for (int x = xs[cx]; x <= xs[cx + 1]; ++x) {
+                            if(isnan(grid[x + nx * y])) wanted[x + nx * y]= true;
+                        }
+                    }
+                }
+                stage= DONE;
+                break;
+
+            case DONE:
+                break;
+        }
+
+        add_serpentine(nodes, wanted);
+    }
+
+    return nodes;
+}
+
+void AdaptiveMesh::set(int node, float z)
+{
+    // the check nodes are compared with the fit before they are set, the coarse nodes are all known by then
+    if(stage == DENSE) {
+        for (size_t c = 0; c < checks.size(); ++c) {
+            if(checks[c] != node) continue;
+            if(fabsf(z - predict(node % nx, node / nx)) > tolerance && !failed[c]) {
+                failed[c]= true;
+                ++dense_cells;
+            }
+        }
+    }
+
+    grid[node]= z;
+    ++probes;
+}
+
+void AdaptiveMesh::fill()
+{
+    for (int node = 0; node < nx * ny; ++node) {
+        if(isnan(grid[node])) grid[node]= predict(node % nx, node / nx);
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef __ADAPTIVEMESH_H
+#define __ADAPTIVEMESH_H
+
+#include <vector>
+
+// Fills a grid of nx by ny bed heights probing as few of its nodes as it can. Every stride'th node is probed first,
+// then the node in the middle of each cell of that coarse grid is probed and compared with a biquadratic fit of the
+// coarse nodes around it. Only the cells where they differ by more than the tolerance have all their nodes probed,
+// the rest are filled in from the fit.
+// Nodes are numbered x + nx * y as in the grid, which holds NAN for the nodes not known yet
+class AdaptiveMesh
+{
+public:
+    AdaptiveMesh(float *grid, int nx, int ny, int stride, float tolerance);
+
+    // the nodes to probe next, in rows going back and forth. Empty once there is nothing more to probe
+    std::vector<int> next();
+    void set(int node, float z);
+
+    // fills in the nodes that were not probed
+    void fill();
+
+    int get_probes() const { return probes; }
+    int get_dense_cells() const { return dense_cells; }
+
+private:
+    enum STAGE { COARSE, CHECK, DENSE, DONE };
+
+    float predict(int x, int y) const;
+    static int find_cell(const std::vector<int> &c, float v);
+    static int weights(const std::vector<int> &c, float v, float *w);
+    int check_node(int cx, int cy) const;
+    void add_serpentine(std::vector<int> &nodes, const std::vector<bool> &wanted) const;
+
+    float *grid;
+    int nx, ny;
+    float tolerance;
+    STAGE stage;
+    int probes;
+    int dense_cells;
+
+    // the grid lines of the coarse grid
+    std::vector<int> xs, ys;
+    // the check node of each cell of the coarse grid and whether it was off
+    std::vector<int> checks;
+    std::vector<bool> failed;
+};
+
+#endif
@@ -43,6 +43,12 @@
 
       Then when M500 is issued it will save M375 which will cause the grid to be loaded on boot. The default is to not autoload the grid on boot
 
+    Optionally G31 can probe a coarse grid of every adaptive_stride'th point first, then probe the point in the middle of
+    each of its cells and only probe the rest of the points of the cells where that is further than adaptive_tolerance
+    from a fit of the coarse grid. The other points are filled in from the fit. 0 probes every point
+      leveling-strategy.rectangular-grid.adaptive_stride     2
+      leveling-strategy.rectangular-grid.adaptive_tolerance  0.02
+
     Optionally an initial_height can be set that tell the intial probe where to stop the fast decent before it probes, this should be around 5-10mm above the bed
       leveling-strategy.rectangular-grid.initial_height  10
 
@@ -86,6 +92,7 @@
 #include "PublicData.h"
 #include "Conveyor.h"
 #include "ZProbe.h"
+#include "AdaptiveMesh.h"
 #include "nuts_bolts.h"
 #include "utils.h"
 #include "platform_memory.h"
@@ -100,6 +107,8 @@
 #define grid_x_size_checksum         CHECKSUM("grid_x_size")
 #define grid_y_size_checksum         CHECKSUM("grid_y_size")
 #define tolerance_checksum           CHECKSUM("tolerance")
+#define adaptive_stride_checksum     CHECKSUM("adaptive_stride")
+#define adaptive_tolerance_checksum  CHECKSUM("adaptive_tolerance")
 #define save_checksum                CHECKSUM("save")
 #define probe_offsets_checksum       CHECKSUM("probe_offsets")
 #define initial_height_checksum      CHECKSUM("initial_height")
@@ -129,6 +138,8 @@ bool CartGridStrategy::handleConfig()
     this->current_grid_x_size = this->configured_grid_x_size = THEKERNEL->config->value(leveling_strategy_checksum, cart_grid_leveling_strategy_checksum, grid_x_size_checksum)->by_default(grid_size)->as_number();
     this->current_grid_y_size = this->configured_grid_y_size = THEKERNEL->config->value(leveling_strategy_checksum, cart_grid_leveling_strategy_checksum, grid_y_size_checksum)->by_default(grid_size)->as_number();
     tolerance = THEKERNEL->config->value(leveling_strategy_checksum, cart_grid_leveling_strategy_checksum, tolerance_checksum)->by_default(0.03F)->as_number();
+    adaptive_stride = THEKERNEL->config->value(leveling_strategy_checksum, cart_grid_leveling_strategy_checksum, adaptive_stride_checksum)->by_default(0)->as_number();
+    adaptive_tolerance = THEKERNEL->config->value(leveling_strategy_checksum, cart_grid_leveling_strategy_checksum, adaptive_tolerance_checksum)->by_default(0.02F)->as_number();
     save = THEKERNEL->config->value(leveling_strategy_checksum, cart_grid_leveling_strategy_checksum, save_checksum)->by_default(false)->as_bool();
     do_home = THEKERNEL->config->value(leveling_strategy_checksum, cart_grid_leveling_strategy_checksum, do_home_checksum)->by_default(true)->as_bool();
     only_by_two_corners = THEKERNEL->config->value(leveling_strategy_checksum, cart_grid_leveling_strategy_checksum, only_by_two_corners_checksum)->by_default(false)->as_bool();
@@ -320,19 +331,19 @@ bool CartGridStrategy::probe_grid(int n, int m, float _x_start, float _y_start,
 
     float x_step = _x_size / n;
     float y_step = _y_size / m;
+    std::vector<std::pair<float, float>> points;
     for (int c = 0; c < m; ++c) {
         float y = _y_start + y_step * c;
         for (int r = 0; r < n; ++r) {
-            float x = _x_start + x_step * r;
-            float z = 0.0F;
-            float mm;
-            if(!zprobe->doProbeAt(mm, x, y)) return false;
-            z = zprobe->getProbeHeight() - mm;
-            stream->printf("%1.4f ", z);
+            points.push_back({_x_start + x_step * r, y});
         }
-        stream->printf("\n");
     }
-    return true;
+
+    return zprobe->probe_points(points, [this, n, stream](int i, float mm, uint32_t us) {
+        float z = zprobe->getProbeHeight() - mm;
+        stream->printf("%1.4f ", z);
+        if(i % n == n - 1) stream->printf("\n");
+    });
 }
 
 bool CartGridStrategy::handleGcode(Gcode *gcode)
@@ -504,36 +515,47 @@ bool CartGridStrategy::doProbe(Gcode *gc)
 
     gc->stream->printf("Probe start ht is %f mm, rectangular bed width %fmm, height %fmm, grid size is %dx%d\n", initial_z, x_size, y_size, current_grid_x_size, current_grid_y_size);
 
-    // do first probe for 0,0
-    float mm;
-    if(!zprobe->doProbeAt(mm, this->x_start - X_PROBE_OFFSET_FROM_EXTRUDER, this->y_start - Y_PROBE_OFFSET_FROM_EXTRUDER)) return false;
-    float z_reference = zprobe->getProbeHeight() - mm; // this should be zero
-    gc->stream->printf("probe at 0,0 is %f mm\n", z_reference);
-
-    // probe all the points of the grid
-    for (int yCount = 0; yCount < this->current_grid_y_size; yCount++) {
-        float yProbe = this->y_start + (this->y_size / (this->current_grid_y_size - 1)) * yCount;
-        int xStart, xStop, xInc;
-        if (yCount % 2) {
-            xStart = this->current_grid_x_size - 1;
-            xStop = -1;
-            xInc = -1;
-        } else {
-            xStart = 0;
-            xStop = this->current_grid_x_size;
-            xInc = 1;
+    float z_reference = NAN;
+    uint32_t total_us = 0;
+    int probed;
+    if(this->adaptive_stride > 1) {
+        // a coarse grid first, then more points only where the bed does not fit it
+        AdaptiveMesh mesh(grid, current_grid_x_size, current_grid_y_size, adaptive_stride, adaptive_tolerance);
+        for (std::vector<int> cells = mesh.next(); !cells.empty(); cells = mesh.next()) {
+            if(!probe_cells(cells, z_reference, &mesh, gc->stream, total_us)) {
+                reset_bed_level();
+                return false;
+            }
         }
+        mesh.fill();
+        probed = mesh.get_probes();
+        gc->stream->printf("%d cells of the coarse grid were probed densely\n", mesh.get_dense_cells());
 
-        for (int xCount = xStart; xCount != xStop; xCount += xInc) {
-            float xProbe = this->x_start + (this->x_size / (this->current_grid_x_size - 1)) * xCount;
+    } else {
+        // probe all the points of the grid
+        std::vector<int> cells;
+        for (int yCount = 0; yCount < this->current_grid_y_size; yCount++) {
+            int xStart, xStop, xInc;
+            if (yCount % 2) {
+                xStart = this->current_grid_x_size - 1;
+                xStop = -1;
+                xInc = -1;
+            } else {
+                xStart = 0;
+                xStop = this->current_grid_x_size;
+                xInc = 1;
+            }
 
-            if(!zprobe->doProbeAt(mm, xProbe - X_PROBE_OFFSET_FROM_EXTRUDER, yProbe - Y_PROBE_OFFSET_FROM_EXTRUDER)) return false;
-            float measured_z = zprobe->getProbeHeight() - mm - z_reference; // this is the delta z from bed at 0,0
-            gc->stream->printf("DEBUG: X%1.4f, Y%1.4f, Z%1.4f\n", xProbe, yProbe, measured_z);
-            grid[xCount + (this->current_grid_x_size * yCount)] = measured_z;
+            for (int xCount = xStart; xCount != xStop; xCount += xInc) {
+                cells.push_back(xCount + (this->current_grid_x_size * yCount));
+            }
         }
+        if(!probe_cells(cells, z_reference, nullptr, gc->stream, total_us)) return false;
+        probed = cells.size();
     }
 
+    gc->stream->printf("probed %d of %d points in %1.1f s\n", probed, current_grid_x_size * current_grid_y_size, total_us / 1000000.0F);
+
     print_bed_level(gc->stream);
 
     setAdjustFunction(true);
@@ -541,6 +563,37 @@ bool CartGridStrategy::doProbe(Gcode *gc)
     return true;
 }
 
+// probes the grid cells in the order given and sets their height from the bed at 0,0 in the grid, or the mesh if there is one.
+// If z_reference is NAN 0,0 is probed first to set it
+bool CartGridStrategy::probe_cells(const std::vector<int> &cells, float &z_reference, AdaptiveMesh *mesh, StreamOutput *stream, uint32_t &total_us)
+{
+    float x_step = this->x_size / (this->current_grid_x_size - 1);
+    float y_step = this->y_size / (this->current_grid_y_size - 1);
+
+    std::vector<std::pair<float, float>> points;
+    bool reference = isnan(z_reference);
+    if(reference) points.push_back({this->x_start - X_PROBE_OFFSET_FROM_EXTRUDER, this->y_start - Y_PROBE_OFFSET_FROM_EXTRUDER});
+    for (int c : cells) {
+        float xProbe = this->x_start + x_step * (c % this->current_grid_x_size);
+        float yProbe = this->y_start + y_step * (c / this->current_grid_x_size);
+        points.push_back({xProbe - X_PROBE_OFFSET_FROM_EXTRUDER, yProbe - Y_PROBE_OFFSET_FROM_EXTRUDER});
+    }
+
+    return zprobe->probe_points(points, [&](int i, float mm, uint32_t us) {
+        total_us += us;
+        if(reference && i == 0) {
+            z_reference = zprobe->getProbeHeight() - mm; // this should be zero
+            stream->printf("probe at 0,0 is %f mm\n", z_reference);
+            return;
+        }
+        int c = cells[reference ? i - 1 : i];
+        float measured_z = zprobe->getProbeHeight() - mm - z_reference; // this is the delta z from bed at 0,0
+        stream->printf("DEBUG: X%1.4f, Y%1.4f, Z%1.4f, %lu ms\n", points[i].first + X_PROBE_OFFSET_FROM_EXTRUDER, points[i].second + Y_PROBE_OFFSET_FROM_EXTRUDER, measured_z, us / 1000);
+        if(mesh != nullptr) mesh->set(c, measured_z);
+        else grid[c] = measured_z;
+    });
+}
+
 void CartGridStrategy::doCompensation(float *target, bool inverse)
 {
     // Adjust print surface height by linear interpolation over the bed_level array.
@@ -4,11 +4,13 @@
 
 #include <string.h>
 #include <tuple>
+#include <vector>
 
 #define cart_grid_leveling_strategy_checksum CHECKSUM("rectangular-grid")
 
 class StreamOutput;
 class Gcode;
+class AdaptiveMesh;
 
 class CartGridStrategy : public LevelingStrategy
 {
@@ -29,9 +31,11 @@ private:
     void save_grid(StreamOutput *stream);
     bool load_grid(StreamOutput *stream);
     bool probe_grid(int n, int m, float _x_start, float _y_start, float _x_size, float _y_size, StreamOutput *stream);
+    bool probe_cells(const std::vector<int> &cells, float &z_reference, AdaptiveMesh *mesh, StreamOutput *stream, uint32_t &total_us);
 
     float initial_height;
     float tolerance;
+    float adaptive_tolerance;
 
     float *grid;
     std::tuple<float, float, float> probe_offsets;
@@ -43,6 +47,7 @@ private:
         uint8_t configured_grid_y_size:8;
         uint8_t current_grid_x_size:8;
         uint8_t current_grid_y_size:8;
+        uint8_t adaptive_stride:8;
     };
 
     struct {
@@ -239,22 +239,38 @@ bool DeltaGridStrategy::probe_grid(int n, float radius, StreamOutput *stream)
 
     float d = ((radius * 2) / (n - 1));
 
+    // Avoid probing the corners (outside the round or hexagon print surface) on a delta printer.
+    std::vector<std::pair<float, float>> points;
+    std::vector<int> cells;
     for (int c = 0; c < n; ++c) {
         float y = -radius + d * c;
         for (int r = 0; r < n; ++r) {
             float x = -radius + d * r;
-            // Avoid probing the corners (outside the round or hexagon print surface) on a delta printer.
-            float distance_from_center = sqrtf(x * x + y * y);
-            float z = 0.0F;
-            if (distance_from_center <= radius) {
-                float mm;
-                if(!zprobe->doProbeAt(mm, x, y)) return false;
-                z = zprobe->getProbeHeight() - mm;
+            if (sqrtf(x * x + y * y) <= radius) {
+                points.push_back({x, y});
+                cells.push_back(r + n * c);
             }
-            stream->printf("%8.4f ", z);
         }
-        stream->printf("\n");
     }
+
+    // the cells that are not probed are printed as 0 as the rows get to them
+    int next = 0;
+    auto print_to = [&](int cell) {
+        for (; next < cell; ++next) {
+            stream->printf("%8.4f ", 0.0F);
+            if (next % n == n - 1) stream->printf("\n");
+        }
+    };
+
+    bool ok = zprobe->probe_points(points, [&](int i, float mm, uint32_t us) {
+        print_to(cells[i]);
+        stream->printf("%8.4f ", zprobe->getProbeHeight() - mm);
+        if (next % n == n - 1) stream->printf("\n");
+        ++next;
+    });
+    if(!ok) return false;
+
+    print_to(n * n);
     return true;
 }
 
@@ -269,21 +285,22 @@ bool DeltaGridStrategy::probe_spiral(int n, float radius, StreamOutput *stream)
 
     auto theta = [a](float length) {return sqrtf(2 * length / a); };
 
-    float maxz = NAN, minz = NAN;
+    std::vector<std::pair<float, float>> points;
     for (int i = 0; i < n; i++) {
         float angle = theta(i * step_length);
         float r = angle * a;
         // polar to cartesian
-        float x = r * cosf(angle);
-        float y = r * sinf(angle);
+        points.push_back({r * cosf(angle), r * sinf(angle)});
+    }
 
-        float mm;
-        if (!zprobe->doProbeAt(mm, x, y)) return false;
+    float maxz = NAN, minz = NAN;
+    bool ok = zprobe->probe_points(points, [&](int i, float mm, uint32_t us) {
         float z = zprobe->getProbeHeight() - mm;
-        stream->printf("PROBE: X%1.4f, Y%1.4f, Z%1.4f\n", x, y, z);
+        stream->printf("PROBE: X%1.4f, Y%1.4f, Z%1.4f\n", points[i].first, points[i].second, z);
         if(isnan(maxz) || z > maxz) maxz = z;
         if(isnan(minz) || z < minz) minz = z;
-    }
+    });
+    if (!ok) return false;
 
     stream->printf("max: %1.4f, min: %1.4f, delta: %1.4f\n", maxz, minz, maxz - minz);
     return true;
@@ -441,13 +458,11 @@ bool DeltaGridStrategy::doProbe(Gcode *gc)
 
     gc->stream->printf("Probe start ht is %f mm, probe radius is %f mm, grid size is %dx%d\n", initial_z, radius, grid_size, grid_size);
 
-    // do first probe for 0,0
-    float mm;
-    if(!zprobe->doProbeAt(mm, -X_PROBE_OFFSET_FROM_EXTRUDER, -Y_PROBE_OFFSET_FROM_EXTRUDER)) return false;
-    float z_reference = zprobe->getProbeHeight() - mm; // this should be zero
-    gc->stream->printf("probe at 0,0 is %f mm\n", z_reference);
+    // first probe is for 0,0 then all the points in the grid within the given radius, which go in grid at cells
+    std::vector<std::pair<float, float>> points;
+    std::vector<int> cells;
+    points.push_back({-X_PROBE_OFFSET_FROM_EXTRUDER, -Y_PROBE_OFFSET_FROM_EXTRUDER});
 
-    // probe all the points in the grid within the given radius
     for (int yCount = 0; yCount < grid_size; yCount++) {
         float yProbe = FRONT_PROBE_BED_POSITION + AUTO_BED_LEVELING_GRID_Y * yCount;
         int xStart, xStop, xInc;
@@ -468,13 +483,28 @@ bool DeltaGridStrategy::doProbe(Gcode *gc)
             float distance_from_center = sqrtf(xProbe * xProbe + yProbe * yProbe);
             if (distance_from_center > radius) continue;
 
-            if(!zprobe->doProbeAt(mm, xProbe - X_PROBE_OFFSET_FROM_EXTRUDER, yProbe - Y_PROBE_OFFSET_FROM_EXTRUDER)) return false;
-            float measured_z = zprobe->getProbeHeight() - mm - z_reference; // this is the delta z from bed at 0,0
-            gc->stream->printf("DEBUG: X%1.4f, Y%1.4f, Z%1.4f\n", xProbe, yProbe, measured_z);
-            grid[xCount + (grid_size * yCount)] = measured_z;
+            points.push_back({xProbe - X_PROBE_OFFSET_FROM_EXTRUDER, yProbe - Y_PROBE_OFFSET_FROM_EXTRUDER});
+            cells.push_back(xCount + (grid_size * yCount));
         }
     }
 
+    float z_reference = 0;
+    uint32_t total_us = 0;
+    bool ok = zprobe->probe_points(points, [&](int i, float mm, uint32_t us) {
+        total_us += us;
+        if(i == 0) {
+            z_reference = zprobe->getProbeHeight() - mm; // this should be zero
+            gc->stream->printf("probe at 0,0 is %f mm\n", z_reference);
+            return;
+        }
+        float measured_z = zprobe->getProbeHeight() - mm - z_reference; // this is the delta z from bed at 0,0
+        gc->stream->printf("DEBUG: X%1.4f, Y%1.4f, Z%1.4f, %lu ms\n", points[i].first + X_PROBE_OFFSET_FROM_EXTRUDER, points[i].second + Y_PROBE_OFFSET_FROM_EXTRUDER, measured_z, us / 1000);
+        grid[cells[i - 1]] = measured_z;
+    });
+    if(!ok) return false;
+
+    gc->stream->printf("probed %d points in %1.1f s\n", (int)points.size(), total_us / 1000000.0F);
+
     extrapolate_unprobed_bed_level();
     print_bed_level(gc->stream);
 
@@ -26,6 +26,9 @@
 #include "LevelingStrategy.h"
 #include "StepTicker.h"
 #include "utils.h"
+#include "EdgeTrigger.h"
+
+#include "mbed.h" // for us_ticker_read()
 
 // strategies we know about
 #include "DeltaCalibrationStrategy.h"
@@ -36,10 +39,13 @@
 #define enable_checksum          CHECKSUM("enable")
 #define probe_pin_checksum       CHECKSUM("probe_pin")
 #define debounce_ms_checksum     CHECKSUM("debounce_ms")
+#define interrupt_checksum       CHECKSUM("interrupt")
+#define glitch_filter_checksum   CHECKSUM("glitch_filter_us")
 #define slow_feedrate_checksum   CHECKSUM("slow_feedrate")
 #define fast_feedrate_checksum   CHECKSUM("fast_feedrate")
 #define return_feedrate_checksum CHECKSUM("return_feedrate")
 #define probe_height_checksum    CHECKSUM("probe_height")
+#define slow_zone_checksum       CHECKSUM("slow_zone")
 #define gamma_max_checksum       CHECKSUM("gamma_max")
 #define reverse_z_direction_checksum CHECKSUM("reverse_z")
 
@@ -69,8 +75,15 @@ void ZProbe::on_module_loaded()
     // register event-handlers
     register_for_event(ON_GCODE_RECEIVED);
 
-    // we read the probe in this timer
+    // a probe on port 0 or 2 stops the motors from its pin interrupt, an edge has to last glitch_filter_us
+    if(THEKERNEL->config->value(zprobe_checksum, interrupt_checksum)->by_default(true)->as_bool()) {
+        uint32_t filter_us= std::min(100, std::max(0, THEKERNEL->config->value(zprobe_checksum, glitch_filter_checksum)->by_default(10)->as_int()));
+        trigger= EdgeTrigger::create(&this->pin, filter_us, STEPPER[Z_AXIS], [this]() { on_probe_edge(); });
+    }
+
+    // we read the probe in this timer, also with the interrupt in case it was already triggered when the move started
     probing= false;
+    probe_detected= false;
     THEKERNEL->slow_ticker->attach(1000, this, &ZProbe::read_probe);
 }
 
@@ -139,6 +152,7 @@ void ZProbe::config_load()
     this->return_feedrate = THEKERNEL->config->value(zprobe_checksum, return_feedrate_checksum)->by_default(0)->as_number(); // feedrate in mm/sec
     this->reverse_z     = THEKERNEL->config->value(zprobe_checksum, reverse_z_direction_checksum)->by_default(false)->as_bool(); // Z probe moves in reverse direction
     this->max_z         = THEKERNEL->config->value(gamma_max_checksum)->by_default(500)->as_number(); // maximum zprobe distance
+    this->slow_zone     = THEKERNEL->config->value(zprobe_checksum, slow_zone_checksum)->by_default(0)->as_number(); // only probe this far at slow feedrate in probe_points
 }
 
 uint32_t ZProbe::read_probe(uint32_t dummy)
@@ -152,10 +166,7 @@ uint32_t ZProbe::read_probe(uint32_t dummy)
             if(debounce < debounce_ms) {
                 debounce++;
             } else {
-                // we signal the motors to stop, which will preempt any moves on that axis
-                // we do all motors as it may be a delta
-                for(auto &a : THEROBOT->actuators) a->stop_moving();
-                probe_detected= true;
+                stop_on_probe(STEPPER[Z_AXIS]->get_current_step());
                 debounce= 0;
             }
 
@@ -168,6 +179,26 @@ uint32_t ZProbe::read_probe(uint32_t dummy)
     return 0;
 }
 
+// Called from the edge trigger interrupt once the edge has passed the glitch filter
+void ZProbe::on_probe_edge()
+{
+    if(!probing || probe_detected) return;
+
+    // if it is not moving yet it will be caught by read_probe once it is
+    if(STEPPER[X_AXIS]->is_moving() || STEPPER[Y_AXIS]->is_moving() || STEPPER[Z_AXIS]->is_moving()) {
+        stop_on_probe(trigger->get_edge_position());
+    }
+}
+
+void ZProbe::stop_on_probe(int32_t position)
+{
+    // we signal the motors to stop, which will preempt any moves on that axis
+    // we do all motors as it may be a delta
+    for(auto &a : THEROBOT->actuators) a->stop_moving();
+    trigger_position= position;
+    probe_detected= true;
+}
+
 // single probe in Z with custom feedrate
 // returns boolean value indicating if probe was triggered
 bool ZProbe::run_probe(float& mm, float feedrate, float max_dist, bool reverse)
@@ -182,6 +213,7 @@ bool ZProbe::run_probe(float& mm, float feedrate, float max_dist, bool reverse)
     probing= true;
     probe_detected= false;
     debounce= 0;
+    if(trigger != nullptr) trigger->arm();
 
     // save current actuator position so we can report how far we moved
     float z_start_pos= THEROBOT->actuators[Z_AXIS]->get_current_position();
@@ -195,9 +227,15 @@ bool ZProbe::run_probe(float& mm, float feedrate, float max_dist, bool reverse)
     // wait until finished
     THECONVEYOR->wait_for_idle();
 
-    // now see how far we moved, get delta in z we moved
+    if(trigger != nullptr) trigger->disarm();
+
+    // now see how far we moved, get delta in z we moved, up to where the probe triggered rather than where it stopped
     // NOTE this works for deltas as well as all three actuators move the same amount in Z
-    mm= z_start_pos - THEROBOT->actuators[2]->get_current_position();
+    if(probe_detected) {
+        mm= z_start_pos - trigger_position / Z_STEPS_PER_MM;
+    } else {
+        mm= z_start_pos - THEROBOT->actuators[2]->get_current_position();
+    }
 
     // set the last probe position to the actuator units moved during this home
     THEROBOT->set_last_probe_position(std::make_tuple(0, 0, mm, probe_detected?1:0));
@@ -219,21 +257,85 @@ bool ZProbe::run_probe_return(float& mm, float feedrate, float max_dist, bool re
 
     bool ok= run_probe(mm, feedrate, max_dist, reverse);
 
-    // move probe back to where it was
-    float fr;
-    if(this->return_feedrate != 0) { // use return_feedrate if set
-        fr = this->return_feedrate;
-    } else {
-        fr = this->slow_feedrate*2; // nominally twice slow feedrate
-        if(fr > this->fast_feedrate) fr = this->fast_feedrate; // unless that is greater than fast feedrate
-    }
-
     // absolute move back to saved starting position
-    coordinated_move(NAN, NAN, save_z_pos, fr, false);
+    coordinated_move(NAN, NAN, save_z_pos, get_return_feedrate(), false);
 
     return ok;
 }
 
+float ZProbe::get_return_feedrate() const
+{
+    if(this->return_feedrate != 0) return this->return_feedrate; // use return_feedrate if set
+
+    float fr = this->slow_feedrate*2; // nominally twice slow feedrate
+    if(fr > this->fast_feedrate) fr = this->fast_feedrate; // unless that is greater than fast feedrate
+    return fr;
+}
+
+// probes down from the travel height, fast until slow_zone above where the bed should be then slow. bed_mm is how far
+// below the bed was found from the same height, NAN if that is not known yet which probes all the way slowly. If the
+// probe triggers while going fast it backs off and probes that part again slowly
+bool ZProbe::probe_down(float &mm, float bed_mm)
+{
+    float fast_mm= (slow_zone > 0 && !isnan(bed_mm)) ? bed_mm - slow_zone : 0;
+    if(fast_mm <= 0) return run_probe(mm, slow_feedrate);
+
+    float first= 0;
+    if(run_probe(first, fast_feedrate, fast_mm)) {
+        // the bed is higher here, do not trust a hit at speed
+        coordinated_move(NAN, NAN, slow_zone, get_return_feedrate(), true);
+        first -= slow_zone;
+    }
+    if(THEKERNEL->is_halted()) return false;
+
+    float second;
+    if(!run_probe(second, slow_feedrate)) return false;
+    mm= first + second;
+    return true;
+}
+
+bool ZProbe::probe_points(const std::vector<std::pair<float, float>> &points, probe_done_t done)
+{
+    if(points.empty()) return true;
+
+    float travel_z= THEROBOT->get_axis_position(Z_AXIS);
+    uint32_t start= us_ticker_read();
+
+    coordinated_move(points[0].first, points[0].second, NAN, getFastFeedrate());
+
+    // each point starts from travel_z, so the one before it says roughly where the bed is
+    float bed_mm= NAN;
+    for (size_t i = 0; i < points.size(); ++i) {
+        float mm;
+        if(!probe_down(mm, bed_mm)) {
+            coordinated_move(NAN, NAN, travel_z, get_return_feedrate(), false);
+            return false;
+        }
+
+        // straight up half way so the probe is clear of the bed, then up the rest of the way while going to the
+        // next point. Both are queued so the planner runs them together with no stop
+        float z= THEROBOT->get_axis_position(Z_AXIS);
+        if(i + 1 < points.size()) {
+            queue_move(NAN, NAN, (z + travel_z) / 2, get_return_feedrate(), false);
+            queue_move(points[i + 1].first, points[i + 1].second, travel_z, getFastFeedrate(), false);
+        } else {
+            queue_move(NAN, NAN, travel_z, get_return_feedrate(), false);
+        }
+
+        bed_mm= mm;
+
+        uint32_t now= us_ticker_read();
+        done(i, mm, now - start);
+        start= now;
+
+        // the results can be printed while it is moving
+        THEKERNEL->conveyor->wait_for_idle();
+        if(THEKERNEL->is_halted()) return false;
+    }
+
+    return true;
+}
+
 bool ZProbe::doProbeAt(float &mm, float x, float y)
 {
     // move to xy
@@ -398,6 +500,7 @@ void ZProbe::probe_XYZ(Gcode *gcode, int axis)
     // enable the probe checking in the timer
     probing= true;
     probe_detected= false;
+    if(trigger != nullptr) trigger->arm();
     THEROBOT->disable_segmentation= true; // we must disable segmentation as this won't work with it enabled (beware on deltas probing in X or Y)
 
     // get probe feedrate in mm/min and convert to mm/sec if specified
@@ -414,6 +517,7 @@ void ZProbe::probe_XYZ(Gcode *gcode, int axis)
 
     // disable probe checking
     probing= false;
+    if(trigger != nullptr) trigger->disarm();
     THEROBOT->disable_segmentation= false;
 
     // if the probe stopped the move we need to correct the last_milestone as it did not reach where it thought
@@ -439,6 +543,13 @@ void ZProbe::probe_XYZ(Gcode *gcode, int axis)
 // Only move the coordinates that are passed in as not nan
 // NOTE must use G53 to force move in machine coordinates and ignore any WCS offsets
 void ZProbe::coordinated_move(float x, float y, float z, float feedrate, bool relative)
+{
+    queue_move(x, y, z, feedrate, relative);
+    THEKERNEL->conveyor->wait_for_idle();
+}
+
+// as coordinated_move but returns as soon as the move is queued
+void ZProbe::queue_move(float x, float y, float z, float feedrate, bool relative)
 {
     char cmd[64];
 
@@ -474,7 +585,6 @@ void ZProbe::coordinated_move(float x, float y, float z, float feedrate, bool re
     message.message = cmd;
     message.stream = &(StreamOutput::NullStream);
     THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message );
-    THEKERNEL->conveyor->wait_for_idle();
     THEROBOT->pop_state();
 }
 
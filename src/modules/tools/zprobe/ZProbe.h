@@ -12,6 +12,7 @@
 #include "Pin.h"
 
 #include <vector>
+#include <functional>
 
 // defined here as they are used in multiple files
 #define zprobe_checksum            CHECKSUM("zprobe")
@@ -21,12 +22,13 @@ class StepperMotor;
 class Gcode;
 class StreamOutput;
 class LevelingStrategy;
+class EdgeTrigger;
 
 class ZProbe: public Module
 {
 
 public:
-    ZProbe() : invert_override(false) {};
+    ZProbe() : trigger(nullptr), invert_override(false) {};
     virtual ~ZProbe() {};
 
     void on_module_loaded();
@@ -36,6 +38,12 @@ public:
     bool run_probe_return(float& mm, float feedrate, float max_dist= -1, bool reverse= false);
     bool doProbeAt(float &mm, float x, float y);
 
+    // probes each point as doProbeAt does, but the return from one point runs into the travel to the next and each
+    // point after the first is approached at the fast feedrate down to slow_zone above where the point before it found
+    // the bed. done is called with the distance probed at each point and how long the point took in us
+    using probe_done_t = std::function<void(int i, float mm, uint32_t us)>;
+    bool probe_points(const std::vector<std::pair<float, float>> &points, probe_done_t done);
+
     void coordinated_move(float x, float y, float z, float feedrate, bool relative=false);
     void home();
 
@@ -49,16 +57,25 @@ private:
     void config_load();
     void probe_XYZ(Gcode *gc, int axis);
     uint32_t read_probe(uint32_t dummy);
+    void on_probe_edge();
+    void stop_on_probe(int32_t position);
+    void queue_move(float x, float y, float z, float feedrate, bool relative);
+    bool probe_down(float &mm, float bed_mm);
+    float get_return_feedrate() const;
 
     float slow_feedrate;
     float fast_feedrate;
     float return_feedrate;
     float probe_height;
     float max_z;
+    float slow_zone;
 
     Pin pin;
     std::vector<LevelingStrategy*> strategies;
     uint16_t debounce_ms, debounce;
+    EdgeTrigger *trigger; // nullptr if the pin is polled
+    int32_t trigger_position; // Z step position when the probe triggered
+    volatile bool probe_detected; // set from the pin interrupt so it is not in the bitfield
 
     volatile struct {
         bool is_delta:1;
@@ -66,7 +83,6 @@ private:
         bool probing:1;
         bool reverse_z:1;
         bool invert_override:1;
-        volatile bool probe_detected:1;
     };
 };
 
@@ -5,6 +5,7 @@
 #include "libs/utils.h"
 #include <libs/Pin.h>
 #include "mbed.h"
+#include "SPIBus.h"
 #include <string>
 #include <math.h>
 
@@ -12,6 +13,7 @@ class AD5206 : public DigipotBase {
     public:
         AD5206(){
             this->spi= new mbed::SPI(P0_9,P0_8,P0_7); //should be able to set those pins in config
+            this->bus= SPIBus::get(1);
             cs.from_string("4.29")->as_output(); //this also should be configurable
             cs.set(1);
             for (int i = 0; i < 6; i++) currents[i] = -1;
@@ -27,6 +29,7 @@ class AD5206 : public DigipotBase {
 				current = min( max( current, 0.0F ), 2.0F );
 				char adresses[6] = { 0x05, 0x03, 0x01, 0x00, 0x02, 0x04 };
 				currents[channel] = current;
+				SPIBus::Lock lock(bus);
 				cs.set(0);
 				spi->write((int)adresses[channel]);
 				spi->write((int)current_to_wiper(current));
@@ -53,6 +56,7 @@ class AD5206 : public DigipotBase {
 
         Pin cs;
         mbed::SPI* spi;
+        SPIBus *bus;
         float currents[6];
 };
 
@@ -13,7 +13,7 @@
 #include "Config.h"
 #include "checksumm.h"
 
-#include "mbed.h" // for SPI
+#include "SPIBus.h"
 
 #include "drivers/TMC26X/TMC26X.h"
 #include "drivers/DRV8711/drv8711.h"
@@ -45,10 +45,13 @@ MotorDriverControl::MotorDriverControl(uint8_t id) : id(id)
     enable_event= false;
     current_override= false;
     microstep_override= false;
+    bus= nullptr;
+    transaction= nullptr;
 }
 
 MotorDriverControl::~MotorDriverControl()
 {
+    delete transaction;
 }
 
 // this will load all motor driver controls defined in config, called from main
@@ -122,19 +125,14 @@ bool MotorDriverControl::config_module(uint16_t cs)
     int spi_frequency = THEKERNEL->config->value(motor_driver_control_checksum, cs, spi_frequency_checksum)->by_default(1000000)->as_number();
 
     // select SPI channel to use
-    PinName mosi, miso, sclk;
-    if(spi_channel == 0) {
-        mosi = P0_18; miso = P0_17; sclk = P0_15;
-    } else if(spi_channel == 1) {
-        mosi = P0_9; miso = P0_8; sclk = P0_7;
-    } else {
+    if(spi_channel != 0 && spi_channel != 1) {
         THEKERNEL->streams->printf("MotorDriverControl %c ERROR: Unknown SPI Channel: %d\n", axis, spi_channel);
         return false;
     }
 
-    this->spi = new mbed::SPI(mosi, miso, sclk);
-    this->spi->frequency(spi_frequency);
-    this->spi->format(8, 3); // 8bit, mode3
+    this->bus = SPIBus::get(spi_channel);
+    this->transaction = new SPITransaction();
+    this->transaction->setup(&spi_cs_pin, 8, 3, spi_frequency); // 8bit, mode3
 
     // set default max currents for each chip, can be overidden in config
     switch(chip) {
@@ -461,14 +459,13 @@ void MotorDriverControl::set_options(Gcode *gcode)
     }
 }
 
-// Called by the drivers codes to send and receive SPI data to/from the chip
+// Called by the drivers codes to send and receive SPI data to/from the chip, waits for the bus if another device is using it
 int MotorDriverControl::sendSPI(uint8_t *b, int cnt, uint8_t *r)
 {
-    spi_cs_pin.set(0);
-    for (int i = 0; i < cnt; ++i) {
-        r[i]= spi->write(b[i]);
-    }
-    spi_cs_pin.set(1);
+    transaction->tx= b;
+    transaction->rx= r;
+    transaction->length= cnt;
+    bus->transfer(transaction);
     return cnt;
 }
 
@@ -5,10 +5,8 @@
 
 #include <stdint.h>
 
-namespace mbed {
-    class SPI;
-}
-
+class SPIBus;
+class SPITransaction;
 class DRV8711DRV;
 class TMC26X;
 class StreamOutput;
@@ -40,7 +38,8 @@ class MotorDriverControl : public Module {
         int sendSPI(uint8_t *b, int cnt, uint8_t *r);
 
         Pin spi_cs_pin;
-        mbed::SPI *spi;
+        SPIBus *bus;
+        SPITransaction *transaction;
 
         enum CHIP_TYPE {
             DRV8711,
@@ -90,6 +90,7 @@ ST7565::ST7565(uint8_t variant)
     }
 
     this->spi = new mbed::SPI(mosi, miso, sclk);
+    this->bus = SPIBus::get(spi_channel);
     this->spi->frequency(THEKERNEL->config->value(panel_checksum, spi_frequency_checksum)->by_default(1000000)->as_number()); //4Mhz freq, can try go a little lower
 
     //chip select
@@ -166,6 +167,7 @@ ST7565::~ST7565()
 //send commands to lcd
 void ST7565::send_commands(const unsigned char *buf, size_t size)
 {
+    SPIBus::Lock lock(bus);
     cs.set(0);
     if(a0.connected()) a0.set(0);
     while(size-- > 0) {
@@ -177,6 +179,7 @@ void ST7565::send_commands(const unsigned char *buf, size_t size)
 //send data to lcd
 void ST7565::send_data(const unsigned char *buf, size_t size)
 {
+    SPIBus::Lock lock(bus);
     cs.set(0);
     if(a0.connected()) a0.set(1);
     while(size-- > 0) {
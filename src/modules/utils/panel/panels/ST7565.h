@@ -10,6 +10,7 @@
 
 #include "LcdBase.h"
 #include "mbed.h"
+#include "SPIBus.h"
 #include "libs/Pin.h"
 
 class ST7565: public LcdBase {
@@ -59,6 +60,7 @@ private:
     //buffer
 	unsigned char *framebuffer;
 	mbed::SPI* spi;
+	SPIBus *bus;
 	Pin cs;
 	Pin rst;
 	Pin a0;
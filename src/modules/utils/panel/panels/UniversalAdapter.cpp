@@ -34,15 +34,17 @@
 #define INIT_ADAPTER 0xFE
 #define POLL         0xFF
 
-// helper class to assert and deassert chip select
+// helper class to assert and deassert chip select, holds the bus while selected
 UniversalAdapter::SPIFrame::SPIFrame(UniversalAdapter *pu)
 {
     this->u = pu;
+    u->bus->lock();
     u->cs_pin->set(0);
 }
 UniversalAdapter::SPIFrame::~SPIFrame()
 {
     u->cs_pin->set(1);
+    u->bus->unlock();
 }
 
 UniversalAdapter::UniversalAdapter()
@@ -66,6 +68,7 @@ UniversalAdapter::UniversalAdapter()
     }
 
     this->spi = new mbed::SPI(mosi, miso, sclk);
+    this->bus = SPIBus::get(spi_channel);
     // chip select not selected
     this->cs_pin->set(1);
 
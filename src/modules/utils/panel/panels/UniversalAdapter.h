@@ -10,6 +10,7 @@
 
 #include "LcdBase.h"
 #include "mbed.h"
+#include "SPIBus.h"
 
 class Pin;
 
@@ -51,6 +52,7 @@ class UniversalAdapter : public LcdBase {
         uint8_t sendReadCmd(uint8_t cmd);
         uint16_t ledBits;
         mbed::SPI* spi;
+        SPIBus *bus;
         Pin *cs_pin;
         Pin *busy_pin;
 };
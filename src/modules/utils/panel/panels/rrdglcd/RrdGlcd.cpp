@@ -136,8 +136,8 @@ static const uint8_t font5x8[] = {
     0x00,0x00,0x78,0x78,0x78,0x78,0x00,0x00
 };
 
-#define ST7920_CS()              {cs.set(1);wait_us(10);}
-#define ST7920_NCS()             {cs.set(0);wait_us(10);}
+#define ST7920_CS()              {bus->lock();cs.set(1);wait_us(10);}
+#define ST7920_NCS()             {cs.set(0);wait_us(10);bus->unlock();}
 #define ST7920_WRITE_BYTE(a)     {this->spi->write((a)&0xf0);this->spi->write((a)<<4);wait_us(10);}
 #define ST7920_WRITE_BYTES(p,l)  {uint8_t i;for(i=0;i<l;i++){this->spi->write(*p&0xf0);this->spi->write(*p<<4);p++;} wait_us(10); }
 #define ST7920_SET_CMD()         {this->spi->write(0xf8);wait_us(10);}
@@ -158,6 +158,7 @@ RrdGlcd::RrdGlcd(int spi_channel, Pin cs) {
     }
 
     this->spi = new mbed::SPI(mosi, miso, sclk);
+    this->bus = SPIBus::get(spi_channel);
 
     //chip select
     this->cs= cs;
@@ -14,6 +14,7 @@
  */
 
 #include <mbed.h>
+#include "SPIBus.h"
 #include "libs/Kernel.h"
 #include "libs/utils.h"
 #include <libs/Pin.h>
@@ -54,6 +55,7 @@ public:
 private:
     Pin cs;
     mbed::SPI* spi;
+    SPIBus *bus;
     void renderChar(uint8_t *fb, char c, int ox, int oy);
     void displayChar(int row, int column,char inpChr);
 
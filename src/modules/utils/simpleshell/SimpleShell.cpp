@@ -40,6 +40,9 @@
 #include "md5.h"
 #include "utils.h"
 #include "AutoPushPop.h"
+#include "SPIBus.h"
+#include "HeapTrace.h"
+#include "BootTrace.h"
 
 #include "system_LPC17xx.h"
 #include "LPC17xx.h"
@@ -76,6 +79,8 @@ const SimpleShell::ptentry_t SimpleShell::commands_table[] = {
     {"?",        SimpleShell::help_command},
     {"version",  SimpleShell::version_command},
     {"mem",      SimpleShell::mem_command},
+    {"spi",      SimpleShell::spi_command},
+    {"boot",     SimpleShell::boot_command},
     {"get",      SimpleShell::get_command},
     {"set_temp", SimpleShell::set_temp_command},
     {"switch",   SimpleShell::switch_command},
@@ -586,15 +591,30 @@ void SimpleShell::mem_command( string parameters, StreamOutput *stream)
     uint32_t f = heapWalk(stream, verbose);
     stream->printf("Total Free RAM: %lu bytes\r\n", m + f);
 
-    stream->printf("Free AHB0: %lu, AHB1: %lu\r\n", AHB0.free(), AHB1.free());
+    stream->printf("Free AHB0: %lu (largest %lu), AHB1: %lu (largest %lu)\r\n", AHB0.free(), AHB0.largest_free(), AHB1.free(), AHB1.largest_free());
     if (verbose) {
         AHB0.debug(stream);
         AHB1.debug(stream);
+#ifdef HEAP_TRACE
+        heap_trace.dump(stream);
+#endif
     }
 
     stream->printf("Block size: %u bytes, Tickinfo size: %u bytes\n", sizeof(Block), sizeof(Block::tickinfo_t) * Block::n_actuators);
 }
 
+// show how busy the shared SPI buses are and how often devices had to wait for them
+void SimpleShell::spi_command( string parameters, StreamOutput *stream)
+{
+    SPIBus::dump_stats(stream);
+}
+
+// show how long each stage of boot took
+void SimpleShell::boot_command( string parameters, StreamOutput *stream)
+{
+    boot_trace.dump(stream);
+}
+
 static uint32_t getDeviceType()
 {
 #define IAP_LOCATION 0x1FFF1FF1
@@ -1138,6 +1158,8 @@ void SimpleShell::help_command( string parameters, StreamOutput *stream )
     stream->printf("Commands:\r\n");
     stream->printf("version\r\n");
     stream->printf("mem [-v]\r\n");
+    stream->printf("spi - show SPI bus usage\r\n");
+    stream->printf("boot - show how long each stage of boot took\r\n");
     stream->printf("ls [-s] [folder]\r\n");
     stream->printf("cd folder\r\n");
     stream->printf("pwd\r\n");
@@ -14,6 +14,7 @@ This is aprt of the Smoothie test framework, it generates a Mockable Kernl so ke
 #include "libs/Config.h"
 #include "libs/nuts_bolts.h"
 #include "libs/SlowTicker.h"
+#include "libs/PwmEngine.h"
 #include "libs/Adc.h"
 #include "libs/StreamOutputPool.h"
 #include <mri.h>
@@ -28,6 +29,7 @@ This is aprt of the Smoothie test framework, it generates a Mockable Kernl so ke
 #include "modules/robot/Robot.h"
 #include "modules/robot/Stepper.h"
 #include "modules/robot/Conveyor.h"
+#include "modules/robot/Block.h"
 
 #include "Config.h"
 #include "FirmConfigSource.h"
@@ -42,6 +44,8 @@ Kernel* Kernel::instance;
 // The kernel is the central point in Smoothie : it stores modules, and handles event calls
 Kernel::Kernel(){
     instance= this; // setup the Singleton instance of the kernel
+    halted= false;
+    feed_hold= false;
 
     // serial first at fixed baud rate (DEFAULT_SERIAL_BAUD_RATE) so config can report errors to serial
     // Set to UART0, this will be changed to use the same UART as MRI if it's enabled
@@ -57,6 +61,7 @@ Kernel::Kernel(){
     this->current_path   = "/";
 
     this->slow_ticker = new SlowTicker();
+    this->pwm_engine = new PwmEngine();
 
     // dummies (would be nice to refactor to not have to create a conveyor)
     this->conveyor= new Conveyor();
@@ -81,6 +86,10 @@ static std::map<_EVENT_ENUM, std::function<void(void*)> > event_callbacks;
 
 // Call a specific event with an argument
 void Kernel::call_event(_EVENT_ENUM id_event, void * argument){
+    if(id_event == ON_HALT) {
+        this->halted= (argument == nullptr);
+    }
+
     for (auto m : hooks[id_event]) {
         (m->*kernel_callback_functions[id_event])(argument);
     }
@@ -124,6 +133,13 @@ void test_kernel_teardown()
     event_callbacks.clear();
 }
 
+void test_kernel_unregister(Module *mod)
+{
+    for (int e = 0; e < NUMBER_OF_DEFINED_EVENTS; ++e) {
+        THEKERNEL->unregister_for_event((_EVENT_ENUM)e, mod);
+    }
+}
+
 void test_kernel_trap_event(_EVENT_ENUM id_event, std::function<void(void*)> fnc)
 {
     event_callbacks[id_event]= fnc;
@@ -133,3 +149,22 @@ void test_kernel_untrap_event(_EVENT_ENUM id_event)
 {
     event_callbacks.erase(id_event);
 }
+
+// stands in for the planner, the only other user of the conveyor's queue
+class TestConveyor
+{
+    public:
+        static void queue_block(std::function<void(Block*)> fill)
+        {
+            Block *block= THECONVEYOR->queue.head_ref();
+            fill(block);
+            block->calculate_trapezoid(0, 0);
+            block->ready();
+            THECONVEYOR->queue_head_block();
+        }
+};
+
+void test_kernel_queue_block(std::function<void(Block*)> fill)
+{
+    TestConveyor::queue_block(fill);
+}
@@ -3,7 +3,13 @@
 #include "Module.h"
 #include <functional>
 
+class Block;
+
 void test_kernel_setup_config(const char* start, const char* end);
 void test_kernel_teardown();
+// the kernel keeps the modules that registered for events, so a test removes its module with this before deleting it
+void test_kernel_unregister(Module *mod);
 void test_kernel_trap_event(_EVENT_ENUM id_event, std::function<void(void*)> fnc);
 void test_kernel_untrap_event(_EVENT_ENUM id_event);
+// fill sets the steps, rates and lengths of the block, which is then queued from rest to rest as the planner would
+void test_kernel_queue_block(std::function<void(Block*)> fill);
@@ -0,0 +1,69 @@
+#include "BootTrace.h"
+#include "StreamOutput.h"
+
+#include <string.h>
+
+#include "easyunit/test.h"
+
+// boot with made up times, in us from when the kernel started
+TEST(BootTrace,stages_steps_and_loading)
+{
+    BootTrace trace;
+
+    trace.stage("Config", 1000);
+    trace.step("firm", 300);
+    trace.step("sd", 4000);
+    trace.stage("Robot", 9000);
+    trace.loaded(2500);
+    trace.stage("Panel", 12000);
+    trace.loaded(100);
+    trace.loaded(200);
+    trace.finish(20000);
+
+    ASSERT_TRUE(trace.is_done());
+    ASSERT_EQUALS(19000, (int)trace.get_total());
+    ASSERT_EQUALS(5, trace.get_records());
+
+    // each stage runs until the next one starts, the steps keep their own times and do not end the stage
+    static const struct { const char *name; int us; int loaded_us; bool is_step; } expected[] = {
+        {"Config", 8000, 0, false},
+        {"firm", 300, 0, true},
+        {"sd", 4000, 0, true},
+        {"Robot", 3000, 2500, false},
+        {"Panel", 8000, 300, false},
+    };
+    for (int i = 0; i < 5; ++i) {
+        const BootTrace::record_t &r = trace.get_record(i);
+        ASSERT_TRUE(strcmp(expected[i].name, r.name) == 0);
+        ASSERT_EQUALS(expected[i].us, (int)r.us);
+        ASSERT_EQUALS(expected[i].loaded_us, (int)r.loaded_us);
+        ASSERT_EQUALS(expected[i].is_step, (bool)r.is_step);
+    }
+
+    // nothing is recorded once boot is done, as add_module is still called for tools made later
+    trace.stage("late", 30000);
+    trace.step("late step", 10);
+    trace.loaded(10);
+    ASSERT_EQUALS(5, trace.get_records());
+    ASSERT_EQUALS(19000, (int)trace.get_total());
+
+    trace.summary(&StreamOutput::NullStream);
+    trace.dump(&StreamOutput::NullStream);
+}
+
+TEST(BootTrace,more_stages_than_records)
+{
+    BootTrace trace;
+    for (int i = 0; i < 100; ++i) trace.stage("module", i * 10);
+    trace.finish(1000);
+
+    ASSERT_EQUALS(1000, (int)trace.get_total());
+    ASSERT_TRUE(trace.get_records() < 100);
+
+    // the stages that did not fit are charged to the last one, so the stages still add up to the total
+    int last = trace.get_records() - 1;
+    ASSERT_EQUALS(1000 - last * 10, (int)trace.get_record(last).us);
+    uint32_t sum = 0;
+    for (int i = 0; i < trace.get_records(); ++i) sum += trace.get_record(i).us;
+    ASSERT_EQUALS(1000, (int)sum);
+}
@@ -0,0 +1,234 @@
+#include "Config.h"
+#include "ConfigValue.h"
+#include "ConfigCache.h"
+#include "ConfigSources/FirmConfigSource.h"
+#include "ConfigSources/FileConfigSource.h"
+#include "checksumm.h"
+#include "utils.h"
+
+#include "mbed.h" // for us_ticker_read()
+
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "easyunit/test.h"
+
+static const char cache_config[] =
+    "# a comment\n"
+    "alpha_steps_per_mm 80 # X\n"
+    "temperature_control.hotend.enable true\n"
+    "\n"
+    "temperature_control.bed.enable true\n"
+    "alpha_steps_per_mm 160\n"
+    "temperature_control.hotend2.enable true\n"
+    "   beta_steps_per_mm\t\t100\n";
+
+TEST(ConfigCache,lookup_and_replace)
+{
+    Config config(new FirmConfigSource("rom", cache_config, &cache_config[sizeof(cache_config) - 1]));
+    config.config_cache_load();
+
+    // the later line replaces the earlier one
+    ASSERT_EQUALS(160, config.value(CHECKSUM("alpha_steps_per_mm"))->as_int());
+    ASSERT_EQUALS(100, config.value(CHECKSUM("beta_steps_per_mm"))->as_int());
+    ASSERT_TRUE(config.value(CHECKSUM("temperature_control"), CHECKSUM("bed"), CHECKSUM("enable"))->as_bool());
+    ASSERT_EQUALS(42, config.value(CHECKSUM("gamma_steps_per_mm"))->by_default(42)->as_int());
+    ASSERT_TRUE(config.value(CHECKSUM("gamma_steps_per_mm"))->as_string().empty());
+}
+
+TEST(ConfigCache,modules_in_order_read)
+{
+    Config config(new FirmConfigSource("rom", cache_config, &cache_config[sizeof(cache_config) - 1]));
+    config.config_cache_load();
+
+    std::vector<uint16_t> modules;
+    config.get_module_list(&modules, CHECKSUM("temperature_control"));
+    ASSERT_EQUALS(3, (int)modules.size());
+    ASSERT_EQUALS(CHECKSUM("hotend"), modules[0]);
+    ASSERT_EQUALS(CHECKSUM("bed"), modules[1]);
+    ASSERT_EQUALS(CHECKSUM("hotend2"), modules[2]);
+}
+
+static const char pin_config[] =
+    "temperature_control.hotend2.heater_pin 1.23\n"
+    "spindle.encoder_pha_pin 1.20^\n"
+    "spindle.encoder_phb_pin 1.23 \n"
+    "switch.fan.output_pin 1.230\n"
+    "gamma_max 11.23\n";
+
+TEST(ConfigCache,pin_users)
+{
+    Config config(new FirmConfigSource("rom", pin_config, &pin_config[sizeof(pin_config) - 1]));
+    config.config_cache_load();
+
+    ASSERT_EQUALS(2, config.pin_users(1, 23));
+    ASSERT_EQUALS(1, config.pin_users(1, 20));
+    ASSERT_EQUALS(0, config.pin_users(1, 2));
+    config.config_cache_clear();
+    ASSERT_EQUALS(0, config.pin_users(1, 23));
+}
+
+TEST(ConfigCache,pop_and_empty)
+{
+    ConfigCache cache;
+    uint16_t a[3] = {1, 2, 3}, b[3] = {1, 2, 4};
+    cache.add(a, "one");
+    cache.add(b, "two");
+    cache.pop();
+    cache.build_index();
+    ASSERT_EQUALS(1, (int)cache.size());
+    ConfigValue v;
+    ASSERT_TRUE(cache.lookup(a, v));
+    ASSERT_TRUE(v.as_string() == "one");
+    ASSERT_TRUE(!cache.lookup(b, v));
+
+    ConfigCache empty;
+    empty.build_index();
+    ASSERT_TRUE(!empty.lookup(a, v));
+}
+
+// somewhere the test can write, the sd card on the board
+static const char *image_file()
+{
+    static const char *files[] = { "/sd/cachetst.bin", "cachetst.bin" };
+    for (auto f : files) {
+        FILE *fp = fopen(f, "w");
+        if(fp != NULL) {
+            fclose(fp);
+            return f;
+        }
+    }
+    return nullptr;
+}
+
+TEST(ConfigCache,image_round_trip)
+{
+    const char *file = image_file();
+    if(file == nullptr) {
+        printf("ConfigCache image: nowhere to write, skipped\n");
+        return;
+    }
+
+    ConfigCache cache;
+    uint16_t a[3] = {1, 2, 3}, b[3] = {1, 2, 4}, c[3] = {5, 0, 0};
+    cache.add(a, "12.5");
+    cache.add(b, "true");
+    cache.add(c, "!1.23^");
+    cache.build_index();
+    cache.parse_values();
+    uint8_t digest[16] = {1, 2, 3};
+    ASSERT_TRUE(cache.save_image(file, digest));
+
+    ConfigCache loaded;
+    ConfigValue v;
+    ASSERT_TRUE(loaded.load_image(file, digest));
+    ASSERT_EQUALS(3, (int)loaded.size());
+    ASSERT_TRUE(loaded.lookup(a, v));
+    ASSERT_EQUALS_DELTA(12.5F, v.as_number(), 0.0001F);
+    ASSERT_EQUALS(12, v.as_int());
+    ASSERT_TRUE(loaded.lookup(b, v));
+    ASSERT_TRUE(v.as_bool());
+    ASSERT_TRUE(loaded.lookup(c, v));
+    ASSERT_TRUE(v.as_string() == "!1.23^");
+    ASSERT_TRUE(v.is_inverted());
+    ASSERT_EQUALS_DELTA(1.23F, v.as_number(), 0.0001F);
+
+    // an image of other sources is not used
+    digest[0] = 2;
+    ConfigCache other;
+    ASSERT_TRUE(!other.load_image(file, digest));
+    ASSERT_EQUALS(0, (int)other.size());
+    remove(file);
+}
+
+// Boot time benchmark on the sample config, which is /sd/config on the board and read from the tree on the host.
+// Prints the time to parse it into the cache and to read it back from an image, the heap the cache keeps while the
+// modules load, and the time to look up every setting in it against a linear scan of the same lines, which is what the
+// cache used to do
+TEST(ConfigCache,sample_config_benchmark)
+{
+    const char *files[] = { "/sd/config", "../ConfigSamples/Smoothieboard/config", "ConfigSamples/Smoothieboard/config" };
+    const char *file = nullptr;
+    for (auto f : files) {
+        if(file_exists(f)) {
+            file = f;
+            break;
+        }
+    }
+    if(file == nullptr) {
+        printf("ConfigCache benchmark: no sample config found, skipped\n");
+        return;
+    }
+
+    int heap_before = mallinfo().uordblks;
+    uint32_t t = us_ticker_read();
+    ConfigCache cache;
+    FileConfigSource source(file, "sd");
+    source.transfer_values_to_cache(&cache);
+    cache.build_index();
+    uint32_t parse_us = us_ticker_read() - t;
+    int heap_used = mallinfo().uordblks - heap_before;
+
+    // the settings in the file with the last value of each
+    std::vector<std::pair<std::vector<uint16_t>, std::string>> settings;
+    FILE *fp = fopen(file, "r");
+    char buf[512];
+    while(fgets(buf, sizeof(buf), fp) != NULL) {
+        char key[512], value[512];
+        if(sscanf(buf, "%511s %511s", key, value) != 2 || key[0] == '#' || value[0] == '#') continue;
+        std::vector<uint16_t> cs(3);
+        get_checksums(cs.data(), key);
+        for (auto &s : settings) {
+            if(s.first == cs) s.second = value;
+        }
+        settings.push_back(std::make_pair(cs, std::string(value)));
+    }
+    fclose(fp);
+
+    ConfigValue v;
+    t = us_ticker_read();
+    for (auto &s : settings) {
+        cache.lookup(s.first.data(), v);
+    }
+    uint32_t lookup_us = us_ticker_read() - t;
+
+    t = us_ticker_read();
+    int scanned = 0;
+    for (auto &s : settings) {
+        for (auto &l : settings) {
+            if(memcmp(l.first.data(), s.first.data(), 3 * sizeof(uint16_t)) == 0) {
+                ++scanned;
+                break;
+            }
+        }
+    }
+    uint32_t scan_us = us_ticker_read() - t;
+
+    uint32_t image_us = 0;
+    const char *image = image_file();
+    ConfigCache loaded;
+    if(image != nullptr) {
+        uint8_t digest[16] = {0};
+        cache.parse_values();
+        ASSERT_TRUE(cache.save_image(image, digest));
+        t = us_ticker_read();
+        ASSERT_TRUE(loaded.load_image(image, digest));
+        image_us = us_ticker_read() - t;
+        remove(image);
+    }
+
+    printf("ConfigCache benchmark: %s, %d lines parsed in %lu us, read from an image in %lu us, using %d bytes of heap, %d lookups in %lu us, linear scan %lu us\n",
+           file, (int)settings.size(), (unsigned long)parse_us, (unsigned long)image_us, heap_used, (int)settings.size(), (unsigned long)lookup_us, (unsigned long)scan_us);
+
+    int found = 0, found_in_image = 0;
+    for (auto &s : settings) {
+        if(cache.lookup(s.first.data(), v) && v.as_string() == s.second) ++found;
+        if(loaded.lookup(s.first.data(), v) && v.as_string() == s.second) ++found_in_image;
+    }
+    ASSERT_EQUALS((int)settings.size(), found);
+    ASSERT_EQUALS((int)settings.size(), scanned);
+    if(image != nullptr) ASSERT_EQUALS((int)settings.size(), found_in_image);
+}
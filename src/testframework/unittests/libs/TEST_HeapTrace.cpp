@@ -0,0 +1,178 @@
+#include "HeapTrace.h"
+#include "StreamOutput.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "easyunit/test.h"
+
+// the traces under test have their own tables, so they run the same whether or not the firmware is built with
+// HEAP_TRACE
+static HeapTrace::entry_t trace_table[128];
+
+static void *traced_malloc(HeapTrace &trace, size_t size, uint32_t site)
+{
+    void *p = malloc(size);
+    trace.allocated(p, size, site);
+    return p;
+}
+
+static void traced_free(HeapTrace &trace, void *p)
+{
+    trace.freed(p);
+    free(p);
+}
+
+TEST(HeapTrace,tags_live_and_peak)
+{
+    HeapTrace trace(trace_table, sizeof(trace_table));
+
+    void *a = traced_malloc(trace, 100, 1);
+    trace.set_tag("Robot");
+    void *b = traced_malloc(trace, 40, 2);
+    void *c = traced_malloc(trace, 60, 2);
+    {
+        HeapTrace::Scope scope(&trace, "gcode");
+        traced_free(trace, traced_malloc(trace, 500, 3));
+    }
+    void *d = traced_malloc(trace, 8, 4);
+
+    ASSERT_EQUALS(108, (int)trace.live_bytes("Robot"));
+    ASSERT_EQUALS(0, (int)trace.live_bytes("gcode"));
+    ASSERT_EQUALS(500, (int)trace.peak_bytes("gcode"));
+    ASSERT_EQUALS(208, (int)trace.get_bytes());
+    ASSERT_EQUALS(700, (int)trace.get_peak());
+
+    traced_free(trace, b);
+    ASSERT_EQUALS(68, (int)trace.live_bytes("Robot"));
+    ASSERT_EQUALS(108, (int)trace.peak_bytes("Robot"));
+    trace.reset_peaks();
+    ASSERT_EQUALS(68, (int)trace.peak_bytes("Robot"));
+
+    // not tracked, so ignored
+    int on_stack;
+    trace.freed(&on_stack);
+
+    traced_free(trace, a);
+    traced_free(trace, c);
+    traced_free(trace, d);
+    ASSERT_EQUALS(0, (int)trace.get_bytes());
+    ASSERT_EQUALS(0, (int)trace.get_entries());
+    trace.dump(&StreamOutput::NullStream);
+}
+
+// entries moved back over a freed one must still be found, whatever order they are freed in
+TEST(HeapTrace,frees_in_any_order)
+{
+    HeapTrace trace(trace_table, sizeof(trace_table));
+    std::vector<void *> live;
+    srand(7);
+
+    for (int op = 0; op < 5000; ++op) {
+        if(live.size() < 100 && (live.empty() || rand() % 2 == 0)) {
+            live.push_back(traced_malloc(trace, 1 + rand() % 64, rand() % 8));
+        } else {
+            size_t i = rand() % live.size();
+            traced_free(trace, live[i]);
+            live[i] = live.back();
+            live.pop_back();
+        }
+        if(trace.get_entries() != live.size()) break;
+    }
+    ASSERT_EQUALS((int)live.size(), (int)trace.get_entries());
+
+    for (auto p : live) traced_free(trace, p);
+    ASSERT_EQUALS(0, (int)trace.get_entries());
+    ASSERT_EQUALS(0, (int)trace.get_bytes());
+}
+
+TEST(HeapTrace,full_table_counts_untracked)
+{
+    HeapTrace trace(trace_table, sizeof(trace_table));
+    std::vector<void *> live;
+    for (int i = 0; i < 128; ++i) live.push_back(traced_malloc(trace, 16, 1));
+
+    ASSERT_EQUALS(112, (int)trace.get_entries());
+    ASSERT_EQUALS(16, (int)trace.get_untracked());
+    for (auto p : live) traced_free(trace, p);
+    ASSERT_EQUALS(0, (int)trace.get_bytes());
+}
+
+// Replays the allocations of a long session of G-code: each line makes a Gcode and its command string, which are
+// queued like blocks in the planner and freed as the queue moves on. One path keeps 24 bytes every 2000 lines, which
+// has to show up under its tag while everything else comes back
+TEST(HeapTrace,long_gcode_session_finds_the_leak)
+{
+    const uint32_t GCODE_SITE = 0x1000, COMMAND_SITE = 0x1004, LEAK_SITE = 0x2000;
+    HeapTrace trace(trace_table, sizeof(trace_table));
+    std::vector<void *> queue, leaked;
+
+    trace.set_tag("Kernel");
+    void *boot = traced_malloc(trace, 256, 0x10);
+    trace.set_tag(nullptr);
+
+    for (int line = 0; line < 100000; ++line) {
+        HeapTrace::Scope scope(&trace, "gcode");
+        queue.push_back(traced_malloc(trace, 48, GCODE_SITE));
+        queue.push_back(traced_malloc(trace, 10 + line % 20, COMMAND_SITE));
+        if(queue.size() > 2 * 16) {
+            traced_free(trace, queue[0]);
+            traced_free(trace, queue[1]);
+            queue.erase(queue.begin(), queue.begin() + 2);
+        }
+        if(line % 2000 == 0) {
+            HeapTrace::Scope leaking(&trace, "second tick");
+            leaked.push_back(traced_malloc(trace, 24, LEAK_SITE));
+        }
+    }
+    for (auto p : queue) traced_free(trace, p);
+
+    printf("HeapTrace session: %d bytes live in %d allocations, peak %d\n", (int)trace.get_bytes(), trace.get_entries(), (int)trace.get_peak());
+    ASSERT_EQUALS(0, (int)trace.live_bytes("gcode"));
+    ASSERT_EQUALS(256, (int)trace.live_bytes("Kernel"));
+    ASSERT_EQUALS(50 * 24, (int)trace.live_bytes("second tick"));
+    ASSERT_EQUALS(0, (int)trace.get_untracked());
+    // the queue's high water mark
+    ASSERT_TRUE(trace.peak_bytes("gcode") <= 16 * (48 + 30));
+
+    traced_free(trace, boot);
+    for (auto p : leaked) traced_free(trace, p);
+    ASSERT_EQUALS(0, (int)trace.get_bytes());
+}
+
+// The tags of a real build, every module given a BOOT_STAGE in Kernel.cpp and main.cpp and then the events. They all
+// have to fit, the events are tagged last so they are the ones that would be charged to other
+TEST(HeapTrace,every_module_and_event_has_a_tag)
+{
+    static const char *const modules[] = {
+        "Kernel", "Conveyor", "GcodeDispatch", "Robot", "SimpleShell", "Planner", "Configurator", "Player",
+        "CurrentControl", "KillButton", "PlayLed", "Endstops", "Switch", "Extruder", "TemperatureControl", "Laser",
+        "Spindle", "Panel", "ZProbe", "SCARAcal", "RotaryDeltaCalibration", "Network", "TemperatureSwitch",
+        "Drillingcycles", "FilamentDetector", "MotorDriverControl", "USB"
+    };
+    static const char *const events[NUMBER_OF_DEFINED_EVENTS] = {
+        "main loop", "console line", "gcode", "idle", "second tick", "get public data", "set public data", "halt", "enable"
+    };
+    HeapTrace trace(trace_table, sizeof(trace_table));
+    std::vector<void *> live;
+
+    for (auto name : modules) {
+        trace.set_tag(name);
+        live.push_back(traced_malloc(trace, 16, 1));
+    }
+    trace.set_tag(nullptr);
+    for (auto name : events) {
+        HeapTrace::Scope scope(&trace, name);
+        live.push_back(traced_malloc(trace, 8, 2));
+    }
+
+    // room is left for more modules
+    ASSERT_TRUE(sizeof(modules) / sizeof(modules[0]) + NUMBER_OF_DEFINED_EVENTS + 5 < HeapTrace::MAX_TAGS);
+    for (auto name : modules) ASSERT_EQUALS(16, (int)trace.live_bytes(name));
+    for (auto name : events) ASSERT_EQUALS(8, (int)trace.live_bytes(name));
+    ASSERT_EQUALS(8, (int)trace.live_bytes("gcode"));
+
+    for (auto p : live) traced_free(trace, p);
+    ASSERT_EQUALS(0, (int)trace.get_bytes());
+}
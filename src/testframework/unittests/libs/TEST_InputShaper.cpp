@@ -0,0 +1,149 @@
+#include "InputShaper.h"
+
+#include <stdio.h>
+#include <math.h>
+
+#include "easyunit/test.h"
+
+#define FREQUENCY 100000
+#define FPSCALE (1LL<<62)
+
+// a printer that rings at 50Hz with 10% damping, 80 steps/mm
+#define RESONANCE 50.0F
+#define DAMPING 0.1F
+
+struct shaped_move_t {
+    int32_t planned;        // steps of the planned move
+    int32_t position;       // where the motor ended up
+    float max_lag;          // furthest the motor was behind the planned move, steps
+    float residual;         // largest swing of the toolhead about where it stopped, steps
+    uint32_t settle_ticks;  // ticks after the planned move ended that the motor stopped
+};
+
+// steps a rest to rest trapezoid through the shaper the way StepTicker does, the motor drives a spring and damper model
+// of the toolhead, rate in steps per second and times in seconds
+static shaped_move_t run_move(InputShaper &shaper, float rate, float accel_time, float plateau_time)
+{
+    shaped_move_t r= {0, 0, 0, 0, 0};
+    uint32_t accel_ticks= accel_time * FREQUENCY;
+    uint32_t plateau_ticks= plateau_time * FREQUENCY;
+    uint32_t total= accel_ticks * 2 + plateau_ticks;
+    int64_t plateau_rate= llround((double)rate / FREQUENCY * FPSCALE);
+    int64_t change= plateau_rate / accel_ticks;
+    int64_t spt= 0;
+    int64_t counter= 0;
+
+    double w= 2 * M_PI * RESONANCE;
+    double dt= 1.0 / FREQUENCY;
+    double x= 0, v= 0;
+    bool backwards= false;
+    uint32_t last_step= 0;
+
+    // run on for half a second after to see it ring
+    for (uint32_t tick = 1; tick < total + FREQUENCY / 2; ++tick) {
+        if(tick < total) {
+            if(tick < accel_ticks) spt += change;
+            else if(tick == accel_ticks) spt= plateau_rate;
+            else if(tick >= accel_ticks + plateau_ticks) spt -= change;
+            if(spt < 0) spt= 0;
+
+            counter += spt;
+            if(counter >= FPSCALE) {
+                counter -= FPSCALE;
+                r.planned++;
+                shaper.push(tick, false);
+            }
+        }
+
+        int dir= shaper.want(tick);
+        if(dir != 0) {
+            if(backwards != (dir < 0)) {
+                backwards= dir < 0;
+            } else {
+                r.position += dir;
+                shaper.moved(dir);
+                last_step= tick;
+            }
+        }
+
+        float lag= r.planned - r.position;
+        if(lag > r.max_lag) r.max_lag= lag;
+
+        // the toolhead is pulled towards the motor by the belt
+        double a= w * w * (r.position - x) - 2 * DAMPING * w * v;
+        v += a * dt;
+        x += v * dt;
+
+        if(tick > total && shaper.is_idle() && tick > last_step) {
+            float swing= fabs(x - r.position);
+            if(swing > r.residual) r.residual= swing;
+        }
+    }
+    r.settle_ticks= (last_step > total) ? last_step - total : 0;
+
+    return r;
+}
+
+static shaped_move_t report(const char *name, InputShaper::TYPE type)
+{
+    InputShaper shaper;
+    shaper.configure(type, RESONANCE, DAMPING, FREQUENCY, 20000);
+    // 100mm/s with 5000mm/s² acceleration
+    shaped_move_t r= run_move(shaper, 8000, 0.02F, 0.05F);
+    printf("%s: %ld steps, ended at %ld, lagged up to %1.1f steps, settled %1.1f ms after the plan, rings %1.2f steps\n", name,
+           (long)r.planned, (long)r.position, r.max_lag, r.settle_ticks * 1000.0F / FREQUENCY, r.residual);
+    return r;
+}
+
+TEST(InputShaper,unshaped_follows_plan)
+{
+    shaped_move_t r= report("Unshaped", InputShaper::NONE);
+    ASSERT_EQUALS(r.planned, r.position);
+    ASSERT_TRUE(r.max_lag <= 1);
+    // the model does ring without shaping
+    ASSERT_TRUE(r.residual > 1);
+}
+
+TEST(InputShaper,shapers_cancel_ringing)
+{
+    shaped_move_t none= report("Unshaped", InputShaper::NONE);
+    shaped_move_t zv= report("ZV", InputShaper::ZV);
+    shaped_move_t zvd= report("ZVD", InputShaper::ZVD);
+    shaped_move_t mzv= report("MZV", InputShaper::MZV);
+
+    // no steps are lost and the motor stops where it was planned to
+    ASSERT_EQUALS(zv.planned, zv.position);
+    ASSERT_EQUALS(zvd.planned, zvd.position);
+    ASSERT_EQUALS(mzv.planned, mzv.position);
+
+    ASSERT_TRUE(zv.residual < none.residual / 4);
+    ASSERT_TRUE(zvd.residual < none.residual / 4);
+    ASSERT_TRUE(mzv.residual < none.residual / 4);
+
+    // they finish one shaper length after the plan, ZV half a period, ZVD a whole one
+    ASSERT_TRUE(zv.settle_ticks <= FREQUENCY / RESONANCE / 2 + 10);
+    ASSERT_TRUE(zvd.settle_ticks <= FREQUENCY / RESONANCE + 10);
+    ASSERT_TRUE(zvd.settle_ticks > zv.settle_ticks);
+}
+
+TEST(InputShaper,full_ring_loses_no_steps)
+{
+    // sized for a much slower motor than it is given so the ring fills
+    InputShaper shaper;
+    ASSERT_TRUE(shaper.configure(InputShaper::ZVD, RESONANCE, DAMPING, FREQUENCY, 100));
+    shaped_move_t r= run_move(shaper, 30000, 0.02F, 0.05F);
+
+    ASSERT_EQUALS(r.planned, r.position);
+    ASSERT_TRUE(shaper.is_idle());
+}
+
+TEST(InputShaper,reconfigure_off)
+{
+    InputShaper shaper;
+    ASSERT_TRUE(shaper.configure(InputShaper::MZV, RESONANCE, DAMPING, FREQUENCY, 20000));
+    ASSERT_TRUE(shaper.is_enabled());
+    ASSERT_TRUE(shaper.configure(InputShaper::NONE, RESONANCE, DAMPING, FREQUENCY, 20000));
+    ASSERT_TRUE(!shaper.is_enabled());
+    ASSERT_EQUALS(InputShaper::ZVD, InputShaper::type_from_string("zvd"));
+    ASSERT_EQUALS(InputShaper::NONE, InputShaper::type_from_string("ei"));
+}
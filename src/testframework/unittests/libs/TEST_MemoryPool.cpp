@@ -0,0 +1,170 @@
+#include "MemoryPool.h"
+
+#include "mbed.h" // for us_ticker_read()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "easyunit/test.h"
+
+// the pools under test have their own memory, not AHB0 or AHB1
+static uint8_t pool_memory[16384] __attribute__ ((aligned (4)));
+
+struct allocation_t {
+    uint8_t *p;
+    uint16_t n;
+    uint8_t fill;
+};
+
+static bool intact(const allocation_t &a)
+{
+    for (int i = 0; i < a.n; ++i) {
+        if(a.p[i] != a.fill) return false;
+    }
+    return true;
+}
+
+static uint16_t random_size()
+{
+    // mostly small objects like the ones that churn, with some large ones
+    return (rand() % 5 != 0) ? 1 + rand() % MemoryPool::SLAB_MAX : MemoryPool::SLAB_MAX + 1 + rand() % 500;
+}
+
+TEST(MemoryPool,small_blocks_come_from_slabs)
+{
+    MemoryPool pool(pool_memory, sizeof(pool_memory));
+    uint16_t regions;
+    uint32_t largest = pool.largest_free(&regions);
+
+    void *a = pool.alloc(10);
+    void *b = pool.alloc(12);
+    void *c = pool.alloc(100);
+    ASSERT_TRUE(a != NULL && b != NULL && c != NULL);
+    ASSERT_EQUALS(0, (int)((uintptr_t)a & 3));
+    // the same class is packed together at the top of the pool, a large block is first fit at the bottom
+    ASSERT_EQUALS(12, (int)((uint8_t*)b - (uint8_t*)a));
+    ASSERT_TRUE((uint8_t*)c < (uint8_t*)a);
+
+    pool.dealloc(a);
+    pool.dealloc(b);
+    pool.dealloc(c);
+    // the empty page and its header are kept for the next small block, which gets the last one freed
+    ASSERT_TRUE(pool.alloc(9) == b);
+    ASSERT_EQUALS((int)(largest - MemoryPool::PAGE_SIZE - 4), (int)pool.largest_free());
+}
+
+TEST(MemoryPool,delete_finds_the_pool)
+{
+    MemoryPool pool(pool_memory, sizeof(pool_memory));
+    int *i = new(pool) int(42);
+    ASSERT_TRUE(MemoryPool::find(i) == &pool);
+    delete i;
+
+    int *h = new int(42);
+    ASSERT_TRUE(MemoryPool::find(h) == NULL);
+    delete h;
+}
+
+// random allocations and frees filled with a pattern, which is checked before each free and at the end so a block
+// handed out twice or overlapping another shows up
+TEST(MemoryPool,fuzz)
+{
+    MemoryPool pool(pool_memory, sizeof(pool_memory));
+    uint32_t largest = pool.largest_free();
+    std::vector<allocation_t> live;
+    srand(1234);
+    int failed = 0, corrupt = 0;
+
+    for (int op = 0; op < 20000; ++op) {
+        if(live.empty() || rand() % 100 < 55) {
+            allocation_t a;
+            a.n = random_size();
+            a.fill = rand();
+            a.p = (uint8_t *)pool.alloc(a.n);
+            if(a.p == NULL) {
+                ++failed;
+                continue;
+            }
+            ASSERT_TRUE(pool.has(a.p) && pool.has(a.p + a.n - 1));
+            ASSERT_EQUALS(0, (int)((uintptr_t)a.p & 3));
+            memset(a.p, a.fill, a.n);
+            live.push_back(a);
+        } else {
+            size_t i = rand() % live.size();
+            if(!intact(live[i])) ++corrupt;
+            pool.dealloc(live[i].p);
+            live[i] = live.back();
+            live.pop_back();
+        }
+    }
+
+    for (auto &a : live) {
+        if(!intact(a)) ++corrupt;
+        pool.dealloc(a.p);
+    }
+
+    uint16_t regions;
+    printf("MemoryPool fuzz: %d allocations failed, largest free %lu of %lu after\n", failed, (unsigned long)pool.largest_free(&regions), (unsigned long)largest);
+    ASSERT_EQUALS(0, corrupt);
+    // all that is left is at most an empty page kept for each of the 7 size classes, with free regions between them,
+    // and they are given back for a block that needs the room
+    ASSERT_TRUE(regions <= 8);
+    ASSERT_TRUE(pool.alloc(largest) != NULL);
+}
+
+// Long lived large blocks with small ones allocated and freed between them, as over days of uptime. The small ones
+// used to leave holes between the large ones that a large block no longer fitted in
+TEST(MemoryPool,churn_does_not_fragment)
+{
+    MemoryPool pool(pool_memory, sizeof(pool_memory));
+    std::vector<void *> small, large;
+    srand(42);
+
+    for (int round = 0; round < 200; ++round) {
+        for (int i = 0; i < 8; ++i) small.push_back(pool.alloc(1 + rand() % MemoryPool::SLAB_MAX));
+        if(large.size() < 20) large.push_back(pool.alloc(200 + rand() % 200));
+        // free most of the small ones in random order
+        while(small.size() > 4) {
+            size_t i = rand() % small.size();
+            pool.dealloc(small[i]);
+            small[i] = small.back();
+            small.pop_back();
+        }
+    }
+
+    uint16_t regions;
+    uint32_t largest = pool.largest_free(&regions);
+    printf("MemoryPool churn: largest free %lu in %u free regions, %lu free\n", (unsigned long)largest, regions, (unsigned long)pool.free());
+    ASSERT_TRUE(regions <= 3);
+    ASSERT_TRUE(pool.alloc(largest) != NULL);
+}
+
+// time to allocate and free small blocks with many others live, which a first fit walk has to step over
+TEST(MemoryPool,benchmark)
+{
+    MemoryPool pool(pool_memory, sizeof(pool_memory));
+    std::vector<void *> live;
+    for (int i = 0; i < 200; ++i) live.push_back(pool.alloc(16));
+    for (int i = 0; i < 10; ++i) live.push_back(pool.alloc(300));
+
+    uint32_t t = us_ticker_read();
+    for (int i = 0; i < 10000; ++i) {
+        void *p = pool.alloc(24);
+        pool.dealloc(p);
+    }
+    uint32_t slab_us = us_ticker_read() - t;
+
+    t = us_ticker_read();
+    for (int i = 0; i < 10000; ++i) {
+        void *p = pool.alloc(200);
+        pool.dealloc(p);
+    }
+    uint32_t region_us = us_ticker_read() - t;
+
+    printf("MemoryPool benchmark: 10000 slab alloc/free %lu us, 10000 first fit alloc/free %lu us with %d blocks live\n",
+           (unsigned long)slab_us, (unsigned long)region_us, (int)live.size());
+
+    for (auto p : live) pool.dealloc(p);
+}
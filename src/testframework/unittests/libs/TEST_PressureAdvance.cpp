@@ -0,0 +1,180 @@
+#include "PressureAdvance.h"
+#include "StepTicker.h"
+#include "StepperMotor.h"
+#include "Block.h"
+#include "Conveyor.h"
+#include "Kernel.h"
+#include "Pin.h"
+#include "Test_kernel.h"
+
+#include <stdio.h>
+#include <math.h>
+
+#include "easyunit/test.h"
+
+#define FREQUENCY 100000
+#define EXTRUDER 3
+
+// X, Y, Z and an extruder on the real StepTicker, made once as the motors stay registered for the kernel's events
+static StepTicker *ticker;
+static StepperMotor *e_motor;
+
+struct extruder_steps_t {
+    int32_t position;   // how far the extruder moved, in steps
+    int32_t peak;       // most steps ahead of the block
+    uint32_t block;     // the block's own steps
+};
+
+// each call to ON_IDLE is one tick of the step and unstep interrupts, the conveyor also looks at its queue on idle
+static void setup_ticker(float k)
+{
+    if(ticker == nullptr) {
+        static const char config[]= "planner_queue_size 4\nqueue_delay_time_ms 0\n";
+        test_kernel_setup_config(config, &config[sizeof(config) - 1]);
+        THECONVEYOR->on_module_loaded();
+
+        ticker= new StepTicker();
+        ticker->set_frequency(FREQUENCY);
+        THEKERNEL->step_ticker= ticker;
+        THECONVEYOR->start(EXTRUDER + 1);
+
+        Pin nc;
+        nc.from_string("nc");
+        for (int i = 0; i < EXTRUDER; ++i) {
+            ticker->register_motor(new StepperMotor(nc, nc, nc));
+        }
+        e_motor= new StepperMotor(nc, nc, nc);
+        ticker->register_motor(e_motor);
+    }
+
+    test_kernel_trap_event(ON_IDLE, [](void *) { ticker->step_tick(); ticker->unstep_tick(); });
+    test_kernel_trap_event(ON_ENABLE, [](void *) {});
+    test_kernel_trap_event(ON_HALT, [](void *) {});
+    ticker->set_pressure_advance(EXTRUDER, k);
+}
+
+// queues an extruding move with the primary axis at rate steps per second and the other one at ratio of that, from rest to
+// rest accelerating for accel_time seconds. Returns the extruder's steps
+static uint32_t queue_move(float rate, float accel_time, float plateau_time, float e_ratio= 0.25F)
+{
+    uint32_t steps= lroundf(rate * (accel_time + plateau_time));
+    uint32_t x_steps= e_ratio > 1 ? lroundf(steps / e_ratio) : steps;
+    uint32_t e_steps= e_ratio > 1 ? steps : lroundf(steps * e_ratio);
+    test_kernel_queue_block([=](Block *block) {
+        block->steps[0]= x_steps;
+        block->steps[EXTRUDER]= e_steps;
+        block->steps_event_count= steps;
+        block->millimeters= steps / 80.0F;
+        block->nominal_rate= rate;
+        block->nominal_speed= rate / 80.0F;
+        block->acceleration= rate / accel_time / 80.0F;
+        block->primary_axis= true;
+        block->is_g123= true;
+    });
+    return e_steps;
+}
+
+// steps the move then ticks on for a second with nothing queued
+static extruder_steps_t run_move(float rate, float accel_time, float plateau_time, float e_ratio= 0.25F)
+{
+    int32_t start= e_motor->get_current_step();
+    extruder_steps_t r= {0, 0, queue_move(rate, accel_time, plateau_time, e_ratio)};
+
+    uint32_t ticks= (accel_time * 2 + plateau_time + 1) * FREQUENCY;
+    for (uint32_t i = 0; i < ticks; ++i) {
+        THEKERNEL->call_event(ON_IDLE);
+        const Block *block= ticker->get_current_block();
+        if(block != nullptr) {
+            int32_t ahead= (int32_t)e_motor->get_current_step() - start - (int32_t)block->tick_info[EXTRUDER].step_count;
+            if(ahead > r.peak) r.peak= ahead;
+        }
+    }
+    r.position= (int32_t)e_motor->get_current_step() - start;
+
+    return r;
+}
+
+TEST(PressureAdvance,off_steps_the_block)
+{
+    setup_ticker(0);
+    extruder_steps_t r= run_move(8000, 0.1F, 0.5F);
+
+    ASSERT_EQUALS((int)r.block, r.position);
+    ASSERT_EQUALS(0, r.peak);
+    test_kernel_teardown();
+}
+
+TEST(PressureAdvance,returns_to_block_position)
+{
+    setup_ticker(0.05F);
+    extruder_steps_t r= run_move(8000, 0.1F, 0.5F);
+    printf("Pressure advance: %lu block steps, peak %ld ahead\n", (unsigned long)r.block, (long)r.peak);
+
+    // the same filament is fed in the end and none is left pushed ahead
+    ASSERT_EQUALS((int)r.block, r.position);
+
+    // K times the top speed of the extruder ahead on the plateau
+    ASSERT_TRUE(abs(r.peak - 100) <= 1);
+    test_kernel_teardown();
+}
+
+TEST(PressureAdvance,short_move_never_reaches_top_speed)
+{
+    setup_ticker(0.04F);
+    extruder_steps_t r= run_move(6000, 0.02F, 0);
+
+    ASSERT_EQUALS((int)r.block, r.position);
+    ASSERT_TRUE(r.peak <= 60);
+    test_kernel_teardown();
+}
+
+// a slow X move that extrudes a lot, the extruder has the most steps but it is still an extruding move
+TEST(PressureAdvance,extruder_with_most_steps)
+{
+    setup_ticker(0.05F);
+    extruder_steps_t r= run_move(2000, 0.1F, 0.5F, 4);
+
+    ASSERT_EQUALS((int)r.block, r.position);
+    ASSERT_TRUE(abs(r.peak - 100) <= 1);
+    test_kernel_teardown();
+}
+
+TEST(PressureAdvance,k_is_limited)
+{
+    setup_ticker(5);
+    extruder_steps_t r= run_move(4000, 0.1F, 0.1F);
+
+    // 0.5 seconds at most
+    ASSERT_TRUE(r.peak <= 500);
+    ASSERT_EQUALS((int)r.block, r.position);
+
+    PressureAdvance advance;
+    advance.set_k(0, FREQUENCY);
+    ASSERT_TRUE(!advance.is_enabled());
+    test_kernel_teardown();
+}
+
+// a halt in the middle of a move drops what the advance had pushed ahead, so the next move feeds exactly its own steps
+TEST(PressureAdvance,halt_drops_the_advance)
+{
+    setup_ticker(0.05F);
+    queue_move(8000, 0.1F, 0.5F);
+
+    int32_t start= e_motor->get_current_step();
+    int32_t ahead= 0;
+    for (uint32_t i = 0; i < FREQUENCY && ahead < 50; ++i) {
+        THEKERNEL->call_event(ON_IDLE);
+        const Block *block= ticker->get_current_block();
+        if(block != nullptr) ahead= (int32_t)e_motor->get_current_step() - start - (int32_t)block->tick_info[EXTRUDER].step_count;
+    }
+    ASSERT_TRUE(ahead >= 50);
+
+    // the conveyor flushes the queue on halt, which ticks until the block is dropped
+    THEKERNEL->call_event(ON_HALT, nullptr);
+    ASSERT_TRUE(ticker->get_current_block() == nullptr);
+    THEKERNEL->call_event(ON_HALT, (void *)1);
+
+    extruder_steps_t r= run_move(8000, 0.1F, 0.5F);
+    ASSERT_EQUALS((int)r.block, r.position);
+    test_kernel_teardown();
+}
@@ -0,0 +1,74 @@
+#include "SlidingTrimmedMean.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "easyunit/test.h"
+
+// the sort based filter Adc::read used before, sort the last n samples and sum the middle half
+static uint32_t sorted_trimmed_sum(const uint16_t *samples, int n)
+{
+    uint16_t buf[n];
+    memcpy(buf, samples, sizeof(buf));
+    std::sort(buf, buf + n);
+    uint32_t sum = 0;
+    for (int i = n / 4; i < (n - (n / 4)); ++i) {
+        sum += buf[i];
+    }
+    return sum;
+}
+
+// push samples into both the filter and a shifted buffer like the one the Adc used, and compare after every sample
+template<int n>
+static bool compare_with_sort(uint16_t (*next_sample)(int), int count)
+{
+    SlidingTrimmedMean<n> filter;
+    uint16_t samples[n];
+    memset(samples, 0, sizeof(samples));
+
+    for (int i = 0; i < count; ++i) {
+        uint16_t v = next_sample(i);
+        memmove(&samples[0], &samples[1], sizeof(samples) - sizeof(samples[0]));
+        samples[n - 1] = v;
+        filter.push(v);
+        if(filter.trimmed_sum() != sorted_trimmed_sum(samples, n)) {
+            printf("mismatch at sample %d: %lu != %lu\n", i, (unsigned long)filter.trimmed_sum(), (unsigned long)sorted_trimmed_sum(samples, n));
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint16_t random_sample(int) { return rand() & 0xFFF; }
+static uint16_t few_values(int) { return 2000 + (rand() % 4); }
+static uint16_t noisy_ramp(int i) { return ((i * 3) & 0xFFF) + (rand() % 50) - ((rand() % 20) == 0 ? 1000 : 0); }
+
+TEST(SlidingTrimmedMean,random_matches_sort)
+{
+    srand(1);
+    ASSERT_TRUE(compare_with_sort<32>(random_sample, 10000));
+    ASSERT_TRUE(compare_with_sort<8>(random_sample, 10000));
+}
+
+TEST(SlidingTrimmedMean,duplicates_match_sort)
+{
+    srand(2);
+    ASSERT_TRUE(compare_with_sort<32>(few_values, 10000));
+}
+
+TEST(SlidingTrimmedMean,spikes_match_sort)
+{
+    srand(3);
+    ASSERT_TRUE(compare_with_sort<32>(noisy_ramp, 10000));
+}
+
+TEST(SlidingTrimmedMean,median)
+{
+    SlidingTrimmedMean<8> filter;
+    const uint16_t v[8] = {5, 1, 7, 3, 9, 2, 8, 4};
+    for (int i = 0; i < 8; ++i) filter.push(v[i]);
+    // sorted 1 2 3 4 5 7 8 9
+    ASSERT_EQUALS_V(5, filter.median());
+    ASSERT_EQUALS_V(3 + 4 + 5 + 7, filter.trimmed_sum());
+}
@@ -0,0 +1,106 @@
+#include "SimulatedVFD.h"
+
+#include <string.h>
+
+SimulatedVFD::SimulatedVFD(uint32_t char_us, uint32_t latency_us)
+{
+    this->char_us= char_us;
+    this->latency= latency_us;
+    now= 0;
+    request_length= answer_length= answer_read= 0;
+    answer_start= 0;
+    drop_count= corrupt_count= 0;
+    requests= bad_requests= 0;
+    frequency= 0;
+    transmitting= running= reversed= false;
+}
+
+void SimulatedVFD::set_transmit(bool on)
+{
+    if(on) {
+        request_length= 0;
+    } else if(transmitting) {
+        // the end of a frame
+        answer_request();
+    }
+    transmitting= on;
+}
+
+void SimulatedVFD::write(const uint8_t *data, size_t n)
+{
+    if(!transmitting || request_length + n > sizeof(request)) {
+        bad_requests++;
+        return;
+    }
+    memcpy(&request[request_length], data, n);
+    request_length += n;
+}
+
+int SimulatedVFD::read()
+{
+    if(answer_read >= answer_length) return -1;
+    // each character takes char_us to arrive
+    if((int32_t)(now - (answer_start + (answer_read + 1) * char_us)) < 0) return -1;
+    return answer[answer_read++];
+}
+
+void SimulatedVFD::answer_request()
+{
+    answer_length= answer_read= 0;
+    if(request_length < 4 || ModbusMaster::crc16(request, request_length - 2) != (request[request_length - 2] | (request[request_length - 1] << 8))) {
+        bad_requests++;
+        return;
+    }
+    requests++;
+
+    if(drop_count > 0) {
+        drop_count--;
+        return;
+    }
+
+    answer[0]= request[0];
+    answer[1]= request[1];
+    switch(request[1]) {
+        case 0x03: // control write, the answer is the new state
+            if(request[3] == 0x08) running= false;
+            else if(request[3] == 0x01 || request[3] == 0x11) {
+                running= true;
+                reversed= request[3] == 0x11;
+            }
+            answer[2]= 0x01;
+            answer[3]= request[3];
+            answer_length= 4;
+            break;
+
+        case 0x05: // frequency write, echoed
+            frequency= (request[3] << 8) | request[4];
+            memcpy(&answer[2], &request[2], 3);
+            answer_length= 5;
+            break;
+
+        case 0x04: { // control read, only the frequency is simulated
+            int v= (request[3] == 0x00 && running) ? frequency : 0;
+            answer[2]= 0x03;
+            answer[3]= request[3];
+            answer[4]= v >> 8;
+            answer[5]= v & 0xFF;
+            answer_length= 6;
+            break;
+        }
+
+        default: // illegal function
+            answer[1] |= 0x80;
+            answer[2]= 0x01;
+            answer_length= 3;
+            break;
+    }
+
+    uint16_t crc= ModbusMaster::crc16(answer, answer_length);
+    if(corrupt_count > 0) {
+        corrupt_count--;
+        crc ^= 0x5555;
+    }
+    answer[answer_length++]= crc & 0xFF;
+    answer[answer_length++]= crc >> 8;
+    answer_start= now + latency;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ModbusMaster.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+// A Huanyang VFD on the other end of the RS485 line, for testing the spindle control without hardware. It answers the
+// control write, frequency write and control read commands the way the VFD does, each answer starting latency us after
+// the request and arriving one character at a time. Answers can be dropped or corrupted to test the retries
+class SimulatedVFD : public ModbusTransport
+{
+    public:
+        SimulatedVFD(uint32_t char_us, uint32_t latency_us);
+
+        void set_transmit(bool on);
+        void write(const uint8_t *data, size_t n);
+        int read();
+
+        // the time in us, advanced by the test along with the spindle's poll
+        void set_time(uint32_t now) { this->now= now; }
+
+        // the next n requests get no answer, or an answer with a bad CRC
+        void drop(int n) { drop_count= n; }
+        void corrupt(int n) { corrupt_count= n; }
+
+        bool is_running() const { return running; }
+        bool is_reversed() const { return reversed; }
+        // set frequency in 0.01Hz
+        int get_frequency() const { return frequency; }
+        int get_requests() const { return requests; }
+        // requests with a bad CRC, or written with the transmitter off
+        int get_bad_requests() const { return bad_requests; }
+
+    private:
+        void answer_request();
+
+        uint8_t request[MODBUS_MAX_FRAME];
+        size_t request_length;
+        uint8_t answer[MODBUS_MAX_FRAME];
+        size_t answer_length;
+        size_t answer_read;
+        uint32_t answer_start;
+
+        uint32_t char_us;
+        uint32_t latency;
+        uint32_t now;
+
+        int drop_count;
+        int corrupt_count;
+        int requests;
+        int bad_requests;
+        int frequency;
+
+        bool transmitting;
+        bool running;
+        bool reversed;
+};
@@ -0,0 +1,155 @@
+#include "HuanyangSpindleControl.h"
+#include "ModbusMaster.h"
+#include "SimulatedVFD.h"
+#include "Kernel.h"
+#include "Test_kernel.h"
+#include "StreamOutput.h"
+#include "Gcode.h"
+
+#include <stdio.h>
+
+#include "easyunit/test.h"
+
+// the spindle control talking to a simulated Huanyang VFD, at 9600 baud 8N1 and with the VFD taking 5ms to answer
+
+#define CHAR_US 1042
+#define LATENCY_US 5000
+#define POLL_INTERVAL_US 200000
+
+DECLARE(HuanyangSpindleControl)
+    HuanyangSpindleControl *spindle;
+    SimulatedVFD *vfd;
+END_DECLARE
+
+static uint32_t now;
+
+// runs the idle loop every 100us for ms
+static void idle(HuanyangSpindleControl *spindle, SimulatedVFD *vfd, uint32_t ms)
+{
+    for (uint32_t i = 0; i < ms * 10; ++i) {
+        now += 100;
+        vfd->set_time(now);
+        spindle->poll(now);
+    }
+}
+
+static void send(const char *line)
+{
+    Gcode gc(line, &StreamOutput::NullStream);
+    THEKERNEL->call_event(ON_GCODE_RECEIVED, &gc);
+}
+
+SETUP(HuanyangSpindleControl)
+{
+    now= 0;
+    vfd= new SimulatedVFD(CHAR_US, LATENCY_US);
+    spindle= new HuanyangSpindleControl();
+    spindle->start(vfd, CHAR_US, POLL_INTERVAL_US);
+    spindle->register_for_event(ON_GCODE_RECEIVED);
+}
+
+TEARDOWN(HuanyangSpindleControl)
+{
+    test_kernel_unregister(spindle);
+    delete spindle->master;
+    delete spindle;
+    delete vfd;
+
+    test_kernel_teardown();
+}
+
+TESTF(HuanyangSpindleControl,m3_does_not_wait_for_the_vfd)
+{
+    send("M3 S12000");
+
+    // nothing has been sent yet, it goes out from the idle loop
+    ASSERT_EQUALS(0, vfd->get_requests());
+    ASSERT_TRUE(!spindle->master->is_idle());
+
+    // on, then the speed
+    uint32_t start= now;
+    while(!vfd->is_running() && now - start < 100000) idle(spindle, vfd, 1);
+    printf("Spindle running %lu ms after M3\n", (unsigned long)(now - start) / 1000);
+    ASSERT_TRUE(vfd->is_running());
+    ASSERT_TRUE(now - start < 20000);
+
+    idle(spindle, vfd, 200);
+    ASSERT_EQUALS(20000, vfd->get_frequency());
+    ASSERT_EQUALS(0, vfd->get_bad_requests());
+}
+
+TESTF(HuanyangSpindleControl,polls_speed_in_background)
+{
+    ASSERT_EQUALS(-1, spindle->get_current_rpm());
+
+    send("M3 S12000");
+    idle(spindle, vfd, 1000);
+    ASSERT_EQUALS(12000, spindle->get_current_rpm());
+
+    send("M5");
+    idle(spindle, vfd, 1000);
+    ASSERT_TRUE(!vfd->is_running());
+    ASSERT_EQUALS(0, spindle->get_current_rpm());
+    ASSERT_EQUALS(0, (int)spindle->master->get_failures());
+}
+
+TESTF(HuanyangSpindleControl,retries_lost_answer)
+{
+    vfd->drop(1);
+    send("M3 S6000");
+    idle(spindle, vfd, 1000);
+
+    // the first request was lost so it was sent again
+    ASSERT_TRUE(vfd->is_running());
+    ASSERT_EQUALS(10000, vfd->get_frequency());
+    ASSERT_EQUALS(1, (int)spindle->master->get_retries());
+    ASSERT_EQUALS(0, (int)spindle->master->get_failures());
+}
+
+TESTF(HuanyangSpindleControl,retries_corrupt_answer)
+{
+    vfd->corrupt(1);
+    send("M3 S6000");
+    idle(spindle, vfd, 1000);
+
+    ASSERT_TRUE(vfd->is_running());
+    ASSERT_EQUALS(1, (int)spindle->master->get_retries());
+    ASSERT_EQUALS(0, (int)spindle->master->get_failures());
+    ASSERT_EQUALS(6000, spindle->get_current_rpm());
+}
+
+TESTF(HuanyangSpindleControl,gives_up_and_recovers)
+{
+    // a dead VFD fails every request after the retries and the queue keeps moving
+    vfd->drop(1000);
+    send("M3 S6000");
+    idle(spindle, vfd, 3000);
+    ASSERT_TRUE(spindle->master->get_failures() >= 2);
+    ASSERT_EQUALS(-1, spindle->get_current_rpm());
+
+    // then it comes back
+    vfd->drop(0);
+    send("M3 S6000");
+    idle(spindle, vfd, 1000);
+    ASSERT_TRUE(vfd->is_running());
+    ASSERT_EQUALS(6000, spindle->get_current_rpm());
+}
+
+TESTF(HuanyangSpindleControl,m4_reverses_running_spindle)
+{
+    send("M3 S6000");
+    idle(spindle, vfd, 500);
+    ASSERT_TRUE(vfd->is_running());
+    ASSERT_TRUE(!vfd->is_reversed());
+
+    // as rigid tapping does at the bottom of the hole
+    send("M4");
+    idle(spindle, vfd, 500);
+    ASSERT_TRUE(vfd->is_running());
+    ASSERT_TRUE(vfd->is_reversed());
+
+    send("M3");
+    idle(spindle, vfd, 500);
+    ASSERT_TRUE(!vfd->is_reversed());
+    ASSERT_EQUALS(0, vfd->get_bad_requests());
+}
@@ -33,6 +33,7 @@ SETUP(Switch)
 TEARDOWN(Switch)
 {
     // delete the module
+    test_kernel_unregister(ts);
     delete ts;
 
     // have kernel reset to a clean state
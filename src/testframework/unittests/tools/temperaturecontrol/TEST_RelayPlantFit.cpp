@@ -0,0 +1,101 @@
+#include "RelayPlantFit.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#include "easyunit/test.h"
+
+// first order plus dead time heater, output is in pwm units like the autotuner uses
+struct FOPDTPlant {
+    static const int max_delay= 1024;
+    float gain, time_constant, ambient, y;
+    float delay[max_delay];
+    int n_delay, head;
+    uint32_t seed;
+
+    FOPDTPlant(float g, float tc, float dead_time, float dt) : gain(g), time_constant(tc), ambient(25), y(0), head(0), seed(1)
+    {
+        n_delay= dead_time / dt;
+        for (int i = 0; i < n_delay; ++i) delay[i]= 0;
+    }
+
+    void step(float u, float dt)
+    {
+        if(n_delay > 0) {
+            float d= delay[head];
+            delay[head]= u;
+            head= (head + 1) % n_delay;
+            u= d;
+        }
+        y += (gain * u - y) / time_constant * dt;
+    }
+
+    // ±0.1°C of noise
+    float read()
+    {
+        seed= seed * 1103515245 + 12345;
+        return ambient + y + ((int)((seed >> 16) % 201) - 100) / 1000.0F;
+    }
+};
+
+static const float dt= 0.05F;
+
+static void run_relay(RelayPlantFit &fit, FOPDTPlant &p, int max_cycles)
+{
+    while(!fit.is_converged() && fit.get_cycles() < max_cycles) {
+        p.step(fit.update(p.read(), dt), dt);
+    }
+}
+
+TEST(RelayPlantFit,hotend_converges_early)
+{
+    FOPDTPlant p(1.5F, 150, 6, dt);
+    RelayPlantFit fit(25, 200, 255, 0.5F);
+    run_relay(fit, p, 8);
+
+    ASSERT_TRUE(fit.is_converged());
+    ASSERT_TRUE(fit.get_cycles() <= 3);
+    ASSERT_TRUE(fabsf(fit.get_gain() - 1.5F) < 0.075F);
+    ASSERT_TRUE(fabsf(fit.get_time_constant() - 150) < 7.5F);
+    ASSERT_TRUE(fabsf(fit.get_dead_time() - 6) < 1.2F);
+}
+
+TEST(RelayPlantFit,bed_converges_early)
+{
+    FOPDTPlant p(0.4F, 600, 20, dt);
+    RelayPlantFit fit(25, 100, 255, 0.5F);
+    run_relay(fit, p, 8);
+
+    ASSERT_TRUE(fit.is_converged());
+    ASSERT_TRUE(fit.get_cycles() <= 3);
+    ASSERT_TRUE(fabsf(fit.get_gain() - 0.4F) < 0.02F);
+    ASSERT_TRUE(fabsf(fit.get_time_constant() - 600) < 30);
+    ASSERT_TRUE(fabsf(fit.get_dead_time() - 20) < 4);
+}
+
+TEST(RelayPlantFit,rules)
+{
+    FOPDTPlant p(1.5F, 150, 6, dt);
+    RelayPlantFit fit(25, 200, 255, 0.5F);
+
+    float kp, ki, kd;
+    ASSERT_TRUE(!fit.get_gains(RelayPlantFit::CLASSIC_PID, kp, ki, kd));
+    ASSERT_TRUE(!fit.get_gains(RelayPlantFit::IMC, kp, ki, kd));
+
+    run_relay(fit, p, 8);
+
+    // classic is the same Ziegler-Nichols calculation the autotuner always did
+    ASSERT_TRUE(fit.get_gains(RelayPlantFit::CLASSIC_PID, kp, ki, kd));
+    float ku= fit.get_ultimate_gain(), pu= fit.get_ultimate_period();
+    ASSERT_TRUE(fabsf(kp - 0.6F * ku) < 0.001F * kp);
+    ASSERT_TRUE(fabsf(ki - 1.2F * ku / pu) < 0.001F * ki);
+    ASSERT_TRUE(fabsf(kd - 0.075F * ku * pu) < 0.001F * kd);
+
+    // less aggressive rules give lower gains
+    float kp2, ki2, kd2;
+    ASSERT_TRUE(fit.get_gains(RelayPlantFit::NO_OVERSHOOT, kp2, ki2, kd2));
+    ASSERT_TRUE(kp2 < kp && ki2 < ki);
+
+    ASSERT_TRUE(fit.get_gains(RelayPlantFit::IMC, kp, ki, kd));
+    ASSERT_TRUE(kp > 0 && ki > 0 && kd > 0);
+}
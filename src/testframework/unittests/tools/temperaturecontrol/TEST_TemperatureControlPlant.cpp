@@ -0,0 +1,239 @@
+#include "TemperatureControl.h"
+#include "PID_Autotuner.h"
+#include "ThermalPlant.h"
+#include "Kernel.h"
+#include "checksumm.h"
+#include "utils.h"
+#include "Test_kernel.h"
+#include "StreamOutput.h"
+#include "Gcode.h"
+
+#include <stdio.h>
+
+#include "easyunit/test.h"
+
+// closed loop tests of TemperatureControl on a simulated heater, they print the measured response so controller
+// changes can be compared, and assert limits a little looser than the current controllers achieve
+
+DECLARE(TemperatureControlPlant)
+    TemperatureControl *tc;
+    ThermalPlant *plant;
+END_DECLARE
+
+SETUP(TemperatureControlPlant)
+{
+    tc= nullptr;
+    plant= nullptr;
+}
+
+TEARDOWN(TemperatureControlPlant)
+{
+    if(tc != nullptr) {
+        test_kernel_unregister(tc);
+        // this also deletes the plant as it is the sensor
+        delete tc;
+    }
+
+    test_kernel_teardown();
+}
+
+// the sensor type is not one TemperatureControl knows so it makes a dummy which the plant then replaces
+#define HOTEND_CONFIG "\
+temperature_control.hotend.enable true \n\
+temperature_control.hotend.designator T \n\
+temperature_control.hotend.sensor simulated \n\
+temperature_control.hotend.heater_pin 2.7 \n\
+temperature_control.hotend.max_temp 300 \n\
+temperature_control.hotend.runaway_range 20 \n\
+temperature_control.hotend.runaway_heating_timeout 120 \n\
+"
+
+const static char default_config[]= HOTEND_CONFIG;
+
+const static char tuned_pid_config[]= HOTEND_CONFIG "\
+temperature_control.hotend.p_factor 25 \n\
+temperature_control.hotend.i_factor 1.0 \n\
+temperature_control.hotend.d_factor 120 \n\
+";
+
+const static char bang_bang_config[]= HOTEND_CONFIG "\
+temperature_control.hotend.bang_bang true \n\
+temperature_control.hotend.hysteresis 2 \n\
+";
+
+// the model matches the plant the tests use
+const static char model_config[]= HOTEND_CONFIG "\
+temperature_control.hotend.use_model true \n\
+temperature_control.hotend.model_gain 3.0 \n\
+temperature_control.hotend.model_time_constant 100 \n\
+temperature_control.hotend.model_dead_time 4 \n\
+temperature_control.hotend.model_ambient 20 \n\
+";
+
+// a 3°C/s hotend with a 100s time constant and a sensor lagging 4s behind the block, as used in all these tests
+static ThermalPlant *make_plant()
+{
+    return new ThermalPlant(3.0F, 100, 4);
+}
+
+static TemperatureControl *load(const char *config, size_t size, ThermalPlant *plant)
+{
+    test_kernel_setup_config(config, &config[size]);
+    TemperatureControl *tc= new TemperatureControl(get_checksum("hotend"), 0);
+    tc->on_module_loaded();
+    plant->attach(tc);
+    // get a first reading in
+    plant->run(1);
+    return tc;
+}
+
+static void report(const char *name, ThermalPlant *plant)
+{
+    printf("%s: settled in %1.1f s, overshoot %1.2f°C\n", name, plant->get_settling_time(), plant->get_overshoot());
+}
+
+TESTF(TemperatureControlPlant,pid_default_heat_up)
+{
+    plant= make_plant();
+    tc= load(default_config, sizeof(default_config), plant);
+
+    plant->track(200, 2);
+    tc->set_desired_temperature(200);
+    plant->run(400);
+    report("PID defaults", plant);
+
+    ASSERT_TRUE(!plant->is_halted());
+    ASSERT_TRUE(plant->get_settling_time() >= 0 && plant->get_settling_time() < 300);
+    ASSERT_TRUE(plant->get_overshoot() < 10);
+}
+
+TESTF(TemperatureControlPlant,pid_tuned_heat_up)
+{
+    plant= make_plant();
+    tc= load(tuned_pid_config, sizeof(tuned_pid_config), plant);
+    plant->set_noise(0.2F);
+
+    plant->track(200, 2);
+    tc->set_desired_temperature(200);
+    plant->run(300);
+    report("PID tuned", plant);
+
+    ASSERT_TRUE(!plant->is_halted());
+    ASSERT_TRUE(plant->get_settling_time() >= 0 && plant->get_settling_time() < 150);
+    ASSERT_TRUE(plant->get_overshoot() < 6);
+}
+
+TESTF(TemperatureControlPlant,bang_bang_holds_band)
+{
+    plant= make_plant();
+    tc= load(bang_bang_config, sizeof(bang_bang_config), plant);
+
+    tc->set_desired_temperature(200);
+    plant->run(150);
+
+    // once there it should stay within a few degrees of the hysteresis
+    plant->track(200, 6);
+    plant->run(150);
+    printf("Bang bang: peak %1.2f°C over target\n", plant->get_overshoot());
+
+    ASSERT_TRUE(!plant->is_halted());
+    ASSERT_TRUE(plant->get_settling_time() == 0);
+}
+
+TESTF(TemperatureControlPlant,model_heat_up)
+{
+    plant= make_plant();
+    tc= load(model_config, sizeof(model_config), plant);
+
+    plant->track(200, 2);
+    tc->set_desired_temperature(200);
+    plant->run(300);
+    report("Model", plant);
+
+    ASSERT_TRUE(!plant->is_halted());
+    ASSERT_TRUE(plant->get_settling_time() >= 0 && plant->get_settling_time() < 130);
+    ASSERT_TRUE(plant->get_overshoot() < 2);
+}
+
+TESTF(TemperatureControlPlant,autotune)
+{
+    plant= make_plant();
+    tc= load(default_config, sizeof(default_config), plant);
+
+    PID_Autotuner autotuner;
+    plant->attach(&autotuner);
+    Gcode gc("M303 E0 S200", &StreamOutput::NullStream);
+    autotuner.on_gcode_received(&gc);
+
+    // tune then let it cool back down
+    float start= plant->get_time();
+    plant->run(800);
+    ASSERT_TRUE(!plant->is_halted());
+    ASSERT_TRUE(plant->get_sensor_temperature() < 30);
+    printf("Autotune: peak block temperature %1.1f°C in %1.0f s\n", plant->get_max_heater_temperature(), plant->get_time() - start);
+
+    // the tuned gains should do much better than the defaults
+    plant->track(200, 2);
+    tc->set_desired_temperature(200);
+    plant->run(300);
+    report("PID autotuned", plant);
+
+    ASSERT_TRUE(plant->get_settling_time() >= 0 && plant->get_settling_time() < 150);
+    ASSERT_TRUE(plant->get_overshoot() < 5);
+}
+
+TESTF(TemperatureControlPlant,heater_failure_times_out)
+{
+    plant= make_plant();
+    tc= load(default_config, sizeof(default_config), plant);
+    plant->set_fault(ThermalPlant::HEATER_FAILED);
+
+    float start= plant->get_time();
+    tc->set_desired_temperature(200);
+    plant->run(300);
+
+    ASSERT_TRUE(plant->is_halted());
+    float latency= plant->get_halt_time() - start;
+    printf("Heater failure: halted after %1.1f s\n", latency);
+    // checked every 8 seconds, so up to 16 seconds later than the 120 second timeout
+    ASSERT_TRUE(latency > 120 && latency <= 136 + 1);
+}
+
+TESTF(TemperatureControlPlant,detached_sensor_runaway)
+{
+    plant= make_plant();
+    tc= load(tuned_pid_config, sizeof(tuned_pid_config), plant);
+
+    tc->set_desired_temperature(200);
+    plant->run(200);
+    ASSERT_TRUE(!plant->is_halted());
+
+    float start= plant->get_time();
+    plant->set_fault(ThermalPlant::SENSOR_DETACHED);
+    plant->run(120);
+
+    ASSERT_TRUE(plant->is_halted());
+    float latency= plant->get_halt_time() - start;
+    printf("Detached sensor: halted after %1.1f s, block reached %1.1f°C\n", latency, plant->get_max_heater_temperature());
+    // two 8 second checks outside runaway_range after the reading drops 20°C
+    ASSERT_TRUE(latency < 20);
+}
+
+TESTF(TemperatureControlPlant,open_sensor_halts)
+{
+    plant= make_plant();
+    tc= load(tuned_pid_config, sizeof(tuned_pid_config), plant);
+
+    tc->set_desired_temperature(200);
+    plant->run(100);
+
+    float start= plant->get_time();
+    plant->set_fault(ThermalPlant::SENSOR_OPEN);
+    plant->run(5);
+
+    ASSERT_TRUE(plant->is_halted());
+    float latency= plant->get_halt_time() - start;
+    printf("Open sensor: halted after %1.2f s\n", latency);
+    // on the first bad reading
+    ASSERT_TRUE(latency < 0.1F);
+}
@@ -0,0 +1,140 @@
+#include "ThermalModel.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#include "easyunit/test.h"
+
+// simulated heater with the same structure as ThermalModel, plus some sensor noise
+struct Plant {
+    float gain, time_constant, dead_time, fan_loss, ambient;
+    float heater, sensor, fan;
+    uint32_t seed;
+
+    Plant(float g, float tc, float dt) : gain(g), time_constant(tc), dead_time(dt), fan_loss(0.5F), ambient(25), heater(25), sensor(25), fan(0), seed(1) {}
+
+    void step(float output, float dt)
+    {
+        heater += (gain * output - (1.0F + fan_loss * fan) * (heater - ambient) / time_constant) * dt;
+        sensor += (heater - sensor) * dt / dead_time;
+    }
+
+    // ±0.1°C of noise
+    float read()
+    {
+        seed= seed * 1103515245 + 12345;
+        return sensor + ((int)((seed >> 16) % 201) - 100) / 1000.0F;
+    }
+};
+
+static const float dt= 0.05F; // the default 20 readings per second
+
+// runs the tuner on the plant, the returned model is invalid if the tune failed
+static ThermalModel tune(Plant &p, float target)
+{
+    ThermalModelTuner tuner(p.ambient, target, 1.0F);
+    while(tuner.get_state() != ThermalModelTuner::DONE && tuner.get_state() != ThermalModelTuner::FAILED) {
+        p.step(tuner.update(p.read(), dt), dt);
+    }
+
+    ThermalModel m;
+    if(tuner.get_state() == ThermalModelTuner::DONE) tuner.get_result(m);
+    return m;
+}
+
+TEST(ThermalModel,tune_identifies_plant)
+{
+    Plant hotend(2.5F, 150, 6);
+    ThermalModel m= tune(hotend, 200);
+    ASSERT_TRUE(m.is_valid());
+    ASSERT_TRUE(fabsf(m.gain - 2.5F) < 0.25F);
+    ASSERT_TRUE(fabsf(m.time_constant - 150) < 30);
+    ASSERT_TRUE(fabsf(m.dead_time - 6) < 2);
+
+    Plant bed(0.5F, 600, 20);
+    m= tune(bed, 100);
+    ASSERT_TRUE(m.is_valid());
+    ASSERT_TRUE(fabsf(m.gain - 0.5F) < 0.05F);
+    ASSERT_TRUE(fabsf(m.time_constant - 600) < 120);
+    ASSERT_TRUE(fabsf(m.dead_time - 20) < 5);
+}
+
+// heat up with a tuned model, it should get there at close to full power speed and settle without overshoot
+struct heat_up_result {
+    float reached;      // time to get within 1°C of the target
+    float full_power;   // the same at full power with no lag, the sensor lag then adds a few dead times
+    float overshoot;
+    float final_error;
+};
+
+static heat_up_result heat_up(float gain, float time_constant, float dead_time, float target)
+{
+    Plant p(gain, time_constant, dead_time);
+    ThermalModel m= tune(p, target);
+
+    Plant q(gain, time_constant, dead_time);
+    m.reset(q.read());
+    heat_up_result r;
+    float max_temp= 0;
+    r.reached= 1e6F;
+    for (float t = 0; t < 900; t += dt) {
+        q.step(m.update(q.read(), target, dt, 1.0F), dt);
+        if(q.sensor > max_temp) max_temp= q.sensor;
+        if(r.reached > t && q.sensor >= target - 1) r.reached= t;
+    }
+
+    r.full_power= -time_constant * logf(1.0F - (target - 1 - q.ambient) / (gain * time_constant));
+    r.overshoot= max_temp - target;
+    r.final_error= fabsf(q.sensor - target);
+    return r;
+}
+
+TEST(ThermalModel,heat_up_without_overshoot)
+{
+    // hotend
+    heat_up_result r= heat_up(2.5F, 150, 6, 200);
+    ASSERT_TRUE(r.reached < r.full_power + 5 * 6);
+    ASSERT_TRUE(r.overshoot < 1.0F);
+    ASSERT_TRUE(r.final_error < 0.2F);
+
+    // fast hotend
+    r= heat_up(4.0F, 100, 3, 250);
+    ASSERT_TRUE(r.reached < r.full_power + 5 * 3);
+    ASSERT_TRUE(r.overshoot < 1.0F);
+    ASSERT_TRUE(r.final_error < 0.2F);
+
+    // bed
+    r= heat_up(0.5F, 600, 20, 100);
+    ASSERT_TRUE(r.reached < r.full_power + 5 * 20);
+    ASSERT_TRUE(r.overshoot < 1.0F);
+    ASSERT_TRUE(r.final_error < 0.2F);
+}
+
+// the fan feed forward should keep the temperature closer to the target when the fan turns on
+static float fan_droop(bool feed_forward)
+{
+    Plant p(2.5F, 150, 6);
+    ThermalModel m= tune(p, 200);
+    m.fan_loss= feed_forward ? p.fan_loss : 0;
+
+    Plant q(2.5F, 150, 6);
+    m.reset(q.read());
+    for (float t = 0; t < 600; t += dt) q.step(m.update(q.read(), 200, dt, 1.0F), dt);
+
+    q.fan= 1;
+    m.set_feed_forward(1, 0);
+    float worst= 0;
+    for (float t = 0; t < 300; t += dt) {
+        q.step(m.update(q.read(), 200, dt, 1.0F), dt);
+        if(fabsf(q.sensor - 200) > worst) worst= fabsf(q.sensor - 200);
+    }
+    return worst;
+}
+
+TEST(ThermalModel,fan_feed_forward)
+{
+    float with= fan_droop(true);
+    float without= fan_droop(false);
+    ASSERT_TRUE(with < 1.0F);
+    ASSERT_TRUE(with < without / 2);
+}
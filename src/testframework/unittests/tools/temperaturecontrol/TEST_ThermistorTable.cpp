@@ -0,0 +1,92 @@
+#include "ThermistorTable.h"
+#include "predefined_thermistors.h"
+#include "predefined_thermistor_tables.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include "easyunit/test.h"
+
+// the float math the table replaces, used as the reference
+static float beta_temperature(uint32_t adc, float beta, float r0, float t0, int r1, int r2)
+{
+    float r = ThermistorTable::adc_to_resistance(adc, r1, r2, PREDEFINED_THERMISTOR_TABLES_MAX_ADC);
+    return (1.0F / ((1.0F / (t0 + 273.15F)) + (logf(r / r0) / beta))) - 273.15F;
+}
+
+static float shh_temperature(uint32_t adc, float c1, float c2, float c3, int r1, int r2)
+{
+    float l = logf(ThermistorTable::adc_to_resistance(adc, r1, r2, PREDEFINED_THERMISTOR_TABLES_MAX_ADC));
+    return (1.0F / (c1 + c2 * l + c3 * powf(l, 3))) - 273.15F;
+}
+
+// worst error against the reference over the ADC range that reads 0°C to 350°C, the tables are within 0.3°C
+template<typename F>
+static float worst_error(const thermistor_table_entry_t *table, F reference)
+{
+    float worst = 0;
+    for (uint32_t adc = 1; adc < PREDEFINED_THERMISTOR_TABLES_MAX_ADC; ++adc) {
+        float t = reference(adc);
+        if(t < 0.0F || t > 350.0F) continue;
+        float e = fabsf(ThermistorTable::lookup(table, adc) - t);
+        if(e > worst) worst = e;
+    }
+    return worst;
+}
+
+TEST(ThermistorTable,beta_accuracy)
+{
+    thermistor_table_entry_t table[THERMISTOR_TABLE_SIZE];
+    for (auto& i : predefined_thermistors_beta) {
+        ThermistorTable::build_beta(table, i.beta, i.r0, i.t0, i.r1, i.r2, PREDEFINED_THERMISTOR_TABLES_MAX_ADC);
+        float e = worst_error(table, [&i](uint32_t adc) { return beta_temperature(adc, i.beta, i.r0, i.t0, i.r1, i.r2); });
+        printf("%s beta worst error %f\n", i.name, e);
+        ASSERT_TRUE(e < 0.3F);
+    }
+}
+
+TEST(ThermistorTable,steinhart_hart_accuracy)
+{
+    thermistor_table_entry_t table[THERMISTOR_TABLE_SIZE];
+    for (auto& i : predefined_thermistors) {
+        ThermistorTable::build_steinhart_hart(table, i.c1, i.c2, i.c3, i.r1, i.r2, PREDEFINED_THERMISTOR_TABLES_MAX_ADC);
+        float e = worst_error(table, [&i](uint32_t adc) { return shh_temperature(adc, i.c1, i.c2, i.c3, i.r1, i.r2); });
+        printf("%s S/H worst error %f\n", i.name, e);
+        ASSERT_TRUE(e < 0.3F);
+    }
+}
+
+TEST(ThermistorTable,predefined_tables_match_built_tables)
+{
+    thermistor_table_entry_t table[THERMISTOR_TABLE_SIZE];
+    int n = 0;
+    for (auto& i : predefined_thermistors) {
+        ThermistorTable::build_steinhart_hart(table, i.c1, i.c2, i.c3, i.r1, i.r2, PREDEFINED_THERMISTOR_TABLES_MAX_ADC);
+        for (int j = 0; j < THERMISTOR_TABLE_SIZE; ++j) {
+            ASSERT_TRUE(abs(table[j].adc - predefined_thermistors_tables[n][j].adc) <= 1);
+            ASSERT_TRUE(abs(table[j].temp - predefined_thermistors_tables[n][j].temp) <= 2);
+        }
+        ++n;
+    }
+
+    n = 0;
+    for (auto& i : predefined_thermistors_beta) {
+        ThermistorTable::build_beta(table, i.beta, i.r0, i.t0, i.r1, i.r2, PREDEFINED_THERMISTOR_TABLES_MAX_ADC);
+        for (int j = 0; j < THERMISTOR_TABLE_SIZE; ++j) {
+            ASSERT_TRUE(abs(table[j].adc - predefined_thermistors_beta_tables[n][j].adc) <= 1);
+            ASSERT_TRUE(abs(table[j].temp - predefined_thermistors_beta_tables[n][j].temp) <= 2);
+        }
+        ++n;
+    }
+}
+
+TEST(ThermistorTable,monotonic)
+{
+    const thermistor_table_entry_t *table = predefined_thermistors_tables[0];
+    float last = ThermistorTable::lookup(table, 1);
+    for (uint32_t adc = 2; adc < PREDEFINED_THERMISTOR_TABLES_MAX_ADC; ++adc) {
+        float t = ThermistorTable::lookup(table, adc);
+        ASSERT_TRUE(t <= last);
+        last = t;
+    }
+}
@@ -0,0 +1,119 @@
+#include "ThermalPlant.h"
+#include "TemperatureControl.h"
+#include "PID_Autotuner.h"
+#include "Test_kernel.h"
+
+#include <math.h>
+
+// the sensor of a detached probe cools much slower than it followed the block
+#define DETACHED_LAG 10.0F
+
+ThermalPlant::ThermalPlant(float gain, float time_constant, float sensor_lag, float ambient)
+{
+    this->gain= gain;
+    this->time_constant= time_constant;
+    this->sensor_lag= sensor_lag;
+    this->ambient= ambient;
+    tc= nullptr;
+    autotuner= nullptr;
+    noise= 0;
+    fault= NO_FAULT;
+    heater= sensor= max_heater= ambient;
+    time= 0;
+    ticks= 0;
+    seed= 1;
+    target= band= 0;
+    track_time= last_outside= 0;
+    max_reading= ambient;
+    halt_time= 0;
+    tracking= false;
+    halted= false;
+}
+
+float ThermalPlant::get_temperature()
+{
+    if(fault == SENSOR_OPEN) return INFINITY;
+    if(noise == 0) return sensor;
+
+    seed= seed * 1103515245 + 12345;
+    return sensor + noise * (((int)((seed >> 16) % 2001) - 1000) / 1000.0F);
+}
+
+void ThermalPlant::attach(TemperatureControl *tc)
+{
+    this->tc= tc;
+    delete tc->sensor;
+    tc->sensor= this;
+
+    // the controller calls ON_HALT on a runaway or a bad reading, note when it happened
+    test_kernel_trap_event(ON_HALT, [this](void *arg) {
+        if(arg == nullptr && !this->halted) {
+            this->halted= true;
+            this->halt_time= this->time;
+        }
+    });
+}
+
+void ThermalPlant::track(float target, float band)
+{
+    this->target= target;
+    this->band= band;
+    track_time= last_outside= time;
+    max_reading= sensor;
+    tracking= true;
+}
+
+float ThermalPlant::get_settling_time() const
+{
+    if(fabsf(sensor - target) > band) return -1;
+    return last_outside - track_time;
+}
+
+void ThermalPlant::step(float dt)
+{
+    // the heater output as a fraction of full power, set() drives the pin directly so read it back then
+    int pwm= tc->heater_pin.get_pwm();
+    if(pwm < 0) pwm= tc->heater_pin.get() ? PID_PWM_MAX - 1 : 0;
+    float output= (fault == HEATER_FAILED) ? 0 : pwm / (float)(PID_PWM_MAX - 1);
+
+    heater += (gain * output - (heater - ambient) / time_constant) * dt;
+    if(fault == SENSOR_DETACHED) {
+        sensor += (ambient - sensor) * dt / DETACHED_LAG;
+    } else {
+        sensor += (heater - sensor) * dt / sensor_lag;
+    }
+    time += dt;
+
+    if(heater > max_heater) max_heater= heater;
+    if(tracking) {
+        if(sensor > max_reading) max_reading= sensor;
+        if(fabsf(sensor - target) > band) last_outside= time;
+    }
+}
+
+void ThermalPlant::run(float seconds, std::function<void()> every_second)
+{
+    uint32_t rate= tc->readings_per_second;
+    uint32_t period_us= 1000000 / rate;
+    float dt= 1.0F / rate;
+    uint32_t n= roundf(seconds * rate);
+
+    for (uint32_t i = 0; i < n && !halted; ++i) {
+        step(dt);
+
+        ++ticks;
+        tc->thermistor_read_tick(ticks * period_us);
+        tc->on_main_loop(nullptr);
+
+        // the autotuner runs on its own 20Hz tick
+        if(autotuner != nullptr && (ticks * 20) / rate != ((ticks - 1) * 20) / rate) {
+            autotuner->on_tick(0);
+            autotuner->on_idle(nullptr);
+        }
+
+        if(ticks % rate == 0) {
+            tc->on_second_tick(nullptr);
+            if(every_second) every_second();
+        }
+    }
+}
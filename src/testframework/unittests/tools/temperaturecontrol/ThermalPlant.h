@@ -0,0 +1,87 @@
+#pragma once
+
+#include "TempSensor.h"
+
+#include <functional>
+#include <stdint.h>
+
+class TemperatureControl;
+class PID_Autotuner;
+
+// Simulated heater for running a TemperatureControl in closed loop without hardware. It has the same structure as ThermalModel
+//   dH/dt = gain * output - (H - ambient) / time_constant
+//   dS/dt = (H - S) / sensor_lag
+// where output is read back from the controller's heater pin. It replaces the controller's sensor, and drives the
+// controller the way the firmware does, a reading tick at readings_per_second, the main loop and the second tick.
+// Faults can be injected at any time, and the response to a target change is measured for settling time and overshoot
+class ThermalPlant : public TempSensor
+{
+    public:
+        enum FAULT {
+            NO_FAULT,
+            SENSOR_OPEN,        // reads as infinity, like an open thermistor
+            SENSOR_DETACHED,    // fell out of the block, reads the block cooling towards ambient
+            HEATER_FAILED       // heater gets no power
+        };
+
+        ThermalPlant(float gain, float time_constant, float sensor_lag, float ambient= 20);
+
+        float get_temperature();
+
+        // becomes the controller's sensor, the controller owns it after this and deletes it
+        void attach(TemperatureControl *tc);
+        // the autotuner is ticked at 20Hz like the firmware does
+        void attach(PID_Autotuner *autotuner) { this->autotuner= autotuner; }
+
+        // uniform noise of ± amplitude °C on the readings
+        void set_noise(float amplitude) { noise= amplitude; }
+        void set_fault(FAULT f) { fault= f; }
+
+        // runs the plant and the controller for the given time, stops at a halt. every_second is called after the second tick
+        void run(float seconds, std::function<void()> every_second= nullptr);
+
+        // starts measuring the response to target, band is the ± error that counts as settled
+        void track(float target, float band);
+
+        float get_time() const { return time; }
+        float get_heater_temperature() const { return heater; }
+        float get_sensor_temperature() const { return sensor; }
+        float get_max_heater_temperature() const { return max_heater; }
+
+        // seconds from track() until the reading stayed within the band, negative if it is still outside it
+        float get_settling_time() const;
+        float get_overshoot() const { return max_reading - target; }
+
+        bool is_halted() const { return halted; }
+        float get_halt_time() const { return halt_time; }
+
+    private:
+        void step(float dt);
+
+        TemperatureControl *tc;
+        PID_Autotuner *autotuner;
+
+        float gain;
+        float time_constant;
+        float sensor_lag;
+        float ambient;
+        float noise;
+        FAULT fault;
+
+        float heater;
+        float sensor;
+        float time;
+        uint32_t ticks;
+        uint32_t seed;
+
+        float target;
+        float band;
+        float track_time;
+        float last_outside;
+        float max_reading;
+        float max_heater;
+        float halt_time;
+
+        bool tracking;
+        bool halted;
+};
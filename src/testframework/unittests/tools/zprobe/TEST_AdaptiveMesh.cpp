@@ -0,0 +1,129 @@
+#include "AdaptiveMesh.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include "easyunit/test.h"
+
+// adaptive meshes of synthetic beds, 9x9 nodes over 200 x 200mm. They print how many nodes were probed and the worst
+// error of the filled in grid against the bed so changes to the fit can be compared
+
+#define N 9
+#define SIZE 200.0F
+#define TOLERANCE 0.02F
+
+typedef float (*bed_t)(float x, float y);
+
+static float tilted(float x, float y) { return 0.001F * x - 0.0005F * y + 0.1F; }
+static float bowl(float x, float y) { return 0.00002F * ((x - 100) * (x - 100) + (y - 100) * (y - 100)); }
+static float wavy(float x, float y) { return 0.05F * sinf(x / 40) * cosf(y / 50); }
+// flat with a 0.3mm bump about 10mm wide
+static float bump(float x, float y) { return 0.3F * expf(-((x - 150) * (x - 150) + (y - 50) * (y - 50)) / (2 * 10 * 10)); }
+
+static float node_x(int node) { return (node % N) * SIZE / (N - 1); }
+static float node_y(int node) { return (node / N) * SIZE / (N - 1); }
+
+// probes the bed as the mesh asks, returns the worst error of the grid
+static float mesh_bed(bed_t bed, int stride, AdaptiveMesh *&mesh, float *grid)
+{
+    mesh= new AdaptiveMesh(grid, N, N, stride, TOLERANCE);
+    for (std::vector<int> nodes = mesh->next(); !nodes.empty(); nodes = mesh->next()) {
+        for (int n : nodes) mesh->set(n, bed(node_x(n), node_y(n)));
+    }
+    mesh->fill();
+
+    float worst= 0;
+    for (int n = 0; n < N * N; ++n) {
+        float e= fabsf(grid[n] - bed(node_x(n), node_y(n)));
+        if(e > worst) worst= e;
+    }
+    return worst;
+}
+
+static void report(const char *name, AdaptiveMesh *mesh, float error)
+{
+    printf("%s: probed %d of %d nodes, %d dense cells, worst error %1.4f mm\n", name, mesh->get_probes(), N * N, mesh->get_dense_cells(), error);
+}
+
+TEST(AdaptiveMesh,tilted_bed_is_exact)
+{
+    float grid[N * N];
+    AdaptiveMesh *mesh;
+    float error= mesh_bed(tilted, 2, mesh, grid);
+    report("Tilted", mesh, error);
+
+    // the 5x5 coarse grid and a check in each of its 16 cells
+    ASSERT_EQUALS(25 + 16, mesh->get_probes());
+    ASSERT_EQUALS(0, mesh->get_dense_cells());
+    ASSERT_TRUE(error < 0.0001F);
+    delete mesh;
+}
+
+TEST(AdaptiveMesh,bowl_is_exact)
+{
+    float grid[N * N];
+    AdaptiveMesh *mesh;
+    float error= mesh_bed(bowl, 2, mesh, grid);
+    report("Bowl", mesh, error);
+
+    ASSERT_EQUALS(0, mesh->get_dense_cells());
+    ASSERT_TRUE(error < 0.0001F);
+    delete mesh;
+}
+
+TEST(AdaptiveMesh,wavy_bed_within_tolerance)
+{
+    float grid[N * N];
+    AdaptiveMesh *mesh;
+    float error= mesh_bed(wavy, 2, mesh, grid);
+    report("Wavy", mesh, error);
+
+    ASSERT_TRUE(mesh->get_probes() < N * N);
+    ASSERT_TRUE(error <= TOLERANCE);
+    delete mesh;
+}
+
+TEST(AdaptiveMesh,bump_is_probed_densely)
+{
+    float grid[N * N];
+    AdaptiveMesh *mesh;
+    float error= mesh_bed(bump, 2, mesh, grid);
+    report("Bump", mesh, error);
+
+    // the four cells around the bump, and a couple more where the fit of the coarse nodes rings
+    ASSERT_TRUE(mesh->get_dense_cells() >= 4 && mesh->get_dense_cells() <= 6);
+    ASSERT_TRUE(mesh->get_probes() < N * N * 3 / 4);
+    ASSERT_TRUE(error <= TOLERANCE);
+
+    // the bump itself is on a node that was probed
+    int top= 6 + N * 2;
+    ASSERT_TRUE(fabsf(grid[top] - bump(node_x(top), node_y(top))) < 0.0001F);
+    delete mesh;
+}
+
+TEST(AdaptiveMesh,coarser_stride_with_uneven_edge)
+{
+    float grid[N * N];
+    AdaptiveMesh *mesh;
+    // grid lines at 0, 3, 6 and 8
+    float error= mesh_bed(bowl, 3, mesh, grid);
+    report("Bowl stride 3", mesh, error);
+
+    ASSERT_EQUALS(16 + 9, mesh->get_probes());
+    ASSERT_TRUE(error < 0.0001F);
+    delete mesh;
+}
+
+TEST(AdaptiveMesh,serpentine_order)
+{
+    float grid[N * N];
+    AdaptiveMesh mesh(grid, N, N, 2, TOLERANCE);
+    std::vector<int> nodes= mesh.next();
+
+    // the first row left to right then the next one back
+    ASSERT_EQUALS(25, (int)nodes.size());
+    ASSERT_EQUALS(0, nodes[0]);
+    ASSERT_EQUALS(8, nodes[4]);
+    ASSERT_EQUALS(8 + 2 * N, nodes[5]);
+    ASSERT_EQUALS(2 * N, nodes[9]);
+}